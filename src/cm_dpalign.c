@@ -1092,7 +1092,7 @@ cm_CYKInsideAlignHB(CM_t *cm, char *errbuf,  ESL_DSQ *dsq, int L, float size_lim
 {
   int      status;
   int      v,y,z;	/* indices for states  */
-  int      j,d,i,k;	/* indices in sequence dimensions */
+  int      j,d,i;	/* indices in sequence dimensions */
   float    sc;		/* a temporary variable holding a score */
   int      yoffset;	/* y=base+offset -- counter in child states that v can transit to */
   int      b;		/* best local begin state */
@@ -1104,16 +1104,14 @@ cm_CYKInsideAlignHB(CM_t *cm, char *errbuf,  ESL_DSQ *dsq, int L, float size_lim
   int      j_sdr;              /* j - sdr */
 
   /* indices used for handling band-offset issues, and in the depths of the DP recursion */
-  int      jp_v, jp_y, jp_z;   /* offset j index for states v, y, z */
+  int      jp_v;               /* offset j index for state v */
   int      jp_y_sdr;           /* jp_y - sdr */
   int      jn, jx;             /* current minimum/maximum j allowed */
   int      jpn, jpx;           /* minimum/maximum jp_v */
-  int      dp_v, dp_y;         /* d index for state v/y in alpha w/mem eff bands */
+  int      dp_v;               /* d index for state v in alpha w/mem eff bands */
   int      dn, dx;             /* current minimum/maximum d allowed */
   int      dp_y_sd;            /* dp_y - sd */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   int      Lp;                 /* L index also changes depending on state */
   float    tsc;                /* a transition score */
   int      yvalid_idx;         /* for keeping track of which children are valid */
@@ -1383,66 +1381,8 @@ cm_CYKInsideAlignHB(CM_t *cm, char *errbuf,  ESL_DSQ *dsq, int L, float size_lim
       y = cm->cfirst[v]; /* left  subtree */
       z = cm->cnum[v];   /* right subtree */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
-       */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-        /* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-
-	      if ((sc = alpha[y][jp_y-k][dp_y - k] + alpha[z][jp_z][kp_z]) 
-		  > alpha[v][jp_v][dp_v]) { 
-		alpha[v][jp_v][dp_v] = sc;
-		kshadow[v][jp_v][dp_v] = k;
-	      }
-	    }
-	  }
-	}
-      }
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c) */
+      cm_bif_HBMaxPlus(cp9b, v, y, z, alpha[v], kshadow[v], alpha[y], alpha[z], FALSE);
     } /* finished calculating deck v. */
          
     /* allow local begins, if nec */
@@ -1763,7 +1703,7 @@ cm_InsideAlignHB(CM_t *cm, char *errbuf, ESL_DSQ *dsq, int L, float size_limit,
 {
   int      status;
   int      v,y,z;	/* indices for states  */
-  int      j,d,i,k;	/* indices in sequence dimensions */
+  int      j,d,i;	/* indices in sequence dimensions */
   float    sc;		/* the final score */
   float    tsc;         /* a temporary variable holding a transition score */
   int      yoffset;	/* y=base+offset -- counter in child states that v can transit to */
@@ -1775,16 +1715,14 @@ cm_InsideAlignHB(CM_t *cm, char *errbuf, ESL_DSQ *dsq, int L, float size_limit,
 
   /* indices used for handling band-offset issues, and in the depths of the DP recursion */
   int     *yvalidA;            /* [0..MAXCONNECT-1] TRUE if v->yoffset is legal transition (within bands) */
-  int      jp_v, jp_y, jp_z;   /* offset j index for states v, y, z */
+  int      jp_v;               /* offset j index for state v */
   int      jp_y_sdr;           /* jp_y - sdr */
   int      jn, jx;             /* current minimum/maximum j allowed */
   int      jpn, jpx;           /* minimum/maximum jp_v */
-  int      dp_v, dp_y;         /* d index for state v/y in alpha w/mem eff bands */
+  int      dp_v;               /* d index for state v in alpha w/mem eff bands */
   int      dn, dx;             /* current minimum/maximum d allowed */
   int      dp_y_sd;            /* dp_y - sd */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   int      Lp;                 /* L also changes depending on state */
   int      yvalid_idx;         /* for keeping track of which children are valid */
   int      yvalid_ct;          /* for keeping track of which children are valid */
@@ -2011,63 +1949,8 @@ cm_InsideAlignHB(CM_t *cm, char *errbuf, ESL_DSQ *dsq, int L, float size_limit,
       y = cm->cfirst[v]; /* left  subtree */
       z = cm->cnum[v];   /* right subtree */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
-       */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	ESL_DASSERT1((j >= 0 && j <= L));
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-	/* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-
-	      alpha[v][jp_v][dp_v] = FLogsum(alpha[v][jp_v][dp_v], alpha[y][jp_y-k][dp_y - k] + alpha[z][jp_z][kp_z]); 
-	    }
-	  }
-	}
-      }
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c) */
+      cm_bif_HBLogsumPlus(cp9b, v, y, z, alpha[v], alpha[y], alpha[z], FALSE);
     }
       
     /* allow local begins, if nec */
@@ -0,0 +1,517 @@
+/* cm_dpbif.c
+ *
+ * Bifurcation kernels shared by the CYK and Inside DP scanning and
+ * alignment functions in cm_dpsearch.c, cm_dpsearch_trunc.c and
+ * cm_dpalign.c.
+ *
+ * For a B_st v with left child y (BEGL_S) and right child z
+ * (BEGR_S) every DP routine fills cell alpha[v][j][d] as the max
+ * (CYK) or logsum (Inside) over k of alpha[y][j-k][d-k] +
+ * alpha[z][j][k]. For multifurcating models (tRNA, RNaseP, SRP...)
+ * this O(W^3) term dominates the running time. The original loops
+ * were ordered j, d, k which reads a different row of y's deck for
+ * every k and can't be vectorized. The functions here reorder the
+ * loops as j, k, d: for a fixed k the y cells for consecutive d are
+ * contiguous in memory and the z cell is a constant, so the inner
+ * loop is a simple 'max-plus' or 'logsum-plus' of one row into
+ * another. In the non-banded scanners the d dimension is further
+ * split into tiles of CM_BIF_TILE cells to keep the v row resident
+ * in cache while the k loop streams over y's rows.
+ *
+ * For any given cell the k values are still visited in increasing
+ * order, so the results (including CYK shadow k values, where ties
+ * are broken in favor of the smallest k) are identical to those of
+ * the original loops.
+ *
+ * Contents:
+ *    1. Row kernels.
+ *    2. Scan matrix (CM_SCAN_MX) bifurcation functions.
+ *    3. HMM banded matrix bifurcation functions.
+ *    4. Benchmark driver.
+ *    5. Copyright and license information.
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************
+ */
+
+#include "esl_config.h"
+#include "p7_config.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "easel.h"
+
+#include "hmmer.h"
+
+#include "infernal.h"
+
+/*****************************************************************
+ * 1. Row kernels.
+ *****************************************************************/
+
+/* Function:  cm_bif_FMaxPlusRow()
+ *
+ * Purpose:   Max-plus update of a row: for i = 0..n-1 set
+ *            dst[i] = max(dst[i], src[i] + addsc). Vectorized with
+ *            SSE2 if available.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_FMaxPlusRow(float *dst, const float *src, float addsc, int n)
+{
+  int i = 0;
+#ifdef HAVE_SSE2
+  __m128 addv = _mm_set1_ps(addsc);
+  for (; i+4 <= n; i += 4)
+    _mm_storeu_ps(dst+i, _mm_max_ps(_mm_loadu_ps(dst+i), _mm_add_ps(_mm_loadu_ps(src+i), addv)));
+#endif
+  for (; i < n; i++)
+    dst[i] = ESL_MAX(dst[i], src[i] + addsc);
+}
+
+/* Function:  cm_bif_FMaxPlusRowShadow()
+ *
+ * Purpose:   Same as cm_bif_FMaxPlusRow() but also keeps a
+ *            shadow row: for i = 0..n-1, if src[i] + addsc > dst[i]
+ *            set dst[i] = src[i] + addsc and kshadow[i] = k.  A
+ *            strict '>' is used so that, as in the original CYK
+ *            alignment code, ties are won by the k that was
+ *            seen first.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_FMaxPlusRowShadow(float *dst, int *kshadow, const float *src, float addsc, int k, int n)
+{
+  int   i = 0;
+  float sc;
+#ifdef HAVE_SSE2
+  __m128  addv = _mm_set1_ps(addsc);
+  __m128i kv   = _mm_set1_epi32(k);
+  __m128  scv, dstv, mask;
+  __m128i shv, imask;
+  for (; i+4 <= n; i += 4) {
+    scv   = _mm_add_ps(_mm_loadu_ps(src+i), addv);
+    dstv  = _mm_loadu_ps(dst+i);
+    mask  = _mm_cmpgt_ps(scv, dstv);
+    imask = _mm_castps_si128(mask);
+    shv   = _mm_loadu_si128((__m128i *) (kshadow+i));
+    _mm_storeu_ps(dst+i, _mm_or_ps(_mm_and_ps(mask, scv), _mm_andnot_ps(mask, dstv)));
+    _mm_storeu_si128((__m128i *) (kshadow+i), _mm_or_si128(_mm_and_si128(imask, kv), _mm_andnot_si128(imask, shv)));
+  }
+#endif
+  for (; i < n; i++) {
+    if((sc = src[i] + addsc) > dst[i]) {
+      dst[i]     = sc;
+      kshadow[i] = k;
+    }
+  }
+}
+
+/* Function:  cm_bif_FLogsumPlusRow()
+ *
+ * Purpose:   Logsum-plus update of a row: for i = 0..n-1 set
+ *            dst[i] = FLogsum(dst[i], src[i] + addsc).
+ *
+ *            FLogsum() is a table lookup so this isn't vectorized,
+ *            but the contiguous access pattern is still much
+ *            friendlier to the cache than the original d, k order.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_FLogsumPlusRow(float *dst, const float *src, float addsc, int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    dst[i] = FLogsum(dst[i], src[i] + addsc);
+}
+
+/* Function:  cm_bif_ILogsumPlusRow()
+ *
+ * Purpose:   Scaled integer version of cm_bif_FLogsumPlusRow():
+ *            for i = 0..n-1 set dst[i] = ILogsum(dst[i], src[i] + addsc).
+ *
+ * Returns:   void
+ */
+void
+cm_bif_ILogsumPlusRow(int *dst, const int *src, int addsc, int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    dst[i] = ILogsum(dst[i], src[i] + addsc);
+}
+
+/*****************************************************************
+ * 2. Scan matrix (CM_SCAN_MX) bifurcation functions.
+ *****************************************************************/
+
+/* Function:  cm_bif_ScanMaxPlus()
+ *
+ * Purpose:   Bifurcation step for the CYK scanners FastCYKScan():
+ *            for state v, current j and d = <dn>..<dx>, update
+ *            <vrow>[d] (alpha[jp_v][v][d]) with the max over valid k
+ *            of alpha_begl[jp_wA[k]][w][d-k] + <yrow>[k], where w
+ *            is v's BEGL_S child, <yrow> is alpha[jp_y][y] for v's
+ *            BEGR_S child y and <jp_wA>[k] is the rolling index of
+ *            row j-k in the BEGL_S deck.
+ *
+ *            Valid k satisfy <kn> <= k <= <kx> (the band on y) and
+ *            <dn_w> <= d-k <= <dx_w> (the band on w). <vrow> must
+ *            already be initialized for d = dn..dx.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_ScanMaxPlus(float *vrow, float ***alpha_begl, const int *jp_wA, int w, const float *yrow,
+		   int dn, int dx, int kn, int kx, int dn_w, int dx_w)
+{
+  int d0, d1;   /* first, last d of current tile */
+  int dlo, dhi; /* first, last d for current k within current tile */
+  int k, kfirst, klast;
+
+  for (d0 = dn; d0 <= dx; d0 += CM_BIF_TILE) {
+    d1     = ESL_MIN(dx, d0 + CM_BIF_TILE - 1);
+    kfirst = ESL_MAX(kn, d0 - dx_w);
+    klast  = ESL_MIN(kx, d1 - dn_w);
+    for (k = kfirst; k <= klast; k++) {
+      dlo = ESL_MAX(d0, k + dn_w);
+      dhi = ESL_MIN(d1, k + dx_w);
+      if(dlo <= dhi) cm_bif_FMaxPlusRow(vrow + dlo, alpha_begl[jp_wA[k]][w] + dlo - k, yrow[k], dhi - dlo + 1);
+    }
+  }
+}
+
+/* Function:  cm_bif_ScanFLogsumPlus()
+ *
+ * Purpose:   Same as cm_bif_ScanMaxPlus() but sums over k with
+ *            FLogsum(), for FastFInsideScan().
+ *
+ * Returns:   void
+ */
+void
+cm_bif_ScanFLogsumPlus(float *vrow, float ***alpha_begl, const int *jp_wA, int w, const float *yrow,
+		       int dn, int dx, int kn, int kx, int dn_w, int dx_w)
+{
+  int d0, d1;   /* first, last d of current tile */
+  int dlo, dhi; /* first, last d for current k within current tile */
+  int k, kfirst, klast;
+
+  for (d0 = dn; d0 <= dx; d0 += CM_BIF_TILE) {
+    d1     = ESL_MIN(dx, d0 + CM_BIF_TILE - 1);
+    kfirst = ESL_MAX(kn, d0 - dx_w);
+    klast  = ESL_MIN(kx, d1 - dn_w);
+    for (k = kfirst; k <= klast; k++) {
+      dlo = ESL_MAX(d0, k + dn_w);
+      dhi = ESL_MIN(d1, k + dx_w);
+      if(dlo <= dhi) cm_bif_FLogsumPlusRow(vrow + dlo, alpha_begl[jp_wA[k]][w] + dlo - k, yrow[k], dhi - dlo + 1);
+    }
+  }
+}
+
+/* Function:  cm_bif_ScanILogsumPlus()
+ *
+ * Purpose:   Same as cm_bif_ScanMaxPlus() but for scaled integer
+ *            scores, summing over k with ILogsum(), for
+ *            FastIInsideScan().
+ *
+ * Returns:   void
+ */
+void
+cm_bif_ScanILogsumPlus(int *vrow, int ***alpha_begl, const int *jp_wA, int w, const int *yrow,
+		       int dn, int dx, int kn, int kx, int dn_w, int dx_w)
+{
+  int d0, d1;   /* first, last d of current tile */
+  int dlo, dhi; /* first, last d for current k within current tile */
+  int k, kfirst, klast;
+
+  for (d0 = dn; d0 <= dx; d0 += CM_BIF_TILE) {
+    d1     = ESL_MIN(dx, d0 + CM_BIF_TILE - 1);
+    kfirst = ESL_MAX(kn, d0 - dx_w);
+    klast  = ESL_MIN(kx, d1 - dn_w);
+    for (k = kfirst; k <= klast; k++) {
+      dlo = ESL_MAX(d0, k + dn_w);
+      dhi = ESL_MIN(d1, k + dx_w);
+      if(dlo <= dhi) cm_bif_ILogsumPlusRow(vrow + dlo, alpha_begl[jp_wA[k]][w] + dlo - k, yrow[k], dhi - dlo + 1);
+    }
+  }
+}
+
+/*****************************************************************
+ * 3. HMM banded matrix bifurcation functions.
+ *****************************************************************/
+
+/* Function:  cm_bif_HBMaxPlus()
+ *
+ * Purpose:   Bifurcation step for HMM banded CYK functions. For
+ *            B_st <v> with left child <y> and right child <z>,
+ *            for all j and d within the bands in <cp9b> update
+ *            <vdeck>[jp_v][dp_v] with the max over k of
+ *            <ydeck>[jp_y-k][dp_y-k] + <zdeck>[jp_z][kp_z], where
+ *            jp_*, dp_* and kp_z are offset indices in the
+ *            memory efficient banded decks (see cm_CYKInsideAlignHB()).
+ *
+ *            The three decks can be from different matrices, which
+ *            is what the truncated functions need (e.g. for a Left
+ *            marginal cell of v: J deck of y, L deck of z).
+ *
+ *            If <kshadow> is non-NULL, it is the shadow deck for v
+ *            and is updated with the k of the best cell.
+ *
+ *            If <do_skip_end_k> is TRUE, k == 0 and k == d are not
+ *            allowed, as required for the Terminal (T) matrix of
+ *            the truncated functions.
+ *
+ *            <vdeck> must already be initialized.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_HBMaxPlus(CP9Bands_t *cp9b, int v, int y, int z, float **vdeck, int **kshadow, float **ydeck, float **zdeck, int do_skip_end_k)
+{
+  int  *jmin  = cp9b->jmin;
+  int  *jmax  = cp9b->jmax;
+  int **hdmin = cp9b->hdmin;
+  int **hdmax = cp9b->hdmax;
+  int   j, jn, jx;       /* current j and its min, max */
+  int   jp_v, jp_y, jp_z; /* offset j for states v, y, z */
+  int   k, kn, kx;       /* current k and its min, max */
+  int   dlo, dhi;        /* min, max d for current k */
+  int   dn_v, dx_v;      /* hdmin, hdmax for v, j */
+
+  /* Any valid j must be within both state v and state z's j band */
+  jn = ESL_MAX(jmin[v], jmin[z]);
+  jx = ESL_MIN(jmax[v], jmax[z]);
+  for (j = jn; j <= jx; j++) {
+    jp_v = j - jmin[v];
+    jp_y = j - jmin[y];
+    jp_z = j - jmin[z];
+    dn_v = hdmin[v][jp_v];
+    dx_v = hdmax[v][jp_v];
+    if(dn_v > dx_v) continue;
+    /* A valid k must satisfy the following 6 inequalities:
+     * (1) k >= j-jmax[y];
+     * (2) k <= j-jmin[y]; 
+     *     1 and 2 guarantee (j-k) is within state y's j band
+     *
+     * (3) k >= hdmin[z][j-jmin[z]];
+     * (4) k <= hdmax[z][j-jmin[z]]; 
+     *     3 and 4 guarantee k is within z's j=(j), d band
+     *
+     * (5) k >= d-hdmax[y][j-jmin[y]-k];
+     * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
+     *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
+     *
+     * kn and kx satisfy 1-4. For each k, 5 and 6 define a
+     * contiguous range of d, dlo..dhi, which we intersect with v's
+     * d band for j.
+     */
+    kn = ESL_MAX(ESL_MAX(j-jmax[y], hdmin[z][jp_z]), 0);
+    kx = ESL_MIN(jp_y, hdmax[z][jp_z]);
+    if(do_skip_end_k) kn = ESL_MAX(kn, 1);
+    for (k = kn; k <= kx; k++) {
+      dlo = ESL_MAX(dn_v, k + hdmin[y][jp_y-k]);
+      dhi = ESL_MIN(dx_v, k + hdmax[y][jp_y-k]);
+      if(do_skip_end_k) dlo = ESL_MAX(dlo, k+1);
+      if(dlo > dhi) continue;
+      if(kshadow != NULL) {
+	cm_bif_FMaxPlusRowShadow(vdeck[jp_v] + (dlo - dn_v), kshadow[jp_v] + (dlo - dn_v),
+				 ydeck[jp_y-k] + (dlo - k - hdmin[y][jp_y-k]),
+				 zdeck[jp_z][k - hdmin[z][jp_z]], k, dhi - dlo + 1);
+      }
+      else {
+	cm_bif_FMaxPlusRow(vdeck[jp_v] + (dlo - dn_v),
+			   ydeck[jp_y-k] + (dlo - k - hdmin[y][jp_y-k]),
+			   zdeck[jp_z][k - hdmin[z][jp_z]], dhi - dlo + 1);
+      }
+    }
+  }
+}
+
+/* Function:  cm_bif_HBLogsumPlus()
+ *
+ * Purpose:   Same as cm_bif_HBMaxPlus() but sums over k with
+ *            FLogsum(), for the HMM banded Inside functions. There
+ *            is no shadow deck.
+ *
+ * Returns:   void
+ */
+void
+cm_bif_HBLogsumPlus(CP9Bands_t *cp9b, int v, int y, int z, float **vdeck, float **ydeck, float **zdeck, int do_skip_end_k)
+{
+  int  *jmin  = cp9b->jmin;
+  int  *jmax  = cp9b->jmax;
+  int **hdmin = cp9b->hdmin;
+  int **hdmax = cp9b->hdmax;
+  int   j, jn, jx;       /* current j and its min, max */
+  int   jp_v, jp_y, jp_z; /* offset j for states v, y, z */
+  int   k, kn, kx;       /* current k and its min, max */
+  int   dlo, dhi;        /* min, max d for current k */
+  int   dn_v, dx_v;      /* hdmin, hdmax for v, j */
+
+  jn = ESL_MAX(jmin[v], jmin[z]);
+  jx = ESL_MIN(jmax[v], jmax[z]);
+  for (j = jn; j <= jx; j++) {
+    jp_v = j - jmin[v];
+    jp_y = j - jmin[y];
+    jp_z = j - jmin[z];
+    dn_v = hdmin[v][jp_v];
+    dx_v = hdmax[v][jp_v];
+    if(dn_v > dx_v) continue;
+    kn = ESL_MAX(ESL_MAX(j-jmax[y], hdmin[z][jp_z]), 0);
+    kx = ESL_MIN(jp_y, hdmax[z][jp_z]);
+    if(do_skip_end_k) kn = ESL_MAX(kn, 1);
+    for (k = kn; k <= kx; k++) {
+      dlo = ESL_MAX(dn_v, k + hdmin[y][jp_y-k]);
+      dhi = ESL_MIN(dx_v, k + hdmax[y][jp_y-k]);
+      if(do_skip_end_k) dlo = ESL_MAX(dlo, k+1);
+      if(dlo > dhi) continue;
+      cm_bif_FLogsumPlusRow(vdeck[jp_v] + (dlo - dn_v),
+			    ydeck[jp_y-k] + (dlo - k - hdmin[y][jp_y-k]),
+			    zdeck[jp_z][k - hdmin[z][jp_z]], dhi - dlo + 1);
+    }
+  }
+}
+
+/*****************************************************************
+ * 4. Benchmark driver.
+ *****************************************************************/
+#ifdef CM_DPBIF_BENCHMARK
+/*
+  gcc -o benchmark-cm-dpbif -std=gnu99 -g -O2 -I. -L. -I../hmmer/src -L../hmmer/src -I../easel -L../easel -DCM_DPBIF_BENCHMARK cm_dpbif.c -linfernal -lhmmer -leasel -lm
+  ./benchmark-cm-dpbif
+
+  Isolates the cost of the bifurcation step of the non-banded CYK
+  and Inside scanners: random BEGL_S and BEGR_S decks of width W are
+  combined for <-N> j positions, first with the original j, d, k
+  loop order and then with cm_bif_ScanMaxPlus() (or
+  cm_bif_ScanFLogsumPlus() with --inside). The two results are
+  compared and must be identical.
+ */
+#include "esl_config.h"
+#include "p7_config.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "easel.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_stopwatch.h"
+
+#include "hmmer.h"
+
+#include "infernal.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",             0 },
+  { "-s",        eslARG_INT,    "181", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                    0 },
+  { "-N",        eslARG_INT,   "2000", NULL, "n>0", NULL,  NULL, NULL, "number of j positions to compute",                 0 },
+  { "-W",        eslARG_INT,    "200", NULL, "n>0", NULL,  NULL, NULL, "window size W (max d)",                            0 },
+  { "--inside",  eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "benchmark logsum-plus (Inside) not max-plus (CYK)", 0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "benchmark driver for CM bifurcation kernels";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go         = cm_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_STOPWATCH  *w          = esl_stopwatch_Create();
+  ESL_RANDOMNESS *r          = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  int             N          = esl_opt_GetInteger(go, "-N");
+  int             W          = esl_opt_GetInteger(go, "-W");
+  int             do_inside  = esl_opt_GetBoolean(go, "--inside");
+  float        ***alpha_begl = NULL; /* [0..j..W][0][0..d..W] BEGL_S deck */
+  float         **yrow       = NULL; /* [0..j..W][0..d..W]    BEGR_S deck */
+  float          *vrow1      = NULL; /* [0..d..W] result, original loop order */
+  float          *vrow2      = NULL; /* [0..d..W] result, cm_bif_Scan*() */
+  int            *jp_wA      = NULL;
+  int             j, d, k, n;
+  float           sc;
+  int             status;
+
+  FLogsumInit();
+
+  ESL_ALLOC(alpha_begl, sizeof(float **) * (W+1));
+  ESL_ALLOC(yrow,       sizeof(float *)  * (W+1));
+  for (j = 0; j <= W; j++) { alpha_begl[j] = NULL; yrow[j] = NULL; }
+  for (j = 0; j <= W; j++) {
+    ESL_ALLOC(alpha_begl[j],    sizeof(float *));
+    alpha_begl[j][0] = NULL;
+    ESL_ALLOC(alpha_begl[j][0], sizeof(float) * (W+1));
+    ESL_ALLOC(yrow[j],          sizeof(float) * (W+1));
+    for (d = 0; d <= W; d++) {
+      alpha_begl[j][0][d] = -20. * esl_random(r);
+      yrow[j][d]          = -20. * esl_random(r);
+    }
+  }
+  ESL_ALLOC(vrow1, sizeof(float) * (W+1));
+  ESL_ALLOC(vrow2, sizeof(float) * (W+1));
+  ESL_ALLOC(jp_wA, sizeof(int)   * (W+1));
+
+  esl_stopwatch_Start(w);
+  for (n = 0; n < N; n++) {
+    j = W + n;
+    for (d = 0; d <= W; d++) jp_wA[d] = (j-d)%(W+1);
+    for (d = 0; d <= W; d++) {
+      sc = IMPOSSIBLE;
+      if(do_inside) { for (k = 0; k <= d; k++) sc = FLogsum(sc, alpha_begl[jp_wA[k]][0][d-k] + yrow[j%(W+1)][k]); }
+      else          { for (k = 0; k <= d; k++) sc = ESL_MAX(sc, alpha_begl[jp_wA[k]][0][d-k] + yrow[j%(W+1)][k]); }
+      vrow1[d] = sc;
+    }
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time original d, k loop:      ");
+
+  esl_stopwatch_Start(w);
+  for (n = 0; n < N; n++) {
+    j = W + n;
+    for (d = 0; d <= W; d++) jp_wA[d] = (j-d)%(W+1);
+    esl_vec_FSet(vrow2, W+1, IMPOSSIBLE);
+    if(do_inside) cm_bif_ScanFLogsumPlus(vrow2, alpha_begl, jp_wA, 0, yrow[j%(W+1)], 0, W, 0, W, 0, W);
+    else          cm_bif_ScanMaxPlus    (vrow2, alpha_begl, jp_wA, 0, yrow[j%(W+1)], 0, W, 0, W, 0, W);
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time bifurcation kernel:      ");
+
+  for (d = 0; d <= W; d++)
+    if(vrow1[d] != vrow2[d]) esl_fatal("kernel result differs from original at d=%d (%.6f != %.6f)", d, vrow1[d], vrow2[d]);
+
+  printf("# window size W                 %d\n", W);
+  printf("# number of j positions         %d\n", N);
+  printf("# cells per j                   %d\n", (W+1)*(W+2)/2);
+  printf("# %s results identical\n", do_inside ? "logsum-plus" : "max-plus");
+
+  status = eslOK;
+ ERROR:
+  if(alpha_begl != NULL) {
+    for (j = 0; j <= W; j++) { if(alpha_begl[j] != NULL) { if(alpha_begl[j][0] != NULL) free(alpha_begl[j][0]); free(alpha_begl[j]); } }
+    free(alpha_begl);
+  }
+  if(yrow != NULL) {
+    for (j = 0; j <= W; j++) { if(yrow[j] != NULL) free(yrow[j]); }
+    free(yrow);
+  }
+  if(vrow1 != NULL) free(vrow1);
+  if(vrow2 != NULL) free(vrow2);
+  if(jp_wA != NULL) free(jp_wA);
+  esl_getopts_Destroy(go);
+  esl_stopwatch_Destroy(w);
+  esl_randomness_Destroy(r);
+  return status;
+}
+#endif /*CM_DPBIF_BENCHMARK*/
+/*****************************************************************
+ * @LICENSE@
+ *****************************************************************/
@@ -100,14 +100,12 @@ FastCYKScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *dsq, i
   int       yoffset;		/* offset to a child state */
   int       i,j;		/* index of start/end positions in sequence, 0..L */
   int       d;			/* a subsequence length, 0..W */
-  int       k;			/* used in bifurc calculations: length of right subseq */
   int       prv, cur;		/* previous, current j row (0 or 1) */
   int       v, w, y;            /* state indices */
   int       jp_v;  	        /* offset j for state v */
   int       jp_y;  	        /* offset j for state y */
   int       jp_g;               /* offset j for gamma (j-i0+1) */
   int       dp_y;               /* offset d for state y */
-  int       kmin, kmax;         /* for B_st's, min/max value consistent with bands*/
   int       L;                  /* length of the subsequence (j0-i0+1) */
   int       W;                  /* max d; max size of a hit, this is min(L, smx->W) */
   int       sd;                 /* StateDelta(cm->sttype[v]), # emissions from v */
@@ -256,27 +254,23 @@ FastCYKScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *dsq, i
 	  if(cm->sttype[v] == B_st) {
 	    w = cm->cfirst[v]; /* BEGL_S */
 	    y = cm->cnum[v];   /* BEGR_S */
-	    for (d = dnA[v]; d <= dxA[v]; d++) {
-	      /* k is the length of the right fragment */
-	      if(do_banded) {
-		/* Careful, make sure k is consistent with bands in
-		 * state w and state y, and don't forget that
-		 * dmin/dmax values can exceed W. */
-		dn_y = ESL_MIN(dmin[y], smx->W); 
-		dx_y = ESL_MIN(dmax[y], smx->W);
-		dn_w = ESL_MIN(dmin[w], smx->W);
-		dx_w = ESL_MIN(dmax[w], smx->W);
-		kmin = ESL_MAX(0, ESL_MAX(dn_y, d-dx_w));
-		kmax = ESL_MIN(dx_y, d-dn_w);
-	      }
-	      else { kmin = 0; kmax = d; }
-
-	      sc = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B_st */
-	      for (k = kmin; k <= kmax; k++) 
-		sc = ESL_MAX(sc, (alpha_begl[jp_wA[k]][w][d-k] + alpha[jp_y][y][k]));
-	      alpha[jp_v][v][d] = sc;
-	      /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
+	    /* k is the length of the right fragment */
+	    if(do_banded) {
+	      /* Careful, make sure k is consistent with bands in
+	       * state w and state y, and don't forget that
+	       * dmin/dmax values can exceed W. */
+	      dn_y = ESL_MIN(dmin[y], smx->W); 
+	      dx_y = ESL_MIN(dmax[y], smx->W);
+	      dn_w = ESL_MIN(dmin[w], smx->W);
+	      dx_w = ESL_MIN(dmax[w], smx->W);
 	    }
+	    else { dn_y = dn_w = 0; dx_y = dx_w = W; }
+
+	    for (d = dnA[v]; d <= dxA[v]; d++) 
+	      alpha[jp_v][v][d] = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B_st */
+	    /* the k loop is done by the shared bifurcation kernel (cm_dpbif.c) */
+	    cm_bif_ScanMaxPlus(alpha[jp_v][v], alpha_begl, jp_wA, w, alpha[jp_y][y], dnA[v], dxA[v], ESL_MAX(0, dn_y), dx_y, dn_w, dx_w);
+	    /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
 	  }
 	  else if (cm->stid[v] == BEGL_S) {
 	    y = cm->cfirst[v]; 
@@ -1116,14 +1110,12 @@ FastIInsideScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *ds
   int       yoffset;		/* offset to a child state */
   int       i,j;		/* index of start/end positions in sequence, 0..L */
   int       d;			/* a subsequence length, 0..W */
-  int       k;			/* used in bifurc calculations: length of right subseq */
   int       prv, cur;		/* previous, current j row (0 or 1) */
   int       v, w, y;            /* state indices */
   int       jp_v;  	        /* offset j for state v */
   int       jp_y;  	        /* offset j for state y */
   int       jp_g;               /* offset j for gamma (j-i0+1) */
   int       dp_y;               /* offset d for state y */
-  int       kmin, kmax;         /* for B_st's, min/max value consistent with bands*/
   int       L;                  /* length of the subsequence (j0-i0+1) */
   int       W;                  /* max d; max size of a hit, this is min(L, smx->W) */
   int       sd;                 /* StateDelta(cm->sttype[v]), # emissions from v */
@@ -1271,27 +1263,23 @@ FastIInsideScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *ds
 	  if(cm->sttype[v] == B_st) {
 	    w = cm->cfirst[v]; /* BEGL_S */
 	    y = cm->cnum[v];   /* BEGR_S */
-	    for (d = dnA[v]; d <= dxA[v]; d++) {
-	      /* k is the length of the right fragment */
-	      if(do_banded) {
-		/* Careful, make sure k is consistent with bands in
-		 * state w and state y, and don't forget that
-		 * dmin/dmax values can exceed W. */
-		dn_y = ESL_MIN(dmin[y], smx->W); 
-		dx_y = ESL_MIN(dmax[y], smx->W);
-		dn_w = ESL_MIN(dmin[w], smx->W);
-		dx_w = ESL_MIN(dmax[w], smx->W);
-		kmin = ESL_MAX(0, ESL_MAX(dn_y, d-dx_w));
-		kmax = ESL_MIN(dx_y, d-dn_w);
-	      }
-	      else { kmin = 0; kmax = d; }
-
-	      sc = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B st */
-	      for (k = kmin; k <= kmax; k++) 
-		sc = ILogsum(sc, (alpha_begl[jp_wA[k]][w][d-k] + alpha[jp_y][y][k]));
-	      alpha[jp_v][v][d] = sc;
-	      /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
+	    /* k is the length of the right fragment */
+	    if(do_banded) {
+	      /* Careful, make sure k is consistent with bands in
+	       * state w and state y, and don't forget that
+	       * dmin/dmax values can exceed W. */
+	      dn_y = ESL_MIN(dmin[y], smx->W); 
+	      dx_y = ESL_MIN(dmax[y], smx->W);
+	      dn_w = ESL_MIN(dmin[w], smx->W);
+	      dx_w = ESL_MIN(dmax[w], smx->W);
 	    }
+	    else { dn_y = dn_w = 0; dx_y = dx_w = W; }
+
+	    for (d = dnA[v]; d <= dxA[v]; d++) 
+	      alpha[jp_v][v][d] = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B st */
+	    /* the k loop is done by the shared bifurcation kernel (cm_dpbif.c) */
+	    cm_bif_ScanILogsumPlus(alpha[jp_v][v], alpha_begl, jp_wA, w, alpha[jp_y][y], dnA[v], dxA[v], ESL_MAX(0, dn_y), dx_y, dn_w, dx_w);
+	    /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
 	  }
 	  else if (cm->stid[v] == BEGL_S) {
 	    y = cm->cfirst[v]; 
@@ -1741,14 +1729,12 @@ FastFInsideScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *ds
   int       yoffset;		/* offset to a child state */
   int       i,j;		/* index of start/end positions in sequence, 0..L */
   int       d;			/* a subsequence length, 0..W */
-  int       k;			/* used in bifurc calculations: length of right subseq */
   int       prv, cur;		/* previous, current j row (0 or 1) */
   int       v, w, y;            /* state indices */
   int       jp_v;  	        /* offset j for state v */
   int       jp_y;  	        /* offset j for state y */
   int       jp_g;               /* offset j for gamma (j-i0+1) */
   int       dp_y;               /* offset d for state y */
-  int       kmin, kmax;         /* for B_st's, min/max value consistent with bands*/
   int       L;                  /* length of the subsequence (j0-i0+1) */
   int       W;                  /* max d; max size of a hit, this is min(L, smx->W) */
   int       sd;                 /* StateDelta(cm->sttype[v]), # emissions from v */
@@ -1898,27 +1884,23 @@ FastFInsideScan(CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *ds
 	  if(cm->sttype[v] == B_st) {
 	    w = cm->cfirst[v]; /* BEGL_S */
 	    y = cm->cnum[v];   /* BEGR_S */
-	    for (d = dnA[v]; d <= dxA[v]; d++) {
-	      /* k is the length of the right fragment */
-	      if(do_banded) {
-		/* Careful, make sure k is consistent with bands in
-		 * state w and state y, and don't forget that
-		 * dmin/dmax values can exceed W. */
-		dn_y = ESL_MIN(dmin[y], smx->W); 
-		dx_y = ESL_MIN(dmax[y], smx->W);
-		dn_w = ESL_MIN(dmin[w], smx->W);
-		dx_w = ESL_MIN(dmax[w], smx->W);
-		kmin = ESL_MAX(0, ESL_MAX(dn_y, d-dx_w));
-		kmax = ESL_MIN(dx_y, d-dn_w);
-	      }
-	      else { kmin = 0; kmax = d; }
-
-	      sc = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B_st */
-	      for (k = kmin; k <= kmax; k++) 
-		sc = FLogsum(sc, (alpha_begl[jp_wA[k]][w][d-k] + alpha[jp_y][y][k]));
-	      alpha[jp_v][v][d] = sc;
-	      /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
+	    /* k is the length of the right fragment */
+	    if(do_banded) {
+	      /* Careful, make sure k is consistent with bands in
+	       * state w and state y, and don't forget that
+	       * dmin/dmax values can exceed W. */
+	      dn_y = ESL_MIN(dmin[y], smx->W); 
+	      dx_y = ESL_MIN(dmax[y], smx->W);
+	      dn_w = ESL_MIN(dmin[w], smx->W);
+	      dx_w = ESL_MIN(dmax[w], smx->W);
 	    }
+	    else { dn_y = dn_w = 0; dx_y = dx_w = W; }
+
+	    for (d = dnA[v]; d <= dxA[v]; d++) 
+	      alpha[jp_v][v][d] = init_scAA[v][d-sd]; /* state delta (sd) is 0 for B_st */
+	    /* the k loop is done by the shared bifurcation kernel (cm_dpbif.c) */
+	    cm_bif_ScanFLogsumPlus(alpha[jp_v][v], alpha_begl, jp_wA, w, alpha[jp_y][y], dnA[v], dxA[v], ESL_MAX(0, dn_y), dx_y, dn_w, dx_w);
+	    /* careful: scores for w, the BEGL_S child of v, are in alpha_begl, not alpha */
 	  }
 	  else if (cm->stid[v] == BEGL_S) {
 	    y = cm->cfirst[v]; 
@@ -3248,7 +3230,7 @@ FastCYKScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DSQ *d
   int     *bestr;       /* best root state for d at current j */
   float   *bestsc;      /* best score for d at current j */
   int      v,y,z;	/* indices for states  */
-  int      j,d,i,k;	/* indices in sequence dimensions */
+  int      j,d,i;	/* indices in sequence dimensions */
   float    sc;		/* a temporary variable holding a score */
   int      yoffset;	/* y=base+offset -- counter in child states that v can transit to */
   int     *yvalidA;     /* [0..MAXCONNECT-1] TRUE if v->yoffset is legal transition (within bands) */
@@ -3256,7 +3238,7 @@ FastCYKScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DSQ *d
   /* indices used for handling band-offset issues, and in the depths of the DP recursion */
   int      sd;                 /* StateDelta(cm->sttype[v]) */
   int      sdr;                /* StateRightDelta(cm->sttype[v] */
-  int      jp_v, jp_y, jp_z;   /* offset j index for states v, y, z */
+  int      jp_v, jp_y;         /* offset j index for states v, y */
   int      jp_y_sdr;           /* jp_y - sdr */
   int      j_sdr;              /* j - sdr */
   int      jn, jx;             /* current minimum/maximum j allowed */
@@ -3266,8 +3248,6 @@ FastCYKScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DSQ *d
   int      dp;                 /* ESL_MAX(d-sd, 0) */
   int      dp_y_sd;            /* dp_y - sd */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   float    tsc;                /* a transition score */
   int      yvalid_idx;         /* for keeping track of which children are valid */
   int      yvalid_ct;          /* for keeping track of which children are valid */
@@ -3549,61 +3529,8 @@ FastCYKScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DSQ *d
       y = cm->cfirst[v]; /* left  subtree */
       z = cm->cnum[v];   /* right subtree */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
-       */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-	/* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-	      alpha[v][jp_v][dp_v] = ESL_MAX(alpha[v][jp_v][dp_v], alpha[y][jp_y-k][dp_y - k] + alpha[z][jp_z][kp_z]);
-	    }
-	  }
-	}
-      }
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c) */
+      cm_bif_HBMaxPlus(cp9b, v, y, z, alpha[v], NULL, alpha[y], alpha[z], FALSE);
     } /* finished calculating deck v. */
   } /* end of for (v = cm->M-1; v >= 0; v--) */
         
@@ -3785,7 +3712,7 @@ FastFInsideScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DS
   int     *bestr;       /* best root state for d at current j */
   float   *bestsc;      /* best score for d at current j */
   int      v,y,z;	/* indices for states  */
-  int      j,d,i,k;	/* indices in sequence dimensions */
+  int      j,d,i;	/* indices in sequence dimensions */
   float    sc;		/* a temporary variable holding a score */
   int      yoffset;	/* y=base+offset -- counter in child states that v can transit to */
   int     *yvalidA;     /* [0..MAXCONNECT-1] TRUE if v->yoffset is legal transition (within bands) */
@@ -3793,7 +3720,7 @@ FastFInsideScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DS
   /* indices used for handling band-offset issues, and in the depths of the DP recursion */
   int      sd;                 /* StateDelta(cm->sttype[v]) */
   int      sdr;                /* StateRightDelta(cm->sttype[v] */
-  int      jp_v, jp_y, jp_z;   /* offset j index for states v, y, z */
+  int      jp_v, jp_y;         /* offset j index for states v, y */
   int      jp_y_sdr;           /* jp_y - sdr */
   int      j_sdr;              /* j - sdr */
   int      jn, jx;             /* current minimum/maximum j allowed */
@@ -3803,8 +3730,6 @@ FastFInsideScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DS
   int      dp;                 /* ESL_MAX(d-sd, 0) */
   int      dp_y_sd;            /* dp_y - sd */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   float    tsc;                /* a transition score */
   int      yvalid_idx;         /* for keeping track of which children are valid */
   int      yvalid_ct;          /* for keeping track of which children are valid */
@@ -4063,61 +3988,8 @@ FastFInsideScanHB(CM_t *cm, char *errbuf, CM_HB_MX *mx, float size_limit, ESL_DS
       y = cm->cfirst[v]; /* left  subtree */
       z = cm->cnum[v];   /* right subtree */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
-       */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-	/* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-	      alpha[v][jp_v][dp_v] = FLogsum(alpha[v][jp_v][dp_v], alpha[y][jp_y-k][dp_y - k] + alpha[z][jp_z][kp_z]);
-	    }
-	  }
-	}
-      }
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c) */
+      cm_bif_HBLogsumPlus(cp9b, v, y, z, alpha[v], alpha[y], alpha[z], FALSE);
     } /* finished calculating deck v. */
 
   } /* end of for (v = cm->M-1; v >= 0; v--) */
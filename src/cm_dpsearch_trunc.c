@@ -1392,7 +1392,7 @@ TrCYKScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int pass_
   char    *bestmode;           /* best mode for parsetree for d at current j */
   float   *bestsc;             /* best score for parsetree for d at current j */
   int      v,y,z;	       /* indices for states  */
-  int      j,d,i,k;            /* indices in sequence dimensions */
+  int      j,d,i;              /* indices in sequence dimensions */
   float    Lsc, Rsc;           /* temporary scores */
   int      yoffset;	       /* y=base+offset -- counter in child states that v can transit to */
   int     *yvalidA;            /* [0..MAXCONNECT-1] TRUE if v->yoffset is legal transition (within bands) */
@@ -1411,8 +1411,6 @@ TrCYKScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int pass_
   int      dp_y_sd;            /* dp_y - sd */
   int      dp_y_sdr;           /* dp_y - sdr, often for jp_y_sdr */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   float    tsc;                /* a transition score */
   int      yvalid_idx;         /* for keeping track of which children are valid */
   int      yvalid_ct;          /* for keeping track of which children are valid */
@@ -2041,73 +2039,15 @@ TrCYKScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int pass_
       do_R_z = cp9b->Rvalid[z] && fill_R ? TRUE : FALSE;
       do_T_z = cp9b->Tvalid[z] && fill_T ? TRUE : FALSE; /* will be FALSE, z is not a B_st */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c),
+       * once for each valid combination of v, y and z matrices. To update
+       * a cell in the T matrix with a sum of an R matrix value for y and
+       * a L matrix value for z, k != 0 and k != d are also required.
        */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-	/* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	i = j - hdmin[v][jp_v] + 1;
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++, i--) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the {J,L,R} matrix y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop)) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   *
-	   * To update a cell in the T matrix with a sum of an R matrix value for y
-	   * and a L matrix value for z, there are 2 additional inequalities to satisfy:
-	   * (7) k != 0
-	   * (8) k != d
-	   * We ensure 7 and 8 in the loop below.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-	      if(do_J_v && do_J_y && do_J_z) Jalpha[v][jp_v][dp_v] = ESL_MAX(Jalpha[v][jp_v][dp_v], Jalpha[y][jp_y-k][dp_y - k] + Jalpha[z][jp_z][kp_z]);
-	      if(do_L_v && do_J_y && do_L_z) Lalpha[v][jp_v][dp_v] = ESL_MAX(Lalpha[v][jp_v][dp_v], Jalpha[y][jp_y-k][dp_y - k] + Lalpha[z][jp_z][kp_z]);
-	      if(do_R_v && do_R_y && do_J_z) Ralpha[v][jp_v][dp_v] = ESL_MAX(Ralpha[v][jp_v][dp_v], Ralpha[y][jp_y-k][dp_y - k] + Jalpha[z][jp_z][kp_z]);
-	      if(k != 0 && k != d) {
-		if(do_T_v && do_R_y && do_L_z) Talpha[v][jp_v][dp_v] = ESL_MAX(Talpha[v][jp_v][dp_v], Ralpha[y][jp_y-k][dp_y - k] + Lalpha[z][jp_z][kp_z]);
-	      }
-	    }
-	  }
-	}
-      }
+      if(do_J_v && do_J_y && do_J_z) cm_bif_HBMaxPlus(cp9b, v, y, z, Jalpha[v], NULL, Jalpha[y], Jalpha[z], FALSE);
+      if(do_L_v && do_J_y && do_L_z) cm_bif_HBMaxPlus(cp9b, v, y, z, Lalpha[v], NULL, Jalpha[y], Lalpha[z], FALSE);
+      if(do_R_v && do_R_y && do_J_z) cm_bif_HBMaxPlus(cp9b, v, y, z, Ralpha[v], NULL, Ralpha[y], Jalpha[z], FALSE);
+      if(do_T_v && do_R_y && do_L_z) cm_bif_HBMaxPlus(cp9b, v, y, z, Talpha[v], NULL, Ralpha[y], Lalpha[z], TRUE);
 
       /* two additional special cases in trCYK (these are not in standard CYK).
        * we do these in their own for(j.. { for(d.. { } } loops b/c one 
@@ -2508,7 +2448,7 @@ FTrInsideScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int p
   char    *bestmode;           /* best mode for parsetree for d at current j */
   float   *bestsc;             /* best score for parsetree for d at current j */
   int      v,y,z;	       /* indices for states  */
-  int      j,d,i,k;	       /* indices in sequence dimensions */
+  int      j,d,i;	       /* indices in sequence dimensions */
   float    Lsc, Rsc;           /* temporary scores */
   int      yoffset;	       /* y=base+offset -- counter in child states that v can transit to */
   int     *yvalidA;            /* [0..MAXCONNECT-1] TRUE if v->yoffset is legal transition (within bands) */
@@ -2527,8 +2467,6 @@ FTrInsideScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int p
   int      dp_y_sd;            /* dp_y - sd */
   int      dp_y_sdr;           /* dp_y - sdr, often for jp_y_sdr */
   int      dpn, dpx;           /* minimum/maximum dp_v */
-  int      kp_z;               /* k (in the d dim) index for state z in alpha w/mem eff bands */
-  int      kn, kx;             /* current minimum/maximum k value */
   float    tsc;                /* a transition score */
   int      yvalid_idx;         /* for keeping track of which children are valid */
   int      yvalid_ct;          /* for keeping track of which children are valid */
@@ -3157,73 +3095,15 @@ FTrInsideScanHB(CM_t *cm, char *errbuf, CM_TR_HB_MX *mx, float size_limit, int p
       do_R_z = cp9b->Rvalid[z] && fill_R ? TRUE : FALSE;
       do_T_z = cp9b->Tvalid[z] && fill_T ? TRUE : FALSE; /* will be FALSE, z is not a B_st */
       
-      /* Any valid j must be within both state v and state z's j band 
-       * I think jmin[v] <= jmin[z] is guaranteed by the way bands are 
-       * constructed, but we'll check anyway. 
+      /* The j, k, d loops are done by the shared bifurcation kernel (cm_dpbif.c),
+       * once for each valid combination of v, y and z matrices. To update
+       * a cell in the T matrix with a sum of an R matrix value for y and
+       * a L matrix value for z, k != 0 and k != d are also required.
        */
-      jn = (jmin[v] > jmin[z]) ? jmin[v] : jmin[z];
-      jx = (jmax[v] < jmax[z]) ? jmax[v] : jmax[z];
-      /* the main j loop */
-      for (j = jn; j <= jx; j++) { 
-	jp_v = j - jmin[v];
-	jp_y = j - jmin[y];
-	jp_z = j - jmin[z];
-	kn = ((j-jmax[y]) > (hdmin[z][jp_z])) ? (j-jmax[y]) : hdmin[z][jp_z];
-        kn = ESL_MAX(kn, 0); /* kn must be non-negative, added with fix to bug i36 */
-	/* kn satisfies inequalities (1) and (3) (listed below)*/	
-	kx = ( jp_y       < (hdmax[z][jp_z])) ?  jp_y       : hdmax[z][jp_z];
-	/* kn satisfies inequalities (2) and (4) (listed below)*/	
-	i = j - hdmin[v][jp_v] + 1;
-	for (d = hdmin[v][jp_v]; d <= hdmax[v][jp_v]; d++, i--) {
-	  dp_v = d - hdmin[v][jp_v];  /* d index for state v in alpha w/mem eff bands */
-	      
-	  /* Find the first k value that implies a valid cell in the {J,L,R} matrix y and z decks.
-	   * This k must satisfy the following 6 inequalities (some may be redundant):
-	   * (1) k >= j-jmax[y];
-	   * (2) k <= j-jmin[y]; 
-	   *     1 and 2 guarantee (j-k) is within state y's j band
-	   *
-	   * (3) k >= hdmin[z][j-jmin[z]];
-	   * (4) k <= hdmax[z][j-jmin[z]]; 
-	   *     3 and 4 guarantee k is within z's j=(j), d band
-	   *
-	   * (5) k >= d-hdmax[y][j-jmin[y]-k];
-	   * (6) k <= d-hdmin[y][j-jmin[y]-k]; 
-	   *     5 and 6 guarantee (d-k) is within state y's j=(j-k) d band
-	   *
-	   * kn and kx were set above (outside (for (dp_v...) loop) that
-	   * satisfy 1-4 (b/c 1-4 are d-independent and k-independent)
-	   * RHS of inequalities 5 and 6 are dependent on k, so we check
-	   * for these within the next for loop.
-	   *
-	   * To update a cell in the T matrix with a sum of an R matrix value for y
-	   * and a L matrix value for z, there are 2 additional inequalities to satisfy:
-	   * (7) k != 0
-	   * (8) k != d
-	   * We ensure 7 and 8 in the loop below.
-	   */
-	  for(k = kn; k <= kx; k++) { 
-	    if((k >= d - hdmax[y][jp_y-k]) && k <= d - hdmin[y][jp_y-k]) {
-	      /* for current k, all 6 inequalities have been satisified 
-	       * so we know the cells corresponding to the platonic 
-	       * matrix cells alpha[v][j][d], alpha[y][j-k][d-k], and
-	       * alpha[z][j][k] are all within the bands. These
-	       * cells correspond to alpha[v][jp_v][dp_v], 
-	       * alpha[y][jp_y-k][d-hdmin[jp_y-k]-k],
-	       * and alpha[z][jp_z][k-hdmin[jp_z]];
-	       */
-	      kp_z = k-hdmin[z][jp_z];
-	      dp_y = d-hdmin[y][jp_y-k];
-	      if(do_J_v && do_J_y && do_J_z) Jalpha[v][jp_v][dp_v] = FLogsum(Jalpha[v][jp_v][dp_v], Jalpha[y][jp_y-k][dp_y - k] + Jalpha[z][jp_z][kp_z]);
-	      if(do_L_v && do_J_y && do_L_z) Lalpha[v][jp_v][dp_v] = FLogsum(Lalpha[v][jp_v][dp_v], Jalpha[y][jp_y-k][dp_y - k] + Lalpha[z][jp_z][kp_z]);
-	      if(do_R_v && do_R_y && do_J_z) Ralpha[v][jp_v][dp_v] = FLogsum(Ralpha[v][jp_v][dp_v], Ralpha[y][jp_y-k][dp_y - k] + Jalpha[z][jp_z][kp_z]);
-	      if((k != 0) && (k != d)) {
-		if(do_T_v && do_R_y && do_L_z) Talpha[v][jp_v][dp_v] = FLogsum(Talpha[v][jp_v][dp_v], Ralpha[y][jp_y-k][dp_y - k] + Lalpha[z][jp_z][kp_z]);
-	      }
-	    }
-	  }
-	}
-      }
+      if(do_J_v && do_J_y && do_J_z) cm_bif_HBLogsumPlus(cp9b, v, y, z, Jalpha[v], Jalpha[y], Jalpha[z], FALSE);
+      if(do_L_v && do_J_y && do_L_z) cm_bif_HBLogsumPlus(cp9b, v, y, z, Lalpha[v], Jalpha[y], Lalpha[z], FALSE);
+      if(do_R_v && do_R_y && do_J_z) cm_bif_HBLogsumPlus(cp9b, v, y, z, Ralpha[v], Ralpha[y], Jalpha[z], FALSE);
+      if(do_T_v && do_R_y && do_L_z) cm_bif_HBLogsumPlus(cp9b, v, y, z, Talpha[v], Ralpha[y], Lalpha[z], TRUE);
 
       /* two additional special cases in trCYK (these are not in standard CYK).
        * we do these in their own for(j.. { for(d.. { } } loops b/c one 
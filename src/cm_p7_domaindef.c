@@ -75,6 +75,9 @@ static int glocal_rescore_isolated_domain(P7_DOMAINDEF *ddef, const P7_PROFILE *
  *            using <fwd> and <bck> matrices as workspace for the
  *            necessary full-matrix DP calculations. Caller provides a
  *            new or reused <ddef> object to hold these results.
+ *            Only the special state rows of <gxf> and <gxb> are
+ *            used, so they can be filled by cm_p7_GForward() and
+ *            cm_p7_GBackward().
  *            
  *            As a special case, if the profile is in unihit mode
  *            upon entering, we don't ever modify its configuration.
@@ -0,0 +1,1004 @@
+/* cm_p7_gfwdback.c
+ *
+ * Fast Forward/Backward for glocal (and truncated) p7 profiles, used
+ * by the glocal Forward filter (F4) and glocal envelope definition
+ * stages of the pipeline.
+ *
+ * HMMER's optimized (striped) Forward/Backward implementations
+ * assume a local multihit model, so the pipeline has had to use the
+ * generic p7_GForward() and p7_GBackward() for the glocal <gm> and
+ * the truncated <Rgm>, <Lgm> and <Tgm> profiles. Those fill a full
+ * (M+1) x (L+1) matrix with a log-sum-exp per cell. But the callers
+ * only need the score and the special state (N,B,E,J,C) rows:
+ * p7_domaindef_GlocalByPosteriorHeuristics() only passes the full
+ * sequence <gxf> and <gxb> matrices to p7_GDomainDecoding(), and
+ * recomputes matrices for each region it defines.
+ *
+ * The functions here compute the same quantities in probability
+ * space with doubles, keeping only two rows of main states and
+ * rescaling a row whenever its largest value drifts too far from 1.
+ * The match and insert cells of a row depend only on the previous
+ * row, so they are computed in simple loops over k that the compiler
+ * can vectorize; only the delete chain is a serial recurrence. The
+ * special state rows are stored in the P7_GMX in log space (nats)
+ * exactly as p7_GForward()/p7_GBackward() store them, so
+ * p7_GDomainDecoding() can use them unchanged.
+ *
+ * cm_p7_GForwardFused() runs Forward for up to CM_P7_NFUSED
+ * profiles that differ only in their begin and end scoring (the
+ * standard glocal <gm> and the truncated <Rgm>, <Lgm> and <Tgm>) in
+ * one sweep: the profiles' cells are interleaved, so each emission
+ * and transition probability is loaded once per cell and the
+ * innermost loops (including the delete chain) run across profiles.
+ *
+ * Contents:
+ *    1. CM_P7_GFB workspace.
+ *    2. Forward and Backward.
+ *    3. Fused Forward for truncated profile variants.
+ *    4. Unit tests.
+ *    5. Test driver.
+ */
+#include "esl_config.h"
+#include "p7_config.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "easel.h"
+
+#include "hmmer.h"
+
+#include "infernal.h"
+
+#define GFB_SCALEMAX 1e100  /* rescale a row if its max value is above this */
+#define GFB_SCALEMIN 1e-100 /* rescale a row if its max value is below this */
+
+static double gfb_rescale(int M, double *mx, double *ix, double *dx, double *xv, double *ret_lscale);
+static int    gfb_set_emissions(CM_P7_GFB *gfb, const ESL_DSQ *dsq, int L);
+static int    gfb_compatible(const CM_P7_GFB *gfb, const P7_PROFILE *gm);
+
+/*****************************************************************
+ * 1. CM_P7_GFB workspace.
+ *****************************************************************/
+
+/* Function:  cm_p7_gfb_Create()
+ *
+ * Purpose:   Allocate a workspace for cm_p7_GForward() and
+ *            cm_p7_GBackward() for profiles of up to <allocM>
+ *            nodes. It grows as necessary in cm_p7_gfb_SetProfile().
+ *
+ * Returns:   a pointer to the new workspace, or NULL on allocation
+ *            failure.
+ */
+CM_P7_GFB *
+cm_p7_gfb_Create(int allocM)
+{
+  int        status;
+  CM_P7_GFB *gfb = NULL;
+  int        x;
+
+  ESL_ALLOC(gfb, sizeof(CM_P7_GFB));
+  gfb->gm     = NULL;
+  gfb->M      = 0;
+  gfb->allocM = 0;
+  gfb->Kp     = 0;
+  gfb->tsc    = NULL;
+  gfb->msc    = NULL;
+  gfb->isc    = NULL;
+  gfb->rset   = NULL;
+  gfb->row    = NULL;
+  gfb->frow   = NULL;
+  gfb->fbm    = NULL;
+  for(x = 0; x < p7P_NTRANS; x++) gfb->tp[x] = NULL;
+
+  if((status = cm_p7_gfb_GrowTo(gfb, ESL_MAX(1, allocM))) != eslOK) goto ERROR;
+  return gfb;
+
+ ERROR:
+  cm_p7_gfb_Destroy(gfb);
+  return NULL;
+}
+
+/* Function:  cm_p7_gfb_GrowTo()
+ *
+ * Purpose:   Make sure <gfb> can hold a profile of <M> nodes,
+ *            reallocating if necessary. Invalidates the profile
+ *            <gfb> was set to, if any.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEMEM> on allocation failure.
+ */
+int
+cm_p7_gfb_GrowTo(CM_P7_GFB *gfb, int M)
+{
+  int status;
+  int x;
+
+  if(M <= gfb->allocM) return eslOK;
+
+  if(gfb->tsc  != NULL) free(gfb->tsc);
+  if(gfb->row  != NULL) free(gfb->row);
+  if(gfb->frow != NULL) free(gfb->frow);
+  if(gfb->fbm  != NULL) free(gfb->fbm);
+  if(gfb->msc  != NULL) {
+    for(x = 0; x < gfb->Kp; x++) free(gfb->msc[x]);
+    free(gfb->msc);
+  }
+  if(gfb->isc != NULL) {
+    for(x = 0; x < gfb->Kp; x++) free(gfb->isc[x]);
+    free(gfb->isc);
+  }
+  if(gfb->rset != NULL) free(gfb->rset);
+  gfb->tsc  = gfb->row = gfb->frow = gfb->fbm = NULL;
+  gfb->msc  = gfb->isc = NULL;
+  gfb->rset = NULL;
+  gfb->Kp   = 0;
+  gfb->gm   = NULL;
+
+  /* transition probabilities, one array of M+1 per transition type, so
+   * each can be streamed through contiguously in the DP loops */
+  ESL_ALLOC(gfb->tsc, sizeof(double) * p7P_NTRANS * (M+1));
+  for(x = 0; x < p7P_NTRANS; x++) gfb->tp[x] = gfb->tsc + x * (M+1);
+  /* eight rows of M+2 doubles: current and previous M, I, D and two temporary rows */
+  ESL_ALLOC(gfb->row, sizeof(double) * 8 * (M+2));
+  /* for cm_p7_GForwardFused(): six interleaved rows and begin probabilities */
+  ESL_ALLOC(gfb->frow, sizeof(double) * 6 * (M+2) * CM_P7_NFUSED);
+  ESL_ALLOC(gfb->fbm,  sizeof(double) *     (M+1) * CM_P7_NFUSED);
+  gfb->allocM = M;
+  return eslOK;
+
+ ERROR:
+  gfb->allocM = 0;
+  return status;
+}
+
+/* Function:  cm_p7_gfb_SetProfile()
+ *
+ * Purpose:   Prepare <gfb> for Forward/Backward with profile <gm>:
+ *            convert its transition scores to probabilities and mark
+ *            all of its emission probabilities as not yet computed
+ *            (they are computed on demand, only for residues that
+ *            occur in the target sequences).
+ *
+ *            Only the special state transitions (<gm->xsc>) of <gm>
+ *            may change before <gm> is used with <gfb> again, as
+ *            they do when p7_ReconfigLength() and friends are
+ *            called; if anything else changes, this function must be
+ *            called again.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEMEM> on allocation failure.
+ */
+int
+cm_p7_gfb_SetProfile(CM_P7_GFB *gfb, const P7_PROFILE *gm)
+{
+  int status;
+  int M = gm->M;
+  int k, t, x;
+
+  if((status = cm_p7_gfb_GrowTo(gfb, M)) != eslOK) return status;
+
+  if(gfb->msc == NULL) {
+    ESL_ALLOC(gfb->msc,  sizeof(double *) * gm->abc->Kp);
+    ESL_ALLOC(gfb->isc,  sizeof(double *) * gm->abc->Kp);
+    ESL_ALLOC(gfb->rset, sizeof(int)      * gm->abc->Kp);
+    for(x = 0; x < gm->abc->Kp; x++) gfb->msc[x] = gfb->isc[x] = NULL;
+    gfb->Kp = gm->abc->Kp;
+    for(x = 0; x < gfb->Kp; x++) {
+      ESL_ALLOC(gfb->msc[x], sizeof(double) * (gfb->allocM+1));
+      ESL_ALLOC(gfb->isc[x], sizeof(double) * (gfb->allocM+1));
+    }
+  }
+  else if(gfb->Kp != gm->abc->Kp) {
+    ESL_EXCEPTION(eslEINVAL, "cm_p7_gfb_SetProfile(): alphabet size changed");
+  }
+
+  /* gm->tsc only has rows 0..M-1; nothing transits out of node M */
+  for(k = 0; k < M; k++)
+    for(t = 0; t < p7P_NTRANS; t++)
+      gfb->tp[t][k] = exp(gm->tsc[k*p7P_NTRANS + t]);
+  for(t = 0; t < p7P_NTRANS; t++) gfb->tp[t][M] = 0.;
+  for(x = 0; x < gfb->Kp; x++) gfb->rset[x] = FALSE;
+
+  gfb->gm = gm;
+  gfb->M  = M;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* Function:  cm_p7_gfb_Destroy()
+ *
+ * Purpose:   Free a CM_P7_GFB.
+ */
+void
+cm_p7_gfb_Destroy(CM_P7_GFB *gfb)
+{
+  int x;
+
+  if(gfb == NULL) return;
+  if(gfb->tsc  != NULL) free(gfb->tsc);
+  if(gfb->row  != NULL) free(gfb->row);
+  if(gfb->frow != NULL) free(gfb->frow);
+  if(gfb->fbm  != NULL) free(gfb->fbm);
+  if(gfb->msc  != NULL) {
+    for(x = 0; x < gfb->Kp; x++) if(gfb->msc[x] != NULL) free(gfb->msc[x]);
+    free(gfb->msc);
+  }
+  if(gfb->isc != NULL) {
+    for(x = 0; x < gfb->Kp; x++) if(gfb->isc[x] != NULL) free(gfb->isc[x]);
+    free(gfb->isc);
+  }
+  if(gfb->rset != NULL) free(gfb->rset);
+  free(gfb);
+  return;
+}
+
+/*****************************************************************
+ * 2. Forward and Backward.
+ *****************************************************************/
+
+/* Function:  cm_p7_GForward()
+ * Synopsis:  Forward for a glocal or truncated profile, special states only.
+ *
+ * Purpose:   Compute the Forward score of digital sequence <dsq> of
+ *            length <L> against profile <gm>, which must be the
+ *            profile <gfb> was last prepared for with
+ *            cm_p7_gfb_SetProfile(). The special state rows of
+ *            <gx>, which must have been allocated for at least <L>
+ *            rows, are filled in log space as p7_GForward() would fill
+ *            them, but the main state cells of <gx> are not touched.
+ *            Return the score in nats in <opt_sc>.
+ *
+ *            In the unexpected event of a result that isn't finite,
+ *            we fall back to p7_GForward() to calculate it.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEMEM> on allocation failure.
+ */
+int
+cm_p7_GForward(const ESL_DSQ *dsq, int L, const P7_PROFILE *gm, CM_P7_GFB *gfb, P7_GMX *gx, float *opt_sc)
+{
+  int           status;
+  int           M    = gm->M;
+  int           i, k;
+  float        *xmx  = gx->xmx;
+  double       *pM, *pI, *pD, *cM, *cI, *cD, *tmp;
+  const double *tMM  = gfb->tp[p7P_MM];
+  const double *tIM  = gfb->tp[p7P_IM];
+  const double *tDM  = gfb->tp[p7P_DM];
+  const double *tBM  = gfb->tp[p7P_BM];
+  const double *tMD  = gfb->tp[p7P_MD];
+  const double *tMI  = gfb->tp[p7P_MI];
+  const double *tII  = gfb->tp[p7P_II];
+  const double *tDD  = gfb->tp[p7P_DD];
+  const double *em, *ei;
+  double        xv[p7G_NXCELLS];
+  double        xB;
+  double        lscale = 0.;
+  double        tNloop = exp(gm->xsc[p7P_N][p7P_LOOP]);
+  double        tNmove = exp(gm->xsc[p7P_N][p7P_MOVE]);
+  double        tJloop = exp(gm->xsc[p7P_J][p7P_LOOP]);
+  double        tJmove = exp(gm->xsc[p7P_J][p7P_MOVE]);
+  double        tCloop = exp(gm->xsc[p7P_C][p7P_LOOP]);
+  double        tEloop = exp(gm->xsc[p7P_E][p7P_LOOP]);
+  double        tEmove = exp(gm->xsc[p7P_E][p7P_MOVE]);
+  int           do_local = p7_profile_IsLocal(gm);
+  float         sc;
+
+  if(gfb->gm != gm || gfb->M != M) ESL_EXCEPTION(eslEINVAL, "cm_p7_GForward(): workspace not prepared for this profile");
+  if((status = gfb_set_emissions(gfb, dsq, L)) != eslOK) return status;
+
+  pM = gfb->row;
+  pI = pM + (M+2);
+  pD = pI + (M+2);
+  cM = pD + (M+2);
+  cI = cM + (M+2);
+  cD = cI + (M+2);
+
+  /* initialization of the zero row */
+  for(k = 0; k <= M; k++) pM[k] = pI[k] = pD[k] = 0.;
+  xv[p7G_N] = 1.;		                 /* S->N, p=1            */
+  xv[p7G_B] = tNmove;		                 /* S->N->B, no N-tail   */
+  xv[p7G_E] = xv[p7G_J] = xv[p7G_C] = 0.;        /* need seq to get here */
+  for(k = 0; k < p7G_NXCELLS; k++) xmx[k] = (xv[k] > 0.) ? log(xv[k]) : -eslINFINITY;
+
+  for(i = 1; i <= L; i++) {
+    em = gfb->msc[dsq[i]];
+    ei = gfb->isc[dsq[i]];
+    xB = xv[p7G_B];
+
+    /* match and insert cells depend only on the previous row */
+    cM[0] = cI[0] = cD[0] = 0.;
+    for(k = 1; k <= M; k++)
+      cM[k] = (pM[k-1] * tMM[k-1] + pI[k-1] * tIM[k-1] + pD[k-1] * tDM[k-1] + xB * tBM[k-1]) * em[k];
+    for(k = 1; k < M; k++)
+      cI[k] = (pM[k] * tMI[k] + pI[k] * tII[k]) * ei[k];
+    cI[M] = 0.;
+
+    /* delete cells are a serial chain along the row */
+    cD[1] = 0.;
+    for(k = 2; k <= M; k++)
+      cD[k] = cM[k-1] * tMD[k-1] + cD[k-1] * tDD[k-1];
+
+    xv[p7G_E] = cM[M] + cD[M];
+    if(do_local) {
+      for(k = 1; k < M; k++) xv[p7G_E] += cM[k] + cD[k];
+    }
+    xv[p7G_J] = xv[p7G_J] * tJloop + xv[p7G_E] * tEloop;
+    xv[p7G_C] = xv[p7G_C] * tCloop + xv[p7G_E] * tEmove;
+    xv[p7G_N] = xv[p7G_N] * tNloop;
+    xv[p7G_B] = xv[p7G_N] * tNmove + xv[p7G_J] * tJmove;
+
+    tmp = pM; pM = cM; cM = tmp;
+    tmp = pI; pI = cI; cI = tmp;
+    tmp = pD; pD = cD; cD = tmp;
+    gfb_rescale(M, pM, pI, pD, xv, &lscale); /* pM, pI, pD: the row we just computed */
+
+    for(k = 0; k < p7G_NXCELLS; k++)
+      xmx[i*p7G_NXCELLS + k] = (xv[k] > 0.) ? log(xv[k]) + lscale : -eslINFINITY;
+  }
+  sc = xmx[L*p7G_NXCELLS + p7G_C] + gm->xsc[p7P_C][p7P_MOVE];
+
+  if(isnan(sc) || sc == eslINFINITY) return p7_GForward(dsq, L, gm, gx, opt_sc);
+
+  gx->M = M;
+  gx->L = L;
+  if(opt_sc != NULL) *opt_sc = sc;
+  return eslOK;
+}
+
+/* Function:  cm_p7_GBackward()
+ * Synopsis:  Backward for a glocal or truncated profile, special states only.
+ *
+ * Purpose:   The Backward counterpart of cm_p7_GForward(): compute
+ *            the Backward score of <dsq> against <gm> and fill the
+ *            special state rows of <gx> in log space as
+ *            p7_GBackward() would fill them. <gfb> must have been
+ *            prepared for <gm> with cm_p7_gfb_SetProfile().
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEMEM> on allocation failure.
+ */
+int
+cm_p7_GBackward(const ESL_DSQ *dsq, int L, const P7_PROFILE *gm, CM_P7_GFB *gfb, P7_GMX *gx, float *opt_sc)
+{
+  int           status;
+  int           M    = gm->M;
+  int           i, k;
+  float        *xmx  = gx->xmx;
+  double       *nM, *nI, *cM, *cI, *cD, *u, *v, *tmp;
+  const double *tMM  = gfb->tp[p7P_MM];
+  const double *tIM  = gfb->tp[p7P_IM];
+  const double *tDM  = gfb->tp[p7P_DM];
+  const double *tBM  = gfb->tp[p7P_BM];
+  const double *tMD  = gfb->tp[p7P_MD];
+  const double *tMI  = gfb->tp[p7P_MI];
+  const double *tII  = gfb->tp[p7P_II];
+  const double *tDD  = gfb->tp[p7P_DD];
+  const double *em, *ei;
+  double        xv[p7G_NXCELLS];
+  double        xE;
+  double        lscale = 0.;
+  double        esc    = p7_profile_IsLocal(gm) ? 1. : 0.;
+  double        tNloop = exp(gm->xsc[p7P_N][p7P_LOOP]);
+  double        tNmove = exp(gm->xsc[p7P_N][p7P_MOVE]);
+  double        tJloop = exp(gm->xsc[p7P_J][p7P_LOOP]);
+  double        tJmove = exp(gm->xsc[p7P_J][p7P_MOVE]);
+  double        tCloop = exp(gm->xsc[p7P_C][p7P_LOOP]);
+  double        tCmove = exp(gm->xsc[p7P_C][p7P_MOVE]);
+  double        tEloop = exp(gm->xsc[p7P_E][p7P_LOOP]);
+  double        tEmove = exp(gm->xsc[p7P_E][p7P_MOVE]);
+  float         sc;
+
+  if(gfb->gm != gm || gfb->M != M) ESL_EXCEPTION(eslEINVAL, "cm_p7_GBackward(): workspace not prepared for this profile");
+  if((status = gfb_set_emissions(gfb, dsq, L)) != eslOK) return status;
+
+  /* the row we're computing is cM, cI, cD, the one we computed last
+   * is nM, nI */
+  cM = gfb->row;
+  cI = cM + (M+2);
+  cD = cI + (M+2);
+  nM = cD + (M+2);
+  nI = nM + (M+2);
+  u  = nI + (M+2);
+  v  = u  + (M+2);
+
+  /* initialization of the L row */
+  xv[p7G_J] = xv[p7G_B] = xv[p7G_N] = 0.;
+  xv[p7G_C] = tCmove;		  /* C<-T */
+  xv[p7G_E] = xv[p7G_C] * tEmove; /* E<-C, no tail */
+  xE = xv[p7G_E];
+  cM[0] = cI[0] = cD[0] = 0.;
+  cM[M] = cD[M] = xE;
+  cI[M] = 0.;
+  for(k = M-1; k >= 1; k--) {
+    cM[k] = xE * esc + cD[k+1] * tMD[k];
+    cD[k] = xE * esc + cD[k+1] * tDD[k];
+    cI[k] = 0.;
+  }
+  gfb_rescale(M, cM, cI, cD, xv, &lscale);
+  for(k = 0; k < p7G_NXCELLS; k++)
+    xmx[L*p7G_NXCELLS + k] = (xv[k] > 0.) ? log(xv[k]) + lscale : -eslINFINITY;
+
+  for(i = L-1; i >= 0; i--) {
+    tmp = nM; nM = cM; cM = tmp;
+    tmp = nI; nI = cI; cI = tmp;
+    em = gfb->msc[dsq[i+1]];
+    ei = gfb->isc[dsq[i+1]];
+
+    /* fold the emission of x_{i+1} into the next row */
+    u[0] = v[0] = 0.;
+    for(k = 1; k <= M; k++) u[k] = nM[k] * em[k];
+    for(k = 1; k <  M; k++) v[k] = nI[k] * ei[k];
+    u[M+1] = v[M] = 0.;
+
+    xv[p7G_B] = 0.;
+    for(k = 1; k <= M; k++) xv[p7G_B] += u[k] * tBM[k-1];
+
+    if(i == 0) { /* only N and B are reachable in row 0 */
+      xv[p7G_N] = xv[p7G_N] * tNloop + xv[p7G_B] * tNmove;
+      xv[p7G_J] = xv[p7G_C] = xv[p7G_E] = 0.;
+      for(k = 0; k < p7G_NXCELLS; k++)
+	xmx[k] = (xv[k] > 0.) ? log(xv[k]) + lscale : -eslINFINITY;
+      break;
+    }
+
+    xv[p7G_J] = xv[p7G_J] * tJloop + xv[p7G_B] * tJmove;
+    xv[p7G_C] = xv[p7G_C] * tCloop;
+    xv[p7G_E] = xv[p7G_J] * tEloop + xv[p7G_C] * tEmove;
+    xv[p7G_N] = xv[p7G_N] * tNloop + xv[p7G_B] * tNmove;
+    xE = xv[p7G_E] * esc;
+
+    /* delete cells are a serial chain along the row */
+    cM[M] = cD[M] = xv[p7G_E];
+    cI[M] = 0.;
+    for(k = M-1; k >= 1; k--)
+      cD[k] = u[k+1] * tDM[k] + cD[k+1] * tDD[k] + xE;
+
+    /* match and insert cells then only need the next row and cD */
+    for(k = 1; k < M; k++) {
+      cM[k] = u[k+1] * tMM[k] + v[k] * tMI[k] + cD[k+1] * tMD[k] + xE;
+      cI[k] = u[k+1] * tIM[k] + v[k] * tII[k];
+    }
+    cM[0] = cI[0] = cD[0] = 0.;
+
+    gfb_rescale(M, cM, cI, cD, xv, &lscale);
+    for(k = 0; k < p7G_NXCELLS; k++)
+      xmx[i*p7G_NXCELLS + k] = (xv[k] > 0.) ? log(xv[k]) + lscale : -eslINFINITY;
+  }
+  sc = xmx[p7G_N];
+
+  if(isnan(sc) || sc == eslINFINITY) return p7_GBackward(dsq, L, gm, gx, opt_sc);
+
+  gx->M = M;
+  gx->L = L;
+  if(opt_sc != NULL) *opt_sc = sc;
+  return eslOK;
+}
+
+/*****************************************************************
+ * 3. Fused Forward for truncated profile variants.
+ *****************************************************************/
+
+/* Function:  cm_p7_GForwardFused()
+ * Synopsis:  Forward for several begin/end variants of a profile in one sweep.
+ *
+ * Purpose:   Compute the Forward scores of digital sequence <dsq> of
+ *            length <L> against <ngm> profiles <gmA[0..ngm-1]>,
+ *            <ngm> <= CM_P7_NFUSED, in a single DP sweep. <gfb> must
+ *            have been prepared with cm_p7_gfb_SetProfile() for a
+ *            profile (usually <gmA[0]>) whose emission scores and
+ *            transition scores other than begins are identical to
+ *            those of each profile in <gmA>, as is the case for the
+ *            standard glocal profile and the truncated profiles
+ *            configured from the same HMM by
+ *            p7_ProfileConfig5PrimeTrunc(),
+ *            p7_ProfileConfig3PrimeTrunc() and
+ *            p7_ProfileConfig5PrimeAnd3PrimeTrunc(). The profiles may
+ *            differ in their begin scores, local/glocal ends and
+ *            length configuration.
+ *
+ *            For each profile <v>, the special state rows are stored
+ *            in <xmxA[v]>, which must have room for <L+1> rows of
+ *            <p7G_NXCELLS> floats and can be a P7_GMX's <xmx>, laid
+ *            out as cm_p7_GForward() and p7_GForward() would lay them
+ *            out, and the score in nats in <scA[v]>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEINCOMPAT> if a profile in <gmA> isn't compatible
+ *            with the one <gfb> was prepared for.
+ *            <eslERANGE> if any result isn't finite; caller should
+ *            compute the scores separately.
+ */
+int
+cm_p7_GForwardFused(const ESL_DSQ *dsq, int L, const P7_PROFILE **gmA, int ngm, CM_P7_GFB *gfb, float **xmxA, float *scA)
+{
+  int           status;
+  int           M = gfb->M;
+  int           i, k, v, s;
+  const int     NV = CM_P7_NFUSED;
+  double       *pM, *pI, *pD, *cM, *cI, *cD, *tmp;
+  const double *tMM = gfb->tp[p7P_MM];
+  const double *tIM = gfb->tp[p7P_IM];
+  const double *tDM = gfb->tp[p7P_DM];
+  const double *tMD = gfb->tp[p7P_MD];
+  const double *tMI = gfb->tp[p7P_MI];
+  const double *tII = gfb->tp[p7P_II];
+  const double *tDD = gfb->tp[p7P_DD];
+  double       *bm  = gfb->fbm;
+  const double *em, *ei;
+  double        a, b, c;
+  double        xN[CM_P7_NFUSED], xB[CM_P7_NFUSED], xE[CM_P7_NFUSED], xJ[CM_P7_NFUSED], xC[CM_P7_NFUSED];
+  double        esc[CM_P7_NFUSED], lscale[CM_P7_NFUSED], max[CM_P7_NFUSED];
+  double        tNloop[CM_P7_NFUSED], tNmove[CM_P7_NFUSED], tJloop[CM_P7_NFUSED], tJmove[CM_P7_NFUSED];
+  double        tCloop[CM_P7_NFUSED], tEloop[CM_P7_NFUSED], tEmove[CM_P7_NFUSED];
+  double        xv[p7G_NXCELLS];
+  int           any_local = FALSE;
+
+  if(ngm < 1 || ngm > NV) ESL_EXCEPTION(eslEINVAL, "cm_p7_GForwardFused(): invalid number of profiles");
+  if(gfb->gm == NULL)     ESL_EXCEPTION(eslEINVAL, "cm_p7_GForwardFused(): workspace not prepared");
+  for(v = 0; v < ngm; v++) if(! gfb_compatible(gfb, gmA[v])) return eslEINCOMPAT;
+  if((status = gfb_set_emissions(gfb, dsq, L)) != eslOK) return status;
+
+  /* per-profile begins and special transitions; unused lanes stay 0. */
+  for(v = 0; v < NV; v++) {
+    if(v < ngm) { 
+      for(k = 0; k < M; k++) bm[k*NV+v] = exp(gmA[v]->tsc[k*p7P_NTRANS + p7P_BM]);
+      bm[M*NV+v] = 0.;
+      esc[v]    = p7_profile_IsLocal(gmA[v]) ? 1. : 0.;
+      tNloop[v] = exp(gmA[v]->xsc[p7P_N][p7P_LOOP]);
+      tNmove[v] = exp(gmA[v]->xsc[p7P_N][p7P_MOVE]);
+      tJloop[v] = exp(gmA[v]->xsc[p7P_J][p7P_LOOP]);
+      tJmove[v] = exp(gmA[v]->xsc[p7P_J][p7P_MOVE]);
+      tCloop[v] = exp(gmA[v]->xsc[p7P_C][p7P_LOOP]);
+      tEloop[v] = exp(gmA[v]->xsc[p7P_E][p7P_LOOP]);
+      tEmove[v] = exp(gmA[v]->xsc[p7P_E][p7P_MOVE]);
+      if(esc[v] > 0.) any_local = TRUE;
+      xN[v] = 1.;		/* S->N, p=1 */
+    }
+    else { 
+      for(k = 0; k <= M; k++) bm[k*NV+v] = 0.;
+      esc[v] = tNloop[v] = tNmove[v] = tJloop[v] = tJmove[v] = tCloop[v] = tEloop[v] = tEmove[v] = 0.;
+      xN[v] = 0.;
+    }
+    xB[v]     = xN[v] * tNmove[v];
+    xE[v]     = xJ[v] = xC[v] = 0.;
+    lscale[v] = 0.;
+  }
+
+  pM = gfb->frow;
+  pI = pM + (M+2)*NV;
+  pD = pI + (M+2)*NV;
+  cM = pD + (M+2)*NV;
+  cI = cM + (M+2)*NV;
+  cD = cI + (M+2)*NV;
+
+  /* initialization of the zero row */
+  for(k = 0; k < (M+1)*NV; k++) pM[k] = pI[k] = pD[k] = 0.;
+  for(v = 0; v < ngm; v++) { 
+    xv[p7G_E] = xE[v]; xv[p7G_N] = xN[v]; xv[p7G_J] = xJ[v]; xv[p7G_B] = xB[v]; xv[p7G_C] = xC[v];
+    for(s = 0; s < p7G_NXCELLS; s++) xmxA[v][s] = (xv[s] > 0.) ? log(xv[s]) : -eslINFINITY;
+  }
+
+  for(i = 1; i <= L; i++) {
+    em = gfb->msc[dsq[i]];
+    ei = gfb->isc[dsq[i]];
+
+    for(v = 0; v < NV; v++) cM[v] = cI[v] = cD[v] = 0.;
+    for(k = 1; k <= M; k++) {
+      a = tMM[k-1]; b = tIM[k-1]; c = tDM[k-1];
+      for(v = 0; v < NV; v++)
+	cM[k*NV+v] = (pM[(k-1)*NV+v] * a + pI[(k-1)*NV+v] * b + pD[(k-1)*NV+v] * c + xB[v] * bm[(k-1)*NV+v]) * em[k];
+    }
+    for(k = 1; k < M; k++) {
+      a = tMI[k]; b = tII[k];
+      for(v = 0; v < NV; v++)
+	cI[k*NV+v] = (pM[k*NV+v] * a + pI[k*NV+v] * b) * ei[k];
+    }
+    for(v = 0; v < NV; v++) cI[M*NV+v] = cD[NV+v] = 0.;
+
+    /* the delete chain is serial in k, but runs across the profiles */
+    for(k = 2; k <= M; k++) {
+      a = tMD[k-1]; b = tDD[k-1];
+      for(v = 0; v < NV; v++)
+	cD[k*NV+v] = cM[(k-1)*NV+v] * a + cD[(k-1)*NV+v] * b;
+    }
+
+    /* local ends are summed onto the end at node M in the order
+     * cm_p7_GForward() sums them, so the results are the same; for
+     * a glocal profile, esc[v] is 0. and adds nothing */
+    for(v = 0; v < NV; v++) xE[v] = cM[M*NV+v] + cD[M*NV+v];
+    if(any_local) { 
+      for(k = 1; k < M; k++)
+	for(v = 0; v < NV; v++) xE[v] += esc[v] * (cM[k*NV+v] + cD[k*NV+v]);
+    }
+    for(v = 0; v < NV; v++) { 
+      xJ[v] = xJ[v] * tJloop[v] + xE[v] * tEloop[v];
+      xC[v] = xC[v] * tCloop[v] + xE[v] * tEmove[v];
+      xN[v] = xN[v] * tNloop[v];
+      xB[v] = xN[v] * tNmove[v] + xJ[v] * tJmove[v];
+    }
+
+    tmp = pM; pM = cM; cM = tmp;
+    tmp = pI; pI = cI; cI = tmp;
+    tmp = pD; pD = cD; cD = tmp;
+
+    /* rescale each profile's row independently, as in gfb_rescale() */
+    for(v = 0; v < NV; v++) max[v] = ESL_MAX(ESL_MAX(xE[v], xJ[v]), ESL_MAX(ESL_MAX(xC[v], xN[v]), xB[v]));
+    for(k = 0; k <= M; k++)
+      for(v = 0; v < NV; v++) max[v] = ESL_MAX(max[v], ESL_MAX(pM[k*NV+v], ESL_MAX(pI[k*NV+v], pD[k*NV+v])));
+    for(v = 0; v < ngm; v++) { 
+      if(max[v] > 0. && (max[v] > GFB_SCALEMAX || max[v] < GFB_SCALEMIN)) { 
+	a = 1. / max[v];
+	for(k = 0; k <= M; k++) { 
+	  pM[k*NV+v] *= a;
+	  pI[k*NV+v] *= a;
+	  pD[k*NV+v] *= a;
+	}
+	xE[v] *= a; xJ[v] *= a; xC[v] *= a; xN[v] *= a; xB[v] *= a;
+	lscale[v] += log(max[v]);
+      }
+      xv[p7G_E] = xE[v]; xv[p7G_N] = xN[v]; xv[p7G_J] = xJ[v]; xv[p7G_B] = xB[v]; xv[p7G_C] = xC[v];
+      for(s = 0; s < p7G_NXCELLS; s++)
+	xmxA[v][i*p7G_NXCELLS + s] = (xv[s] > 0.) ? log(xv[s]) + lscale[v] : -eslINFINITY;
+    }
+  }
+
+  status = eslOK;
+  for(v = 0; v < ngm; v++) { 
+    scA[v] = xmxA[v][L*p7G_NXCELLS + p7G_C] + gmA[v]->xsc[p7P_C][p7P_MOVE];
+    if(isnan(scA[v]) || scA[v] == eslINFINITY) status = eslERANGE;
+  }
+  return status;
+}
+
+
+/* gfb_rescale()
+ * If the largest value in the special states <xv> and the M, I and D
+ * cells <mx>, <ix>, <dx> of the row just computed is outside
+ * [GFB_SCALEMIN..GFB_SCALEMAX], divide them all by it and add its
+ * log to <ret_lscale>. Return the largest value.
+ */
+static double
+gfb_rescale(int M, double *mx, double *ix, double *dx, double *xv, double *ret_lscale)
+{
+  double max = 0.;
+  double inv;
+  int    k;
+
+  for(k = 0; k <= M; k++)          max = ESL_MAX(max, ESL_MAX(mx[k], ESL_MAX(ix[k], dx[k])));
+  for(k = 0; k < p7G_NXCELLS; k++) max = ESL_MAX(max, xv[k]);
+
+  if(max > 0. && (max > GFB_SCALEMAX || max < GFB_SCALEMIN)) {
+    inv = 1. / max;
+    for(k = 0; k <= M; k++) {
+      mx[k] *= inv;
+      ix[k] *= inv;
+      dx[k] *= inv;
+    }
+    for(k = 0; k < p7G_NXCELLS; k++) xv[k] *= inv;
+    *ret_lscale += log(max);
+  }
+  return max;
+}
+
+/* gfb_set_emissions()
+ * Convert the match and insert emission scores of <gfb->gm> to
+ * odds ratios for each residue in <dsq> that hasn't been seen
+ * since cm_p7_gfb_SetProfile().
+ */
+static int
+gfb_set_emissions(CM_P7_GFB *gfb, const ESL_DSQ *dsq, int L)
+{
+  const P7_PROFILE *gm = gfb->gm;
+  int   i, k;
+  int   x;
+
+  for(i = 1; i <= L; i++) {
+    x = dsq[i];
+    if(x >= gfb->Kp) ESL_EXCEPTION(eslEINVAL, "gfb_set_emissions(): invalid residue");
+    if(gfb->rset[x]) continue;
+    gfb->msc[x][0] = gfb->isc[x][0] = 0.;
+    for(k = 1; k <= gm->M; k++) {
+      gfb->msc[x][k] = exp(gm->rsc[x][k*p7P_NR + p7P_MSC]);
+      gfb->isc[x][k] = exp(gm->rsc[x][k*p7P_NR + p7P_ISC]);
+    }
+    gfb->rset[x] = TRUE;
+  }
+  return eslOK;
+}
+
+/* gfb_compatible()
+ * Return TRUE if profile <gm> has the same emission scores and
+ * non-begin transition scores as the profile <gfb> was prepared for,
+ * so it can share <gfb>'s probabilities in cm_p7_GForwardFused().
+ */
+static int
+gfb_compatible(const CM_P7_GFB *gfb, const P7_PROFILE *gm)
+{
+  const P7_PROFILE *gm0 = gfb->gm;
+  int k, t, x;
+
+  if(gm == gm0) return TRUE;
+  if(gm->M != gm0->M || gm->abc->Kp != gm0->abc->Kp) return FALSE;
+  for(k = 0; k < gm->M; k++)
+    for(t = 0; t < p7P_NTRANS; t++)
+      if(t != p7P_BM && gm->tsc[k*p7P_NTRANS + t] != gm0->tsc[k*p7P_NTRANS + t]) return FALSE;
+  for(x = 0; x < gm->abc->Kp; x++)
+    if(memcmp(gm->rsc[x], gm0->rsc[x], sizeof(float) * (gm->M+1) * p7P_NR) != 0) return FALSE;
+  return TRUE;
+}
+
+/*****************************************************************
+ * 4. Unit tests.
+ *****************************************************************/
+#ifdef CM_P7_GFWDBACK_TESTDRIVE
+#include "esl_randomseq.h"
+#include "esl_sq.h"
+
+static char *gmname[CM_P7_NFUSED] = { "gm", "Rgm", "Lgm", "Tgm" };
+
+/* configure_profiles()
+ * Configure <hmm> into the four profiles the pipeline uses, for a
+ * target of length <L>, as pli_p7_env_def() does: the glocal
+ * <gmA[0]> and the 5' truncated <gmA[1]> (Rgm), 3' truncated
+ * <gmA[2]> (Lgm) and 5' and 3' truncated <gmA[3]> (Tgm).
+ */
+static void
+configure_profiles(P7_HMM *hmm, P7_BG *bg, int L, P7_PROFILE **gmA)
+{
+  gmA[0] = p7_profile_Create(hmm->M, hmm->abc);
+  p7_ProfileConfig(hmm, bg, gmA[0], L, p7_GLOCAL);
+  gmA[1] = p7_profile_Clone(gmA[0]);
+  p7_ProfileConfig5PrimeTrunc(gmA[1], L);
+  gmA[2] = p7_profile_Clone(gmA[0]);
+  p7_ProfileConfig3PrimeTrunc(hmm, gmA[2], L);
+  gmA[3] = p7_profile_Clone(gmA[0]);
+  p7_ProfileConfig(hmm, bg, gmA[3], L, p7_LOCAL);
+  p7_ProfileConfig5PrimeAnd3PrimeTrunc(gmA[3], L);
+}
+
+/* reconfig_lengths()
+ * Set the length models of the profiles of configure_profiles() for
+ * a target of length <L>; Tgm has none.
+ */
+static void
+reconfig_lengths(P7_PROFILE **gmA, int L)
+{
+  p7_ReconfigLength(gmA[0], L);
+  p7_ReconfigLength5PrimeTrunc(gmA[1], L);
+  p7_ReconfigLength3PrimeTrunc(gmA[2], L);
+}
+
+/* sample_seq()
+ * Sample target sequence <idx> into <sq>: even ones are emitted by
+ * the core model of <hmm>, so they score well, odd ones are i.i.d.
+ * of length <L>.
+ */
+static void
+sample_seq(ESL_RANDOMNESS *r, P7_HMM *hmm, P7_BG *bg, int L, int idx, ESL_SQ *sq)
+{
+  esl_sq_Reuse(sq);
+  if(idx % 2 == 0) { 
+    do { 
+      esl_sq_Reuse(sq);
+      if(p7_CoreEmit(r, hmm, sq, NULL) != eslOK) esl_fatal("failed to emit sequence");
+    } while(sq->n == 0);
+  }
+  else { 
+    esl_sq_GrowTo(sq, L);
+    if(esl_rsq_xfIID(r, bg->f, hmm->abc->K, L, sq->dsq) != eslOK) esl_fatal("failed to sample sequence");
+    sq->n = L;
+  }
+}
+
+/* compare_xmx()
+ * Return eslOK if the special state rows 0..<L> of <xmx1> and <xmx2>
+ * agree within <tol> nats (both -infinity counts as agreeing),
+ * eslFAIL if not.
+ */
+static int
+compare_xmx(const float *xmx1, const float *xmx2, int L, float tol)
+{
+  float a, b;
+  int   i, s;
+
+  for(i = 0; i <= L; i++)
+    for(s = 0; s < p7G_NXCELLS; s++) { 
+      a = xmx1[i*p7G_NXCELLS + s];
+      b = xmx2[i*p7G_NXCELLS + s];
+      if(a == -eslINFINITY && b == -eslINFINITY) continue;
+      if(a == -eslINFINITY || b == -eslINFINITY || fabs(a - b) > tol) return eslFAIL;
+    }
+  return eslOK;
+}
+
+/* utest_generic()
+ * Sample an HMM of <M> nodes and configure it into gm, Rgm, Lgm and
+ * Tgm. For each profile and <N> sampled target sequences, check that
+ * cm_p7_GForward() and cm_p7_GBackward() give the same scores and
+ * special state rows as p7_GForward() and p7_GBackward() within <tol>
+ * nats (those use a table-driven approximate logsum), and that the
+ * Forward and Backward scores agree.
+ */
+static void
+utest_generic(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int M, int L, int N, float tol)
+{
+  char        msg[] = "cm_p7_gfwdback generic comparison unit test failed";
+  P7_HMM     *hmm   = NULL;
+  P7_PROFILE *gmA[CM_P7_NFUSED];
+  CM_P7_GFB  *gfb   = NULL;
+  P7_GMX     *gx1   = NULL;
+  P7_GMX     *gx2   = NULL;
+  ESL_SQ     *sq    = NULL;
+  float       fsc1, fsc2, bsc1, bsc2;
+  int         idx, v;
+
+  if(p7_hmm_Sample(r, M, abc, &hmm)   != eslOK) esl_fatal("%s", msg);
+  configure_profiles(hmm, bg, L, gmA);
+  if((gfb = cm_p7_gfb_Create(M))      == NULL)  esl_fatal("%s", msg);
+  if((gx1 = p7_gmx_Create(M, L))      == NULL)  esl_fatal("%s", msg);
+  if((gx2 = p7_gmx_Create(M, L))      == NULL)  esl_fatal("%s", msg);
+  if((sq  = esl_sq_CreateDigital(abc)) == NULL) esl_fatal("%s", msg);
+
+  for(idx = 0; idx < N; idx++) { 
+    sample_seq(r, hmm, bg, L, idx, sq);
+    reconfig_lengths(gmA, sq->n);
+    p7_gmx_GrowTo(gx1, M, sq->n);
+    p7_gmx_GrowTo(gx2, M, sq->n);
+
+    for(v = 0; v < CM_P7_NFUSED; v++) { 
+      if(cm_p7_gfb_SetProfile(gfb, gmA[v]) != eslOK) esl_fatal("%s", msg);
+
+      if(p7_GForward   (sq->dsq, sq->n, gmA[v],      gx1, &fsc1) != eslOK) esl_fatal("%s", msg);
+      if(cm_p7_GForward(sq->dsq, sq->n, gmA[v], gfb, gx2, &fsc2) != eslOK) esl_fatal("%s", msg);
+      if(fabs(fsc1 - fsc2) > tol)                                  esl_fatal("%s: %s seq %d Forward score %.4f, p7_GForward() %.4f", msg, gmname[v], idx, fsc2, fsc1);
+      if(compare_xmx(gx1->xmx, gx2->xmx, sq->n, tol) != eslOK)     esl_fatal("%s: %s seq %d Forward special rows differ", msg, gmname[v], idx);
+
+      if(p7_GBackward   (sq->dsq, sq->n, gmA[v],      gx1, &bsc1) != eslOK) esl_fatal("%s", msg);
+      if(cm_p7_GBackward(sq->dsq, sq->n, gmA[v], gfb, gx2, &bsc2) != eslOK) esl_fatal("%s", msg);
+      if(fabs(bsc1 - bsc2) > tol)                                   esl_fatal("%s: %s seq %d Backward score %.4f, p7_GBackward() %.4f", msg, gmname[v], idx, bsc2, bsc1);
+      if(compare_xmx(gx1->xmx, gx2->xmx, sq->n, tol) != eslOK)      esl_fatal("%s: %s seq %d Backward special rows differ", msg, gmname[v], idx);
+
+      if(fabs(fsc2 - bsc2) > 0.001)                                 esl_fatal("%s: %s seq %d Forward score %.4f, Backward score %.4f", msg, gmname[v], idx, fsc2, bsc2);
+    }
+  }
+
+  for(v = 0; v < CM_P7_NFUSED; v++) p7_profile_Destroy(gmA[v]);
+  p7_hmm_Destroy(hmm);
+  cm_p7_gfb_Destroy(gfb);
+  p7_gmx_Destroy(gx1);
+  p7_gmx_Destroy(gx2);
+  esl_sq_Destroy(sq);
+}
+
+/* utest_fused()
+ * Sample an HMM of <M> nodes and configure it into gm, Rgm, Lgm and
+ * Tgm. For <N> sampled target sequences, check that
+ * cm_p7_GForwardFused() scoring all four profiles gives the scores
+ * and special state rows cm_p7_GForward() gives for each. The sums
+ * are done in the same order in both, but the compiler may contract
+ * them into fused multiply-adds differently, so we allow <tol> nats.
+ */
+static void
+utest_fused(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int M, int L, int N, float tol)
+{
+  char        msg[] = "cm_p7_gfwdback fused Forward unit test failed";
+  P7_HMM     *hmm   = NULL;
+  P7_PROFILE *gmA[CM_P7_NFUSED];
+  P7_GMX     *gxA[CM_P7_NFUSED];
+  float      *xmxA[CM_P7_NFUSED];
+  float       scA[CM_P7_NFUSED];
+  CM_P7_GFB  *gfb   = NULL;
+  P7_GMX     *gx    = NULL;
+  ESL_SQ     *sq    = NULL;
+  float       sc;
+  int         idx, v;
+
+  if(p7_hmm_Sample(r, M, abc, &hmm)   != eslOK) esl_fatal("%s", msg);
+  configure_profiles(hmm, bg, L, gmA);
+  if((gfb = cm_p7_gfb_Create(M))      == NULL)  esl_fatal("%s", msg);
+  if((gx  = p7_gmx_Create(M, L))      == NULL)  esl_fatal("%s", msg);
+  for(v = 0; v < CM_P7_NFUSED; v++) 
+    if((gxA[v] = p7_gmx_Create(M, L)) == NULL)  esl_fatal("%s", msg);
+  if((sq  = esl_sq_CreateDigital(abc)) == NULL) esl_fatal("%s", msg);
+
+  for(idx = 0; idx < N; idx++) { 
+    sample_seq(r, hmm, bg, L, idx, sq);
+    reconfig_lengths(gmA, sq->n);
+    p7_gmx_GrowTo(gx, M, sq->n);
+    for(v = 0; v < CM_P7_NFUSED; v++) { 
+      p7_gmx_GrowTo(gxA[v], M, sq->n);
+      xmxA[v] = gxA[v]->xmx;
+    }
+
+    if(cm_p7_gfb_SetProfile(gfb, gmA[0]) != eslOK)                                            esl_fatal("%s", msg);
+    if(cm_p7_GForwardFused(sq->dsq, sq->n, (const P7_PROFILE **) gmA, CM_P7_NFUSED, gfb, xmxA, scA) != eslOK) esl_fatal("%s: profiles not fused", msg);
+
+    for(v = 0; v < CM_P7_NFUSED; v++) { 
+      if(cm_p7_gfb_SetProfile(gfb, gmA[v])                       != eslOK) esl_fatal("%s", msg);
+      if(cm_p7_GForward(sq->dsq, sq->n, gmA[v], gfb, gx, &sc)    != eslOK) esl_fatal("%s", msg);
+      if(fabs(sc - scA[v]) > tol)                                          esl_fatal("%s: %s seq %d fused score %.6f, unfused %.6f", msg, gmname[v], idx, scA[v], sc);
+      if(compare_xmx(gx->xmx, xmxA[v], sq->n, tol)               != eslOK) esl_fatal("%s: %s seq %d special rows differ", msg, gmname[v], idx);
+    }
+  }
+
+  for(v = 0; v < CM_P7_NFUSED; v++) { 
+    p7_profile_Destroy(gmA[v]);
+    p7_gmx_Destroy(gxA[v]);
+  }
+  p7_hmm_Destroy(hmm);
+  cm_p7_gfb_Destroy(gfb);
+  p7_gmx_Destroy(gx);
+  esl_sq_Destroy(sq);
+}
+#endif /*CM_P7_GFWDBACK_TESTDRIVE*/
+
+/*****************************************************************
+ * 5. Test driver.
+ *****************************************************************/
+#ifdef CM_P7_GFWDBACK_TESTDRIVE
+/*
+  gcc -o cm_p7_gfwdback_utest -std=gnu99 -g -O2 -I. -L. -I../hmmer/src -L../hmmer/src -I../easel -L../easel -DCM_P7_GFWDBACK_TESTDRIVE cm_p7_gfwdback.c -linfernal -lhmmer -leasel -lm 
+  ./cm_p7_gfwdback_utest
+*/
+#include "esl_config.h"
+#include "p7_config.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+
+#include "hmmer.h"
+
+#include "infernal.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",             0 },
+  { "-s",        eslARG_INT,    "181", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                    0 },
+  { "-M",        eslARG_INT,     "50", NULL, "n>0", NULL,  NULL, NULL, "length of sampled HMMs",                           0 },
+  { "-L",        eslARG_INT,    "100", NULL, "n>0", NULL,  NULL, NULL, "length of i.i.d. target sequences",                0 },
+  { "-N",        eslARG_INT,     "10", NULL, "n>0", NULL,  NULL, NULL, "number of target sequences per HMM",               0 },
+  { "-t",        eslARG_REAL,   "0.1", NULL, "x>0", NULL,  NULL, NULL, "tolerance (nats) for comparison to p7_GForward()", 0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for cm_p7_gfwdback.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go  = cm_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r   = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc = esl_alphabet_Create(eslRNA);
+  P7_BG          *bg  = p7_bg_Create(abc);
+  int             M   = esl_opt_GetInteger(go, "-M");
+  int             L   = esl_opt_GetInteger(go, "-L");
+  int             N   = esl_opt_GetInteger(go, "-N");
+  float           tol = esl_opt_GetReal   (go, "-t");
+
+  p7_FLogsumInit();
+
+  utest_generic(r, abc, bg, M, L, N, tol);
+  utest_generic(r, abc, bg, 1, L, N, tol); /* a one-node model has no delete chain */
+  utest_fused  (r, abc, bg, M, L, N, 1e-4);
+  utest_fused  (r, abc, bg, 1, L, N, 1e-4);
+
+  p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*CM_P7_GFWDBACK_TESTDRIVE*/
@@ -27,10 +27,64 @@
 #include "esl_vectorops.h"
 #include "esl_wuss.h"
 
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif
+
 #include "hmmer.h"
 
 #include "infernal.h"
 
+/* Random sequences for calibrating a filter HMM are sampled in chunks
+ * of CALIB_CHUNK, each from its own RNG stream seeded by the chunk's
+ * index, so the scores don't depend on the number of threads used.
+ */
+#define CALIB_CHUNK 50
+
+/* the simulations done by cm_p7_CalibrateParallel() */
+#define CALIB_MSV   0  /* local MSV mu */
+#define CALIB_VIT   1  /* local Viterbi mu */
+#define CALIB_LFWD  2  /* local Forward tau */
+#define CALIB_GFWD  3  /* glocal Forward tau */
+#define CALIB_NSIM  4
+
+/* CALIB_PHASE: the simulations that use random sequences of one
+ * length <L>. Each of the <N> sequences, i, is scored by each
+ * simulation s with i < n[s], so simulations of the same length
+ * share the sequences.
+ */
+typedef struct {
+  int      L;                 /* length of the sequences */
+  int      N;                 /* number of sequences, max of n[] */
+  int      n[CALIB_NSIM];     /* number of sequences to score for each simulation, 0 if it's not of length <L> */
+  double  *xv[CALIB_NSIM];    /* [0..n[s]-1] bit scores for each simulation */
+  int      first_chunk;       /* index of this phase's first chunk over all phases, for seeding */
+} CALIB_PHASE;
+
+/* CALIB_WORKQUEUE: the chunks of a phase, shared by the threads
+ * of cm_p7_CalibrateParallel(). The profiles and null model are
+ * configured for the phase's length and only read by the threads.
+ */
+typedef struct {
+  CALIB_PHASE     *ph;
+  P7_OPROFILE     *om;        /* local profile */
+  P7_PROFILE      *gm;        /* glocal profile */
+  P7_BG           *bg;        /* null model */
+  int              nchunks;   /* number of chunks in this phase */
+  int              next;      /* next chunk to sample, protected by <mutex> */
+  int              status;    /* eslOK, or status of first failed chunk, protected by <mutex> */
+  char             errbuf[eslERRBUFSIZE];
+#ifdef HMMER_THREADS
+  pthread_mutex_t  mutex;
+#endif
+} CALIB_WORKQUEUE;
+
+static int  calib_chunk (CALIB_WORKQUEUE *wq, int c, P7_OMX *ox, P7_GMX *gx, ESL_DSQ *dsq, char *errbuf);
+static void calib_worker(CALIB_WORKQUEUE *wq);
+#ifdef HMMER_THREADS
+static void *calib_thread(void *arg);
+#endif
+
 /* Function: BuildP7HMM_MatchEmitsOnly()
  * Incept:   EPN, Tue Aug  5 15:33:00 2008
  * 
@@ -228,6 +282,7 @@ cm_cp9_to_p7(CM_t *cm, CP9_t *cp9, char *errbuf)
  * 
  * Purpose:  Calibrate a p7 HMM for local MSV, Viterbi, Forward and 
  *           also glocal Forward. 
+ *           Same as cm_p7_CalibrateParallel() without threads.
  * 
  * Args:     hmm       - the hmm
  *           errbuf    - for error messages
@@ -256,30 +311,171 @@ cm_p7_Calibrate(P7_HMM *hmm, char *errbuf,
 		double ElfT, double EgfT, 
 		double *ret_gfmu, double *ret_gflambda)
 {
-  int        status;
-  P7_OPROFILE    *om = NULL;
-  P7_BG          *bg = NULL;
-  P7_PROFILE     *gm = NULL;
-  ESL_RANDOMNESS *r  = NULL;
-  double lmmu, lvmu, lftau, gfmu;
-  double lmlam, lvlam, lflam, gflambda, lambda;
+  return cm_p7_CalibrateParallel(hmm, errbuf, ElmL, ElvL, ElfL, EgfL, ElmN, ElvN, ElfN, EgfN, ElfT, EgfT, 0, ret_gfmu, ret_gflambda);
+}
 
-  /*printf("cm_p7_Calibrate:\n\tElmL: %d\n\tElvL: %d\n\tElfL: %d\n\tEgfL: %d\n\tElmN: %d\n\tElvN: %d\n\tElfN: %d\n\tEgfN: %d\n\tElfT: %f\n\tEgfT: %f\n\n", ElmL, ElvL, ElfL, EgfL, ElmN, ElvN, ElfN, EgfN, ElfT, EgfT, do_real, do_null3, do_fitlam, do_bias);*/
+/* Function: cm_p7_CalibrateParallel()
+ * 
+ * Purpose:  Calibrate a p7 HMM for local MSV, Viterbi, Forward and 
+ *           also glocal Forward, using <ncpus> threads if <ncpus> is
+ *           greater than 1 and we were compiled with thread support.
+ *
+ *           As in HMMER's p7_Calibrate(), each calibration scores
+ *           random iid sequences sampled from the background
+ *           model. Calibrations that use sequences of the same
+ *           length (by default local MSV and Viterbi) score the
+ *           same sequences, so each sequence is sampled once. The
+ *           sequences are sampled in chunks, each from its own RNG
+ *           stream with a fixed seed, and the chunks are spread
+ *           over the threads, so the results are reproducible and
+ *           identical for any <ncpus>.
+ * 
+ * Args:     hmm       - the hmm
+ *           errbuf    - for error messages
+ *           ElmL      - length of sequences to sample for local MSV
+ *           ElvL      - length of sequences to sample for local Vit
+ *           ElfL      - length of sequences to sample for local Fwd
+ *           EgfL      - length of sequences to sample for glocal Fwd
+ *           ElmN      - number of sequences to sample for local MSV
+ *           ElvN      - number of sequences to sample for local Vit
+ *           ElfN      - number of sequences to sample for local Fwd
+ *           EgfN      - number of sequences to sample for glocal Fwd
+ *           ElfT      - fraction of tail mass to fit for  local Fwd (usually (HMMER3 is) 0.04)
+ *           EgfT      - fraction of tail mass to fit for glocal Fwd 
+ *           ncpus     - number of threads to use, 0 or 1 for none
+ *           ret_gfmu  - RETURN: mu for glocal forward
+ *           ret_gflambda - RETURN: lambda for glocal forward
+ *           
+ * Return:   eslOK   on success
+ *
+ * Throws:   eslEINCOMPAT on contract violation
+ *           eslEMEM on memory error
+ *           eslESYS if a thread can't be created
+ */
+int
+cm_p7_CalibrateParallel(P7_HMM *hmm, char *errbuf, 
+			int ElmL, int ElvL, int ElfL, int EgfL, 
+			int ElmN, int ElvN, int ElfN, int EgfN, 
+			double ElfT, double EgfT, int ncpus,
+			double *ret_gfmu, double *ret_gflambda)
+{
+  int              status;
+  P7_OPROFILE     *om = NULL;
+  P7_BG           *bg = NULL;
+  P7_PROFILE      *gm = NULL;   /* local, then glocal after we've created <om> from it */
+  CALIB_PHASE      phA[CALIB_NSIM];
+  CALIB_WORKQUEUE  wq;
+  double          *xvA[CALIB_NSIM];
+  int              LA[CALIB_NSIM];
+  int              NA[CALIB_NSIM];
+  int              nph = 0;     /* number of phases (distinct sequence lengths) */
+  int              nchunks = 0; /* total number of chunks over all phases */
+  int              s, s2, p;
+  double           gmu, glam;
+  double           lmmu, lvmu, lftau, gfmu;
+  double           gflambda, lambda;
+#ifdef HMMER_THREADS
+  pthread_t       *threadA  = NULL;
+  int              nthreads;
+  int              t;
+#endif
+
+  LA[CALIB_MSV] = ElmL; LA[CALIB_VIT] = ElvL; LA[CALIB_LFWD] = ElfL; LA[CALIB_GFWD] = EgfL;
+  NA[CALIB_MSV] = ElmN; NA[CALIB_VIT] = ElvN; NA[CALIB_LFWD] = ElfN; NA[CALIB_GFWD] = EgfN;
+  for(s = 0; s < CALIB_NSIM; s++) xvA[s] = NULL;
 
   /* most of this code stolen from hmmer's evalues.c::p7_Calibrate() */
-  if ((r      = esl_randomness_CreateFast(42)) == NULL)                   ESL_XFAIL(eslEMEM, errbuf, "cm_p7_Calibrate(): failed to create RNG");
   if ((bg     = p7_bg_Create(hmm->abc)) == NULL)                          ESL_XFAIL(eslEMEM, errbuf, "cm_p7_Calibrate(): failed to allocate background");
   if ((gm     = p7_profile_Create(hmm->M, hmm->abc))  == NULL)            ESL_XFAIL(eslEMEM, errbuf, "cm_p7_Calibrate(): failed to allocate profile");
   if ((status = p7_ProfileConfig(hmm, bg, gm, ElmL, p7_LOCAL)) != eslOK)  ESL_XFAIL(status,  errbuf, "cm_p7_Calibrate(): failed to configure profile");
   if ((om     = p7_oprofile_Create(hmm->M, hmm->abc)) == NULL)            ESL_XFAIL(eslEMEM, errbuf, "cm_p7_Calibrate(): failed to create optimized profile");
   if ((status = p7_oprofile_Convert(gm, om)) != eslOK)                    ESL_XFAIL(status,  errbuf, "cm_p7_Calibrate(): failed to convert to optimized profile");
+  if ((status = p7_ProfileConfig(hmm, bg, gm, EgfL, p7_GLOCAL)) != eslOK) ESL_XFAIL(status,  errbuf, "cm_p7_Calibrate(): failed to configure glocal profile");
+
+  lambda = 0.;
+  if ((status = p7_Lambda(hmm, bg, &lambda)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine lambda");
+
+  /* group the simulations by sequence length */
+  for(s = 0; s < CALIB_NSIM; s++) { 
+    if(NA[s] <= 0) ESL_XFAIL(eslEINCOMPAT, errbuf, "cm_p7_Calibrate(): number of sequences to sample must be positive");
+    ESL_ALLOC(xvA[s], sizeof(double) * NA[s]);
+    for(p = 0; p < nph; p++) if(phA[p].L == LA[s]) break;
+    if(p == nph) { 
+      phA[p].L = LA[s];
+      phA[p].N = 0;
+      esl_vec_ISet(phA[p].n, CALIB_NSIM, 0);
+      for(s2 = 0; s2 < CALIB_NSIM; s2++) phA[p].xv[s2] = NULL;
+      nph++;
+    }
+    phA[p].n[s]  = NA[s];
+    phA[p].xv[s] = xvA[s];
+    phA[p].N     = ESL_MAX(phA[p].N, NA[s]);
+  }
 
-  /* The calibration steps themselves */
-  lambda = lmlam = lvlam = lflam = 0.;
-  if ((status = p7_Lambda      (hmm, bg, &lambda))                         != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine lambda");
-  if ((status = p7_MSVMu    (r, om, bg, ElmL, ElmN, lambda, &lmmu))        != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine msv mu");
-  if ((status = p7_ViterbiMu(r, om, bg, ElvL, ElvN, lambda, &lvmu))        != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine vit mu");
-  if ((status = p7_Tau      (r, om, bg, ElfL, ElfN, lambda, ElfT, &lftau)) != eslOK)   ESL_XFAIL(status,  errbuf, "failed to determine fwd tau");
+  /* sample and score the sequences of each phase */
+#ifdef HMMER_THREADS
+  if(ncpus > 1) ESL_ALLOC(threadA, sizeof(pthread_t) * ncpus);
+  if(pthread_mutex_init(&wq.mutex, NULL) != 0) ESL_XFAIL(eslESYS, errbuf, "mutex init failed");
+#endif
+  for(p = 0; p < nph; p++) { 
+    phA[p].first_chunk = nchunks;
+    p7_oprofile_ReconfigLength(om, phA[p].L);
+    p7_ReconfigLength(gm, phA[p].L);
+    p7_bg_SetLength(bg, phA[p].L);
+
+    wq.ph        = &(phA[p]);
+    wq.om        = om;
+    wq.gm        = gm;
+    wq.bg        = bg;
+    wq.nchunks   = (phA[p].N + CALIB_CHUNK - 1) / CALIB_CHUNK;
+    wq.next      = 0;
+    wq.status    = eslOK;
+    wq.errbuf[0] = '\0';
+    nchunks     += wq.nchunks;
+
+#ifdef HMMER_THREADS
+    nthreads = ESL_MIN(ncpus, wq.nchunks);
+    if(nthreads > 1) { 
+      for(t = 0; t < nthreads; t++) { 
+	if(pthread_create(&(threadA[t]), NULL, calib_thread, &wq) != 0) { 
+	  /* let the threads we did create finish, then fail */
+	  for(s = 0; s < t; s++) pthread_join(threadA[s], NULL);
+	  pthread_mutex_destroy(&wq.mutex);
+	  ESL_XFAIL(eslESYS, errbuf, "cm_p7_Calibrate() failed to create thread");
+	}
+      }
+      for(t = 0; t < nthreads; t++) pthread_join(threadA[t], NULL);
+    }
+    else calib_worker(&wq);
+#else
+    calib_worker(&wq);
+#endif
+    if(wq.status != eslOK) { 
+#ifdef HMMER_THREADS
+      pthread_mutex_destroy(&wq.mutex);
+#endif
+      ESL_XFAIL(wq.status, errbuf, "%s", wq.errbuf);
+    }
+  }
+#ifdef HMMER_THREADS
+  pthread_mutex_destroy(&wq.mutex);
+  if(threadA != NULL) free(threadA);
+  threadA = NULL;
+#endif
+
+  /* fit the scores */
+  if ((status = esl_gumbel_FitCompleteLoc(xvA[CALIB_MSV], ElmN, lambda, &lmmu)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine msv mu");
+  if ((status = esl_gumbel_FitCompleteLoc(xvA[CALIB_VIT], ElvN, lambda, &lvmu)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine vit mu");
+  /* Explanation of the eqn below: first find the x at which the Gumbel tail
+   * mass is predicted to be equal to tailp. Then back up from that x
+   * by log(tailp)/lambda to set the origin of the exponential tail to 1.0
+   * instead of tailp.
+   */
+  if ((status = esl_gumbel_FitComplete(xvA[CALIB_LFWD], ElfN, &gmu, &glam)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine fwd tau");
+  lftau = esl_gumbel_invcdf(1.0-ElfT, gmu, glam) + (log(ElfT) / lambda);
+  if ((status = esl_gumbel_FitComplete(xvA[CALIB_GFWD], EgfN, &gmu, &glam)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine fwd tau");
+  gfmu  = esl_gumbel_invcdf(1.0-EgfT, gmu, glam) + (log(EgfT) / lambda);
+  gflambda = lambda;
 
   /* set the p7's evparam[] */
   hmm->evparam[p7_MMU]     = lmmu;
@@ -290,12 +486,7 @@ cm_p7_Calibrate(P7_HMM *hmm, char *errbuf,
   hmm->evparam[p7_FLAMBDA] = lambda;
   hmm->flags              |= p7H_STATS;
 
-  /* finally, determine Glocal Forward stats */
-  if ((status = p7_ProfileConfig(hmm, bg, gm, EgfL, p7_GLOCAL)) != eslOK) goto ERROR; 
-  if ((status = cm_p7_Tau(r, errbuf, NULL, gm, bg, EgfL, EgfN, lambda, EgfT, &gfmu)) != eslOK) ESL_XFAIL(status,  errbuf, "failed to determine fwd tau");
-  gflambda = lambda;
-
-  esl_randomness_Destroy(r); 
+  for(s = 0; s < CALIB_NSIM; s++) free(xvA[s]);
   p7_bg_Destroy(bg);         
   p7_oprofile_Destroy(om);   
   p7_profile_Destroy(gm);   
@@ -306,15 +497,148 @@ cm_p7_Calibrate(P7_HMM *hmm, char *errbuf,
   return eslOK;
 
  ERROR: 
-  if(r != NULL)  esl_randomness_Destroy(r); 
+#ifdef HMMER_THREADS
+  if(threadA != NULL) free(threadA);
+#endif
+  for(s = 0; s < CALIB_NSIM; s++) if(xvA[s] != NULL) free(xvA[s]);
   if(bg != NULL) p7_bg_Destroy(bg);         
   if(om != NULL) p7_oprofile_Destroy(om);   
   if(gm != NULL) p7_profile_Destroy(gm);   
   if(ret_gfmu != NULL) *ret_gfmu = 0.;
   if(ret_gflambda != NULL) *ret_gflambda = 0.;
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "cm_p7_Calibrate(): out of memory");
   return status;
 }
 
+/* calib_chunk()
+ * Sample the sequences of chunk <c> of the phase in <wq> from the
+ * chunk's own RNG stream and score each with the simulations that
+ * need it. <ox>, <gx> and <dsq> are the caller's scratch space,
+ * <ox> and <gx> may be NULL if no simulation in the phase needs them.
+ */
+static int
+calib_chunk(CALIB_WORKQUEUE *wq, int c, P7_OMX *ox, P7_GMX *gx, ESL_DSQ *dsq, char *errbuf)
+{
+  int             status;
+  CALIB_PHASE    *ph = wq->ph;
+  ESL_RANDOMNESS *r  = NULL;
+  int             i;
+  int             iend = ESL_MIN(ph->N, (c+1) * CALIB_CHUNK);
+  float           sc, nullsc;
+
+  if ((r = esl_randomness_CreateFast(42 + ph->first_chunk + c)) == NULL) ESL_FAIL(eslEMEM, errbuf, "cm_p7_Calibrate(): failed to create RNG");
+
+  for (i = c * CALIB_CHUNK; i < iend; i++) 
+    {
+      if((status = esl_rsq_xfIID(r, wq->bg->f, wq->bg->abc->K, ph->L, dsq)) != eslOK) goto ERROR;
+      if((status = p7_bg_NullOne(wq->bg, dsq, ph->L, &nullsc))             != eslOK) goto ERROR;
+      if(i < ph->n[CALIB_MSV]) { 
+	status = p7_MSVFilter(dsq, ph->L, wq->om, ox, &sc);
+	if (status != eslERANGE && status != eslOK) goto ERROR;
+	ph->xv[CALIB_MSV][i] = (sc - nullsc) / eslCONST_LOG2;
+      }
+      if(i < ph->n[CALIB_VIT]) { 
+	status = p7_ViterbiFilter(dsq, ph->L, wq->om, ox, &sc);
+	if (status != eslERANGE && status != eslOK) goto ERROR;
+	ph->xv[CALIB_VIT][i] = (sc - nullsc) / eslCONST_LOG2;
+      }
+      if(i < ph->n[CALIB_LFWD]) { 
+	if ((status = p7_ForwardParser(dsq, ph->L, wq->om, ox, &sc)) != eslOK) goto ERROR;
+	ph->xv[CALIB_LFWD][i] = (sc - nullsc) / eslCONST_LOG2;
+      }
+      if(i < ph->n[CALIB_GFWD]) { 
+	if ((status = p7_GForward(dsq, ph->L, wq->gm, gx, &sc)) != eslOK) goto ERROR;
+	ph->xv[CALIB_GFWD][i] = (sc - nullsc) / eslCONST_LOG2;
+      }
+    }
+
+  esl_randomness_Destroy(r);
+  return eslOK;
+
+ ERROR:
+  if(r != NULL) esl_randomness_Destroy(r);
+  ESL_FAIL(status, errbuf, "cm_p7_Calibrate(): failed to score a random sequence");
+}
+
+/* calib_worker()
+ * Sample and score chunks of the phase in <wq>, taking the next
+ * unsampled chunk from <wq> until none remain or a chunk has
+ * failed. Chunks write to disjoint ranges of the score arrays.
+ */
+static void
+calib_worker(CALIB_WORKQUEUE *wq)
+{
+  int      status;
+  CALIB_PHASE *ph  = wq->ph;
+  P7_OMX  *ox  = NULL;
+  P7_GMX  *gx  = NULL;
+  ESL_DSQ *dsq = NULL;
+  int      c;
+  char     errbuf[eslERRBUFSIZE];
+
+  if(ph->n[CALIB_MSV] > 0 || ph->n[CALIB_VIT] > 0 || ph->n[CALIB_LFWD] > 0) { 
+    if ((ox = p7_omx_Create(wq->om->M, 0, ph->L)) == NULL) { status = eslEMEM; goto ERROR; } /* DP matrix: for ForwardParser, L rows */
+  }
+  if(ph->n[CALIB_GFWD] > 0) { 
+    if ((gx = p7_gmx_Create(wq->gm->M, ph->L)) == NULL)    { status = eslEMEM; goto ERROR; } /* DP matrix: for GForward, L rows */
+  }
+  ESL_ALLOC(dsq, sizeof(ESL_DSQ) * (ph->L+2));
+
+  while(1) { 
+#ifdef HMMER_THREADS
+    if(pthread_mutex_lock(&wq->mutex) != 0) esl_fatal("mutex lock failed");
+#endif
+    c = (wq->status == eslOK && wq->next < wq->nchunks) ? wq->next++ : -1;
+#ifdef HMMER_THREADS
+    if(pthread_mutex_unlock(&wq->mutex) != 0) esl_fatal("mutex unlock failed");
+#endif
+    if(c == -1) break;
+    if((status = calib_chunk(wq, c, ox, gx, dsq, errbuf)) != eslOK) goto FAILED;
+  }
+
+  free(dsq);
+  if(ox != NULL) p7_omx_Destroy(ox);
+  if(gx != NULL) p7_gmx_Destroy(gx);
+  return;
+
+ ERROR:
+  strcpy(errbuf, "cm_p7_Calibrate(): out of memory");
+ FAILED:
+#ifdef HMMER_THREADS
+  if(pthread_mutex_lock(&wq->mutex) != 0) esl_fatal("mutex lock failed");
+#endif
+  if(wq->status == eslOK) { 
+    wq->status = status;
+    strcpy(wq->errbuf, errbuf);
+  }
+#ifdef HMMER_THREADS
+  if(pthread_mutex_unlock(&wq->mutex) != 0) esl_fatal("mutex unlock failed");
+#endif
+  if(dsq != NULL) free(dsq);
+  if(ox  != NULL) p7_omx_Destroy(ox);
+  if(gx  != NULL) p7_gmx_Destroy(gx);
+  return;
+}
+
+#ifdef HMMER_THREADS
+/* calib_thread()
+ * Thread function for cm_p7_CalibrateParallel().
+ */
+static void *
+calib_thread(void *arg)
+{
+#ifdef HAVE_FLUSH_ZERO_MODE
+  /* avoid the performance penalty of sub-normal values, the flag
+   * must be set for each thread (see TW notes 05/08/10)
+   */
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+  calib_worker((CALIB_WORKQUEUE *) arg);
+  pthread_exit(NULL);
+  return NULL; /* NOT REACHED */
+}
+#endif /*HMMER_THREADS*/
+
 /* Function:  cm_p7_Tau()
  * Synopsis:  Determine Forward tau by brief simulation.
  * Incept:    SRE, Thu Aug  9 15:08:39 2007 [Janelia] (p7_Tau())
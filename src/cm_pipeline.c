@@ -4,7 +4,8 @@
  *   1. CM_PIPELINE: allocation, initialization, destruction
  *   2. Pipeline API
  *   3. Non-API filter stage search functions.
- *   4. Copyright and license information
+ *   4. Benchmark driver
+ *   5. Copyright and license information
  */
 #include "esl_config.h"
 #include "p7_config.h"
@@ -32,16 +33,33 @@ static int  pli_cyk_seq_filter     (CM_PIPELINE *pli, off_t cm_offset, const ESL
 static int  pli_final_stage        (CM_PIPELINE *pli, off_t cm_offset, const ESL_SQ *sq, int64_t *es, int64_t *ee, int nenv, CM_TOPHITS *hitlist, CM_t **opt_cm);
 static int  pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, const ESL_SQ *sq, int64_t *ws, int64_t *we, int nwin, CM_TOPHITS *hitlist, CM_t **opt_cm);
 static int  pli_dispatch_cm_search (CM_PIPELINE *pli, CM_t *cm, ESL_DSQ *dsq, int64_t start, int64_t stop, CM_TOPHITS *hitlist, float cutoff, float env_cutoff, int qdbidx, float *ret_sc, int64_t *opt_envi, int64_t *opt_envj);
-static int  pli_align_hit          (CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit);
+static int  pli_align_hit          (CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit, int cp9b_valid);
 static int  pli_scan_mode_read_cm  (CM_PIPELINE *pli, off_t cm_offset, float *p7_evparam, int p7_max_length, CM_t **ret_cm);
 
 static int   pli_pass_statistics        (FILE *ofp, CM_PIPELINE *pli, int pass_idx);
 static int   pli_hmmonly_pass_statistics(FILE *ofp, CM_PIPELINE *pli);
 static int   pli_sum_statistics         (CM_PIPELINE *pli);
-static void  pli_copy_subseq            (const ESL_SQ *src_sq, ESL_SQ *dest_sq, int64_t i, int64_t L);
+static int   pli_workspace_statistics   (FILE *ofp, CM_PIPELINE *pli);
+static int   pli_sqview_Set             (CM_PIPELINE *pli, ESL_SQ **vsqp, const ESL_SQ *src_sq, int64_t i, int64_t L, int do_subseq);
+static void  pli_sqview_Destroy         (ESL_SQ *vsq);
+static int   pli_wcache_Reset           (CM_PIPELINE *pli, const ESL_SQ *sq);
+static int   pli_wcache_SetSSV          (CM_PIPELINE *pli, int64_t *ws, int64_t *we, int nwin, int64_t wc_off, int64_t n, double F1);
+static int   pli_wcache_Window          (CM_PIPELINE *pli, int64_t ws, int64_t we, CM_P7_WCWIN **ret_wcw);
+static float pli_wcache_Filter          (CM_PIPELINE *pli, P7_OPROFILE *om, P7_OMX *ox, const ESL_DSQ *subdsq, int wlen, int64_t wc_i, CM_P7_WCWIN *wcw, int stage);
+static float pli_wcache_FilterScore     (P7_BG *bg, const ESL_DSQ *subdsq, int wlen, CM_P7_WCWIN *wcw);
+static int   pli_lcmask                 (CM_PIPELINE *pli, P7_BG *bg, const ESL_SQ *sq);
+static int   pli_lcmask_add_segment     (CM_PIPELINE *pli, int64_t i, int64_t j);
+static void  pli_oprofile_ReconfigLength(CM_PIPELINE *pli, P7_OPROFILE *om, int L, int do_msv, int do_rest);
+static void  pli_oprofile_InvalidateLength(CM_PIPELINE *pli);
+static int   pli_fparse_Next            (CM_PIPELINE *pli, int M, int L, P7_OMX **ret_ox);
+static void  pli_fparse_Release         (CM_PIPELINE *pli);
+static void  pli_terminal_windows       (const int64_t *ws, const int64_t *we, int nwin, int64_t L, int need_first, int need_final, int *ok);
 static char *pli_describe_pass          (int pass_idx); 
 static char *pli_describe_hits_for_pass (int pass_idx); 
 static float pli_mxsize_limit_from_W    (int W);
+static void  pli_merge_accounting       (CM_PLI_ACCT *a1, const CM_PLI_ACCT *a2);
+static int   pli_gfwd_fused             (CM_PIPELINE *pli, const ESL_SQ *seq, int64_t wstart, int64_t wend, int64_t sqn, P7_PROFILE *gm, P7_PROFILE *Rgm, P7_PROFILE *Lgm, P7_PROFILE *Tgm, float *ret_fwdsc);
+static int   pli_gfwd_cached            (CM_PIPELINE *pli, const ESL_SQ *sq, int64_t wstart, int64_t wend, int M, P7_GMX *gx, float *ret_fwdsc);
 
 /*****************************************************************
  * 1. The CM_PIPELINE object: allocation, initialization, destruction.
@@ -118,6 +136,8 @@ static float pli_mxsize_limit_from_W    (int W);
  *            | --noF3b      |  turn off local forward bias filter          |   FALSE   |
  *            | --noF4b      |  turn off glocal forward bias filter         |   FALSE   |
  *            | --doF5b      |  turn on  per-envelope bias filter           |   TRUE    |
+ *            | --lcmask <x> |  mask low complexity w/score > <x> bits      |   FALSE   |
+ *            | --lcw <n>    |  window length for --lcmask                  |      64   |
  * *** options for defining filter thresholds, usually NULL bc set in DB-size dependent manner
  *            | --F1         |  Stage 1  (MSV)         P value threshold    |    NULL   |
  *            | --F1b        |  Stage 1b (MSV bias)    P value threshold    |    NULL   |
@@ -153,6 +173,7 @@ static float pli_mxsize_limit_from_W    (int W);
  *            | --timeF5     |  abort after F5b stage, for timing expts     |   FALSE   | 
  *            | --timeF6     |  abort after F6  stage, for timing expts     |   FALSE   | 
  *            | --trmF3      |  terminate after F3 stage, output windows    |   FALSE   | 
+ *            | --deferali   |  align hits only after thresholding          |   FALSE   | 
  *            | --nogreedy   |  use optimal CM hit resolution, not greedy   |   FALSE   |
  *            | --cp9noel    |  turn off EL state in CP9 HMM                |   FALSE   |
  *            | --cp9gloc    |  configure CP9 HMM in glocal mode            |   FALSE   |
@@ -173,9 +194,58 @@ cm_pipeline_Create(ESL_GETOPTS *go, ESL_ALPHABET *abc, int clen_hint, int L_hint
   int          status;
   double       Z_Mb; /* database size in Mb */
   int          pass_idx; /* counter over passes */
+  int          c;        /* counter over residue counts */
 
   ESL_ALLOC(pli, sizeof(CM_PIPELINE));
 
+  /* glocal Forward cache, filled by pli_gfwd_fused() (see cm_Pipeline()) */
+  pli->f4c_dsq = NULL;
+  pli->f4c_n   = 0;
+  for(pass_idx = 0; pass_idx < NPLI_PASSES; pass_idx++) { 
+    pli->f4c_do[pass_idx]     = FALSE;
+    pli->f4c_ws[pass_idx]     = -1;
+    pli->f4c_we[pass_idx]     = -1;
+    pli->f4c_sc[pass_idx]     = 0.;
+    pli->f4c_xmx[pass_idx]    = NULL;
+    pli->f4c_nalloc[pass_idx] = 0;
+  }
+
+  /* sequence views, created on first use by pli_sqview_Set() */
+  pli->term_sqv = NULL;
+  pli->win_sqv  = NULL;
+  pli->hit_sqv  = NULL;
+  pli->nsqalloc = 0;
+
+  /* local HMM filter results shared by passes, reset by cm_Pipeline() */
+  pli->wc.dsq          = NULL;
+  pli->wc.L            = 0;
+  pli->wc.ssv_i        = pli->wc.ssv_j = -1;
+  pli->wc.ssv_F1       = 0.;
+  pli->wc.ssv_ws       = NULL;
+  pli->wc.ssv_we       = NULL;
+  pli->wc.ssv_nwin     = 0;
+  pli->wc.ssv_nalloc   = 0;
+  pli->wc.win          = NULL;
+  pli->wc.nwin         = 0;
+  pli->wc.nalloc       = 0;
+  pli->wc.scored       = NULL;
+  pli->wc.scored_alloc = 0;
+  for(pass_idx = 0; pass_idx < NPLI_PASSES; pass_idx++) pli->wc.pstart[pass_idx] = pli->wc.pn[pass_idx] = 0;
+
+  /* filter HMM length configuration memo, see pli_oprofile_ReconfigLength() */
+  pli_oprofile_InvalidateLength(pli);
+  pli->nocfg      = 0;
+  pli->nocfg_skip = 0;
+
+  /* Forward parses kept by the HMM only pass, see pli_fparse_Next() */
+  pli->fpA       = NULL;
+  pli->fp_ws     = NULL;
+  pli->fp_we     = NULL;
+  pli->fp_mb     = NULL;
+  pli->fp_mb_tot = 0.;
+  pli->fp_n      = 0;
+  pli->fp_nalloc = 0;
+
   /* allocate matrices */
   if ((pli->fwd  = p7_omx_Create(clen_hint, L_hint, L_hint)) == NULL) goto ERROR;
   if ((pli->bck  = p7_omx_Create(clen_hint, L_hint, L_hint)) == NULL) goto ERROR;
@@ -185,6 +255,7 @@ cm_pipeline_Create(ESL_GETOPTS *go, ESL_ALPHABET *abc, int clen_hint, int L_hint
   if ((pli->gbck = p7_gmx_Create(clen_hint, L_hint))         == NULL) goto ERROR;
   if ((pli->gxf  = p7_gmx_Create(clen_hint, L_hint))         == NULL) goto ERROR;
   if ((pli->gxb  = p7_gmx_Create(clen_hint, L_hint))         == NULL) goto ERROR;     
+  if ((pli->gfb  = cm_p7_gfb_Create(clen_hint))              == NULL) goto ERROR;
 
   /* Initializations */
   pli->mode         = mode;
@@ -237,6 +308,7 @@ cm_pipeline_Create(ESL_GETOPTS *go, ESL_ALPHABET *abc, int clen_hint, int L_hint
   pli->do_wcx          = esl_opt_IsUsed    (go, "--wcx")        ? TRUE  : FALSE;
   pli->wcx             = esl_opt_IsUsed    (go, "--wcx")        ? esl_opt_GetReal(go, "--wcx") : 0.;
   pli->do_one_cmpass   = esl_opt_GetBoolean(go, "--onepass")    ? TRUE  : FALSE;
+  pli->do_shortpass    = esl_opt_GetBoolean(go, "--shortpass")  ? TRUE  : FALSE;
   pli->do_time_F1      = esl_opt_GetBoolean(go, "--timeF1")     ? TRUE  : FALSE;
   pli->do_time_F2      = esl_opt_GetBoolean(go, "--timeF2")     ? TRUE  : FALSE;
   pli->do_time_F3      = esl_opt_GetBoolean(go, "--timeF3")     ? TRUE  : FALSE;
@@ -244,6 +316,7 @@ cm_pipeline_Create(ESL_GETOPTS *go, ESL_ALPHABET *abc, int clen_hint, int L_hint
   pli->do_time_F5      = esl_opt_GetBoolean(go, "--timeF5")     ? TRUE  : FALSE;
   pli->do_time_F6      = esl_opt_GetBoolean(go, "--timeF6")     ? TRUE  : FALSE;
   pli->do_trm_F3       = esl_opt_GetBoolean(go, "--trmF3")      ? TRUE  : FALSE;
+  pli->do_defer_ali    = esl_opt_GetBoolean(go, "--deferali")   ? TRUE  : FALSE;
 
   /* hard-coded miscellaneous parameters that were command-line
    * settable in past testing, and could be in future testing.
@@ -616,6 +689,23 @@ cm_pipeline_Create(ESL_GETOPTS *go, ESL_ALPHABET *abc, int clen_hint, int L_hint
   if(esl_opt_GetBoolean(go, "--hmmnonull2")) pli->do_null2_hmmonly = FALSE;
   if(esl_opt_GetBoolean(go, "--hmmnobias"))  pli->do_bias_hmmonly  = FALSE;
 
+  /* low complexity masking prior to SSV, off by default, used in
+   * both the CM and HMM only pipelines.
+   */
+  pli->do_lcmask = esl_opt_IsOn(go, "--lcmask") ? TRUE : FALSE;
+  pli->lcmask    = pli->do_lcmask ? esl_opt_GetReal(go, "--lcmask") : 0.;
+  pli->lcw       = esl_opt_GetInteger(go, "--lcw");
+  pli->lcl       = NULL;
+  pli->lc_ss     = NULL;
+  pli->lc_se     = NULL;
+  pli->lc_nseg   = 0;
+  pli->lc_nalloc = 0;
+  if(pli->do_lcmask) { 
+    ESL_ALLOC(pli->lcl, sizeof(float) * (pli->lcw+1));
+    pli->lcl[0] = 0.;
+    for(c = 1; c <= pli->lcw; c++) pli->lcl[c] = (float) c * sreLOG2((double) c);
+  }
+
   /* Finished setting filter stage on/off parameters and thresholds */
   /********************************************************************************/
 
@@ -803,6 +893,8 @@ cm_pipeline_Reuse(CM_PIPELINE *pli)
 void
 cm_pipeline_Destroy(CM_PIPELINE *pli, CM_t *cm)
 {
+  int p;
+
   if (pli == NULL) return;
   
   p7_omx_Destroy(pli->oxf);
@@ -813,6 +905,23 @@ cm_pipeline_Destroy(CM_PIPELINE *pli, CM_t *cm)
   p7_gmx_Destroy(pli->gbck);
   p7_gmx_Destroy(pli->gxf);
   p7_gmx_Destroy(pli->gxb);
+  cm_p7_gfb_Destroy(pli->gfb);
+  for(p = 0; p < NPLI_PASSES; p++) if(pli->f4c_xmx[p] != NULL) free(pli->f4c_xmx[p]);
+  pli_sqview_Destroy(pli->term_sqv);
+  pli_sqview_Destroy(pli->win_sqv);
+  pli_sqview_Destroy(pli->hit_sqv);
+  pli_fparse_Release(pli);
+  if(pli->fpA   != NULL) free(pli->fpA);
+  if(pli->fp_ws != NULL) free(pli->fp_ws);
+  if(pli->fp_we != NULL) free(pli->fp_we);
+  if(pli->fp_mb != NULL) free(pli->fp_mb);
+  if(pli->wc.ssv_ws != NULL) free(pli->wc.ssv_ws);
+  if(pli->wc.ssv_we != NULL) free(pli->wc.ssv_we);
+  if(pli->wc.win    != NULL) free(pli->wc.win);
+  if(pli->wc.scored != NULL) free(pli->wc.scored);
+  if(pli->lcl        != NULL) free(pli->lcl);
+  if(pli->lc_ss      != NULL) free(pli->lc_ss);
+  if(pli->lc_se      != NULL) free(pli->lc_se);
   esl_randomness_Destroy(pli->r);
   p7_domaindef_Destroy(pli->ddef);
   free(pli);
@@ -970,6 +1079,14 @@ cm_pli_NewModel(CM_PIPELINE *pli, int modmode, CM_t *cm, int cm_clen, int cm_W,
   pli->cur_cm_idx   = cur_cm_idx;
   pli->cur_clan_idx = cur_clan_idx;
 
+  /* a new <om> may have been read into the same memory as the last one,
+   * and Forward parses kept for the last model are no longer useful 
+   */
+  if(pli->mode == CM_SEARCH_SEQS || modmode == CM_NEWMODEL_MSV) { 
+    pli_oprofile_InvalidateLength(pli);
+    pli_fparse_Release(pli);
+  }
+
   /* Two sets (A and B) of value updates: 
    * case 1: we do both sets 
    * case 2: we do set A only
@@ -1168,10 +1285,6 @@ cm_pipeline_Merge(CM_PIPELINE *p1, CM_PIPELINE *p2)
   if (p1->mode == CM_SEARCH_SEQS)
     {
       p1->nseqs   += p2->nseqs;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].npli_top += p2->acct[p].npli_top;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].npli_bot += p2->acct[p].npli_bot;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].nres_top += p2->acct[p].nres_top;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].nres_bot += p2->acct[p].nres_bot;
     }
   else
     { /* SCAN mode */
@@ -1179,10 +1292,6 @@ cm_pipeline_Merge(CM_PIPELINE *p1, CM_PIPELINE *p2)
       p1->nnodes          += p2->nnodes;
       p1->nmodels_hmmonly += p2->nmodels_hmmonly;
       p1->nnodes_hmmonly  += p2->nnodes_hmmonly;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].nres_top += p2->acct[p].nres_top;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].nres_bot += p2->acct[p].nres_bot;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].npli_top += p2->acct[p].npli_top;
-      for(p = 0; p < NPLI_PASSES; p++) p1->acct[p].npli_bot += p2->acct[p].npli_bot;
       /* If target CM file was small, it's possible that <p1->nseqs>
        * is 0 and <p2->nseqs> is not, or vice versa. This happens if
        * we had so few CMs in our database that not all threads got to
@@ -1191,43 +1300,11 @@ cm_pipeline_Merge(CM_PIPELINE *p1, CM_PIPELINE *p2)
        */
       p1->nseqs = ESL_MAX(p1->nseqs, p2->nseqs);
     }
+  p1->nsqalloc   += p2->nsqalloc;
+  p1->nocfg      += p2->nocfg;
+  p1->nocfg_skip += p2->nocfg_skip;
 
-  for(p = 0; p < NPLI_PASSES; p++) { 
-    p1->acct[p].n_past_msv  += p2->acct[p].n_past_msv;
-    p1->acct[p].n_past_vit  += p2->acct[p].n_past_vit;
-    p1->acct[p].n_past_fwd  += p2->acct[p].n_past_fwd;
-    p1->acct[p].n_past_gfwd += p2->acct[p].n_past_gfwd;
-    p1->acct[p].n_past_edef += p2->acct[p].n_past_edef;
-    p1->acct[p].n_past_cyk  += p2->acct[p].n_past_cyk;
-    p1->acct[p].n_past_ins  += p2->acct[p].n_past_ins;
-    p1->acct[p].n_output    += p2->acct[p].n_output;
-
-    p1->acct[p].n_past_msvbias  += p2->acct[p].n_past_msvbias;
-    p1->acct[p].n_past_vitbias  += p2->acct[p].n_past_vitbias;
-    p1->acct[p].n_past_fwdbias  += p2->acct[p].n_past_fwdbias;
-    p1->acct[p].n_past_gfwdbias += p2->acct[p].n_past_gfwdbias;
-    p1->acct[p].n_past_edefbias += p2->acct[p].n_past_edefbias;
-
-    p1->acct[p].pos_past_msv  += p2->acct[p].pos_past_msv;
-    p1->acct[p].pos_past_vit  += p2->acct[p].pos_past_vit;
-    p1->acct[p].pos_past_fwd  += p2->acct[p].pos_past_fwd;
-    p1->acct[p].pos_past_gfwd += p2->acct[p].pos_past_gfwd;
-    p1->acct[p].pos_past_edef += p2->acct[p].pos_past_edef;
-    p1->acct[p].pos_past_cyk  += p2->acct[p].pos_past_cyk;
-    p1->acct[p].pos_past_ins  += p2->acct[p].pos_past_ins;
-    p1->acct[p].pos_output    += p2->acct[p].pos_output;
-
-    p1->acct[p].pos_past_msvbias += p2->acct[p].pos_past_msvbias;
-    p1->acct[p].pos_past_vitbias += p2->acct[p].pos_past_vitbias;
-    p1->acct[p].pos_past_fwdbias += p2->acct[p].pos_past_fwdbias;
-    p1->acct[p].pos_past_gfwdbias+= p2->acct[p].pos_past_gfwdbias;
-    p1->acct[p].pos_past_edefbias += p2->acct[p].pos_past_edefbias;
-
-    p1->acct[p].n_overflow_fcyk  += p2->acct[p].n_overflow_fcyk;
-    p1->acct[p].n_overflow_final += p2->acct[p].n_overflow_final;
-    p1->acct[p].n_aln_hb         += p2->acct[p].n_aln_hb;
-    p1->acct[p].n_aln_dccyk      += p2->acct[p].n_aln_dccyk;
-  }
+  for(p = 0; p < NPLI_PASSES; p++) pli_merge_accounting(&(p1->acct[p]), &(p2->acct[p]));
 
   return eslOK;
 }
@@ -1282,8 +1359,6 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
 
   /* variables necessary for re-searching sequence ends */
   ESL_SQ   *sq2search = NULL;  /* a pointer to the sequence to search on current pass */
-  ESL_SQ   *term5sq   = NULL;  /* a copy of the 5'-most pli->maxW residues from sq */
-  ESL_SQ   *term3sq   = NULL;  /* a copy of the 3'-most pli->maxW residues from sq */
   int       p;                 /* counter over passes */
   int       nwin_pass_std_any = -1;  /* number of windows that survived pass 1 (PLI_PASS_STD_ANY), -1 indicates we didn't run PLI_PASS_STD_ANY */
   int       do_pass_std_any;         /* should we do pass 2 (PLI_PASS_STD_ANY)          search the full sequence with CM pipeline? */
@@ -1299,6 +1374,7 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
   int64_t   start_offset;      /* offset to add to start/stop coordinates of hits found in pass 3, in which we re-search the 3' terminus */
   int       winning_pass = -1; /* best scoring pass in HMM stage, only used if pli->do_one_cmpass */
   float     winning_sc   = 0.; /* score of best scoring pass in HMM stage, only used if pli->do_one_cmpass */
+  int       do_short;          /* TRUE to search sq in a single PLI_PASS_5P_AND_3P_ANY pass as one envelope, only possible if pli->do_shortpass */
 
   if (sq->n == 0) return eslOK;    /* silently skip length 0 seqs; they'd cause us all sorts of weird problems */
 
@@ -1384,6 +1460,42 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
     do_pass_5p_only_force = do_pass_3p_only_force = do_pass_5p_and_3p_force = do_pass_5p_and_3p_any = do_pass_hmm_only_any = FALSE;
   }
 
+  /* If pli->do_shortpass, a sequence that includes both termini and
+   * is no longer than the CM's window is searched in a single
+   * PLI_PASS_5P_AND_3P_ANY pass that allows any truncation, instead
+   * of the standard pass and the three forced terminal passes. The
+   * full sequence is its only envelope, so if any window survives
+   * the local HMM filters we skip glocal Forward and HMM envelope
+   * definition and go straight to the (truncated) CYK filter.
+   */
+  do_short = (pli->do_shortpass && pli->do_trunc_ends && pli->do_edef && (! pli->do_hmmonly_cur) && (! pli->do_trm_F3) && 
+	      have5term && have3term && sq->n <= pli->cmW) ? TRUE : FALSE;
+  if(do_short) { 
+    do_pass_5p_and_3p_any = TRUE;
+    do_pass_std_any = do_pass_5p_only_force = do_pass_3p_only_force = do_pass_5p_and_3p_force = do_pass_hmm_only_any = FALSE;
+  }
+
+  /* If sq is no longer than pli->maxW, the forced 5' and 3'
+   * truncated passes search it in full, so their windows are the
+   * same as those of PLI_PASS_STD_ANY. In that case, pli_p7_env_def()
+   * computes the glocal Forward scores of the terminal windows with
+   * the truncated profiles along with the standard profile's in the
+   * PLI_PASS_STD_ANY pass, and the later passes use those.
+   */
+  pli->f4c_dsq = NULL;
+  for(p = 0; p < NPLI_PASSES; p++) { 
+    pli->f4c_do[p] = FALSE;
+    pli->f4c_ws[p] = pli->f4c_we[p] = -1;
+  }
+  if(pli->do_edef && (! pli->do_trm_F3) && do_pass_std_any && sq->n <= pli->maxW) { 
+    pli->f4c_do[PLI_PASS_5P_ONLY_FORCE]   = do_pass_5p_only_force;
+    pli->f4c_do[PLI_PASS_3P_ONLY_FORCE]   = do_pass_3p_only_force;
+    pli->f4c_do[PLI_PASS_5P_AND_3P_FORCE] = do_pass_5p_and_3p_force;
+    pli->f4c_dsq = sq->dsq;
+    pli->f4c_n   = sq->n;
+  }
+  if((status = pli_wcache_Reset(pli, sq)) != eslOK) ESL_FAIL(status, pli->errbuf, "allocation failure");
+
 #if eslDEBUGLEVEL >= 1
   printf("in cm_Pipeline() %s\n", sq->name);
   printf("do_pass_std_any:         %d\n", do_pass_std_any);
@@ -1433,14 +1545,12 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
       sq2search = sq;
     }
     else if(p == PLI_PASS_5P_ONLY_FORCE) { /* research first (5') pli->maxW residues */
-      term5sq = esl_sq_CreateDigital(bg->abc);
-      pli_copy_subseq(sq, term5sq, 1, pli->maxW);
-      sq2search = term5sq;
+      if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, 1, pli->maxW, TRUE)) != eslOK) goto ERROR;
+      sq2search = pli->term_sqv;
     }
     else if(p == PLI_PASS_3P_ONLY_FORCE) { /* research first (5') pli->maxW residues */
-      term3sq = esl_sq_CreateDigital(bg->abc);
-      pli_copy_subseq(sq, term3sq, sq->n - pli->maxW + 1, pli->maxW);
-      sq2search = term3sq;
+      if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, sq->n - pli->maxW + 1, pli->maxW, TRUE)) != eslOK) goto ERROR;
+      sq2search = pli->term_sqv;
       start_offset = sq->n - pli->maxW;
     }
     pli->cur_pass_idx = p; /* pipeline stages will use this to modify pass-specific behavior as necessary */
@@ -1518,6 +1628,26 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
             }
           }
         }
+        else if(do_short) { /* full sequence is the only envelope, its score is the best window score */
+          if(nwin > 0) { 
+            ESL_ALLOC(p7esAA[p], sizeof(int64_t));
+            ESL_ALLOC(p7eeAA[p], sizeof(int64_t));
+            ESL_ALLOC(p7ebAA[p], sizeof(float));
+            p7esAA[p][0] = 1;
+            p7eeAA[p][0] = sq->n;
+            p7ebAA[p][0] = wb[0];
+            for(h = 1; h < nwin; h++) p7ebAA[p][0] = ESL_MAX(p7ebAA[p][0], wb[h]);
+            np7envA[p] = 1;
+            /* account for the envelope as if it survived the stages we skipped */
+            pli->acct[p].n_past_gfwd++;
+            pli->acct[p].pos_past_gfwd += sq->n;
+            pli->acct[p].n_past_edef++;
+            pli->acct[p].pos_past_edef += sq->n;
+            if(pli->do_gfwdbias) { pli->acct[p].n_past_gfwdbias++; pli->acct[p].pos_past_gfwdbias += sq->n; }
+            pli->acct[p].n_past_edefbias++;
+            pli->acct[p].pos_past_edefbias += sq->n;
+          }
+        }
         else { 
 #if eslDEBUGLEVEL >= 3
           printf("\nPIPELINE calling p7_env_def() %s  %" PRId64 " residues (pass: %d)\n", sq2search->name, sq2search->n, p);
@@ -1531,6 +1661,8 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
     if(wb    != NULL) { free(wb);    wb   = NULL; }
     nwin = 0;
   } /* end of 'for(p = PLI_PASS_STD_ANY; p <= PLI_NPASSES; p++)', first loop over pipeline passes */
+  pli->f4c_dsq = NULL; /* cached glocal Forward results are invalid once we're done with the HMM stages */
+  pli->wc.dsq  = NULL; /* as are cached local HMM filter results */
   
   if(pli->do_one_cmpass) { 
     winning_pass = -1;
@@ -1572,16 +1704,18 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
     /* if we know there's no windows that pass local Fwd (F3), our terminal (or full) seqs won't have any either, continue */
     if(p != PLI_PASS_STD_ANY && p != PLI_PASS_HMM_ONLY_ANY && nwin_pass_std_any == 0 && (! pli->do_max)) continue; 
 
-    /* set sq2search and remember start_offset as we did above in first loop over passes, but we don't have to create term5sq and term3sq again */
+    /* set sq2search and remember start_offset as we did above in first loop over passes */
     start_offset = 0;
     if(p == PLI_PASS_STD_ANY || p == PLI_PASS_5P_AND_3P_FORCE || p == PLI_PASS_5P_AND_3P_ANY || p == PLI_PASS_HMM_ONLY_ANY || sq->n <= pli->maxW) { 
       sq2search = sq;
     }
     else if(p == PLI_PASS_5P_ONLY_FORCE) { /* research first (5') pli->maxW residues */
-      sq2search = term5sq;
+      if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, 1, pli->maxW, TRUE)) != eslOK) goto ERROR;
+      sq2search = pli->term_sqv;
     }
     else if(p == PLI_PASS_3P_ONLY_FORCE) { /* research first (5') pli->maxW residues */
-      sq2search = term3sq;
+      if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, sq->n - pli->maxW + 1, pli->maxW, TRUE)) != eslOK) goto ERROR;
+      sq2search = pli->term_sqv;
       start_offset = sq->n - pli->maxW;
     }
     pli->cur_pass_idx = p; /* pipeline stages will use this to modify pass-specific behavior as necessary */
@@ -1665,9 +1799,6 @@ cm_Pipeline(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float
   if(p7eeAA) free(p7eeAA);
   if(p7ebAA) free(p7ebAA);
   
-  if(term5sq != NULL) esl_sq_Destroy(term5sq);
-  if(term3sq != NULL) esl_sq_Destroy(term3sq);
-
   return eslOK;
 
  ERROR: 
@@ -1699,6 +1830,9 @@ cm_pli_Statistics(FILE *ofp, CM_PIPELINE *pli, ESL_STOPWATCH *w)
       pli_pass_statistics(ofp, pli, PLI_PASS_5P_ONLY_FORCE);   fprintf(ofp, "\n");
       pli_pass_statistics(ofp, pli, PLI_PASS_3P_ONLY_FORCE);   fprintf(ofp, "\n");
       pli_pass_statistics(ofp, pli, PLI_PASS_5P_AND_3P_FORCE); fprintf(ofp, "\n");
+      if(pli->do_shortpass) { 
+        pli_pass_statistics(ofp, pli, PLI_PASS_5P_AND_3P_ANY); fprintf(ofp, "\n");
+      }
     }
     else if(pli->do_trunc_5p_ends) { 
       pli_pass_statistics(ofp, pli, PLI_PASS_5P_ONLY_FORCE);   fprintf(ofp, "\n");
@@ -1722,6 +1856,9 @@ cm_pli_Statistics(FILE *ofp, CM_PIPELINE *pli, ESL_STOPWATCH *w)
 	    (int) (pli->acct[PLI_PASS_CM_SUMMED].n_output) + 
 	    (int) (pli->acct[PLI_PASS_HMM_ONLY_ANY].n_output));
   }
+  if(pli->be_verbose) { 
+    pli_workspace_statistics(ofp, pli); fprintf(ofp, "\n");
+  }
   if(w != NULL) esl_stopwatch_Display(ofp, w, "# CPU time: ");
 
   return eslOK;
@@ -1746,14 +1883,24 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
   int64_t pos_output_trunc;    /* number of residues in truncated hits */
   int64_t nres_searched = 0;   /* number of residues searched in this stage */
   int64_t nres_researched = 0; /* number of residues re-searched for truncated hits */
+  int64_t nres_short = 0;      /* number of residues searched only in the --shortpass PLI_PASS_5P_AND_3P_ANY pass */
+  int64_t nres_first;          /* number of residues searched for the first time, in any pass */
+  int     is_short_pass;       /* TRUE if <pass_idx> is the --shortpass short-sequence pass */
 
   CM_PLI_ACCT *pli_acct = &(pli->acct[pass_idx]);
 
+  /* with --shortpass, short sequences are searched for the first (and
+   * only) time in PLI_PASS_5P_AND_3P_ANY, skipping PLI_PASS_STD_ANY 
+   */
+  is_short_pass = (pass_idx == PLI_PASS_5P_AND_3P_ANY && pli->do_shortpass && pli->do_trunc_ends) ? TRUE : FALSE;
+  if(pli->do_shortpass && pli->do_trunc_ends) nres_short = pli->acct[PLI_PASS_5P_AND_3P_ANY].nres_top + pli->acct[PLI_PASS_5P_AND_3P_ANY].nres_bot;
+  nres_first = pli->acct[PLI_PASS_STD_ANY].nres_top + pli->acct[PLI_PASS_STD_ANY].nres_bot + nres_short;
+
   /* first, determine number of residues searched, and num res re-searched for truncated hits */
   nres_searched = pli_acct->nres_top + pli_acct->nres_bot;
   switch(pass_idx) {
   case PLI_PASS_CM_SUMMED: 
-    nres_researched = (pli_acct->nres_top + pli->acct->nres_bot) - (pli->acct[PLI_PASS_STD_ANY].nres_top + pli->acct[PLI_PASS_STD_ANY].nres_bot);
+    nres_researched = nres_searched - nres_first;
     break;
   case PLI_PASS_STD_ANY:
     nres_researched = 0;
@@ -1761,9 +1908,11 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
   case PLI_PASS_5P_ONLY_FORCE:
   case PLI_PASS_3P_ONLY_FORCE:
   case PLI_PASS_5P_AND_3P_FORCE:
-  case PLI_PASS_5P_AND_3P_ANY: 
     nres_researched = pli_acct->nres_top + pli_acct->nres_bot;
     break;
+  case PLI_PASS_5P_AND_3P_ANY: 
+    nres_researched = is_short_pass ? 0 : pli_acct->nres_top + pli_acct->nres_bot;
+    break;
   default: 
     nres_researched = 0;
     break; 
@@ -1781,10 +1930,15 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
 	    pli->nmodels, pli->nnodes);
     if(pass_idx == PLI_PASS_STD_ANY || pass_idx == PLI_PASS_CM_SUMMED) { 
       fprintf(ofp,   "Target sequences:                                  %15" PRId64 "  (%" PRId64 " residues searched)\n",  
-	      pli->nseqs, nres_searched - nres_researched);
+	      pli->nseqs, nres_first);
     }
     if(pass_idx != PLI_PASS_STD_ANY) { 
-      if(pass_idx == PLI_PASS_5P_AND_3P_FORCE) { 
+      if(is_short_pass) { 
+	/* like PLI_PASS_5P_AND_3P_FORCE, only seqs <= cmW are searched in this pass */
+	fprintf(ofp,   "Target sequences searched in short-sequence pass:  %15" PRId64 "  (%" PRId64 " residues searched)\n",  
+		ESL_MAX(pli_acct->npli_top, pli_acct->npli_bot), nres_short);
+      }
+      else if(pass_idx == PLI_PASS_5P_AND_3P_FORCE) { 
       /* special case, not all sequences get searched by this pass, 
        * since only seqs < maxW are searched in this pass (so no
        * sequence is chopped up into overlapping windows) npli
@@ -1810,10 +1964,16 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
   } else { /* SCAN mode */
     if(pass_idx == PLI_PASS_STD_ANY || pass_idx == PLI_PASS_CM_SUMMED) { 
       fprintf(ofp,   "Query sequence(s):                                 %15" PRId64 "  (%d residues searched)\n",  
-	      pli->nseqs, (int) ((nres_searched - nres_researched) / pli->nmodels));
+	      pli->nseqs, (int) (nres_first / pli->nmodels));
     }
     if(pass_idx != PLI_PASS_STD_ANY) { 
-      if(pass_idx == PLI_PASS_5P_AND_3P_FORCE) { 
+      if(is_short_pass) { 
+	/* like PLI_PASS_5P_AND_3P_FORCE, only models with cmW >= the query's length are used in this pass */
+	fprintf(ofp,   "Query sequences searched in short-sequence pass:   %15" PRId64 "  (%.1f residues searched, avg per model)\n",  
+		(pli_acct->npli_top > 0 || pli_acct->npli_bot > 0) ? pli->nseqs : 0, 
+		(pli_acct->npli_top > 0 || pli_acct->npli_bot > 0) ? (float) nres_short / (float) (ESL_MAX(pli_acct->npli_top, pli_acct->npli_bot)) : 0.);
+      }
+      else if(pass_idx == PLI_PASS_5P_AND_3P_FORCE) { 
       /* special case, not all sequences get searched by this pass, 
        * since only seqs < maxW are searched in this pass, if 
        * npli_top or npli_bot is greater than 0, then we searched
@@ -1831,7 +1991,7 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
 		(float) nres_researched / (float) pli->nmodels);
       }
     }
-    if(pass_idx == PLI_PASS_5P_AND_3P_FORCE) { 
+    if(pass_idx == PLI_PASS_5P_AND_3P_FORCE || is_short_pass) { 
       /* special case, only print number of models with which
        * we actually searched. It won't necessarily be all models
        * because only models for which the sequence is < maxW will
@@ -1847,6 +2007,11 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
     }
   }
 
+  if(pli->do_msv && pli->do_lcmask) { 
+    fprintf(ofp, "Residues  masked as low complexity before SSV:     %15" PRId64 "  (%.4g)\n",
+	    pli_acct->pos_lcmask,
+	    (nres_searched == 0) ? 0.0 : (double) pli_acct->pos_lcmask / nres_searched);
+  }
   if(pli->do_msv) { 
     fprintf(ofp, "Windows   passing  local HMM SSV           filter: %15" PRId64 "  (%.4g); expected (%.4g)\n",
 	    pli_acct->n_past_msv,
@@ -1970,8 +2135,12 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
     if(pli->do_trunc_ends) { 
       n_output_trunc   = pli->acct[PLI_PASS_5P_ONLY_FORCE].n_output   + pli->acct[PLI_PASS_3P_ONLY_FORCE].n_output   + pli->acct[PLI_PASS_5P_AND_3P_FORCE].n_output;
       pos_output_trunc = pli->acct[PLI_PASS_5P_ONLY_FORCE].pos_output + pli->acct[PLI_PASS_3P_ONLY_FORCE].pos_output + pli->acct[PLI_PASS_5P_AND_3P_FORCE].pos_output;
+      if(pli->do_shortpass) { /* short sequences were searched only in PLI_PASS_5P_AND_3P_ANY */
+	n_output_trunc   += pli->acct[PLI_PASS_5P_AND_3P_ANY].n_output;
+	pos_output_trunc += pli->acct[PLI_PASS_5P_AND_3P_ANY].pos_output;
+      }
     }
-    else if(pli->do_trunc_5p_ends) { 
+    else if(pli->do_trunc_5p_ends) {
       n_output_trunc   = pli->acct[PLI_PASS_5P_ONLY_FORCE].n_output;
       pos_output_trunc = pli->acct[PLI_PASS_5P_ONLY_FORCE].pos_output;
     }
@@ -2024,6 +2193,13 @@ pli_pass_statistics(FILE *ofp, CM_PIPELINE *pli, int pass_idx)
 	       (pli->final_cm_search_opts & CM_SEARCH_INSIDE) ? "Inside" : "CYK",
 	       0, 0.);
      }
+     fprintf(ofp, "Redundant residues scored by local HMM filters:    %15" PRId64 "  (%.4g); reused (%.4g)\n",
+	     pli_acct->pos_lfilter_redun,
+	     (pli_acct->pos_lfilter == 0) ? 0.0 : (double) pli_acct->pos_lfilter_redun / (double) pli_acct->pos_lfilter,
+	     (pli_acct->pos_lfilter == 0) ? 0.0 : (double) pli_acct->pos_lfilter_reuse / (double) pli_acct->pos_lfilter);
+     fprintf(ofp, "Windows skipped, can't include terminal residue:   %15" PRId64 "  (%.4g)\n",
+	     pli_acct->n_term_skip,
+	     (pli_acct->n_past_msv == 0) ? 0.0 : (double) pli_acct->n_term_skip / (double) pli_acct->n_past_msv);
   }
 
   return eslOK;
@@ -2072,6 +2248,14 @@ pli_hmmonly_pass_statistics(FILE *ofp, CM_PIPELINE *pli)
 	    pli->nmodels_hmmonly, pli->nnodes_hmmonly);
   }
 
+  if(pli->do_lcmask) { 
+    fprintf(ofp, "Residues %smasked as low complexity %s SSV: %s%15" PRId64 "  (%.4g)\n",
+	    match_cm_spacing ? " "      : "",
+	    match_cm_spacing ? "before" : "pre",
+	    match_cm_spacing ? "    "   : "",
+	    pli_acct->pos_lcmask,
+	    (nres_searched == 0) ? 0.0 : (double) pli_acct->pos_lcmask / nres_searched);
+  }
   fprintf(ofp, "Windows %spassing %slocal HMM SSV      %sfilter: %15" PRId64 "  (%.4g); expected (%.4g)\n",
 	  match_cm_spacing ? "  "     : "",
 	  match_cm_spacing ? " "      : "",
@@ -2131,6 +2315,13 @@ pli_hmmonly_pass_statistics(FILE *ofp, CM_PIPELINE *pli)
 	    "");
   }
 
+  if(pli->be_verbose && (! pli->do_max_hmmonly)) { 
+    fprintf(ofp, "Windows with Forward parse reused:         %s%15" PRId64 "  (%.4g)\n",
+	    match_cm_spacing ? "        "  : "",
+	    pli_acct->n_fwd_reuse,
+	    (pli_acct->n_past_fwd == 0) ? 0.0 : (double) pli_acct->n_fwd_reuse / (double) pli_acct->n_past_fwd);
+  }
+
   fprintf(ofp, "Total HMM hits reported:                   %s%15d  (%.4g)\n",
 	  match_cm_spacing ? "        "  : "",
 	  (int) pli_acct->n_output,
@@ -2139,6 +2330,28 @@ pli_hmmonly_pass_statistics(FILE *ofp, CM_PIPELINE *pli)
   return eslOK;
 }
 
+/* Function:  pli_workspace_statistics()
+ * Synopsis:  Final stats output for pipeline workspace reuse.
+ *
+ * Purpose:   Print the number of times pipeline <pli> had to
+ *            allocate workspace it otherwise reuses across 
+ *            sequences and models, and the number of filter HMM
+ *            length reconfigurations it did and skipped, to
+ *            stream <ofp>. Only printed if pli->be_verbose.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+pli_workspace_statistics(FILE *ofp, CM_PIPELINE *pli)
+{
+  fprintf(ofp, "Internal pipeline workspace statistics summary:\n");
+  fprintf(ofp, "-----------------------------------------------\n");
+  fprintf(ofp, "Sequence objects created for subsequence views:    %15" PRId64 "\n", pli->nsqalloc);
+  fprintf(ofp, "Filter HMM length reconfigurations:                %15" PRId64 "  (%" PRId64 " skipped, length unchanged)\n", pli->nocfg, pli->nocfg_skip);
+
+  return eslOK;
+}
+
 /* Function:  pli_sum_statistics()
  * Synopsis:  Sum up pipeline statistics for all CM passes of a pipeline.
  * Incept:    EPN, Thu Feb 23 11:00:39 2012
@@ -2193,6 +2406,12 @@ pli_sum_statistics(CM_PIPELINE *pli)
       pli->acct[PLI_PASS_CM_SUMMED].pos_past_fwdbias  += pli->acct[p].pos_past_fwdbias;
       pli->acct[PLI_PASS_CM_SUMMED].pos_past_gfwdbias += pli->acct[p].pos_past_gfwdbias;
       pli->acct[PLI_PASS_CM_SUMMED].pos_past_edefbias += pli->acct[p].pos_past_edefbias;
+      pli->acct[PLI_PASS_CM_SUMMED].pos_lfilter       += pli->acct[p].pos_lfilter;
+      pli->acct[PLI_PASS_CM_SUMMED].pos_lfilter_redun += pli->acct[p].pos_lfilter_redun;
+      pli->acct[PLI_PASS_CM_SUMMED].pos_lfilter_reuse += pli->acct[p].pos_lfilter_reuse;
+      pli->acct[PLI_PASS_CM_SUMMED].pos_lcmask        += pli->acct[p].pos_lcmask;
+      pli->acct[PLI_PASS_CM_SUMMED].n_fwd_reuse       += pli->acct[p].n_fwd_reuse;
+      pli->acct[PLI_PASS_CM_SUMMED].n_term_skip       += pli->acct[p].n_term_skip;
       
       pli->acct[PLI_PASS_CM_SUMMED].n_overflow_fcyk   += pli->acct[p].n_overflow_fcyk;
       pli->acct[PLI_PASS_CM_SUMMED].n_overflow_final  += pli->acct[p].n_overflow_final;
@@ -2242,6 +2461,12 @@ cm_pli_ZeroAccounting(CM_PLI_ACCT *pli_acct)
   pli_acct->pos_past_fwdbias  = 0;
   pli_acct->pos_past_gfwdbias = 0;
   pli_acct->pos_past_edefbias = 0;
+  pli_acct->pos_lfilter       = 0;
+  pli_acct->pos_lfilter_redun = 0;
+  pli_acct->pos_lfilter_reuse = 0;
+  pli_acct->pos_lcmask        = 0;
+  pli_acct->n_fwd_reuse       = 0;
+  pli_acct->n_term_skip       = 0;
   
   pli_acct->n_overflow_fcyk   = 0;
   pli_acct->n_overflow_final  = 0;
@@ -2251,6 +2476,172 @@ cm_pli_ZeroAccounting(CM_PLI_ACCT *pli_acct)
   return eslOK;
 }
 
+/* Function:  cm_pli_WriteAccounting()
+ * Synopsis:  Save pipeline accounting statistics in binary format.
+ *
+ * Purpose:   Write the number of sequences and models searched by
+ *            pipeline <pli>, the number of sequence objects and
+ *            filter HMM length reconfigurations it made, and its
+ *            accounting statistics for all
+ *            <NPLI_PASSES> passes, to open binary stream <fp>, in the
+ *            order that cm_pipeline_MPISend() packs them. Read them
+ *            back with cm_pli_ReadAccounting(). Used to save the
+ *            statistics of a partially completed search in a cmsearch
+ *            checkpoint file.
+ *
+ * Returns:   <eslOK> on success; 
+ *            <eslFAIL> if a write fails due to system error, such as a
+ *            filled disk.
+ */
+int
+cm_pli_WriteAccounting(FILE *fp, CM_PIPELINE *pli)
+{
+  int p; /* counter over pipeline passes */
+
+  if (fwrite((char *) &(pli->nseqs),           sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nmodels),         sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nnodes),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nmodels_hmmonly), sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nnodes_hmmonly),  sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nsqalloc),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nocfg),           sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  if (fwrite((char *) &(pli->nocfg_skip),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  for(p = 0; p < NPLI_PASSES; p++) { 
+    if (fwrite((char *) &(pli->acct[p].npli_top),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].npli_bot),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].nres_top),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].nres_bot),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_msv),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_vit),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_fwd),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_gfwd),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_edef),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_cyk),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_ins),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_output),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_msvbias),    sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_vitbias),    sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_fwdbias),    sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_gfwdbias),   sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_past_edefbias),   sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_msv),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_vit),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_fwd),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_gfwd),     sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_edef),     sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_cyk),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_ins),      sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_output),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_msvbias),  sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_vitbias),  sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_fwdbias),  sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_gfwdbias), sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_past_edefbias), sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_overflow_fcyk),   sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_overflow_final),  sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_aln_hb),          sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_aln_dccyk),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_lfilter),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_lfilter_redun), sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_lfilter_reuse), sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].pos_lcmask),        sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_fwd_reuse),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+    if (fwrite((char *) &(pli->acct[p].n_term_skip),       sizeof(uint64_t), 1, fp) != 1) return eslFAIL;
+  }
+  return eslOK;
+}
+
+/* Function:  cm_pli_ReadAccounting()
+ * Synopsis:  Read pipeline accounting statistics saved in binary format.
+ *
+ * Purpose:   Read pipeline statistics written by
+ *            cm_pli_WriteAccounting() from open binary stream <fp>,
+ *            and merge them into those of <pli>, exactly as
+ *            cm_pipeline_Merge() would merge the statistics of the
+ *            pipeline they were written from. 
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEOD> if a read fails, likely because the file 
+ *            was truncated; <pli> is unchanged.
+ */
+int
+cm_pli_ReadAccounting(FILE *fp, CM_PIPELINE *pli)
+{
+  int         p; /* counter over pipeline passes */
+  uint64_t    nseqs, nmodels, nnodes, nmodels_hmmonly, nnodes_hmmonly, nsqalloc, nocfg, nocfg_skip;
+  CM_PLI_ACCT acctA[NPLI_PASSES];
+  CM_PLI_ACCT acct;
+
+  if (! fread((char *) &nseqs,           sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nmodels,         sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nnodes,          sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nmodels_hmmonly, sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nnodes_hmmonly,  sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nsqalloc,        sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nocfg,           sizeof(uint64_t), 1, fp)) return eslEOD;
+  if (! fread((char *) &nocfg_skip,      sizeof(uint64_t), 1, fp)) return eslEOD;
+  for(p = 0; p < NPLI_PASSES; p++) { 
+    if (! fread((char *) &(acct.npli_top),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.npli_bot),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.nres_top),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.nres_bot),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_msv),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_vit),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_fwd),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_gfwd),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_edef),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_cyk),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_ins),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_output),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_msvbias),    sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_vitbias),    sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_fwdbias),    sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_gfwdbias),   sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_past_edefbias),   sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_msv),      sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_vit),      sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_fwd),      sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_gfwd),     sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_edef),     sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_cyk),      sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_ins),      sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_output),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_msvbias),  sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_vitbias),  sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_fwdbias),  sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_gfwdbias), sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_past_edefbias), sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_overflow_fcyk),   sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_overflow_final),  sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_aln_hb),          sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_aln_dccyk),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_lfilter),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_lfilter_redun), sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_lfilter_reuse), sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.pos_lcmask),        sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_fwd_reuse),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    if (! fread((char *) &(acct.n_term_skip),       sizeof(uint64_t), 1, fp)) return eslEOD;
+    acctA[p] = acct;
+  }
+
+  if (pli->mode == CM_SEARCH_SEQS) { 
+    pli->nseqs += nseqs;
+  }
+  else { /* SCAN mode, see cm_pipeline_Merge() */
+    pli->nmodels         += nmodels;
+    pli->nnodes          += nnodes;
+    pli->nmodels_hmmonly += nmodels_hmmonly;
+    pli->nnodes_hmmonly  += nnodes_hmmonly;
+    pli->nseqs            = ESL_MAX(pli->nseqs, nseqs);
+  }
+  pli->nsqalloc   += nsqalloc;
+  pli->nocfg      += nocfg;
+  pli->nocfg_skip += nocfg_skip;
+  for(p = 0; p < NPLI_PASSES; p++) pli_merge_accounting(&(pli->acct[p]), &(acctA[p]));
+
+  return eslOK;
+}
+
 /* Function:  cm_pli_PassEnforcesFirstRes()
  * Date:      EPN, Thu Feb 16 07:42:59 2012
  *
@@ -2366,6 +2757,41 @@ cm_pli_AdjustNresForOverlaps(CM_PIPELINE *pli, int64_t noverlap, int in_rc)
   return;
 }
 
+/* Function:  cm_pli_AlignHit()
+ * Synopsis:  Align a hit after the search, for deferred alignment.
+ *
+ * Purpose:  Align hit <hit> in sequence <sq> to <cm> and store 
+ *           the resulting CM_ALIDISPLAY in <hit->ad>, as 
+ *           pli_final_stage() would have if <pli->do_defer_ali>
+ *           were FALSE. This allows a caller that defers alignment
+ *           until after thresholding to align only the hits it
+ *           will report.
+ *
+ *           <hit->start> and <hit->stop> must be coordinates
+ *           in <sq>, and <hit->pass_idx> and <hit->mode> must
+ *           be set. <cm> must be configured as it was for the
+ *           search. The HMM bands from the final search stage
+ *           are long gone, so if HMM banded alignment is used
+ *           new bands are calculated for just the hit; 
+ *           because of this the alignment may differ slightly
+ *           from the one pli_final_stage() would have computed.
+ *
+ * Returns:  eslOK on success, alidisplay in hit->ad.
+ *           ! eslOK on an error, pli->errbuf is filled, hit->ad is NULL.
+ */
+int
+cm_pli_AlignHit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit)
+{
+  int    status;
+  double save_tau = cm->tau;
+
+  cm->tau = pli->final_tau;
+  status  = pli_align_hit(pli, cm, sq, hit, FALSE); /* FALSE: cm->cp9b are not valid for this hit */
+  cm->tau = save_tau;
+
+  return status;
+}
+
 /*------------------- end, pipeline API -------------------------*/
  
 
@@ -2388,6 +2814,12 @@ cm_pli_AdjustNresForOverlaps(CM_PIPELINE *pli, int64_t noverlap, int in_rc)
  *            first search function used and should be followed by a
  *            call to pli_p7_env_def().
  *
+ *            If <sq> is (a view into) the sequence cm_Pipeline() is
+ *            searching, the SSV windows and the MSV, bias, Viterbi
+ *            and Forward scores of windows an earlier pass already
+ *            filtered are taken from the window cache <pli->wc>
+ *            instead of being recomputed.
+ *
  * Returns:   <eslOK> on success. For the <ret_nwin> windows that
  *            survive all filters, the start and end positions of the
  *            windows are stored and returned in <ret_ws> and
@@ -2419,6 +2851,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   float             wsc;               /* the corrected bit score for a window */
   double            P;                 /* P-value of a hit */
   int               i, i2;             /* counters */
+  int               s;                 /* counter over unmasked segments */
   int               wlen;              /* length of current window */
   void             *p;                 /* for ESL_RALLOC */
   int              *useme = NULL;      /* used when merging overlapping windows */
@@ -2438,6 +2871,10 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   int               have_rest;         /* do we have the full <om> read in? */
   P7_HMM_WINDOWLIST wlist;             /* list of windows, structure taken by p7_MSVFilter_longtarget() */
   int               save_max_length = om->max_length;
+  int64_t           wc_off;            /* sq->dsq[1] is pli->wc.dsq[wc_off+1], -1 if <sq> isn't in the window cache */
+  CM_P7_WCWIN      *wcw = NULL;        /* window cache entry for current window, NULL if none */
+  P7_OMX           *fwd_ox = NULL;     /* matrix for the Forward filter's parse of current window */
+  int              *termok = NULL;     /* [0..nwin-1] FALSE if window can't include the terminal residue(s) this pass requires, NULL if none required */
 
   /* filter thresholds and on/off parameters, these will normally be set to
    * CM pipeline values unless pli->cur_pass_idx == PLI_PASS_HMM_ONLY_ANY,
@@ -2456,6 +2893,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   double cur_F3         = (pli->cur_pass_idx == PLI_PASS_HMM_ONLY_ANY) ? pli->F3_hmmonly         : pli->F3;
   double cur_F3b        = (pli->cur_pass_idx == PLI_PASS_HMM_ONLY_ANY) ? 1.0                     : pli->F3b;
 
+  pli->fp_n = 0; /* forget Forward parses kept for the last sequence */
   if (sq->n == 0) return eslOK;    /* silently skip length 0 seqs; they'd cause us all sorts of weird problems */
   p7_omx_GrowTo(pli->oxf, om->M, 0, sq->n);    /* expand the one-row omx if needed */
   have_rest = (om->mode == p7_NO_MODE) ? FALSE : TRUE; /* we use om->mode as a flag to tell us whether we already have read the full <om> from disk or not */
@@ -2467,7 +2905,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   /* Set MSV length as pli->maxW/
    * Note: this differs from nhmmer, which uses om->max_length
    */
-  p7_oprofile_ReconfigMSVLength(om, pli->maxW);
+  pli_oprofile_ReconfigLength(pli, om, pli->maxW, TRUE, FALSE);
   om->max_length = pli->maxW;
 
   #if eslDEBUGLEVEL >= 3
@@ -2478,16 +2916,57 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   nsurv_fwd = 0;
   nwin = 0;
 
+  /* Determine if <sq> is in the residues of the window cache: either
+   * the sequence cm_Pipeline() is searching or a view of one of its
+   * terminal subsequences. If so, windows filtered in an earlier pass
+   * reuse their scores.
+   */
+  wc_off = -1;
+  if(pli->wc.dsq != NULL && sq->dsq >= pli->wc.dsq && sq->dsq + sq->n <= pli->wc.dsq + pli->wc.L) { 
+    wc_off = sq->dsq - pli->wc.dsq;
+    pli->wc.pstart[pli->cur_pass_idx] = pli->wc.nwin;
+    pli->wc.pn[pli->cur_pass_idx]     = 0;
+  }
+
   /***************************************************/
   /* Filter 1: SSV, long target-variant, with p7 HMM */
-  if(cur_do_msv) { 
+  if(cur_do_msv && wc_off != -1 && pli->wc.ssv_i == wc_off+1 && pli->wc.ssv_j == wc_off+sq->n && pli->wc.ssv_F1 == cur_F1) { 
+    /* an earlier pass already found the SSV windows of these residues */
+    nwin = pli->wc.ssv_nwin;
+    ESL_ALLOC(ws, sizeof(int64_t) * ESL_MAX(1, nwin));  // avoid 0 malloc
+    ESL_ALLOC(we, sizeof(int64_t) * ESL_MAX(1, nwin));
+    for(i = 0; i < nwin; i++) { 
+      ws[i] = pli->wc.ssv_ws[i] - wc_off;
+      we[i] = pli->wc.ssv_we[i] - wc_off;
+    }
+    if (nwin > 0 && pli->mode == CM_SCAN_MODELS && (! have_rest)) {
+      if (pli->cmfp) { p7_oprofile_ReadRest(pli->cmfp->hfp, om); pli_oprofile_InvalidateLength(pli); }
+      have_rest = TRUE;
+    }
+  }
+  else if(cur_do_msv) { 
     p7_hmmwindow_init(&wlist);
-    status = p7_SSVFilter_longtarget(sq->dsq, sq->n, om, pli->oxf, msvdata, bg, cur_F1, &wlist);
+    if(pli->do_lcmask) { 
+      /* only search the segments of <sq> that aren't masked as low
+       * complexity, then make window coordinates relative to <sq> */
+      if((status = pli_lcmask(pli, bg, sq)) != eslOK) goto ERROR;
+      for(s = 0; s < pli->lc_nseg; s++) { 
+	i2 = wlist.count;
+	status = p7_SSVFilter_longtarget(sq->dsq + pli->lc_ss[s] - 1, pli->lc_se[s] - pli->lc_ss[s] + 1, om, pli->oxf, msvdata, bg, cur_F1, &wlist);
+	for(i = i2; i < wlist.count; i++) { 
+	  wlist.windows[i].n         += pli->lc_ss[s] - 1;
+	  wlist.windows[i].target_len = sq->n;
+	}
+      }
+    }
+    else { 
+      status = p7_SSVFilter_longtarget(sq->dsq, sq->n, om, pli->oxf, msvdata, bg, cur_F1, &wlist);
+    }
 
     if(wlist.count > 0) { 
       /* In scan mode, if at least one window passes the MSV filter, read the rest of the profile */
       if (pli->mode == CM_SCAN_MODELS && (! have_rest)) {
-	if (pli->cmfp) p7_oprofile_ReadRest(pli->cmfp->hfp, om);
+	if (pli->cmfp) { p7_oprofile_ReadRest(pli->cmfp->hfp, om); pli_oprofile_InvalidateLength(pli); }
 	/* Note: we don't call cm_pli_NewModelThresholds() yet (as p7_pipeline() 
 	 * does at this point), because we don't yet have the CM */
 	have_rest = TRUE;
@@ -2546,6 +3025,9 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     ws = new_ws;
     we = new_we;
     nwin = i2;
+    if(wc_off != -1) { 
+      if((status = pli_wcache_SetSSV(pli, ws, we, nwin, wc_off, sq->n, cur_F1)) != eslOK) goto ERROR;
+    }
   }
   else { /* do_msv is FALSE */
     nwin = 1; /* first window */
@@ -2565,6 +3047,17 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     }
   }     
   pli->acct[pli->cur_pass_idx].n_past_msv += nwin;
+
+  /* In passes that require hits to include the first and/or final
+   * residue of <sq>, pli_p7_env_def() discards the windows that
+   * don't once survivors are merged, so don't filter windows that
+   * can't end up in one that does. (Unless we're terminating after
+   * F3, in which case every surviving window becomes a hit.)
+   */
+  if((cm_pli_PassEnforcesFirstRes(pli->cur_pass_idx) || cm_pli_PassEnforcesFinalRes(pli->cur_pass_idx)) && (! pli->do_trm_F3) && nwin > 0) { 
+    ESL_ALLOC(termok, sizeof(int) * nwin);
+    pli_terminal_windows(ws, we, nwin, sq->n, cm_pli_PassEnforcesFirstRes(pli->cur_pass_idx), cm_pli_PassEnforcesFinalRes(pli->cur_pass_idx), termok);
+  }
   
   /*********************************************/
   /* allocate and initialize survAA, which will keep track of number of windows surviving each stage */
@@ -2580,9 +3073,17 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
   for (i = 0; i < nwin; i++) { wb[i] = -999.0; }
 
   for (i = 0; i < nwin; i++) {
+    if(termok != NULL && (! termok[i])) { 
+      survAA[p7_SURV_F1][i] = TRUE;
+      pli->acct[pli->cur_pass_idx].n_term_skip++;
+      continue;
+    }
     subdsq = sq->dsq + ws[i] - 1;
     have_filtersc = FALSE;
     wlen = we[i] - ws[i] + 1;
+    if(wc_off != -1) { 
+      if((status = pli_wcache_Window(pli, wc_off + ws[i], wc_off + we[i], &wcw)) != eslOK) goto ERROR;
+    }
 
     p7_bg_SetLength(bg, wlen);
     p7_bg_NullOne  (bg, subdsq, wlen, &nullsc);
@@ -2598,9 +3099,9 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
        * Have to run msv again, to get the full score for the window.
        * (using the standard "per-sequence" msv filter this time). 
        */
-      p7_oprofile_ReconfigMSVLength(om, wlen);
-      p7_MSVFilter(subdsq, wlen, om, pli->oxf, &mfsc);
-      p7_bg_FilterScore(bg, subdsq, wlen, &filtersc);
+      pli_oprofile_ReconfigLength(pli, om, wlen, TRUE, FALSE);
+      mfsc     = pli_wcache_Filter(pli, om, pli->oxf, subdsq, wlen, (wc_off == -1) ? -1 : wc_off + ws[i], wcw, CM_P7_WC_MSV);
+      filtersc = pli_wcache_FilterScore(bg, subdsq, wlen, wcw);
       have_filtersc = TRUE;
       
       wsc = (mfsc - filtersc) / eslCONST_LOG2;
@@ -2624,23 +3125,23 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
      * the profile if the msvfilter is off, if so read the rest of the profile.
      */
     if (pli->mode == CM_SCAN_MODELS && (! have_rest)) {
-      if (pli->cmfp) p7_oprofile_ReadRest(pli->cmfp->hfp, om);
+      if (pli->cmfp) { p7_oprofile_ReadRest(pli->cmfp->hfp, om); pli_oprofile_InvalidateLength(pli); }
       /* Note: we don't call cm_pli_NewModelThresholds() yet (as p7_pipeline() 
        * does at this point), because we don't yet have the CM */
       have_rest = TRUE;
     }
-    if(cur_do_msv && cur_do_msvbias) { /* we already called p7_oprofile_ReconfigMSVLength() above */
-      p7_oprofile_ReconfigRestLength(om, wlen);
+    if(cur_do_msv && cur_do_msvbias) { /* we already configured the MSV filter length above */
+      pli_oprofile_ReconfigLength(pli, om, wlen, FALSE, TRUE);
     }
-    else { /* we did not call p7_oprofile_ReconfigMSVLength() above */
-      p7_oprofile_ReconfigLength(om, wlen);
+    else { /* we did not configure the MSV filter length above */
+      pli_oprofile_ReconfigLength(pli, om, wlen, TRUE, TRUE);
     }
 
     if (cur_do_vit) { 
       /******************************************************************************/
       /* Filter 2: Viterbi with p7 HMM */
       /* Second level filter: ViterbiFilter(), multihit with <om> */
-      p7_ViterbiFilter(subdsq, wlen, om, pli->oxf, &vfsc);
+      vfsc  = pli_wcache_Filter(pli, om, pli->oxf, subdsq, wlen, (wc_off == -1) ? -1 : wc_off + ws[i], wcw, CM_P7_WC_VIT);
       wsc   = (vfsc - nullsc) / eslCONST_LOG2; 
       P     = esl_gumbel_surv(wsc,  p7_evparam[CM_p7_LVMU],  p7_evparam[CM_p7_LVLAMBDA]);
       wp[i] = P;
@@ -2657,7 +3158,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     /********************************************/
     if (cur_do_vit && cur_do_vitbias) { 
       if(! have_filtersc) { 
-	p7_bg_FilterScore(bg, subdsq, wlen, &filtersc);
+	filtersc = pli_wcache_FilterScore(bg, subdsq, wlen, wcw);
       }
       have_filtersc = TRUE;
       wsc = (vfsc - filtersc) / eslCONST_LOG2;
@@ -2679,8 +3180,16 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     if(cur_do_fwd) { 
       /******************************************************************************/
       /* Filter 3: Forward with p7 HMM */
-      /* Parse it with Forward and obtain its real Forward score. */
-      p7_ForwardParser(subdsq, wlen, om, pli->oxf, &fwdsc);
+      /* Parse it with Forward and obtain its real Forward score.
+       * In the HMM only pass, parse into a matrix of our own so
+       * pli_final_stage_hmmonly() can use the parse if the window
+       * survives.
+       */
+      fwd_ox = pli->oxf;
+      if(pli->cur_pass_idx == PLI_PASS_HMM_ONLY_ANY && (wcw == NULL || (! (wcw->flags & CM_P7_WC_FWD)))) { 
+	if((status = pli_fparse_Next(pli, om->M, wlen, &fwd_ox)) != eslOK) goto ERROR;
+      }
+      fwdsc = pli_wcache_Filter(pli, om, fwd_ox, subdsq, wlen, (wc_off == -1) ? -1 : wc_off + ws[i], wcw, CM_P7_WC_FWD);
       wsc = (fwdsc - nullsc) / eslCONST_LOG2; 
       P = esl_exp_surv(wsc,  p7_evparam[CM_p7_LFTAU],  p7_evparam[CM_p7_LFLAMBDA]);
       wp[i] = P;
@@ -2697,7 +3206,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
 
     if (cur_do_fwd && cur_do_fwdbias) { 
       if (! have_filtersc) { 
-	p7_bg_FilterScore(bg, subdsq, wlen,     &filtersc);
+	filtersc = pli_wcache_FilterScore(bg, subdsq, wlen, wcw);
       }
       have_filtersc = TRUE;
       wsc = (fwdsc - filtersc) / eslCONST_LOG2;
@@ -2710,6 +3219,11 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     pli->acct[pli->cur_pass_idx].n_past_fwdbias++;
     nsurv_fwd++;
     survAA[p7_SURV_F3b][i] = TRUE;
+    if(cur_do_fwd && fwd_ox != pli->oxf) { /* keep the window's Forward parse */
+      pli->fp_ws[pli->fp_n] = ws[i];
+      pli->fp_we[pli->fp_n] = we[i];
+      pli->fp_n++;
+    }
 
 #if eslDEBUGLEVEL >= 3 
     if(cur_do_fwd && cur_do_fwdbias) printf("SURVIVOR window %5d [%10" PRId64 "..%10" PRId64 "] survived Fwd-Bias  %6.2f bits  P %g\n", i, ws[i], we[i], wb[i], wp[i]);
@@ -2804,6 +3318,7 @@ pli_p7_filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P
     for (i = 0; i < Np7_SURV; i++) free(survAA[i]);
     free(survAA);
   }
+  if(termok != NULL) free(termok);
 
   om->max_length = save_max_length;
 
@@ -2874,8 +3389,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
   float           *eb  = NULL;        /* [0..nenv-1] envelope end   positions */
   int              nenv;              /* number of surviving envelopes */
   int              nenv_alloc;        /* current size of es, ee */
-  ESL_DSQ         *subdsq;            /* a ptr to the first position of a window */
-  ESL_SQ          *seq = NULL;        /* a copy of a window */
+  ESL_SQ          *seq = NULL;        /* a view of a window, pli->win_sqv */
   float            nullsc, filtersc, fwdsc, bcksc;
   P7_PROFILE      *gm  = NULL;        /* a ptr to *opt_gm, for convenience */
   int              do_local_envdef;   /* TRUE if we define envelopes with p7 in local mode, FALSE for glocal */
@@ -2885,6 +3399,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
   P7_PROFILE      *Lgm = NULL;        /* a ptr to *Lopt_gm, for convenience */
   P7_PROFILE      *Tgm = NULL;        /* a ptr to *Topt_gm, for convenience */
   float            safe_lfwdsc;       /* a score <= local Forward score, determined via a correction to a Forward score with Rgm or Lgm */
+  int              fuse_Rgm, fuse_Lgm, fuse_Tgm; /* TRUE to compute F4 for Rgm, Lgm, Tgm along with gm, for later passes (see cm_Pipeline()) */
   int              use_gm, use_Rgm, use_Lgm, use_Tgm; /* only one of these can be TRUE, should we use the standard profile for non
 						       * truncated hits or the specially configured T, R, or L profiles because 
 						       * we're defining envelopes for hits possibly truncated 5', 3' or both 5' and 3'? 
@@ -2912,7 +3427,6 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
   ESL_ALLOC(ee, sizeof(int64_t) * ESL_MAX(1, nenv_alloc)); 
   ESL_ALLOC(eb, sizeof(float)   * ESL_MAX(1, nenv_alloc));
   nenv = 0;
-  seq = esl_sq_CreateDigital(sq->abc);
 
 #if eslDEBUGLEVEL >= 3
   printf("\nPIPELINE p7EnvelopeDef() %s  %" PRId64 " residues\n", sq->name, sq->n);
@@ -2929,15 +3443,21 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
     default: ESL_FAIL(eslEINVAL, pli->errbuf, "pli_p7_env_def() invalid pass index");
     }
   }
+  fuse_Rgm = fuse_Lgm = fuse_Tgm = FALSE;
+  if(use_gm && pli->f4c_dsq == sq->dsq && pli->f4c_n == sq->n) { 
+    fuse_Rgm = pli->f4c_do[PLI_PASS_5P_ONLY_FORCE];
+    fuse_Lgm = pli->f4c_do[PLI_PASS_3P_ONLY_FORCE];
+    fuse_Tgm = pli->f4c_do[PLI_PASS_5P_AND_3P_FORCE];
+  }
 
   /* If we're in SCAN mode and we don't yet have the generic model we
    * need, read the HMM and create it.
    */
   if (pli->mode == CM_SCAN_MODELS && 
       ((use_gm  == TRUE && (*opt_gm)  == NULL) || 
-       (use_Rgm == TRUE && (*opt_Rgm) == NULL) || 
-       (use_Lgm == TRUE && (*opt_Lgm) == NULL) || 
-       (use_Tgm == TRUE && (*opt_Tgm) == NULL))) { 
+       ((use_Rgm || fuse_Rgm) && (*opt_Rgm) == NULL) || 
+       ((use_Lgm || fuse_Lgm) && (*opt_Lgm) == NULL) || 
+       ((use_Tgm || fuse_Tgm) && (*opt_Tgm) == NULL))) { 
     if((*opt_hmm) == NULL) { 
       /* read the HMM from the file */
       if (pli->cmfp      == NULL) ESL_FAIL(eslENOTFOUND, pli->errbuf, "No file available to read HMM from in pli_p7_env_def()");
@@ -2949,15 +3469,15 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       *opt_gm = p7_profile_Create((*opt_hmm)->M, pli->abc);
       p7_ProfileConfig(*opt_hmm, bg, *opt_gm, 100, p7_GLOCAL);
     }
-    if(use_Rgm && (*opt_Rgm == NULL)) { 
+    if((use_Rgm || fuse_Rgm) && (*opt_Rgm == NULL)) { 
       *opt_Rgm = p7_profile_Clone(*opt_gm);
       p7_ProfileConfig5PrimeTrunc(*opt_Rgm, 100);
     }
-    if(use_Lgm && (*opt_Lgm == NULL)) { 
+    if((use_Lgm || fuse_Lgm) && (*opt_Lgm == NULL)) { 
       *opt_Lgm = p7_profile_Clone(*opt_gm);
       p7_ProfileConfig3PrimeTrunc(*opt_hmm, *opt_Lgm, 100);
     }
-    if(use_Tgm && (*opt_Tgm == NULL)) { 
+    if((use_Tgm || fuse_Tgm) && (*opt_Tgm == NULL)) { 
       *opt_Tgm = p7_profile_Clone(*opt_gm);
       p7_ProfileConfig(*opt_hmm, bg, *opt_Tgm, 100, p7_LOCAL);
       p7_ProfileConfig5PrimeAnd3PrimeTrunc(*opt_Tgm, 100);
@@ -2967,6 +3487,18 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
   Rgm = *opt_Rgm;
   Lgm = *opt_Lgm;
   Tgm = *opt_Tgm;
+  if(Rgm == NULL) fuse_Rgm = FALSE;
+  if(Lgm == NULL) fuse_Lgm = FALSE;
+  if(Tgm == NULL) fuse_Tgm = FALSE;
+
+  /* Prepare the glocal Forward/Backward workspace for the profile
+   * we'll use. Only its length configuration changes between
+   * windows, which cm_p7_GForward() and cm_p7_GBackward() pick up
+   * from the profile itself.
+   */
+  if(! do_local_envdef) { 
+    if((status = cm_p7_gfb_SetProfile(pli->gfb, use_Tgm ? Tgm : (use_Rgm ? Rgm : (use_Lgm ? Lgm : gm)))) != eslOK) ESL_FAIL(status, pli->errbuf, "pli_p7_env_def(): unable to prepare glocal Fwd/Bck workspace");
+  }
   
   for (i = 0; i < nwin; i++) {
 #if eslDEBUGLEVEL >= 3    
@@ -2979,13 +3511,10 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
     if(cm_pli_PassEnforcesFinalRes(pli->cur_pass_idx) && we[i] != sq->n) continue; 
 
     wlen   = we[i]   - ws[i] + 1;
-    subdsq = sq->dsq + ws[i] - 1;
-    
-    /* set up seq object for domaindef function */
-    esl_sq_GrowTo(seq, wlen);
-    memcpy((void*)(seq->dsq), subdsq, (wlen+1) * sizeof(uint8_t)); 
-    seq->dsq[0] = seq->dsq[wlen+1] = eslDSQ_SENTINEL;
-    seq->n = wlen;
+
+    /* point seq at the window for domaindef functions, no residues are copied */
+    if((status = pli_sqview_Set(pli, &(pli->win_sqv), sq, ws[i], wlen, FALSE)) != eslOK) goto ERROR;
+    seq = pli->win_sqv;
 
     p7_bg_SetLength(bg, wlen);
     p7_bg_NullOne(bg, seq->dsq, wlen, &nullsc);
@@ -2994,7 +3523,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       /* Local envelope defn: we can use optimized matrices and,
        * consequently, p7_domaindef_ByPosteriorHeuristics().
        */
-      p7_oprofile_ReconfigLength(om, wlen);
+      pli_oprofile_ReconfigLength(pli, om, wlen, TRUE, TRUE);
       p7_ForwardParser(seq->dsq, wlen, om, pli->oxf, NULL);
       p7_omx_GrowTo(pli->oxb, om->M, 0, wlen);
       p7_BackwardParser(seq->dsq, wlen, om, pli->oxf, pli->oxb, NULL);
@@ -3011,7 +3540,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       if(use_Tgm) { 
 	/* no length reconfiguration necessary */
 	p7_gmx_GrowTo(pli->gxf, Tgm->M, wlen);
-	p7_GForward (seq->dsq, wlen, Tgm, pli->gxf, &fwdsc);
+	if(! pli_gfwd_cached(pli, sq, ws[i], we[i], Tgm->M, pli->gxf, &fwdsc)) cm_p7_GForward(seq->dsq, wlen, Tgm, pli->gfb, pli->gxf, &fwdsc);
 	/*printf("Tfwdsc: %.4f\n", fwdsc);*/
 	/* We use local Fwd statistics to determine statistical
 	 * significance of this score, it has already had basically a
@@ -3023,7 +3552,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       else if(use_Rgm) { 
 	p7_ReconfigLength5PrimeTrunc(Rgm, wlen);
 	p7_gmx_GrowTo(pli->gxf, Rgm->M, wlen);
-	p7_GForward (seq->dsq, wlen, Rgm, pli->gxf, &fwdsc);
+	if(! pli_gfwd_cached(pli, sq, ws[i], we[i], Rgm->M, pli->gxf, &fwdsc)) cm_p7_GForward(seq->dsq, wlen, Rgm, pli->gfb, pli->gxf, &fwdsc);
 	/*printf("Rfwdsc: %.4f\n", fwdsc);*/
 	/* We use local Fwd statistics to determine significance of
 	 * the score. GForward penalized 0. for ends and log(1/Rgm->M)
@@ -3039,7 +3568,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       else if(use_Lgm) { 
 	p7_ReconfigLength3PrimeTrunc(Lgm, wlen);
 	p7_gmx_GrowTo(pli->gxf, Lgm->M, wlen);
-	p7_GForward (seq->dsq, wlen, Lgm, pli->gxf, &fwdsc);
+	if(! pli_gfwd_cached(pli, sq, ws[i], we[i], Lgm->M, pli->gxf, &fwdsc)) cm_p7_GForward(seq->dsq, wlen, Lgm, pli->gfb, pli->gxf, &fwdsc);
 	/*printf("Lfwdsc: %.4f\n", fwdsc);*/
 	/* We use local Fwd statistics to determine significance of
 	 * the score, but we need to correct for lack of equiprobable
@@ -3054,7 +3583,10 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       else if(use_gm) { /* normal case, not looking for truncated hits */
 	p7_ReconfigLength(gm, wlen);
 	p7_gmx_GrowTo(pli->gxf, gm->M, wlen);
-	p7_GForward (seq->dsq, wlen, gm, pli->gxf, &fwdsc);
+	if(fuse_Rgm || fuse_Lgm || fuse_Tgm) { 
+	  if((status = pli_gfwd_fused(pli, seq, ws[i], we[i], sq->n, gm, fuse_Rgm ? Rgm : NULL, fuse_Lgm ? Lgm : NULL, fuse_Tgm ? Tgm : NULL, &fwdsc)) != eslOK) ESL_FAIL(status, pli->errbuf, "pli_p7_env_def(): out of memory");
+	}
+	else cm_p7_GForward(seq->dsq, wlen, gm, pli->gfb, pli->gxf, &fwdsc);
 	/*printf(" fwdsc: %.4f\n", fwdsc);*/
 	sc_for_pvalue = (fwdsc - nullsc) / eslCONST_LOG2;
 	P = esl_exp_surv (sc_for_pvalue,  p7_evparam[CM_p7_GFMU],  p7_evparam[CM_p7_GFLAMBDA]);
@@ -3107,29 +3639,29 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
       //if(pli->cur_pass_idx != PLI_PASS_5P_AND_3P_FORCE) continue;
       //if(1) continue;
 
-      /* this block needs to match up with if..else if...else if...else block calling p7_GForward above */
+      /* this block needs to match up with if..else if...else if...else block calling cm_p7_GForward above */
       if(use_Tgm) { 
 	/* no length reconfiguration necessary */
 	p7_gmx_GrowTo(pli->gxb, Tgm->M, wlen);
-	p7_GBackward(seq->dsq, wlen, Tgm, pli->gxb, &bcksc);
+	cm_p7_GBackward(seq->dsq, wlen, Tgm, pli->gfb, pli->gxb, &bcksc);
 	if((status = p7_domaindef_GlocalByPosteriorHeuristics(seq, Tgm, pli->gxf, pli->gxb, pli->gfwd, pli->gbck, pli->ddef, pli->do_null2)) != eslOK) ESL_FAIL(status, pli->errbuf, "unexpected failure during glocal envelope defn"); 
 	/*printf("Tbcksc: %.4f\n", bcksc);*/
       }
       else if(use_Rgm) { 
 	p7_gmx_GrowTo(pli->gxb, Rgm->M, wlen);
-	p7_GBackward(seq->dsq, wlen, Rgm, pli->gxb, &bcksc);
+	cm_p7_GBackward(seq->dsq, wlen, Rgm, pli->gfb, pli->gxb, &bcksc);
 	if((status = p7_domaindef_GlocalByPosteriorHeuristics(seq, Rgm, pli->gxf, pli->gxb, pli->gfwd, pli->gbck, pli->ddef, pli->do_null2)) != eslOK) ESL_FAIL(status, pli->errbuf, "unexpected failure during glocal envelope defn");; 
 	/*printf("Rbcksc: %.4f\n", bcksc);*/
       }
       else if(use_Lgm) { 
 	p7_gmx_GrowTo(pli->gxb, Lgm->M, wlen);
-	p7_GBackward(seq->dsq, wlen, Lgm, pli->gxb, &bcksc);
+	cm_p7_GBackward(seq->dsq, wlen, Lgm, pli->gfb, pli->gxb, &bcksc);
 	if((status = p7_domaindef_GlocalByPosteriorHeuristics(seq, Lgm, pli->gxf, pli->gxb, pli->gfwd, pli->gbck, pli->ddef, pli->do_null2)) != eslOK) ESL_FAIL(status, pli->errbuf, "unexpected failure during glocal envelope defn");
 	/*printf("Lbcksc: %.4f\n", bcksc);*/
       }
       else { /* normal case, not looking for truncated hits */
 	p7_gmx_GrowTo(pli->gxb, gm->M, wlen);
-	p7_GBackward(seq->dsq, wlen, gm, pli->gxb, &bcksc);
+	cm_p7_GBackward(seq->dsq, wlen, gm, pli->gfb, pli->gxb, &bcksc);
 	if((status = p7_domaindef_GlocalByPosteriorHeuristics(seq, gm, pli->gxf, pli->gxb, pli->gfwd, pli->gbck, pli->ddef, pli->do_null2)) != eslOK) ESL_FAIL(status, pli->errbuf, "unexpected failure during glocal envelope defn");
 	/*printf(" bcksc: %.4f\n", bcksc);*/
       }
@@ -3227,9 +3759,7 @@ pli_p7_env_def(CM_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam,
     pli->ddef->ndom = 0; /* reset for next use */
   }
 
-  /* clean up, set return variables, and return */
-  if(seq != NULL) esl_sq_Destroy(seq);
-
+  /* set return variables, and return */
   *ret_es   = es;
   *ret_ee   = ee;
   *ret_eb   = eb;
@@ -3614,9 +4144,11 @@ pli_final_stage(CM_PIPELINE *pli, off_t cm_offset, const ESL_SQ *sq, int64_t *es
     else if(status != eslOK) return status;
 
     /* if we used HMM bands during the final search stage, save a copy
-     * of them, we'll use it to align any hits above threshold below.
+     * of them, we'll use it to align any hits above threshold below
+     * (unless we're deferring alignment, then caller will align the
+     * hits later with cm_pli_AlignHit(), which calculates new bands).
      */
-    if(cm->search_opts & CM_SEARCH_HBANDED) { 
+    if((cm->search_opts & CM_SEARCH_HBANDED) && (! pli->do_defer_ali)) { 
       scan_cp9b = cp9_CloneBands(cm->cp9b, pli->errbuf);
       if(scan_cp9b == NULL) return eslEMEM;
 #if eslDEBUGLEVEL >= 1
@@ -3659,35 +4191,39 @@ pli_final_stage(CM_PIPELINE *pli, off_t cm_offset, const ESL_SQ *sq, int64_t *es
 #if eslDEBUGLEVEL >= 3
       printf("SURVIVOR envelope     [%10ld..%10ld] survived Inside    %6.2f bits  P %g\n", hit->start, hit->stop, hit->score, hit->pvalue);
 #endif
-      /* Get an alignment of the hit. 
+      /* Get an alignment of the hit, unless we're deferring
+       * alignment until after thresholding (--deferali), in which
+       * case the caller aligns only the hits it will report.
        */
-      /* check if we need to overwrite cm->cp9b with scan_cp9b
-       * because alignment of previous hit modified them in previous 
-       * call to pli_align_hit(). 
-       */
-      if(h > nhit && scan_cp9b != NULL) { 
-	if(cm->cp9b != NULL) FreeCP9Bands(cm->cp9b);
-	cm->cp9b = cp9_CloneBands(scan_cp9b, pli->errbuf);
-	if(cm->cp9b == NULL) return status;
-      }
-      /*cm_hit_Dump(stdout, hit);*/
-
-      /* Before we create the hit alignment, we do a sanity check. If
-       * we used HMM bands in the final search stage, the hit
-       * alignment pli_align_hit() is about to do is expected to use
-       * those bands (they're in cm->cp9b). This should be true based
-       * on how the cm_pipeline_Create() function created the pipeline
-       * object. But since that's a complicated function thanks to the
-       * litany of command-line options that affect it, we do a check
-       * here to make sure.
-       */
-      if(scan_cp9b != NULL && (! (pli->cm_align_opts & CM_ALIGN_HBANDED))) { 
-	ESL_FAIL(eslEINVAL, pli->errbuf, "used HMM bands for Inside search stage, but won't for hit alignment, this shouldn't happen");
-      }
-      if(scan_cp9b == NULL && (pli->cm_align_opts & CM_ALIGN_HBANDED)) { 
-	ESL_FAIL(eslEINVAL, pli->errbuf, "did not use HMM bands for Inside search stage, but will for hit alignment, this shouldn't happen");
+      if(! pli->do_defer_ali) { 
+        /* check if we need to overwrite cm->cp9b with scan_cp9b
+         * because alignment of previous hit modified them in previous 
+         * call to pli_align_hit(). 
+         */
+        if(h > nhit && scan_cp9b != NULL) { 
+	  if(cm->cp9b != NULL) FreeCP9Bands(cm->cp9b);
+	  cm->cp9b = cp9_CloneBands(scan_cp9b, pli->errbuf);
+	  if(cm->cp9b == NULL) return status;
+        }
+        /*cm_hit_Dump(stdout, hit);*/
+
+        /* Before we create the hit alignment, we do a sanity check. If
+         * we used HMM bands in the final search stage, the hit
+         * alignment pli_align_hit() is about to do is expected to use
+         * those bands (they're in cm->cp9b). This should be true based
+         * on how the cm_pipeline_Create() function created the pipeline
+         * object. But since that's a complicated function thanks to the
+         * litany of command-line options that affect it, we do a check
+         * here to make sure.
+         */
+        if(scan_cp9b != NULL && (! (pli->cm_align_opts & CM_ALIGN_HBANDED))) { 
+	  ESL_FAIL(eslEINVAL, pli->errbuf, "used HMM bands for Inside search stage, but won't for hit alignment, this shouldn't happen");
+        }
+        if(scan_cp9b == NULL && (pli->cm_align_opts & CM_ALIGN_HBANDED)) { 
+	  ESL_FAIL(eslEINVAL, pli->errbuf, "did not use HMM bands for Inside search stage, but will for hit alignment, this shouldn't happen");
+        }
+        if((status = pli_align_hit(pli, cm, sq, hit, TRUE)) != eslOK) return status; /* TRUE: cm->cp9b are valid for this hit */
       }
-      if((status = pli_align_hit(pli, cm, sq, hit)) != eslOK) return status;
       
       /* Finally, if we're using model-specific bit score thresholds,
        * determine if the significance of the hit (is it reported
@@ -3768,12 +4304,13 @@ pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_B
   int              i, d;              /* counter over windows, domains */
   CM_HIT          *hit = NULL;        /* ptr to the current hit output data   */
   CM_t            *cm = NULL;         /* ptr to *opt_cm, for convenience only */
-  ESL_DSQ         *subdsq;            /* a ptr to the first position of a window */
-  ESL_SQ          *seq = NULL;        /* a copy of a window */
+  ESL_SQ          *seq = NULL;        /* a view of a window, pli->win_sqv */
   int64_t          wlen;              /* window length of current window */
   int              env_len;           /* envelope length */
   float            nullsc;            /* null model score */
   float            avgpp;             /* average PP of emitted residues in a P7_ALIDISPLAY */
+  P7_OMX          *fx;                /* Forward parse of current window */
+  int              f = 0;             /* index in pli->fpA of next Forward parse kept by pli_p7_filter() */
 
   /* variables necessary only for bit score correction if
    * pli->cur_pass_idx = PLI_PASS_HMM_ONLY_ANY that is analogous to
@@ -3792,7 +4329,6 @@ pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_B
 
   if (sq->n == 0) return eslOK;    /* silently skip length 0 seqs; they'd cause us all sorts of weird problems */
   if (nwin == 0)  return eslOK;    /* if there's no windows, return */
-  seq = esl_sq_CreateDigital(sq->abc);
 
   /* if we're in SCAN mode, and we don't yet have a CM, read it and configure it */
   if (pli->mode == CM_SCAN_MODELS && (*opt_cm == NULL)) { 
@@ -3815,12 +4351,9 @@ pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_B
 #endif
 
     wlen   = we[i]   - ws[i] + 1;
-    subdsq = sq->dsq + ws[i] - 1;
-    /* set up seq object for domaindef function */
-    esl_sq_GrowTo(seq, wlen);
-    memcpy((void*)(seq->dsq), subdsq, (wlen+1) * sizeof(uint8_t)); 
-    seq->dsq[0] = seq->dsq[wlen+1] = eslDSQ_SENTINEL;
-    seq->n = wlen;
+    /* point seq at the window for domaindef function, no residues are copied */
+    if((status = pli_sqview_Set(pli, &(pli->win_sqv), sq, ws[i], wlen, FALSE)) != eslOK) ESL_FAIL(status, pli->errbuf, "out of memory");
+    seq = pli->win_sqv;
 
     p7_bg_SetLength(bg, wlen);
     p7_bg_NullOne(bg, seq->dsq, wlen, &nullsc);
@@ -3828,11 +4361,28 @@ pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_B
     /* Local envelope defn: we can use optimized matrices and,
      * consequently, p7_domaindef_ByPosteriorHeuristics().
      */
-    p7_oprofile_ReconfigLength(om, wlen);
-    p7_ForwardParser(seq->dsq, wlen, om, pli->oxf, NULL);
+    pli_oprofile_ReconfigLength(pli, om, wlen, TRUE, TRUE);
+    /* pli_p7_filter() kept the Forward parse of each window that
+     * survived it; use it unless the window is a merge of several.
+     */
+    while(f < pli->fp_n && pli->fp_ws[f] < ws[i]) f++;
+    if(f < pli->fp_n && pli->fp_ws[f] == ws[i] && pli->fp_we[f] == we[i]) { 
+      fx = pli->fpA[f];
+      pli->acct[pli->cur_pass_idx].n_fwd_reuse++;
+#if eslDEBUGLEVEL >= 1
+      /* the kept parse must be the one we'd compute here */
+      p7_ForwardParser(seq->dsq, wlen, om, pli->oxf, NULL);
+      if(fx->totscale != pli->oxf->totscale || memcmp(fx->xmx, pli->oxf->xmx, sizeof(float) * p7X_NXCELLS * (wlen+1)) != 0)
+	ESL_FAIL(eslFAIL, pli->errbuf, "reused Forward parse of window %" PRId64 "..%" PRId64 " differs from a fresh one", ws[i], we[i]);
+#endif
+    }
+    else { 
+      fx = pli->oxf;
+      p7_ForwardParser(seq->dsq, wlen, om, fx, NULL);
+    }
     p7_omx_GrowTo(pli->oxb, om->M, 0, wlen);
-    p7_BackwardParser(seq->dsq, wlen, om, pli->oxf, pli->oxb, NULL);
-    status = p7_domaindef_ByPosteriorHeuristics (seq, /*nt_seq=*/NULL, om, pli->oxf, pli->oxb, pli->fwd, pli->bck, pli->ddef, bg,  /*long_target=*/FALSE,
+    p7_BackwardParser(seq->dsq, wlen, om, fx, pli->oxb, NULL);
+    status = p7_domaindef_ByPosteriorHeuristics (seq, /*nt_seq=*/NULL, om, fx, pli->oxb, pli->fwd, pli->bck, pli->ddef, bg,  /*long_target=*/FALSE,
 						 /*bg_tmp=*/NULL, /*scores_arr=*/NULL, /*fwd_emissions_arr=*/NULL);
 
     if (status != eslOK) ESL_FAIL(status, pli->errbuf, "envelope definition workflow failure"); /* eslERANGE can happen */
@@ -3958,9 +4508,6 @@ pli_final_stage_hmmonly(CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_B
     pli->ddef->ndom = 0; /* reset for next use */
   } /* end of 'for(i = 0; i < win'... */
 
-  /* clean up, set return variables, and return */
-  if(seq != NULL) esl_sq_Destroy(seq);
-
   return eslOK;
 }
 
@@ -4118,15 +4665,21 @@ int pli_dispatch_cm_search(CM_PIPELINE *pli, CM_t *cm, ESL_DSQ *dsq, int64_t sta
  *            search stage (using the same bands we'll use here, those 
  *            in cm->cp9b). 
  *
+ *            If <cp9b_valid> is FALSE, cm->cp9b are not the bands
+ *            from the final search stage (because we're aligning a
+ *            hit after the search, see cm_pli_AlignHit()), so we
+ *            calculate new HMM bands for just the hit, tightening
+ *            them if nec so the matrix fits within our size limit.
+ *
  * Returns: eslOK on success, alidisplay in hit->ad.
  *          ! eslOK on an error, pli->errbuf is filled, hit->ad is NULL.
  */
 int
-pli_align_hit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit)
+pli_align_hit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit, int cp9b_valid)
 {
   int            status;           /* Easel status code */
   CM_ALNDATA    *adata  = NULL;    /* alignment data */
-  ESL_SQ        *sq2aln = NULL;    /* copy of the hit, req'd by DispatchSqAlignment() */
+  ESL_SQ        *sq2aln = NULL;    /* view of the hit, pli->hit_sqv, req'd by DispatchSqAlignment() */
   ESL_STOPWATCH *watch  = NULL;    /* stopwatch for timing alignment step */
   float          null3_correction; /* null 3 bit score penalty, for CYK score */
   float          mxsize_limit = (pli->mxsize_set) ? pli->mxsize_limit : pli_mxsize_limit_from_W(cm->W);
@@ -4136,29 +4689,36 @@ pli_align_hit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit)
   if((watch = esl_stopwatch_Create()) == NULL) ESL_XFAIL(eslEMEM, pli->errbuf, "out of memory");
   esl_stopwatch_Start(watch);  
 
-  /* make new sq object, b/c DispatchSqAlignment() requires one */
-  if((sq2aln = esl_sq_CreateDigitalFrom(cm->abc, "seq", sq->dsq + hit->start - 1, hit->stop - hit->start + 1, NULL, NULL, NULL)) == NULL) goto ERROR;
+  /* point a sq object at the hit, b/c DispatchSqAlignment() requires one */
+  if((status = pli_sqview_Set(pli, &(pli->hit_sqv), sq, hit->start, hit->stop - hit->start + 1, FALSE)) != eslOK) ESL_XFAIL(status, pli->errbuf, "out of memory");
+  sq2aln = pli->hit_sqv;
 
   cm->align_opts = pli->cm_align_opts;
-  if(pli->cur_pass_idx != PLI_PASS_STD_ANY) cm->align_opts |= CM_ALIGN_TRUNC;
+  if(hit->pass_idx != PLI_PASS_STD_ANY) cm->align_opts |= CM_ALIGN_TRUNC;
 
   /* do HMM banded aln, if nec */
   if(cm->align_opts & CM_ALIGN_HBANDED) { /* align with HMM bands */
-    /* we have existing CP9 HMM bands from the final search stage, in
-     * cm->cp9b (caller should have verified this). Shift them by a
-     * fixed offset, this guarantees our alignment will be the same
-     * hit our search found. (After this cm->cp9b bands would fail a
-     * cp9_ValidateBands() check..., but don't worry about
-     * that... they'll work for our purposes here.
-     */
-    cp9_ShiftCMBands(cm, hit->start, hit->stop, (cm->align_opts & CM_ALIGN_TRUNC) ? TRUE : FALSE);
+    if(cp9b_valid) { 
+      /* we have existing CP9 HMM bands from the final search stage, in
+       * cm->cp9b (caller should have verified this). Shift them by a
+       * fixed offset, this guarantees our alignment will be the same
+       * hit our search found. (After this cm->cp9b bands would fail a
+       * cp9_ValidateBands() check..., but don't worry about
+       * that... they'll work for our purposes here.
+       */
+      cp9_ShiftCMBands(cm, hit->start, hit->stop, (cm->align_opts & CM_ALIGN_TRUNC) ? TRUE : FALSE);
+    }
+    else { 
+      /* DispatchSqAlignment() will calculate bands for the hit */
+      cm->align_opts |= CM_ALIGN_XTAU;
+    }
 
     /* sanity check */
     if(! (cm->align_opts & CM_ALIGN_POST)) ESL_XFAIL(eslEINVAL, pli->errbuf, "pli_align_hit() using HMM bands but CM_ALIGN_POST is down"); 
 
     /* compute the HMM banded alignment */
-    status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, mxsize_limit, hit->mode, pli->cur_pass_idx,
-				 TRUE, /* TRUE: cp9b bands are valid, don't recalc them */
+    status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, mxsize_limit, hit->mode, hit->pass_idx,
+				 cp9b_valid, /* TRUE: cp9b bands are valid, don't recalc them */
 				 NULL, NULL, NULL, &adata);
     if(status != eslOK && status != eslERANGE) { 
       goto ERROR;
@@ -4179,20 +4739,20 @@ pli_align_hit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit)
        * alignment should never exceed twice what the Inside scan
        * required.)
        */
-      status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, 2*mxsize_limit, hit->mode, pli->cur_pass_idx,
-				   TRUE, /* TRUE: cp9b bands are valid, don't recalc them */
+      status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, 2*mxsize_limit, hit->mode, hit->pass_idx,
+				   cp9b_valid, /* TRUE: cp9b bands are valid, don't recalc them */
 				   NULL, NULL, NULL, &adata);
       if (status == eslERANGE) ESL_XFAIL(eslEINVAL, pli->errbuf, "pli_align_hit() alignment HB retry mx too big, this shouldn't happen");
       else if(status != eslOK) goto ERROR;
     }
-    pli->acct[pli->cur_pass_idx].n_aln_hb++;
+    pli->acct[hit->pass_idx].n_aln_hb++;
     esl_stopwatch_Stop(watch); /* we started it above before we calc'ed the CP9 bands */ 
   }
   else { /* do non-HMM-banded alignment (! (cm->align_opts & CM_ALIGN_HBANDED)) */
     esl_stopwatch_Start(watch);
-    if((status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, mxsize_limit, hit->mode, pli->cur_pass_idx,
+    if((status = DispatchSqAlignment(cm, pli->errbuf, sq2aln, -1, mxsize_limit, hit->mode, hit->pass_idx,
 				     FALSE, NULL, NULL, NULL, &adata)) != eslOK) goto ERROR;
-    pli->acct[pli->cur_pass_idx].n_aln_dccyk++;
+    pli->acct[hit->pass_idx].n_aln_dccyk++;
     esl_stopwatch_Stop(watch);
   }
   /* ParsetreeDump(stdout, tr, cm, sq2aln->dsq); */
@@ -4211,16 +4771,14 @@ pli_align_hit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit)
 
   /* clean up and return */
   cm->align_opts = pli->cm_align_opts; /* restore these */
-  if(adata  != NULL) cm_alndata_Destroy(adata, FALSE); /* FALSE: don't free adata->sqp (sq2aln) */
-  if(sq2aln != NULL) esl_sq_Destroy(sq2aln); 
+  if(adata  != NULL) cm_alndata_Destroy(adata, FALSE); /* FALSE: don't free adata->sqp (sq2aln, a view kept in pli) */
   if(watch  != NULL) esl_stopwatch_Destroy(watch); 
 
   return eslOK;
 
  ERROR:
   cm->align_opts = pli->cm_align_opts; /* restore these */
-  if(adata  != NULL) cm_alndata_Destroy(adata, FALSE); /* FALSE: don't free adata->sqp (sq2aln) */
-  if(sq2aln != NULL) esl_sq_Destroy(sq2aln); 
+  if(adata  != NULL) cm_alndata_Destroy(adata, FALSE); /* FALSE: don't free adata->sqp (sq2aln, a view kept in pli) */
   if(watch  != NULL) esl_stopwatch_Destroy(watch);
   hit->ad = NULL;
   return status;
@@ -4306,52 +4864,737 @@ pli_scan_mode_read_cm(CM_PIPELINE *pli, off_t cm_offset, float *p7_evparam, int
   return status;
 }
 
-/* Function:  pli_copy_subseq()
- * Incept:    EPN, Tue Aug  9 11:13:02 2011
+/* Function:  pli_sqview_Set()
+ *
+ * Purpose:  Point the sequence view <*vsqp> at residues
+ *           <i>..<i>+<L>-1 of <src_sq>, without copying them.
+ *           If <*vsqp> is NULL, the view is created first (views
+ *           are kept in <pli> and reused, so this happens once per
+ *           view per pipeline).
  *
- * Purpose: Copy a subsequence of an existing sequence <src_sq>
- *           starting at position <i>, of length <L> to another
- *           sequence object <dest_sq>. Copy only residues from
- *           <i>..<i>+<L>-1. <dest_sq> must be pre-allocated.
+ *           A view is an ESL_SQ whose <dsq> points into
+ *           <src_sq->dsq>: (*vsqp)->dsq[1..L] are the residues, but
+ *           (*vsqp)->dsq[0] and (*vsqp)->dsq[L+1] are the residues
+ *           flanking the subsequence in <src_sq> (or its sentinels),
+ *           not sentinels. This is the same trick cmscan uses to
+ *           search chunks of its query, and is safe because
+ *           pipeline stages only read residues 1..n of the
+ *           sequences they're given. A view must never be written
+ *           to or grown, and is only valid while <src_sq> is.
  *
- * Returns: eslOK on success. 
+ *           If <do_subseq> is TRUE, the view is a subsequence of
+ *           <src_sq>: its name, accession, description, source
+ *           length <L> and <start>..<end> coordinates are set from
+ *           <src_sq>, as for the 5' and 3' terminal sequences
+ *           searched in the truncated passes. If FALSE, the view is
+ *           a stand-alone sequence <1>..<L>, as required by the
+ *           envelope definition and alignment functions.
+ *
+ * Returns: eslOK on success.
+ *          eslEMEM on allocation failure.
  */
-void
-pli_copy_subseq(const ESL_SQ *src_sq, ESL_SQ *dest_sq, int64_t i, int64_t L)
-{ 
-  /*Printf("entering pli_copy_subseq i: %" PRId64 " j: %" PRId64 " L: %" PRId64 " start-end: %" PRId64 "... %" PRId64 "\n",
-    i, i+L-1, L, src_sq->start, src_sq->end);
-    fflush(stdout);*/
-
-  esl_sq_Reuse(dest_sq);
-  esl_sq_GrowTo(dest_sq, L);
-  memcpy((void*)(dest_sq->dsq+1), src_sq->dsq+i, L * sizeof(ESL_DSQ));
-  dest_sq->dsq[0] = dest_sq->dsq[L+1] = eslDSQ_SENTINEL;
-  dest_sq->n      = L;
-  dest_sq->L      = src_sq->L;
-
-  if(src_sq->start <= src_sq->end) { 
-    ESL_DASSERT1((L <= (src_sq->end - src_sq->start + 1)));
-    /*assert(L <= (src_sq->end - src_sq->start + 1));*/
-    dest_sq->start = src_sq->start  + i - 1;
-    dest_sq->end   = dest_sq->start + L - 1;
+static int
+pli_sqview_Set(CM_PIPELINE *pli, ESL_SQ **vsqp, const ESL_SQ *src_sq, int64_t i, int64_t L, int do_subseq)
+{
+  int     status;
+  ESL_SQ *vsq = *vsqp;
+
+  if(vsq == NULL) { 
+    if((vsq = esl_sq_CreateDigital(src_sq->abc)) == NULL) return eslEMEM;
+    free(vsq->dsq);
+    vsq->dsq = NULL; /* set below to point into src_sq->dsq */
+    pli->nsqalloc++;
+    *vsqp = vsq;
+  }
+
+  vsq->dsq = src_sq->dsq + i - 1;
+  vsq->n   = L;
+  vsq->C   = 0;
+
+  if(do_subseq) { 
+    vsq->L = src_sq->L;
+    vsq->W = 0;
+    if(src_sq->start <= src_sq->end) { 
+      ESL_DASSERT1((L <= (src_sq->end - src_sq->start + 1)));
+      vsq->start = src_sq->start + i - 1;
+      vsq->end   = vsq->start    + L - 1;
+    }
+    else { 
+      ESL_DASSERT1((L <= (src_sq->start - src_sq->end + 1)));
+      vsq->start = src_sq->end   + L - 1;
+      vsq->end   = vsq->start    - L + 1;
+    }
+    if((status = esl_sq_SetName     (vsq, src_sq->name)) != eslOK) return status;
+    if((status = esl_sq_SetAccession(vsq, src_sq->acc))  != eslOK) return status;
+    if((status = esl_sq_SetDesc     (vsq, src_sq->desc)) != eslOK) return status;
   }
   else { 
-    ESL_DASSERT1((L <= (src_sq->start - src_sq->end + 1)));
-    /*assert(L <= (src_sq->start - src_sq->end + 1));*/
-    dest_sq->start = src_sq->end    + L - 1;
-    dest_sq->end   = dest_sq->start - L + 1;
+    vsq->L     = L;
+    vsq->W     = L;
+    vsq->start = 1;
+    vsq->end   = L;
+  }
+
+  return eslOK;
+}
+
+/* pli_sqview_Destroy()
+ * Free a view created by pli_sqview_Set(), without freeing
+ * the residues it points to. <vsq> may be NULL.
+ */
+static void
+pli_sqview_Destroy(ESL_SQ *vsq)
+{
+  if(vsq == NULL) return;
+  vsq->dsq = NULL; /* important: points into another sequence's residues */
+  esl_sq_Destroy(vsq);
+  return;
+}
+
+/* Function:  pli_wcache_Reset()
+ *
+ * Purpose:  Prepare the window cache <pli->wc> for the sequence <sq>
+ *           that cm_Pipeline() is about to search: forget the
+ *           windows and scores of the previous sequence (or model,
+ *           in scan mode) and mark all residues of <sq> as not yet
+ *           scored by any local HMM filter stage.
+ *
+ * Returns:  eslOK on success.
+ *           eslEMEM on allocation failure.
+ */
+static int
+pli_wcache_Reset(CM_PIPELINE *pli, const ESL_SQ *sq)
+{
+  int           status;
+  CM_P7_WCACHE *wc = &(pli->wc);
+  void         *tmp;
+  int           p;
+
+  wc->dsq      = sq->dsq;
+  wc->L        = sq->n;
+  wc->ssv_i    = wc->ssv_j = -1;
+  wc->ssv_nwin = 0;
+  wc->nwin     = 0;
+  for(p = 0; p < NPLI_PASSES; p++) wc->pstart[p] = wc->pn[p] = 0;
+
+  if(wc->scored_alloc < sq->n+1) { 
+    ESL_RALLOC(wc->scored, tmp, sizeof(uint8_t) * (sq->n+1));
+    wc->scored_alloc = sq->n+1;
+  }
+  memset(wc->scored, 0, sizeof(uint8_t) * (sq->n+1));
+
+  return eslOK;
+
+ ERROR:
+  wc->dsq = NULL;
+  return status;
+}
+
+/* pli_wcache_SetSSV()
+ * Remember the <nwin> windows <ws>..<we> that the SSV filter, with
+ * P-value threshold <F1>, found (and the pipeline split) in the
+ * subsequence of length <n> starting at <wc_off>+1 of the window
+ * cache's residues.
+ */
+static int
+pli_wcache_SetSSV(CM_PIPELINE *pli, int64_t *ws, int64_t *we, int nwin, int64_t wc_off, int64_t n, double F1)
+{
+  int           status;
+  CM_P7_WCACHE *wc = &(pli->wc);
+  void         *tmp;
+  int           i;
+
+  if(wc->ssv_nalloc < nwin) { 
+    ESL_RALLOC(wc->ssv_ws, tmp, sizeof(int64_t) * nwin);
+    ESL_RALLOC(wc->ssv_we, tmp, sizeof(int64_t) * nwin);
+    wc->ssv_nalloc = nwin;
+  }
+  for(i = 0; i < nwin; i++) { 
+    wc->ssv_ws[i] = ws[i] + wc_off;
+    wc->ssv_we[i] = we[i] + wc_off;
+  }
+  wc->ssv_nwin = nwin;
+  wc->ssv_i    = wc_off + 1;
+  wc->ssv_j    = wc_off + n;
+  wc->ssv_F1   = F1;
+
+  return eslOK;
+
+ ERROR:
+  wc->ssv_i = wc->ssv_j = -1;
+  return status;
+}
+
+/* pli_wcache_Window()
+ * Return in <ret_wcw> the window cache's entry for window
+ * <ws>..<we>. If an earlier pass filtered the same window, that
+ * pass's entry is returned, with the scores it computed;
+ * otherwise a new entry with no scores is added to the current
+ * pass's windows. Windows must be requested in increasing order
+ * within a pass, as pli_p7_filter() does.
+ */
+static int
+pli_wcache_Window(CM_PIPELINE *pli, int64_t ws, int64_t we, CM_P7_WCWIN **ret_wcw)
+{
+  int           status;
+  CM_P7_WCACHE *wc = &(pli->wc);
+  CM_P7_WCWIN  *w;
+  void         *tmp;
+  int           p, lo, hi, mid;
+
+  for(p = 0; p < NPLI_PASSES; p++) { 
+    if(p == pli->cur_pass_idx || wc->pn[p] == 0) continue;
+    lo = wc->pstart[p];
+    hi = wc->pstart[p] + wc->pn[p] - 1;
+    while(lo <= hi) { /* binary search, pass p's windows are sorted */
+      mid = (lo + hi) / 2;
+      w   = &(wc->win[mid]);
+      if     (w->ws < ws || (w->ws == ws && w->we < we)) lo = mid+1;
+      else if(w->ws > ws || (w->ws == ws && w->we > we)) hi = mid-1;
+      else { *ret_wcw = w; return eslOK; }
+    }
+  }
+
+  if(wc->nwin == wc->nalloc) { 
+    wc->nalloc = ESL_MAX(64, 2 * wc->nalloc);
+    ESL_RALLOC(wc->win, tmp, sizeof(CM_P7_WCWIN) * wc->nalloc);
+  }
+  w = &(wc->win[wc->nwin++]);
+  w->ws       = ws;
+  w->we       = we;
+  w->flags    = 0;
+  w->mfsc     = w->filtersc = w->vfsc = w->fwdsc = 0.;
+  wc->pn[pli->cur_pass_idx]++;
+
+  *ret_wcw = w;
+  return eslOK;
+
+ ERROR:
+  *ret_wcw = NULL;
+  return status;
+}
+
+/* pli_wcache_Filter()
+ * Return the local HMM filter score for window <subdsq> of length
+ * <wlen>: MSV if <stage> is CM_P7_WC_MSV, Viterbi if
+ * CM_P7_WC_VIT, Forward if CM_P7_WC_FWD. The score is taken from
+ * <wcw>, the window's cache entry, if an earlier pass computed it,
+ * else it is computed in <ox> (with <om> configured for <wlen>) and
+ * saved in <wcw>. <wcw> may be NULL if the window isn't cached.
+ *
+ * Also count the residues scored by the stage in the pass's
+ * accounting, and how many of them are redundant (already scored
+ * by the same stage in this or an earlier pass) and reused. <wc_i>
+ * is the position of subdsq[1] in the window cache's residues, or
+ * -1 if the window isn't cached.
+ */
+static float
+pli_wcache_Filter(CM_PIPELINE *pli, P7_OPROFILE *om, P7_OMX *ox, const ESL_DSQ *subdsq, int wlen, int64_t wc_i, CM_P7_WCWIN *wcw, int stage)
+{
+  CM_PLI_ACCT *acct = &(pli->acct[pli->cur_pass_idx]);
+  uint8_t     *scored;
+  float        sc = 0.;
+  int64_t      nredun = 0;
+  int          x;
+
+  acct->pos_lfilter += wlen;
+  if(wc_i != -1) { 
+    scored = pli->wc.scored + wc_i;
+    for(x = 0; x < wlen; x++) { 
+      if(scored[x] & stage) nredun++;
+      else                  scored[x] |= stage;
+    }
+    acct->pos_lfilter_redun += nredun;
+  }
+
+  if(wcw != NULL && (wcw->flags & stage)) { 
+    acct->pos_lfilter_reuse += wlen;
+    switch(stage) { 
+    case CM_P7_WC_MSV: return wcw->mfsc;
+    case CM_P7_WC_VIT: return wcw->vfsc;
+    case CM_P7_WC_FWD: return wcw->fwdsc;
+    }
+  }
+
+  switch(stage) { 
+  case CM_P7_WC_MSV: p7_MSVFilter    ((ESL_DSQ *) subdsq, wlen, om, ox, &sc); break;
+  case CM_P7_WC_VIT: p7_ViterbiFilter((ESL_DSQ *) subdsq, wlen, om, ox, &sc); break;
+  case CM_P7_WC_FWD: p7_ForwardParser((ESL_DSQ *) subdsq, wlen, om, ox, &sc); break;
+  }
+  if(wcw != NULL) { 
+    switch(stage) { 
+    case CM_P7_WC_MSV: wcw->mfsc  = sc; break;
+    case CM_P7_WC_VIT: wcw->vfsc  = sc; break;
+    case CM_P7_WC_FWD: wcw->fwdsc = sc; break;
+    }
+    wcw->flags |= stage;
+  }
+  return sc;
+}
+
+/* pli_wcache_FilterScore()
+ * Return the bias filter null score for window <subdsq> of length
+ * <wlen>, from its window cache entry <wcw> if an earlier pass
+ * computed it, else compute it with p7_bg_FilterScore() (with <bg>
+ * configured for <wlen>) and save it in <wcw>. <wcw> may be NULL.
+ */
+static float
+pli_wcache_FilterScore(P7_BG *bg, const ESL_DSQ *subdsq, int wlen, CM_P7_WCWIN *wcw)
+{
+  float filtersc;
+
+  if(wcw != NULL && (wcw->flags & CM_P7_WC_BIAS)) return wcw->filtersc;
+
+  p7_bg_FilterScore(bg, (ESL_DSQ *) subdsq, wlen, &filtersc);
+  if(wcw != NULL) { 
+    wcw->filtersc = filtersc;
+    wcw->flags   |= CM_P7_WC_BIAS;
+  }
+  return filtersc;
+}
+
+/* Function:  pli_lcmask()
+ *
+ * Purpose:  Find the segments of <sq> that are not low complexity,
+ *           to be searched with the SSV filter, and store them in
+ *           <pli->lc_ss>, <pli->lc_se> and <pli->lc_nseg>.
+ *
+ *           Each window of <pli->lcw> residues is scored as
+ *           sum_a c_a log_2 (c_a / (n * f_a)), where c_a is the
+ *           count of canonical residue a in the window, n is the
+ *           number of canonical residues in it and f_a is the
+ *           background frequency of a in <bg>: the log odds of the
+ *           window's own composition versus the background, the
+ *           same score the null3 correction of the CM stages uses.
+ *           All residues of windows that score more than
+ *           <pli->lcmask> bits are masked. Residue counts are
+ *           updated as the window slides, so each residue is
+ *           visited twice and each window costs abc->K table
+ *           lookups.
+ *
+ *           The number of masked residues is added to the
+ *           accounting of the current pass.
+ *
+ * Returns:  eslOK on success.
+ *           eslEMEM on allocation failure.
+ */
+static int
+pli_lcmask(CM_PIPELINE *pli, P7_BG *bg, const ESL_SQ *sq)
+{
+  int      status;
+  int      K = bg->abc->K;     /* alphabet size */
+  int      w = pli->lcw;       /* window length */
+  float    lf[p7_MAXABET];     /* [0..a..K-1] log_2 of background frequency of a */
+  int      ct[p7_MAXABET];     /* [0..a..K-1] count of a in current window */
+  int      n = 0;              /* number of canonical residues in current window */
+  float    sc;                 /* score of current window, bits */
+  int64_t  j;                  /* position in sq, end of current window */
+  int64_t  ms = 0, me = -1;    /* current masked stretch is ms..me, me == -1 if none */
+  int64_t  u = 1;              /* first residue of the next unmasked segment */
+  int64_t  nmasked = 0;        /* number of residues masked */
+  int      a;
+  ESL_DSQ  x;
+
+  for(a = 0; a < K; a++) { 
+    lf[a] = sreLOG2(bg->f[a]);
+    ct[a] = 0;
+  }
+  pli->lc_nseg = 0;
+
+  for(j = 1; j <= sq->n; j++) { 
+    x = sq->dsq[j];
+    if(esl_abc_XIsCanonical(bg->abc, x)) { ct[x]++; n++; }
+    if(j > w) { 
+      x = sq->dsq[j-w];
+      if(esl_abc_XIsCanonical(bg->abc, x)) { ct[x]--; n--; }
+    }
+    if(j < w || n == 0) continue;
+
+    sc = -1. * pli->lcl[n];
+    for(a = 0; a < K; a++) sc += pli->lcl[ct[a]] - ct[a] * lf[a];
+    if(sc > pli->lcmask) { 
+      if(me != -1 && j-w+1 <= me+1) { /* extend current masked stretch */
+	me = j;
+      }
+      else { /* close current masked stretch and start a new one */
+	if(me != -1) { 
+	  if((status = pli_lcmask_add_segment(pli, u, ms-1)) != eslOK) return status;
+	  nmasked += me - ms + 1;
+	  u = me + 1;
+	}
+	ms = j-w+1;
+	me = j;
+      }
+    }
+  }
+  if(me != -1) { 
+    if((status = pli_lcmask_add_segment(pli, u, ms-1)) != eslOK) return status;
+    nmasked += me - ms + 1;
+    u = me + 1;
   }
-  /*printf("leaving copy_subseq dest_sq->start..end: %" PRId64 " %" PRId64 " n: %" PRId64 "\n",
-    dest_sq->start, dest_sq->end, dest_sq->n);*/
+  if((status = pli_lcmask_add_segment(pli, u, sq->n)) != eslOK) return status;
+
+  pli->acct[pli->cur_pass_idx].pos_lcmask += nmasked;
+  return eslOK;
+}
 
-  esl_sq_SetName     (dest_sq, src_sq->name);
-  esl_sq_SetAccession(dest_sq, src_sq->acc);
-  esl_sq_SetDesc     (dest_sq, src_sq->desc);
+/* pli_lcmask_add_segment()
+ * Add unmasked segment <i>..<j> to <pli->lc_ss>, <pli->lc_se>,
+ * unless it's empty (i > j).
+ */
+static int
+pli_lcmask_add_segment(CM_PIPELINE *pli, int64_t i, int64_t j)
+{
+  int   status;
+  void *tmp;
+
+  if(i > j) return eslOK;
+  if(pli->lc_nseg == pli->lc_nalloc) { 
+    pli->lc_nalloc = ESL_MAX(16, 2 * pli->lc_nalloc);
+    ESL_RALLOC(pli->lc_ss, tmp, sizeof(int64_t) * pli->lc_nalloc);
+    ESL_RALLOC(pli->lc_se, tmp, sizeof(int64_t) * pli->lc_nalloc);
+  }
+  pli->lc_ss[pli->lc_nseg] = i;
+  pli->lc_se[pli->lc_nseg] = j;
+  pli->lc_nseg++;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* pli_oprofile_ReconfigLength()
+ * Configure the length-dependent parameters of <om> for windows
+ * of length <L>: the MSV filter's if <do_msv> (as
+ * p7_oprofile_ReconfigMSVLength() does) and the Viterbi and
+ * Forward filters' if <do_rest> (as
+ * p7_oprofile_ReconfigRestLength() does), unless they're already
+ * configured for <L>. Consecutive windows often have the same
+ * length: windows longer than 2*W are split into windows of
+ * exactly 2*W, and passes search the same windows.
+ *
+ * This relies on every other change to the length configuration
+ * of <om> between calls being followed by a call to
+ * pli_oprofile_InvalidateLength(), except for the
+ * p7_domaindef_*() functions, which restore the length and mode
+ * of <om> before they return.
+ */
+static void
+pli_oprofile_ReconfigLength(CM_PIPELINE *pli, P7_OPROFILE *om, int L, int do_msv, int do_rest)
+{
+  if(om != pli->ocfg_om) { 
+    pli->ocfg_om    = om;
+    pli->ocfg_msvL  = pli->ocfg_restL = -1;
+  }
+  if(do_msv) { 
+    if(pli->ocfg_msvL != L) { p7_oprofile_ReconfigMSVLength(om, L); pli->ocfg_msvL = L; pli->nocfg++; }
+    else                    pli->nocfg_skip++;
+  }
+  if(do_rest) { 
+    if(pli->ocfg_restL != L || om->L != L) { p7_oprofile_ReconfigRestLength(om, L); pli->ocfg_restL = L; pli->nocfg++; }
+    else                                   pli->nocfg_skip++;
+  }
+  return;
+}
 
+/* pli_oprofile_InvalidateLength()
+ * Forget the lengths the filter HMM was last configured for, 
+ * because the profile or its configuration may have changed
+ * (a new model, or the rest of the profile read from disk).
+ */
+static void
+pli_oprofile_InvalidateLength(CM_PIPELINE *pli)
+{
+  pli->ocfg_om    = NULL;
+  pli->ocfg_msvL  = -1;
+  pli->ocfg_restL = -1;
   return;
 }
 
+/* pli_fparse_Next()
+ * Return in <*ret_ox> the next unused Forward parser matrix
+ * pli->fpA[pli->fp_n], grown for a model of length <M> and a
+ * window of length <L>. The HMM only pass parses each window with
+ * the Forward filter into one of these; the caller keeps it by
+ * setting pli->fp_ws[pli->fp_n], pli->fp_we[pli->fp_n] and
+ * incrementing pli->fp_n, else it's reused for the next window.
+ *
+ * The matrices in pli->fpA are limited to the same total size as
+ * an HMM banded CM matrix (--mxsize). If growing the next one would
+ * exceed that, <*ret_ox> is pli->oxf instead, which the caller
+ * doesn't keep, and pli_final_stage_hmmonly() reparses the window.
+ *
+ * Returns <eslOK> on success, <eslEMEM> on allocation failure.
+ */
+static int
+pli_fparse_Next(CM_PIPELINE *pli, int M, int L, P7_OMX **ret_ox)
+{
+  int   status;
+  void *p;
+  int   nalloc;
+  int   x;
+  float mb;       /* size of pli->fpA[pli->fp_n] once grown, Mb */
+  float mb_limit = (pli->mxsize_set) ? pli->mxsize_limit : pli_mxsize_limit_from_W(pli->cmW);
+
+  if(pli->fp_n == pli->fp_nalloc) { 
+    nalloc = (pli->fp_nalloc == 0) ? 8 : pli->fp_nalloc * 2;
+    ESL_RALLOC(pli->fpA,   p, sizeof(P7_OMX *) * nalloc);
+    ESL_RALLOC(pli->fp_ws, p, sizeof(int64_t)  * nalloc);
+    ESL_RALLOC(pli->fp_we, p, sizeof(int64_t)  * nalloc);
+    ESL_RALLOC(pli->fp_mb, p, sizeof(float)    * nalloc);
+    for(x = pli->fp_nalloc; x < nalloc; x++) { pli->fpA[x] = NULL; pli->fp_mb[x] = 0.; }
+    pli->fp_nalloc = nalloc;
+  }
+
+  /* a parser matrix has one row of main cells and L+1 rows of special cells */
+  mb = (float) (sizeof(float) * (p7X_NSCELLS * (size_t) M + p7X_NXCELLS * (size_t) (L+1))) / 1000000.;
+  mb = ESL_MAX(mb, pli->fp_mb[pli->fp_n]); /* matrices are never shrunk */
+  if(pli->fp_mb_tot - pli->fp_mb[pli->fp_n] + mb > mb_limit) { 
+    *ret_ox = pli->oxf;
+    return eslOK;
+  }
+
+  if(pli->fpA[pli->fp_n] == NULL) { 
+    if((pli->fpA[pli->fp_n] = p7_omx_Create(M, 0, L)) == NULL) { status = eslEMEM; goto ERROR; }
+  }
+  else if((status = p7_omx_GrowTo(pli->fpA[pli->fp_n], M, 0, L)) != eslOK) goto ERROR;
+  pli->fp_mb_tot += mb - pli->fp_mb[pli->fp_n];
+  pli->fp_mb[pli->fp_n] = mb;
+
+  *ret_ox = pli->fpA[pli->fp_n];
+  return eslOK;
+
+ ERROR:
+  *ret_ox = NULL;
+  return status;
+}
+
+/* pli_fparse_Release()
+ * Free the Forward parser matrices in pli->fpA, but not the
+ * arrays of pointers to them, and forget any kept parses. Called
+ * for each new model so that the matrices, which are only grown,
+ * don't stay at their largest size for the rest of a search.
+ */
+static void
+pli_fparse_Release(CM_PIPELINE *pli)
+{
+  int x;
+
+  for(x = 0; x < pli->fp_nalloc; x++) { 
+    if(pli->fpA[x] != NULL) p7_omx_Destroy(pli->fpA[x]);
+    pli->fpA[x]   = NULL;
+    pli->fp_mb[x] = 0.;
+  }
+  pli->fp_mb_tot = 0.;
+  pli->fp_n      = 0;
+}
+
+/* pli_terminal_windows()
+ * Set <ok[i]> to FALSE for each window <ws[i]>..<we[i]> of a
+ * sequence of length <L> that can't be part of a window that
+ * includes residue 1 (if <need_first>) and residue <L> (if
+ * <need_final>) after pli_p7_filter() merges overlapping and
+ * adjacent surviving windows, whichever windows survive; TRUE for
+ * the rest. A window can only be merged with one that reaches the
+ * required end through a chain of overlapping or adjacent windows.
+ *
+ * Removing windows set to FALSE doesn't change the merged windows
+ * that include the required residues only if window starts and ends
+ * are both nondecreasing, as they are for windows from the SSV
+ * filter or the fixed tiling used without it. If they aren't, all
+ * windows are set to TRUE.
+ */
+static void
+pli_terminal_windows(const int64_t *ws, const int64_t *we, int nwin, int64_t L, int need_first, int need_final, int *ok)
+{
+  int64_t reach; /* last end (first start) of windows that reach residue 1 (L), -1 if none yet */
+  int     i;
+
+  for(i = 0; i < nwin; i++) ok[i] = TRUE;
+  for(i = 1; i < nwin; i++) { 
+    if(ws[i] < ws[i-1] || we[i] < we[i-1]) return;
+  }
+
+  if(need_first) { 
+    reach = -1;
+    for(i = 0; i < nwin; i++) { 
+      if(ws[i] == 1 || (reach != -1 && ws[i] <= reach+1)) reach = ESL_MAX(reach, we[i]);
+      else                                                 ok[i] = FALSE;
+    }
+  }
+  if(need_final) { 
+    reach = -1;
+    for(i = nwin-1; i >= 0; i--) { 
+      if(we[i] == L || (reach != -1 && we[i]+1 >= reach)) reach = (reach == -1) ? ws[i] : ESL_MIN(reach, ws[i]);
+      else                                                 ok[i] = FALSE;
+    }
+  }
+  return;
+}
+
+/* Function:  pli_merge_accounting()
+ *
+ * Purpose:   Add the accounting statistics in <a2> to those in <a1>.
+ *
+ * Returns:   void
+ */
+static void
+pli_merge_accounting(CM_PLI_ACCT *a1, const CM_PLI_ACCT *a2)
+{
+  a1->npli_top          += a2->npli_top;
+  a1->npli_bot          += a2->npli_bot;
+  a1->nres_top          += a2->nres_top;
+  a1->nres_bot          += a2->nres_bot;
+  a1->n_past_msv        += a2->n_past_msv;
+  a1->n_past_vit        += a2->n_past_vit;
+  a1->n_past_fwd        += a2->n_past_fwd;
+  a1->n_past_gfwd       += a2->n_past_gfwd;
+  a1->n_past_edef       += a2->n_past_edef;
+  a1->n_past_cyk        += a2->n_past_cyk;
+  a1->n_past_ins        += a2->n_past_ins;
+  a1->n_output          += a2->n_output;
+  a1->n_past_msvbias    += a2->n_past_msvbias;
+  a1->n_past_vitbias    += a2->n_past_vitbias;
+  a1->n_past_fwdbias    += a2->n_past_fwdbias;
+  a1->n_past_gfwdbias   += a2->n_past_gfwdbias;
+  a1->n_past_edefbias   += a2->n_past_edefbias;
+  a1->pos_past_msv      += a2->pos_past_msv;
+  a1->pos_past_vit      += a2->pos_past_vit;
+  a1->pos_past_fwd      += a2->pos_past_fwd;
+  a1->pos_past_gfwd     += a2->pos_past_gfwd;
+  a1->pos_past_edef     += a2->pos_past_edef;
+  a1->pos_past_cyk      += a2->pos_past_cyk;
+  a1->pos_past_ins      += a2->pos_past_ins;
+  a1->pos_output        += a2->pos_output;
+  a1->pos_past_msvbias  += a2->pos_past_msvbias;
+  a1->pos_past_vitbias  += a2->pos_past_vitbias;
+  a1->pos_past_fwdbias  += a2->pos_past_fwdbias;
+  a1->pos_past_gfwdbias += a2->pos_past_gfwdbias;
+  a1->pos_past_edefbias += a2->pos_past_edefbias;
+  a1->pos_lfilter       += a2->pos_lfilter;
+  a1->pos_lfilter_redun += a2->pos_lfilter_redun;
+  a1->pos_lfilter_reuse += a2->pos_lfilter_reuse;
+  a1->pos_lcmask        += a2->pos_lcmask;
+  a1->n_fwd_reuse       += a2->n_fwd_reuse;
+  a1->n_term_skip       += a2->n_term_skip;
+  a1->n_overflow_fcyk   += a2->n_overflow_fcyk;
+  a1->n_overflow_final  += a2->n_overflow_final;
+  a1->n_aln_hb          += a2->n_aln_hb;
+  a1->n_aln_dccyk       += a2->n_aln_dccyk;
+
+  return;
+}
+
+/* Function:  pli_gfwd_fused()
+ *
+ * Purpose:   For the PLI_PASS_STD_ANY pass of pli_p7_env_def():
+ *            compute the glocal Forward score of window
+ *            <wstart>..<wend> of a sequence of length <sqn> (<seq>
+ *            holds just the window) with <gm>, and, in the same DP
+ *            sweep, with each of <Rgm>, <Lgm> and <Tgm> that is
+ *            non-NULL and whose pass will search this window: <Rgm>
+ *            if the window includes the first residue, <Lgm> if it
+ *            includes the final residue, and <Tgm> if it includes
+ *            both. The truncated profiles' results are saved in the
+ *            pipeline's F4 cache for pli_gfwd_cached() to use in
+ *            their own passes.
+ *
+ *            <gm> must already be configured for the window length,
+ *            <pli->gxf> grown to fit it, and <pli->gfb> prepared for
+ *            <gm>. Fills the special state rows of <pli->gxf> and
+ *            returns gm's score in <ret_fwdsc>.
+ *
+ * Returns:   eslOK on success.
+ *            eslEMEM on allocation failure.
+ */
+static int
+pli_gfwd_fused(CM_PIPELINE *pli, const ESL_SQ *seq, int64_t wstart, int64_t wend, int64_t sqn, P7_PROFILE *gm, P7_PROFILE *Rgm, P7_PROFILE *Lgm, P7_PROFILE *Tgm, float *ret_fwdsc)
+{
+  int               status;
+  int               wlen = wend - wstart + 1;
+  int64_t           nx   = (int64_t) (wlen+1) * p7G_NXCELLS;
+  const P7_PROFILE *gmA[CM_P7_NFUSED];   /* profiles to score, gm first */
+  float            *xmxA[CM_P7_NFUSED];  /* special state rows for each profile */
+  float             scA[CM_P7_NFUSED];   /* Forward score for each profile */
+  int               passA[CM_P7_NFUSED]; /* pass each profile is used in */
+  int               ngm = 0;
+  int               v, p;
+  void             *tmp;
+
+  gmA[ngm] = gm;  xmxA[ngm] = pli->gxf->xmx; passA[ngm++] = PLI_PASS_STD_ANY;
+  if(Rgm != NULL && wstart == 1) { 
+    p7_ReconfigLength5PrimeTrunc(Rgm, wlen);
+    gmA[ngm] = Rgm; passA[ngm++] = PLI_PASS_5P_ONLY_FORCE;
+  }
+  if(Lgm != NULL && wend == sqn) { 
+    p7_ReconfigLength3PrimeTrunc(Lgm, wlen);
+    gmA[ngm] = Lgm; passA[ngm++] = PLI_PASS_3P_ONLY_FORCE;
+  }
+  if(Tgm != NULL && wstart == 1 && wend == sqn) { 
+    gmA[ngm] = Tgm; passA[ngm++] = PLI_PASS_5P_AND_3P_FORCE;
+  }
+  if(ngm == 1) return cm_p7_GForward(seq->dsq, wlen, gm, pli->gfb, pli->gxf, ret_fwdsc);
+
+  for(v = 1; v < ngm; v++) { 
+    p = passA[v];
+    if(pli->f4c_nalloc[p] < nx) { 
+      ESL_RALLOC(pli->f4c_xmx[p], tmp, sizeof(float) * nx);
+      pli->f4c_nalloc[p] = nx;
+    }
+    xmxA[v] = pli->f4c_xmx[p];
+  }
+
+  status = cm_p7_GForwardFused(seq->dsq, wlen, gmA, ngm, pli->gfb, xmxA, scA);
+  if(status == eslEINCOMPAT || status == eslERANGE) { 
+    /* the profiles can't share a sweep, or a score isn't finite:
+     * score gm alone and let the later passes score their own */
+    return cm_p7_GForward(seq->dsq, wlen, gm, pli->gfb, pli->gxf, ret_fwdsc);
+  }
+  else if(status != eslOK) return status;
+
+  pli->gxf->M = gm->M;
+  pli->gxf->L = wlen;
+  for(v = 1; v < ngm; v++) { 
+    p = passA[v];
+    pli->f4c_ws[p] = wstart;
+    pli->f4c_we[p] = wend;
+    pli->f4c_sc[p] = scA[v];
+  }
+  *ret_fwdsc = scA[0];
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* Function:  pli_gfwd_cached()
+ *
+ * Purpose:   If the glocal Forward results for window
+ *            <wstart>..<wend> of <sq> in the current pass were
+ *            computed by pli_gfwd_fused() in the PLI_PASS_STD_ANY
+ *            pass, copy its special state rows into <gx>, set <gx>'s
+ *            dimensions (<M> is the profile length), and return the
+ *            score in <ret_fwdsc>.
+ *
+ * Returns:   TRUE if the results were cached, FALSE if not (and
+ *            caller must compute them).
+ */
+static int
+pli_gfwd_cached(CM_PIPELINE *pli, const ESL_SQ *sq, int64_t wstart, int64_t wend, int M, P7_GMX *gx, float *ret_fwdsc)
+{
+  int     p    = pli->cur_pass_idx;
+  int64_t wlen = wend - wstart + 1;
+
+  if(pli->f4c_dsq == NULL || pli->f4c_dsq != sq->dsq || pli->f4c_n != sq->n) return FALSE;
+  if(pli->f4c_ws[p] != wstart || pli->f4c_we[p] != wend)                     return FALSE;
+
+  memcpy(gx->xmx, pli->f4c_xmx[p], sizeof(float) * (wlen+1) * p7G_NXCELLS);
+  gx->M = M;
+  gx->L = wlen;
+  *ret_fwdsc = pli->f4c_sc[p];
+  return TRUE;
+}
+
 /* Function:  pli_describe_pass()
  * Date:      EPN, Tue Nov 29 04:39:38 2011
  *
@@ -4607,10 +5850,311 @@ merge_windows_from_two_lists(int64_t *ws1, int64_t *we1, double *wp1, int *wl1,
 #endif
 
 /*****************************************************************
- * 3. Example 1: "search mode" in a sequence db
+ * 4. Benchmark driver
+ *****************************************************************/
+#ifdef CM_PIPELINE_BENCHMARK
+/*
+  gcc -o benchmark-cm-pipeline -std=gnu99 -g -O2 -I. -L. -I../hmmer/src -L../hmmer/src -I../easel -L../easel -DCM_PIPELINE_BENCHMARK cm_pipeline.c -linfernal -lhmmer -leasel -lm
+  ./benchmark-cm-pipeline
+
+  Measures the sequence handling done by cm_Pipeline() for each
+  chunk of a target: the 5' and 3' terminal subsequences searched
+  in the truncated passes (in both loops over passes), <--nwin>
+  windows passed to envelope definition in the standard pass plus
+  one per terminal subsequence, and <--nhit> hits passed to
+  alignment. This is done first by copying residues into new
+  ESL_SQs, as the pipeline used to, and then with the views the
+  pipeline uses now (pli_sqview_Set()). A checksum of the residues
+  seen through each is compared and must be identical, and the
+  number of ESL_SQs created per Mb searched is reported for each.
+
+  Then times the low complexity masking done before SSV with
+  --lcmask (pli_lcmask()) on each chunk and reports the fraction
+  of residues masked. Chunks are random with AU fraction <--at>;
+  use e.g. --at 0.8 for an AT-rich genome.
+
+  Finally times the length reconfiguration of a sampled filter HMM
+  of <--M> nodes done for <--nwin> windows per chunk by the HMM
+  filters and envelope definition, first with
+  p7_oprofile_Reconfig*Length() directly, as the pipeline used to,
+  and then through pli_oprofile_ReconfigLength(). A fraction
+  <--fsplit> of windows are of length 2*W, as windows split by the
+  filters are; the rest are between W and 2*W.
+ */
+#include "esl_random.h"
+#include "esl_stopwatch.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default   env  range toggles reqs incomp  help                                         docgroup*/
+  { "-h",        eslARG_NONE,    FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",               0 },
+  { "-s",        eslARG_INT,     "181", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                      0 },
+  { "-L",        eslARG_INT,  "100000", NULL, "n>0", NULL,  NULL, NULL, "length of each target chunk",                        0 },
+  { "-N",        eslARG_INT,     "100", NULL, "n>0", NULL,  NULL, NULL, "number of chunks to search",                         0 },
+  { "-W",        eslARG_INT,     "200", NULL, "n>0", NULL,  NULL, NULL, "window length (pli->maxW)",                          0 },
+  { "--nwin",    eslARG_INT,      "20", NULL, "n>=0",NULL,  NULL, NULL, "number of envelope definition windows per chunk",    0 },
+  { "--nhit",    eslARG_INT,       "2", NULL, "n>=0",NULL,  NULL, NULL, "number of hits aligned per chunk",                   0 },
+  { "--at",      eslARG_REAL,    "0.5", NULL, "0<=x<=1",NULL,NULL,NULL, "AU fraction of random target chunks",                0 },
+  { "--lcmask",  eslARG_REAL,     "20", NULL, "x>0", NULL,  NULL, NULL, "low complexity mask threshold, bits",                 0 },
+  { "--lcw",     eslARG_INT,      "64", NULL, "n>=8",NULL,  NULL, NULL, "low complexity mask window length",                  0 },
+  { "--M",       eslARG_INT,     "100", NULL, "n>0", NULL,  NULL, NULL, "length of sampled filter HMM",                       0 },
+  { "--fsplit",  eslARG_REAL,    "0.8", NULL, "0<=x<=1",NULL,NULL,NULL, "fraction of filter windows of length 2*W",          0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "benchmark driver for sequence handling in the CM pipeline";
+
+/* bench_checksum()
+ * Return a checksum of residues 1..n of <sq>.
+ */
+static uint64_t
+bench_checksum(const ESL_SQ *sq)
+{
+  uint64_t sum = 0;
+  int64_t  i;
+  for(i = 1; i <= sq->n; i++) sum = sum * 31 + sq->dsq[i];
+  return sum + sq->start + sq->end;
+}
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go     = cm_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_STOPWATCH  *w      = esl_stopwatch_Create();
+  ESL_RANDOMNESS *r      = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc    = esl_alphabet_Create(eslRNA);
+  P7_BG          *bg     = p7_bg_Create(abc);
+  double          at     = esl_opt_GetReal(go, "--at");
+  double          fq[4];          /* residue frequencies of the target */
+  int64_t         L      = esl_opt_GetInteger(go, "-L");
+  int             N      = esl_opt_GetInteger(go, "-N");
+  int64_t         W      = ESL_MIN(esl_opt_GetInteger(go, "-W"), L);
+  int             nwin   = esl_opt_GetInteger(go, "--nwin");
+  int             nhit   = esl_opt_GetInteger(go, "--nhit");
+  CM_PIPELINE    *pli    = NULL;
+  ESL_SQ         *sq     = NULL;  /* a chunk of the target */
+  ESL_SQ         *wsq    = NULL;  /* a window              */
+  ESL_SQ         *hsq    = NULL;  /* a hit                 */
+  ESL_SQ         *termA[2];
+  int64_t        *wsA    = NULL;  /* [0..nwin-1] window start positions */
+  int64_t        *hsA    = NULL;  /* [0..nhit-1] hit start positions    */
+  int            *wlA    = NULL;  /* [0..nwin-1] filter window lengths   */
+  int             M      = esl_opt_GetInteger(go, "--M");
+  double          fsplit = esl_opt_GetReal(go, "--fsplit");
+  P7_HMM         *hmm    = NULL;
+  P7_PROFILE     *gm     = NULL;
+  P7_OPROFILE    *om     = NULL;
+  int64_t         hlen   = ESL_MAX(1, W/2);
+  int64_t         ncopy  = 0;     /* number of ESL_SQs created copying residues */
+  int64_t         i;
+  int             c, pass, t;
+  uint64_t        sum1   = 0;
+  uint64_t        sum2   = 0;
+  double          Mb     = (double) L * N / 1000000.;
+  int             status;
+
+  /* only the view and low complexity mask fields of the pipeline are used here */
+  ESL_ALLOC(pli, sizeof(CM_PIPELINE));
+  pli->term_sqv = pli->win_sqv = pli->hit_sqv = NULL;
+  pli->nsqalloc = 0;
+  pli->maxW     = W;
+  pli->lcmask   = esl_opt_GetReal(go, "--lcmask");
+  pli->lcw      = esl_opt_GetInteger(go, "--lcw");
+  pli->lc_ss    = pli->lc_se = NULL;
+  pli->lc_nseg  = pli->lc_nalloc = 0;
+  pli->nocfg    = pli->nocfg_skip = 0;
+  pli_oprofile_InvalidateLength(pli);
+  pli->cur_pass_idx = PLI_PASS_STD_ANY;
+  cm_pli_ZeroAccounting(&(pli->acct[PLI_PASS_STD_ANY]));
+  ESL_ALLOC(pli->lcl, sizeof(float) * (pli->lcw+1));
+  pli->lcl[0] = 0.;
+  for(i = 1; i <= pli->lcw; i++) pli->lcl[i] = (float) i * sreLOG2((double) i);
+  fq[0] = fq[3] = at / 2.;
+  fq[1] = fq[2] = (1. - at) / 2.;
+
+  ESL_ALLOC(wsA, sizeof(int64_t) * ESL_MAX(1, nwin));
+  ESL_ALLOC(hsA, sizeof(int64_t) * ESL_MAX(1, nhit));
+  for(i = 0; i < nwin; i++) wsA[i] = 1 + esl_rnd_Roll(r, L - W + 1);
+  for(i = 0; i < nhit; i++) hsA[i] = 1 + esl_rnd_Roll(r, L - hlen + 1);
+  ESL_ALLOC(wlA, sizeof(int) * ESL_MAX(1, nwin));
+  for(i = 0; i < nwin; i++) wlA[i] = (esl_random(r) < fsplit) ? 2*W : W + esl_rnd_Roll(r, W+1);
+
+  if((sq = esl_sq_CreateDigital(abc)) == NULL) { status = eslEMEM; goto ERROR; }
+  if((status = esl_sq_GrowTo(sq, L)) != eslOK) goto ERROR;
+  for(i = 1; i <= L; i++) sq->dsq[i] = esl_rnd_DChoose(r, fq, abc->K);
+  sq->dsq[0] = sq->dsq[L+1] = eslDSQ_SENTINEL;
+  sq->n = sq->L = L;
+  sq->start = 1;
+  sq->end   = L;
+  esl_sq_SetName(sq, "random");
+
+  /* copying residues, as the pipeline used to */
+  esl_stopwatch_Start(w);
+  for(c = 0; c < N; c++) { 
+    termA[0] = esl_sq_CreateDigital(abc);
+    termA[1] = esl_sq_CreateDigital(abc);
+    ncopy += 2;
+    for(t = 0; t < 2; t++) { 
+      esl_sq_GrowTo(termA[t], W);
+      memcpy(termA[t]->dsq+1, sq->dsq + (t == 0 ? 1 : L - W + 1), W * sizeof(ESL_DSQ));
+      termA[t]->dsq[0] = termA[t]->dsq[W+1] = eslDSQ_SENTINEL;
+      termA[t]->n     = W;
+      termA[t]->L     = L;
+      termA[t]->start = (t == 0) ? 1 : L - W + 1;
+      termA[t]->end   = termA[t]->start + W - 1;
+      esl_sq_SetName(termA[t], sq->name);
+    }
+    for(pass = 0; pass < 2; pass++) { 
+      for(t = 0; t < 2; t++) sum1 += bench_checksum(termA[t]);
+    }
+    /* envelope definition: standard pass, then each terminal subsequence */
+    wsq = esl_sq_CreateDigital(abc); ncopy++;
+    for(i = 0; i < nwin; i++) { 
+      esl_sq_GrowTo(wsq, W);
+      memcpy(wsq->dsq, sq->dsq + wsA[i] - 1, (W+1) * sizeof(ESL_DSQ));
+      wsq->dsq[0] = wsq->dsq[W+1] = eslDSQ_SENTINEL;
+      wsq->n = W;
+      wsq->start = 1;
+      wsq->end   = W;
+      sum1 += bench_checksum(wsq);
+    }
+    esl_sq_Destroy(wsq);
+    for(t = 0; t < 2; t++) { 
+      wsq = esl_sq_CreateDigital(abc); ncopy++;
+      esl_sq_GrowTo(wsq, W);
+      memcpy(wsq->dsq, termA[t]->dsq, (W+1) * sizeof(ESL_DSQ));
+      wsq->dsq[0] = wsq->dsq[W+1] = eslDSQ_SENTINEL;
+      wsq->n = W;
+      wsq->start = 1;
+      wsq->end   = W;
+      sum1 += bench_checksum(wsq);
+      esl_sq_Destroy(wsq);
+    }
+    /* alignment */
+    for(i = 0; i < nhit; i++) { 
+      hsq = esl_sq_CreateDigitalFrom(abc, "seq", sq->dsq + hsA[i] - 1, hlen, NULL, NULL, NULL); ncopy++;
+      sum1 += bench_checksum(hsq);
+      esl_sq_Destroy(hsq);
+    }
+    esl_sq_Destroy(termA[0]);
+    esl_sq_Destroy(termA[1]);
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time copying residues:       ");
+  hsq = wsq = NULL;
+
+  /* views, as the pipeline does now */
+  esl_stopwatch_Start(w);
+  for(c = 0; c < N; c++) { 
+    for(pass = 0; pass < 2; pass++) { 
+      for(t = 0; t < 2; t++) { 
+        if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, (t == 0) ? 1 : L - W + 1, W, TRUE)) != eslOK) goto ERROR;
+        sum2 += bench_checksum(pli->term_sqv);
+      }
+    }
+    for(i = 0; i < nwin; i++) { 
+      if((status = pli_sqview_Set(pli, &(pli->win_sqv), sq, wsA[i], W, FALSE)) != eslOK) goto ERROR;
+      sum2 += bench_checksum(pli->win_sqv);
+    }
+    for(t = 0; t < 2; t++) { 
+      if((status = pli_sqview_Set(pli, &(pli->term_sqv), sq, (t == 0) ? 1 : L - W + 1, W, TRUE))  != eslOK) goto ERROR;
+      if((status = pli_sqview_Set(pli, &(pli->win_sqv),  pli->term_sqv, 1, W, FALSE))              != eslOK) goto ERROR;
+      sum2 += bench_checksum(pli->win_sqv);
+    }
+    for(i = 0; i < nhit; i++) { 
+      if((status = pli_sqview_Set(pli, &(pli->hit_sqv), sq, hsA[i], hlen, FALSE)) != eslOK) goto ERROR;
+      sum2 += bench_checksum(pli->hit_sqv);
+    }
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time sequence views:         ");
+
+  if(sum1 != sum2) esl_fatal("residues seen through views differ from copies");
+
+  printf("# Mb searched                     %.2f\n", Mb);
+  printf("# ESL_SQs created, copying        %" PRId64 " (%.1f per Mb)\n", ncopy,         (double) ncopy         / Mb);
+  printf("# ESL_SQs created, views          %" PRId64 " (%.1f per Mb)\n", pli->nsqalloc, (double) pli->nsqalloc / Mb);
+  printf("# residues identical\n");
+
+  /* low complexity masking prior to SSV */
+  esl_stopwatch_Start(w);
+  for(c = 0; c < N; c++) { 
+    if((status = pli_lcmask(pli, bg, sq)) != eslOK) goto ERROR;
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time low complexity mask:    ");
+  printf("# Mb per CPU second, mask         %.1f\n", (w->user > 0.) ? Mb / w->user : 0.);
+  printf("# residues masked                 %" PRIu64 " (%.4f), %d unmasked segments per chunk\n", 
+	 pli->acct[PLI_PASS_STD_ANY].pos_lcmask, (double) pli->acct[PLI_PASS_STD_ANY].pos_lcmask / ((double) L * N), pli->lc_nseg);
+
+  /* filter HMM length reconfiguration: SSV over the chunk, then
+   * MSV, Viterbi and Forward on each window, then envelope
+   * definition on each window.
+   */
+  if((status = p7_hmm_Sample(r, M, abc, &hmm)) != eslOK) goto ERROR;
+  if((gm = p7_profile_Create(hmm->M, abc))   == NULL)  { status = eslEMEM; goto ERROR; }
+  if((om = p7_oprofile_Create(hmm->M, abc))  == NULL)  { status = eslEMEM; goto ERROR; }
+  p7_ProfileConfig(hmm, bg, gm, W, p7_LOCAL);
+  p7_oprofile_Convert(gm, om);
+
+  esl_stopwatch_Start(w);
+  for(c = 0; c < N; c++) { 
+    p7_oprofile_ReconfigMSVLength(om, W);
+    for(i = 0; i < nwin; i++) { 
+      p7_oprofile_ReconfigMSVLength(om, wlA[i]);
+      p7_oprofile_ReconfigRestLength(om, wlA[i]);
+    }
+    for(i = 0; i < nwin; i++) p7_oprofile_ReconfigLength(om, wlA[i]);
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time reconfiguring always:   ");
+  if(nwin > 0) printf("# ns per window, always           %.1f\n", w->user * 1e9 / ((double) N * nwin));
+
+  esl_stopwatch_Start(w);
+  for(c = 0; c < N; c++) { 
+    pli_oprofile_ReconfigLength(pli, om, W, TRUE, FALSE);
+    for(i = 0; i < nwin; i++) { 
+      pli_oprofile_ReconfigLength(pli, om, wlA[i], TRUE, FALSE);
+      pli_oprofile_ReconfigLength(pli, om, wlA[i], FALSE, TRUE);
+    }
+    for(i = 0; i < nwin; i++) pli_oprofile_ReconfigLength(pli, om, wlA[i], TRUE, TRUE);
+  }
+  esl_stopwatch_Stop(w);
+  esl_stopwatch_Display(stdout, w, "# CPU time reconfiguring changes:  ");
+  if(nwin > 0) printf("# ns per window, changes          %.1f\n", w->user * 1e9 / ((double) N * nwin));
+  printf("# reconfigurations done           %" PRId64 ", skipped %" PRId64 "\n", pli->nocfg, pli->nocfg_skip);
+
+  status = eslOK;
+ ERROR:
+  if(pli != NULL) { 
+    pli_sqview_Destroy(pli->term_sqv);
+    pli_sqview_Destroy(pli->win_sqv);
+    pli_sqview_Destroy(pli->hit_sqv);
+    if(pli->lcl   != NULL) free(pli->lcl);
+    if(pli->lc_ss != NULL) free(pli->lc_ss);
+    if(pli->lc_se != NULL) free(pli->lc_se);
+    free(pli);
+  }
+  if(sq  != NULL) esl_sq_Destroy(sq);
+  if(wsA != NULL) free(wsA);
+  if(hsA != NULL) free(hsA);
+  if(wlA != NULL) free(wlA);
+  if(om  != NULL) p7_oprofile_Destroy(om);
+  if(gm  != NULL) p7_profile_Destroy(gm);
+  if(hmm != NULL) p7_hmm_Destroy(hmm);
+  p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  esl_getopts_Destroy(go);
+  esl_stopwatch_Destroy(w);
+  esl_randomness_Destroy(r);
+  return status;
+}
+#endif /*CM_PIPELINE_BENCHMARK*/
+
+/*****************************************************************
+ * 5. Example 1: "search mode" in a sequence db
  *****************************************************************/
 /*****************************************************************
- * 4. Example 2: "scan mode" in an HMM db
+ * 6. Example 2: "scan mode" in an HMM db
  *****************************************************************/
 /*****************************************************************
  * @LICENSE@
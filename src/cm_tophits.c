@@ -27,11 +27,67 @@
 
 #include "hmmer.h"
 
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif
+
 #include "infernal.h"
 
-static int     remove_or_mark_overlaps_one_seq_fast  (CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf);
+#ifdef HMMER_THREADS
+/* OVERLAP_WORKQUEUE: sets of hits shared by the threads of
+ * cm_tophits_RemoveOrMarkOverlapsParallel().
+ */
+typedef struct {
+  CM_TOPHITS      *th;
+  int64_t         *setA;      /* [0..2*nsets-1] first, last hit index of each set */
+  int64_t          nsets;     /* number of sets */
+  int64_t          next;      /* next set to process, protected by <mutex> */
+  int              do_remove; /* TRUE to remove overlaps, FALSE to mark them */
+  int              status;    /* eslOK, or status of first failed set, protected by <mutex> */
+  char             errbuf[eslERRBUFSIZE];
+  pthread_mutex_t  mutex;
+} OVERLAP_WORKQUEUE;
+
+static void   *overlap_thread(void *arg);
+#endif
+
+static int     remove_or_mark_overlaps_one_seq_tree  (CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf);
 static int     remove_or_mark_overlaps_one_seq_memeff(CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf);
+static int     remove_or_mark_overlaps_one_set       (CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf);
+static int64_t next_overlap_set(CM_TOPHITS *th, int64_t i, int do_remove, int do_clans_only, int *ret_do_set);
+static int     overlap_pos_sorter(const void *vh1, const void *vh2);
+static int64_t overlap_pos_index(int64_t *posA, int64_t m, int64_t pos);
+static void    overlap_tree_update(int64_t *mn, int64_t *lz, int64_t k, int64_t lo, int64_t hi, int64_t a, int64_t b, int64_t v);
+static int64_t overlap_tree_query (int64_t *mn, int64_t *lz, int64_t k, int64_t lo, int64_t hi, int64_t a, int64_t b);
 static int64_t overlap_nres(int64_t from1, int64_t to1, int64_t from2, int64_t to2, int64_t *ret_nes, char *errbuf);
+static void    th_bin_header_put(char *buf, int *pos, CM_TOPHITS *th, uint32_t flags);
+static int     th_bin_header_get(char *buf, int n, int *pos, uint64_t *ret_N, uint64_t *ret_nreported, uint64_t *ret_nincluded, char *errbuf);
+static int     hit_serialize  (CM_HIT *hit, uint32_t flags, char **buf, int *nalloc, int *pos);
+static int     hit_deserialize(char *buf, int n, int *pos, CM_HIT *hit);
+static int     bin_reserve(char **buf, int *nalloc, int pos, int64_t n);
+static void    bin_put       (char *buf, int *pos, const void *src, size_t size);
+static void    bin_put_i32   (char *buf, int *pos, int32_t x);
+static void    bin_put_i64   (char *buf, int *pos, int64_t x);
+static void    bin_put_string(char *buf, int *pos, char *s);
+static int     bin_get       (char *buf, int n, int *pos, void *dest, size_t size);
+static int     bin_get_i32   (char *buf, int n, int *pos, int32_t *ret_x);
+static int     bin_get_int   (char *buf, int n, int *pos, int *ret_x);
+static int     bin_get_i64   (char *buf, int n, int *pos, int64_t *ret_x);
+static int     bin_get_string(char *buf, int n, int *pos, char **ret_s);
+static int     lz_compress    (const char *src, int n, char *dst);
+static int     lz_decompress  (const char *src, int n, char *dst, int dstlen);
+static int     lz_put_sequence(char *dst, const char *lit, int nlit, int off, int mlen);
+
+/* Binary hit lists, see cm_tophits_Serialize() */
+static uint32_t v1_thmagic = 0xe3edf4e8; /* "cmth" + 0x80808080 */
+static uint32_t v1_thswap  = 0xe8f4ede3; /* v1_thmagic, byte-swapped */
+#define TH_BIN_HEADER_SIZE (3 * sizeof(uint32_t) + 3 * sizeof(uint64_t))
+#define HIT_BIN_FIXED_SIZE (8 * sizeof(int64_t) + 9 * sizeof(int32_t) + 2 * sizeof(float) + 4 * sizeof(double))
+#define AD_BIN_FIXED_SIZE  (25 * sizeof(int32_t) + 2 * sizeof(int64_t) + 4 * sizeof(float) + 2 * sizeof(double))
+#define LZ_MINMATCH 4
+#define LZ_HASHBITS 12
+#define LZ_HASHSIZE (1 << LZ_HASHBITS)
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
 
 /*****************************************************************
  * 1. The CM_TOPHITS object
@@ -67,6 +123,7 @@ cm_tophits_Create(void)
   h->is_sorted_by_evalue           = TRUE;  /* but only because there's 0 hits */
   h->is_sorted_for_overlap_removal = FALSE; /* actually this is true with 0 hits, but for safety, 
 				             * we don't want multiple sorted_* fields as TRUE */
+  h->is_sorted_for_overlap_markup  = FALSE; /* ditto */
   h->is_sorted_by_position         = FALSE; /* ditto */
   h->hit[0]    = h->unsrt;  /* if you're going to call it "sorted" when it contains just one hit, you need this */
   return h;
@@ -190,7 +247,37 @@ cm_tophits_CreateNextHit(CM_TOPHITS *h, CM_HIT **ret_hit)
 }
 
 /* hit_sorter_by_evalue(), hit_sorter_for_overlap_removal, hit_sorter_for_overlap_markup_clans_only, 
- * hit_sorter_for_overlap_markup_clans_agnostic and hit_sorter_by_position: qsort's pawns, below */
+ * hit_sorter_for_overlap_markup_clans_agnostic and hit_sorter_by_position: qsort's pawns, below.
+ *
+ * Each sorter falls back on hit_sorter_tiebreak() when its own keys
+ * are equal, so that every sorter defines a total order on hits that
+ * differ in any of the tiebreak keys. This makes the sorted order
+ * independent of the order hits were added in, so a list sorted by
+ * qsort() and one built by merging sorted per-thread lists
+ * (cm_tophits_Merge()) are identical.
+ */
+static int
+hit_sorter_tiebreak(const CM_HIT *h1, const CM_HIT *h2)
+{
+  if      (h1->cm_idx   > h2->cm_idx)   return  1; /* cm_idx, low to high */
+  else if (h1->cm_idx   < h2->cm_idx)   return -1;
+  else if (h1->seq_idx  > h2->seq_idx)  return  1; /* seq_idx, low to high */
+  else if (h1->seq_idx  < h2->seq_idx)  return -1;
+  else if (h1->in_rc    > h2->in_rc)    return  1; /* strand, forward, then reverse */
+  else if (h1->in_rc    < h2->in_rc)    return -1;
+  else if (h1->start    > h2->start)    return  1; /* start position, low to high */
+  else if (h1->start    < h2->start)    return -1;
+  else if (h1->stop     > h2->stop)     return  1; /* stop position, low to high */
+  else if (h1->stop     < h2->stop)     return -1;
+  else if (h1->score    < h2->score)    return  1; /* bit score, high to low */
+  else if (h1->score    > h2->score)    return -1;
+  else if (h1->pass_idx < h2->pass_idx) return  1; /* pass_idx, high to low */
+  else if (h1->pass_idx > h2->pass_idx) return -1;
+  else if (h1->hmmonly  > h2->hmmonly)  return  1; /* CM hits before HMM-only hits */
+  else if (h1->hmmonly  < h2->hmmonly)  return -1;
+  return 0;
+}
+
 static int
   hit_sorter_by_evalue(const void *vh1, const void *vh2) 
   {
@@ -208,7 +295,9 @@ static int
       else {
 	if      (h1->start > h2->start) return  1; /* third key, start position, low to high */
 	else if (h1->start < h2->start) return -1;
-	else                            return  (h1->pass_idx < h2->pass_idx ? 1 : -1 ); /* fourth key, pass_idx, high to low */
+	else if (h1->pass_idx < h2->pass_idx) return  1; /* fourth key, pass_idx, high to low */
+	else if (h1->pass_idx > h2->pass_idx) return -1;
+	else                            return  hit_sorter_tiebreak(h1, h2);
       }
     }
   }
@@ -235,7 +324,7 @@ hit_sorter_for_overlap_removal(const void *vh1, const void *vh2)
 	else { 
 	  if     (h1->start > h2->start)  return  1; /* fifth key is start position, low to high (irregardless of in_rc value) */
 	  else if(h1->start < h2->start)  return -1; 
-	  else                            return  0;
+	  else                            return  hit_sorter_tiebreak(h1, h2);
 	}
       }
     }
@@ -269,7 +358,7 @@ hit_sorter_for_overlap_markup_clans_only(const void *vh1, const void *vh2)
             else { 
               if     (h1->cm_idx > h2->cm_idx) return  1; /* seventh key is cm_idx (unique id for models), low to high */
               else if(h1->cm_idx < h2->cm_idx) return -1; 
-              else                             return  0;
+              else                             return  hit_sorter_tiebreak(h1, h2);
             }
           }
         }
@@ -302,7 +391,7 @@ hit_sorter_for_overlap_markup_clans_agnostic(const void *vh1, const void *vh2)
           else { 
             if     (h1->cm_idx > h2->cm_idx) return  1; /* seventh key is cm_idx (unique id for models), low to high */
             else if(h1->cm_idx < h2->cm_idx) return -1; 
-            else                             return  0;
+            else                             return  hit_sorter_tiebreak(h1, h2);
           }
         }
       }
@@ -328,12 +417,12 @@ hit_sorter_by_position(const void *vh1, const void *vh2)
       else if(h1->in_rc) { 
 	if     (h1->stop > h2->stop)    return  1; /* both revcomp:     fourth key is stop  position, low to high */
 	else if(h1->stop < h2->stop)    return -1; 
-	else                            return (h1->start  > h2->start  ? 1 : -1 ); /* both revcomp, same stop position, fourth key is start position, low to high */
+	else                            return hit_sorter_tiebreak(h1, h2); /* both revcomp, same stop position, fifth key is start position, low to high */
       }
       else               {
 	if     (h1->start > h2->start)  return  1; /* both !revcomp:    fourth key is start position, low to high */
 	else if(h1->start < h2->start)  return -1; 
-	else                            return (h1->stop  > h2->stop    ? 1 : -1 ); /* both !revcomp, same start position, fourth key is stop position, low to high */
+	else                            return hit_sorter_tiebreak(h1, h2); /* both !revcomp, same start position, fifth key is stop position, low to high */
       }
     }
   }
@@ -502,11 +591,25 @@ cm_tophits_SortByPosition(CM_TOPHITS *h)
  *            SRE, Fri Dec 28 09:32:12 2007 [Janelia] (p7_tophits.c)
  *
  * Purpose:   Merge <h2> into <h1>. Upon return, <h1>
- *            contains the unsorted, merged list. <h2>
+ *            contains the merged list. <h2>
  *            is effectively destroyed; caller should
  *            not access it further, and may as well free
  *            it immediately.
  *
+ *            If <h1> and <h2> are both sorted the same way (by
+ *            E-value, for overlap removal or by position), the
+ *            merged list stays sorted that way, with the two sorted
+ *            lists merged in linear time; this lets threads sort
+ *            their own lists in parallel before the master merges
+ *            them, instead of the master sorting the full list
+ *            serially. Merging k sorted lists pairwise in a balanced
+ *            tree (list i+s into list i, for s=1,2,4...) is a k-way
+ *            merge in O(N log k) time. Because the sorters define a
+ *            total order (see hit_sorter_tiebreak()), the result is
+ *            the same as sorting the merged list. If either list is
+ *            empty, the merged list keeps the order of the other
+ *            one. Otherwise, <h1> is returned unsorted.
+ *
  * Returns:   <eslOK> on success.
  *
  * Throws:    <eslEMEM> on allocation failure, and
@@ -517,9 +620,21 @@ cm_tophits_Merge(CM_TOPHITS *h1, CM_TOPHITS *h2)
 {
   void    *p;
   CM_HIT  *new2;
-  int      i;
+  CM_HIT  *ori    = h1->unsrt;
+  CM_HIT  *hit2;
+  int      i, j, k;
   int      Nalloc = h1->Nalloc + h2->Nalloc;
+  int      N1     = h1->N;
   int      status;
+  int    (*sorter)(const void *, const void *) = NULL; /* if non-NULL, h1 and h2 are both sorted with this */
+  int      keep_h1_order = FALSE; /* TRUE if h1 is sorted and stays sorted, because h2 is empty */
+  int      keep_h2_order = FALSE; /* TRUE if h2 is sorted and merged list takes its order, because h1 is empty */
+
+  if      (h2->N == 0) keep_h1_order = (h1->is_sorted_by_evalue || h1->is_sorted_for_overlap_removal || h1->is_sorted_for_overlap_markup || h1->is_sorted_by_position);
+  else if (h1->N == 0) keep_h2_order = (h2->is_sorted_by_evalue || h2->is_sorted_for_overlap_removal || h2->is_sorted_for_overlap_markup || h2->is_sorted_by_position);
+  else if (h1->is_sorted_by_evalue           && h2->is_sorted_by_evalue)           sorter = hit_sorter_by_evalue;
+  else if (h1->is_sorted_for_overlap_removal && h2->is_sorted_for_overlap_removal) sorter = hit_sorter_for_overlap_removal;
+  else if (h1->is_sorted_by_position         && h2->is_sorted_by_position)         sorter = hit_sorter_by_position;
 
   /* Attempt our allocations, so we fail early if we fail. 
    * Reallocating h1->unsrt screws up h1->hit, so fix it.
@@ -539,6 +654,44 @@ cm_tophits_Merge(CM_TOPHITS *h1, CM_TOPHITS *h2)
   new2 = h1->unsrt + h1->N;
   memcpy(new2, h2->unsrt, sizeof(CM_HIT) * h2->N);
 
+  /* Construct the new grown h1 */
+  h1->Nalloc = Nalloc;
+  h1->N     += h2->N;
+
+  if (keep_h1_order || sorter != NULL) { 
+    /* translate h1's sorted pointers, h1->unsrt may have moved */
+    for (i = 0; i < N1; i++) h1->hit[i] = h1->unsrt + (h1->hit[i] - ori);
+  }
+  if (keep_h2_order) { 
+    for (i = 0; i < h2->N; i++) h1->hit[i] = new2 + (h2->hit[i] - h2->unsrt);
+    h1->is_sorted_by_evalue           = h2->is_sorted_by_evalue;
+    h1->is_sorted_for_overlap_removal = h2->is_sorted_for_overlap_removal;
+    h1->is_sorted_for_overlap_markup  = h2->is_sorted_for_overlap_markup;
+    h1->is_sorted_by_position         = h2->is_sorted_by_position;
+  }
+  else if (sorter != NULL) { 
+    /* merge the two sorted lists in place, from the back; on ties
+     * take h2's hit first so h1's hits come first in the result 
+     */
+    i = N1-1;
+    j = h2->N-1;
+    for (k = h1->N-1; j >= 0; k--) { 
+      hit2 = new2 + (h2->hit[j] - h2->unsrt);
+      if (i >= 0 && sorter(&(h1->hit[i]), &hit2) > 0) h1->hit[k] = h1->hit[i--];
+      else                                            h1->hit[k] = hit2, j--;
+    }
+    /* h1's sorted flags are unchanged */
+  }
+  else if (! keep_h1_order) { 
+    /* merged list is unsorted */
+    h1->is_sorted_by_evalue           = FALSE;
+    h1->is_sorted_for_overlap_removal = FALSE;
+    h1->is_sorted_for_overlap_markup  = FALSE;
+    h1->is_sorted_by_position         = FALSE;
+    /* reset pointers in sorted list (not really nec because we're not sorted) */
+    for (i = 0; i < h1->N; i++) h1->hit[i] = h1->unsrt + i;
+  }
+
   /* h2 now turns over management of name, acc, desc memory to h1;
    * nullify its pointers, to prevent double free
    */
@@ -550,16 +703,6 @@ cm_tophits_Merge(CM_TOPHITS *h1, CM_TOPHITS *h2)
       h2->unsrt[i].ad   = NULL;
     }
 
-  /* Construct the new grown h1 */
-  h1->Nalloc = Nalloc;
-  h1->N     += h2->N;
-  h1->is_sorted_by_evalue           = FALSE;
-  h1->is_sorted_for_overlap_removal = FALSE;
-  h1->is_sorted_by_position         = FALSE;
-
-  /* reset pointers in sorted list (not really nec because we're not sorted) */
-  for (i = 0; i < h1->N; i++) h1->hit[i] = h1->unsrt + i;
-
   return eslOK;
   
  ERROR:
@@ -790,6 +933,7 @@ cm_tophits_Reuse(CM_TOPHITS *h)
   h->is_sorted_by_evalue           = TRUE;  /* because there's no hits */
   h->is_sorted_for_overlap_removal = FALSE; /* actually this is true with 0 hits, but for safety, 
 			           	     * we don't want multiple sorted_* fields as TRUE */
+  h->is_sorted_for_overlap_markup  = FALSE; /* ditto */
   h->is_sorted_by_position         = FALSE; /* ditto */
 
   h->hit[0]    = h->unsrt;
@@ -912,18 +1056,25 @@ cm_tophits_ComputeEvalues(CM_TOPHITS *th, double eZ, int istart)
  * that all use the same model, are to the same sequence and are on
  * the same strand. The hits in the set are sorted by score. 
  * 
- * remove_or_mark_overlaps_one_seq_fast(): O(N) with number of hits N, but
- * less memory efficient (O(L), requiring an allocation of a char
- * array the length of the sequence). This is how RSEARCH and infernal
- * 1.0.2 did overlap removal. 
+ * remove_or_mark_overlaps_one_seq_tree(): O(N log N) time and O(N)
+ * memory with number of hits N, independent of the length of the
+ * sequence. The hit endpoints in the set are sorted and compressed
+ * into M <= 2N distinct coordinates, and a segment tree over those
+ * coordinates stores, for each coordinate, the lowest (best scoring)
+ * sorted hit index that covers it. Two hits overlap if and only if
+ * their compressed intervals overlap, so each hit needs one range
+ * query and at most one range update per tree. This replaced an
+ * O(N) method that allocated arrays the length of the sequence
+ * (the RSEARCH and infernal 1.0.2 way), which dominated the time
+ * and memory spent here for long target sequences.
  * 
  * remove_or_mark_overlaps_one_seq_memeff(): O(N^2), but O(1) memory (not
- * counting the O(N) memory hit list). This is fast for small numbers
- * of sequences; up to about 10k seqs (10,000 hits takes about ~0.3
- * seconds with benchmark_cm_tophits, but 100,000 hits takes 43s).
+ * counting the O(N) memory hit list). This is fastest for small
+ * numbers of hits, which is by far the common case (for example the
+ * per-window hit lists from the scanning DP functions).
  * 
  * cm_tophits_RemoveOrMarkOverlaps() picks a function to call based on 
- * length of the sequence L and number of hits N.
+ * the number of hits N.
  *
  * If <do_remove> we'll remove duplicate hits, else we'll just 
  * mark them up (this is used by cmscan to mark overlapping hits
@@ -934,132 +1085,135 @@ cm_tophits_ComputeEvalues(CM_TOPHITS *th, double eZ, int istart)
  * Returns eslOK on success
  * Returns eslEINVAL if not all hits in the set have equal srcL, seq_idx, in_rc values (and cm_idx if do_remove == TRUE)
  * Returns eslERANGE if a hit includes positions outside of 1..srcL
- * Returns eslEMEM if out of memory (remove_overlaps_one_seq_fast() only)
+ * Returns eslEMEM if out of memory (remove_or_mark_overlaps_one_seq_tree() only)
  * errbuf is filled if not returning eslOK
  */
-int remove_or_mark_overlaps_one_seq_fast(CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf)
+int remove_or_mark_overlaps_one_seq_tree(CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf)
 { 
   int       status;
   int64_t   i;
-  char     *covered         = NULL;  /* [1..pos..srcL] is position pos covered by a hit we've examined and kept (if do_remove)? */
-  int64_t  *covered_any_idx = NULL;  /* [1..pos..srcL] highest scoring hit_idx that covers position pos */
-  int64_t  *covered_win_idx = NULL;  /* [1..pos..srcL] highest scoring *winning* hit_idx that covers position pos */
-  int       overlap_flag = FALSE;
-  int64_t   srcL    = th->hit[idx1]->srcL;
-  int64_t   cm_idx  = th->hit[idx1]->cm_idx;
-  int64_t   seq_idx = th->hit[idx1]->seq_idx;
-  int       in_rc   = th->hit[idx1]->in_rc;
-  int64_t   pos, min, max; /* position indices in the sequence */
-  int64_t   max_value = idx2+1; /* default value for covered_any_idx and covered_win_idx, so we can use ESL_MIN with range of valid values idx1..idx2 */
+  int64_t   n         = idx2-idx1+1; /* number of hits in the set */
+  int64_t  *posA      = NULL;  /* [0..m-1] sorted, unique hit endpoints in the set, the compressed coordinates */
+  int64_t  *any_mn    = NULL;  /* segment tree: min over node's range of best hit_idx that covers each coord */
+  int64_t  *any_lz    = NULL;  /* segment tree: best hit_idx that covers all coords in node's range */
+  int64_t  *win_mn    = NULL;  /* same as any_mn, but only for *winning* hits (kept hits if do_remove) */
+  int64_t  *win_lz    = NULL;  /* same as any_lz, but only for *winning* hits (kept hits if do_remove) */
+  int64_t   m         = 0;     /* number of compressed coordinates */
+  int64_t   nnodes;            /* number of nodes allocated for each segment tree */
+  int64_t   srcL      = th->hit[idx1]->srcL;
+  int64_t   cm_idx    = th->hit[idx1]->cm_idx;
+  int64_t   seq_idx   = th->hit[idx1]->seq_idx;
+  int       in_rc     = th->hit[idx1]->in_rc;
+  int64_t   min, max;  /* compressed coordinates of the current hit */
+  int64_t   any_oidx, win_oidx;
+  int64_t   max_value = idx2+1; /* default value for tree nodes, so we can use ESL_MIN with range of valid values idx1..idx2 */
 
   if(   do_remove  && (! th->is_sorted_for_overlap_removal)) ESL_FAIL(eslEINVAL, errbuf, "removing overlapping hits but hit list is not sorted properly");
   if((! do_remove) && (! th->is_sorted_for_overlap_markup))  ESL_FAIL(eslEINVAL, errbuf, "marking overlapping hits but hit list is not sorted properly");
 
-  /*printf("in remove_or_mark_overlaps_one_seq_fast() do_remove: %d i: %" PRId64 " j: %" PRId64 "\n", do_remove, idx1, idx2);
+  /*printf("in remove_or_mark_overlaps_one_seq_tree() do_remove: %d i: %" PRId64 " j: %" PRId64 "\n", do_remove, idx1, idx2);
     cm_tophits_Dump(stdout, th);*/
 
-  ESL_ALLOC(covered, sizeof(char) * (srcL+1));
-  for(i = 0; i <= srcL; i++) covered[i] = FALSE;
-  if(! do_remove) { 
-    ESL_ALLOC(covered_any_idx, sizeof(int64_t) * (srcL+1));
-    ESL_ALLOC(covered_win_idx, sizeof(int64_t) * (srcL+1));
-    for(i = 0; i <= srcL; i++) covered_any_idx[i] = max_value;
-    for(i = 0; i <= srcL; i++) covered_win_idx[i] = max_value;
+  /* verify that what we think is true is true, and collect the endpoints of all hits */
+  ESL_ALLOC(posA, sizeof(int64_t) * n * 2);
+  for(i = idx1; i <= idx2; i++) { 
+    if(th->hit[i]->srcL    != srcL)                       ESL_XFAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, srcL inconsistent, hit %" PRId64, i);
+    if(th->hit[i]->seq_idx != seq_idx)                    ESL_XFAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, seq_idx is inconsistent, hit %" PRId64, i);
+    if(th->hit[i]->in_rc   != in_rc)                      ESL_XFAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, in_rc is inconsistent, hit %" PRId64, i);
+    if(th->hit[i]->start < 1 || th->hit[i]->start > srcL) ESL_XFAIL(eslERANGE, errbuf, "removing/marking overlapping hits, start posn is inconsistent, hit %" PRId64, i);
+    if(th->hit[i]->stop  < 1 || th->hit[i]->stop  > srcL) ESL_XFAIL(eslERANGE, errbuf, "removing/marking overlapping hits, stop posn is inconsistent, hit %" PRId64, i);
+    if(do_remove && th->hit[i]->cm_idx  != cm_idx)        ESL_XFAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, cm_idx is inconsistent, hit %" PRId64, i);
+    if((! do_remove) && (th->hit[i]->flags & CM_HIT_IS_MARKED_OVERLAP)) ESL_XFAIL(eslEINVAL, errbuf, "marking overlapping hits, overlap flag already up for hit %" PRId64, i);
+
+    if(! (th->hit[i]->flags & CM_HIT_IS_REMOVED_DUPLICATE)) { 
+      posA[m++] = th->hit[i]->start;
+      posA[m++] = th->hit[i]->stop;
+    }
   }
+  if(m == 0) { free(posA); return eslOK; } /* all hits already removed */
 
-  for(i = idx1; i <= idx2; i++) { 
-    /* verify that what we think is true is true */
-    if(th->hit[i]->srcL    != srcL)                       ESL_FAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, srcL inconsistent, hit %" PRId64, i);
-    if(th->hit[i]->seq_idx != seq_idx)                    ESL_FAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, seq_idx is inconsistent, hit %" PRId64, i);
-    if(th->hit[i]->in_rc   != in_rc)                      ESL_FAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, in_rc is inconsistent, hit %" PRId64, i);
-    if(th->hit[i]->flags & CM_HIT_IS_MARKED_OVERLAP)      ESL_FAIL(eslEINVAL, errbuf, "marking overlapping hits, overlap flag already up for hit %" PRId64 "\n", i);
-    if(th->hit[i]->start < 1 || th->hit[i]->start > srcL) ESL_FAIL(eslERANGE, errbuf, "removing/marking overlapping hits, start posn is inconsistent, hit %" PRId64, i);
-    if(th->hit[i]->stop  < 1 || th->hit[i]->stop  > srcL) ESL_FAIL(eslERANGE, errbuf, "removing/marking overlapping hits, stop posn is inconsistent, hit %" PRId64, i);
+  /* compress the coordinates: sort and remove duplicates */
+  qsort(posA, m, sizeof(int64_t), overlap_pos_sorter);
+  for(min = 0, i = 1; i < m; i++) { 
+    if(posA[i] != posA[min]) posA[++min] = posA[i];
+  }
+  m = min+1;
 
-    if(do_remove && th->hit[i]->cm_idx  != cm_idx) ESL_FAIL(eslEINVAL, errbuf, "removing/marking overlapping hits, cm_idx is inconsistent, hit %" PRId64, i);
+  nnodes = 4 * m;
+  ESL_ALLOC(win_mn, sizeof(int64_t) * nnodes);
+  ESL_ALLOC(win_lz, sizeof(int64_t) * nnodes);
+  for(i = 0; i < nnodes; i++) win_mn[i] = win_lz[i] = max_value;
+  if(! do_remove) { 
+    ESL_ALLOC(any_mn, sizeof(int64_t) * nnodes);
+    ESL_ALLOC(any_lz, sizeof(int64_t) * nnodes);
+    for(i = 0; i < nnodes; i++) any_mn[i] = any_lz[i] = max_value;
+  }
 
+  for(i = idx1; i <= idx2; i++) { 
     if(! (th->hit[i]->flags & CM_HIT_IS_REMOVED_DUPLICATE)) { 
       /* i is not a duplicate that's already been removed */
-      
-      min = ESL_MIN(th->hit[i]->start, th->hit[i]->stop); 
-      max = ESL_MAX(th->hit[i]->start, th->hit[i]->stop); 
-      overlap_flag = FALSE;
-      for(pos = min; pos <= max; pos++) { 
-        if(covered[pos] == TRUE) { overlap_flag = TRUE; break; }
-      }
-    
+      min = overlap_pos_index(posA, m, ESL_MIN(th->hit[i]->start, th->hit[i]->stop));
+      max = overlap_pos_index(posA, m, ESL_MAX(th->hit[i]->start, th->hit[i]->stop));
+
       /* how we process the hit differs significantly between
        * whether we're in remove mode (do_remove is TRUE) or
        * mark mode (do_remove is FALSE)
        */
       if(do_remove) { 
-        if(overlap_flag) { 
+        /* the win tree holds only the hits we've kept */
+        if(overlap_tree_query(win_mn, win_lz, 1, 0, m-1, min, max) != max_value) { 
           th->hit[i]->flags |=  CM_HIT_IS_REMOVED_DUPLICATE;
           th->hit[i]->flags &= ~CM_HIT_IS_REPORTED;  /* could be set if pli->use_bit_cutoffs (--cut_ga, --cut_nc, --cut_tc) */
           th->hit[i]->flags &= ~CM_HIT_IS_INCLUDED;  /* could be set if pli->use_bit_cutoffs (--cut_ga, --cut_nc, --cut_tc) */
         }
         else { 
-          for(pos = min; pos <= max; pos++) covered[pos] = TRUE;
+          overlap_tree_update(win_mn, win_lz, 1, 0, m-1, min, max, i);
         }
       }
       else { /* do_remove is FALSE */
-        if(overlap_flag) { 
+        /* determine the hit_idx of the best hit it overlaps with (any_oidx) 
+         * and the best non-marked hit it overlaps with (win_oidx), 
+         * these will often be the same hit_idx
+         */
+        any_oidx = overlap_tree_query(any_mn, any_lz, 1, 0, m-1, min, max);
+        if(any_oidx != max_value) { 
           /* marking overlaps, not removing them */
           th->hit[i]->flags |=  CM_HIT_IS_MARKED_OVERLAP;
-          /* determine the hit_idx of the best hit it overlaps with (any_oidx) 
-           * and the best non-marked hit it overlaps with (win_oidx), 
-           * these will often be the same hit_idx
-           */
-          /* first, the best hit (any_oidx) */
-          th->hit[i]->any_oidx = covered_any_idx[min];
-          for(pos = min+1; pos <= max; pos++) { 
-            th->hit[i]->any_oidx = ESL_MIN(th->hit[i]->any_oidx, covered_any_idx[pos]);
-          }
-          if(th->hit[i]->any_oidx == max_value) th->hit[i]->any_oidx = -1; /* no overlap */
-
-          /* second, the best winning hit (win_oidx) */
-          th->hit[i]->win_oidx = covered_win_idx[min];
-          for(pos = min+1; pos <= max; pos++) { 
-            th->hit[i]->win_oidx = ESL_MIN(th->hit[i]->win_oidx, covered_win_idx[pos]);
-          }
-          if(th->hit[i]->win_oidx == max_value) th->hit[i]->win_oidx = -1; /* no overlap */
-
-          /* now th->hit[i]->any_oidx and th->hit[i]->win_oidx point to 
-           * the sorted hit index, change it to the actual hit_idx 
-           */
-          if(th->hit[i]->any_oidx != -1) th->hit[i]->any_oidx = th->hit[th->hit[i]->any_oidx]->hit_idx;
-          if(th->hit[i]->win_oidx != -1) th->hit[i]->win_oidx = th->hit[th->hit[i]->win_oidx]->hit_idx;
-        } /* end of 'if(overlap_flag)' */
+          win_oidx = overlap_tree_query(win_mn, win_lz, 1, 0, m-1, min, max);
+          /* any_oidx and win_oidx are sorted hit indices, change them to the actual hit_idx */
+          th->hit[i]->any_oidx = th->hit[any_oidx]->hit_idx;
+          th->hit[i]->win_oidx = (win_oidx == max_value) ? -1 : th->hit[win_oidx]->hit_idx;
+        }
         else { /* no overlap */
           /* need to keep track that this hit is the best scoring winning hit 
            * that covers any previously uncovered positions 
            */
-          for(pos = min; pos <= max; pos++) { 
-            if(covered_win_idx[pos] == max_value) covered_win_idx[pos] = i;
-          }
+          overlap_tree_update(win_mn, win_lz, 1, 0, m-1, min, max, i);
         }
         /* regardless of whether we found an overlap or not, we need
          * to keep track that this hit is the best scoring hit that
-         * covers any previously uncovered positions, and update
-         * covered[] as well.
+         * covers any previously uncovered positions
          */
-        for(pos = min; pos <= max; pos++) { 
-          if(covered_any_idx[pos] == max_value) covered_any_idx[pos] = i;
-          covered[pos] = TRUE;
-        }
+        overlap_tree_update(any_mn, any_lz, 1, 0, m-1, min, max, i);
       }
     }
   }
 
-  if(covered         != NULL) free(covered);
-  if(covered_any_idx != NULL) free(covered_any_idx);
-  if(covered_win_idx != NULL) free(covered_win_idx);
+  free(posA);
+  free(win_mn);
+  free(win_lz);
+  if(any_mn != NULL) free(any_mn);
+  if(any_lz != NULL) free(any_lz);
   return eslOK;
 
  ERROR:
-  if(covered != NULL) free(covered);
-  ESL_FAIL(status, errbuf, "removing/marking overlapping hits, out of memory");
-  return status; /* NOT REACHED */
+  if(posA   != NULL) free(posA);
+  if(win_mn != NULL) free(win_mn);
+  if(win_lz != NULL) free(win_lz);
+  if(any_mn != NULL) free(any_mn);
+  if(any_lz != NULL) free(any_lz);
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "removing/marking overlapping hits, out of memory");
+  return status; 
 }
 
 int remove_or_mark_overlaps_one_seq_memeff(CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf)
@@ -1135,6 +1289,164 @@ int remove_or_mark_overlaps_one_seq_memeff(CM_TOPHITS *th, int64_t idx1, int64_t
   return eslOK;
 }
 
+/* Helpers for remove_or_mark_overlaps_one_seq_tree().
+ *
+ * overlap_pos_sorter(): qsort() comparison for int64_t positions.
+ * overlap_pos_index():  binary search for <pos> in sorted, unique <posA[0..m-1]>.
+ *
+ * overlap_tree_update() and overlap_tree_query() implement a segment
+ * tree over compressed coordinates 0..m-1 with 1-based node indices
+ * (children of node k are 2k and 2k+1) supporting 'set each value
+ * in range a..b to min(value, v)' and 'return min value in range
+ * a..b'. <lz[k]> is a pending minimum for all coordinates under node
+ * k, never pushed down, and <mn[k]> is the minimum over node k's
+ * whole range, including lz[k].
+ */
+int
+overlap_pos_sorter(const void *vh1, const void *vh2)
+{
+  int64_t p1 = *((int64_t *) vh1);
+  int64_t p2 = *((int64_t *) vh2);
+
+  if      (p1 < p2) return -1;
+  else if (p1 > p2) return  1;
+  return 0;
+}
+
+int64_t
+overlap_pos_index(int64_t *posA, int64_t m, int64_t pos)
+{
+  int64_t lo = 0;
+  int64_t hi = m-1;
+  int64_t mid;
+
+  while(lo < hi) { 
+    mid = lo + (hi-lo)/2;
+    if(posA[mid] < pos) lo = mid+1;
+    else                hi = mid;
+  }
+  return lo;
+}
+
+void
+overlap_tree_update(int64_t *mn, int64_t *lz, int64_t k, int64_t lo, int64_t hi, int64_t a, int64_t b, int64_t v)
+{
+  int64_t mid;
+
+  if(b < lo || hi < a) return;
+  if(a <= lo && hi <= b) { 
+    lz[k] = ESL_MIN(lz[k], v);
+    mn[k] = ESL_MIN(mn[k], v);
+    return;
+  }
+  mid = lo + (hi-lo)/2;
+  overlap_tree_update(mn, lz, 2*k,   lo,    mid, a, b, v);
+  overlap_tree_update(mn, lz, 2*k+1, mid+1, hi,  a, b, v);
+  mn[k] = ESL_MIN(lz[k], ESL_MIN(mn[2*k], mn[2*k+1]));
+}
+
+int64_t
+overlap_tree_query(int64_t *mn, int64_t *lz, int64_t k, int64_t lo, int64_t hi, int64_t a, int64_t b)
+{
+  int64_t mid;
+  int64_t v1, v2;
+
+  if(a <= lo && hi <= b) return mn[k];
+  mid = lo + (hi-lo)/2;
+  v1  = (a <= mid) ? overlap_tree_query(mn, lz, 2*k,   lo,    mid, a, b) : lz[k];
+  v2  = (b >  mid) ? overlap_tree_query(mn, lz, 2*k+1, mid+1, hi,  a, b) : lz[k];
+  return ESL_MIN(lz[k], ESL_MIN(v1, v2));
+}
+
+/* Function:  remove_or_mark_overlaps_one_set()
+ *
+ * Purpose:   Remove or mark overlaps in the set of hits <idx1..idx2>
+ *            using the fastest helper for a set of that size: the
+ *            O(N^2) method needs no allocation and wins for small
+ *            sets, the O(N log N) tree method wins for big ones.
+ *
+ * Returns:   Same as the helpers it calls.
+ */
+int
+remove_or_mark_overlaps_one_set(CM_TOPHITS *th, int64_t idx1, int64_t idx2, int do_remove, char *errbuf)
+{
+  if((idx2-idx1+1) < 128) return remove_or_mark_overlaps_one_seq_memeff(th, idx1, idx2, do_remove, errbuf);
+  else                    return remove_or_mark_overlaps_one_seq_tree  (th, idx1, idx2, do_remove, errbuf);
+}
+
+/* Function:  next_overlap_set()
+ *
+ * Purpose:   Given the index of the first hit <i> of a set of hits in
+ *            a list sorted for overlap removal or markup, return the
+ *            index of the first hit of the next set. Hits i to j-1
+ *            (where j is the return value) form a set of hits that
+ *            all share cm_idx (if <do_remove>), seq_idx, in_rc and
+ *            clan_idx (if <do_clans_only>). Set <*ret_do_set> to TRUE
+ *            if overlaps must be removed or marked in the set, FALSE
+ *            if not.
+ *
+ * Returns:   index of the first hit of the next set, th->N if none.
+ */
+int64_t
+next_overlap_set(CM_TOPHITS *th, int64_t i, int do_remove, int do_clans_only, int *ret_do_set)
+{
+  int64_t j = i+1;
+
+  while(j < th->N && 
+        ((! do_remove) || (th->hit[j]->cm_idx  == th->hit[i]->cm_idx))  &&
+        th->hit[j]->seq_idx == th->hit[i]->seq_idx &&
+        th->hit[j]->in_rc   == th->hit[i]->in_rc   && 
+        ((! do_clans_only) || (th->hit[j]->clan_idx == th->hit[i]->clan_idx))) { 
+    j++;
+  }
+  *ret_do_set = (j != (i+1) &&                                      /* more than one hit in set i..j-1 */
+                 ((! do_clans_only) || th->hit[i]->clan_idx != -1)) /* we're not only marking overlaps within same clan OR 
+                                                                     * we are and all hits are in same clan, this way if 
+                                                                     * do_clans_only is TRUE we won't remove overlaps between
+                                                                     * hits in families that are not members of any clan */
+    ? TRUE : FALSE;
+  return j;
+}
+
+#ifdef HMMER_THREADS
+/* Function:  overlap_thread()
+ *
+ * Purpose:   Thread function for cm_tophits_RemoveOrMarkOverlapsParallel().
+ *            Repeatedly take the next unprocessed set of hits from the
+ *            shared OVERLAP_WORKQUEUE <arg> and remove or mark overlaps
+ *            in it, until no sets remain or a worker has failed.
+ *            Sets are disjoint ranges of th->hit, so workers never
+ *            touch the same hits.
+ */
+void *
+overlap_thread(void *arg)
+{
+  OVERLAP_WORKQUEUE *wq = (OVERLAP_WORKQUEUE *) arg;
+  int64_t            s;
+  int                status;
+  char               errbuf[eslERRBUFSIZE];
+
+  while(1) { 
+    if(pthread_mutex_lock(&wq->mutex) != 0) esl_fatal("mutex lock failed");
+    s = (wq->status == eslOK && wq->next < wq->nsets) ? wq->next++ : -1;
+    if(pthread_mutex_unlock(&wq->mutex) != 0) esl_fatal("mutex unlock failed");
+    if(s == -1) break;
+
+    if((status = remove_or_mark_overlaps_one_set(wq->th, wq->setA[2*s], wq->setA[2*s+1], wq->do_remove, errbuf)) != eslOK) { 
+      if(pthread_mutex_lock(&wq->mutex) != 0) esl_fatal("mutex lock failed");
+      if(wq->status == eslOK) { 
+        wq->status = status;
+        strcpy(wq->errbuf, errbuf);
+      }
+      if(pthread_mutex_unlock(&wq->mutex) != 0) esl_fatal("mutex unlock failed");
+      break;
+    }
+  }
+  pthread_exit(NULL);
+  return NULL; /* NOT REACHED */
+}
+#endif /*HMMER_THREADS*/
+
 /* Function:  cm_tophits_RemoveOrMarkOverlaps()
  * Synopsis:  Remove or mark overlapping hits from a tophits object sorted by seq_idx.
  * Incept:    EPN, Tue Jun 14 05:42:31 2011
@@ -1147,10 +1459,9 @@ int remove_or_mark_overlaps_one_seq_memeff(CM_TOPHITS *th, int64_t idx1, int64_t
  *            greedily. For each hit for the same model, sequence and
  *            strand, remove all lower scoring hits that overlap with
  *            it. This is done by one of two helper functions
- *            (remove_or_mark_overlaps_one_seq_fast() or
+ *            (remove_or_mark_overlaps_one_seq_tree() or
  *            remove_or_mark_overlaps_one_seq_memeff() described near
- *            their definition above) depending on the length of the
- *            sequence and the number of hits.
+ *            their definition above) depending on the number of hits.
  *
  *            This function can be used to either mark overlaps or
  *            remove them, determined by the 
@@ -1169,29 +1480,52 @@ int remove_or_mark_overlaps_one_seq_memeff(CM_TOPHITS *th, int64_t idx1, int64_t
  */
 int
 cm_tophits_RemoveOrMarkOverlaps(CM_TOPHITS *th, int do_clans_only, char *errbuf)
+{
+  return cm_tophits_RemoveOrMarkOverlapsParallel(th, do_clans_only, 0, errbuf);
+}
+
+/* Function:  cm_tophits_RemoveOrMarkOverlapsParallel()
+ * Synopsis:  Remove or mark overlapping hits, using multiple threads.
+ *
+ * Purpose:   Same as cm_tophits_RemoveOrMarkOverlaps(), but if
+ *            <ncpus> is greater than 1 and we were compiled with
+ *            thread support, spread the independent sets of hits
+ *            (one per model (if removing), sequence, strand and clan
+ *            (if <do_clans_only>)) over <ncpus> threads. Threads take
+ *            sets one at a time from a shared counter, so a few huge
+ *            sets (long contigs) don't leave the other threads idle.
+ *            The result is identical to the serial one.
+ *
+ * Returns:   eslOK on success. 
+ *            eslEINVAL if th is not sorted appropriately, errbuf filled
+ *            eslERANGE if a hit includes positions outside of 1..srcL, errbuf filled
+ *            eslEMEM if we run out of memory, errbuf filled
+ *            eslESYS if a thread can't be created, errbuf filled
+ */
+int
+cm_tophits_RemoveOrMarkOverlapsParallel(CM_TOPHITS *th, int do_clans_only, int ncpus, char *errbuf)
 {
   int status;
   int64_t i, j;            
-  int64_t nhits  = 0;
   int do_remove = FALSE;
-  int srcL_limit;
+  int do_set;
+#ifdef HMMER_THREADS
+  OVERLAP_WORKQUEUE wq;
+  pthread_t        *threadA  = NULL;
+  int64_t           nsets    = 0;
+  int64_t           nalloc   = 0;
+  int               nthreads = 0;
+  int               t;
+  void             *p;
+#endif
 
   if (th->is_sorted_for_overlap_removal && 
       th->is_sorted_for_overlap_markup) { 
     ESL_FAIL(eslEINVAL, errbuf, "cm_tophits_RemoveOrMarkOverlaps() list is not sorted appropriately");
   }
 
-  if (th->is_sorted_for_overlap_removal) { 
-    do_remove = TRUE;
-    srcL_limit = 256000000;
-  }
-  else if (th->is_sorted_for_overlap_markup) { 
-    do_remove = FALSE;
-    srcL_limit = 256000000 / 16; 
-    /* we require about 16X more memory in remove_or_mark_overlaps_one_seq_fast() if we're sorting for
-     * overlap markup, so our limit is 1/16 the length.
-     */
-  }
+  if      (th->is_sorted_for_overlap_removal) do_remove = TRUE;
+  else if (th->is_sorted_for_overlap_markup)  do_remove = FALSE;
   else { 
     ESL_FAIL(eslEINVAL, errbuf, "cm_tophits_RemoveOrMarkOverlaps() list is not sorted appropriately");
   }
@@ -1201,38 +1535,66 @@ cm_tophits_RemoveOrMarkOverlaps(CM_TOPHITS *th, int do_clans_only, char *errbuf)
 
   if (th->N<2) return eslOK;
 
+#ifdef HMMER_THREADS
+  if(ncpus > 1) { 
+    /* collect the sets that need work, as pairs of first, last hit indices */
+    wq.setA = NULL;
+    for(i = 0; i < th->N; i = j) { 
+      j = next_overlap_set(th, i, do_remove, do_clans_only, &do_set);
+      if(do_set) { 
+        if(nsets == nalloc) { 
+          nalloc = (nalloc == 0) ? 256 : nalloc * 2;
+          ESL_RALLOC(wq.setA, p, sizeof(int64_t) * nalloc * 2);
+        }
+        wq.setA[2*nsets]   = i;
+        wq.setA[2*nsets+1] = j-1;
+        nsets++;
+      }
+    }
+    nthreads = ESL_MIN(ncpus, nsets);
+
+    if(nthreads > 1) { 
+      wq.th        = th;
+      wq.nsets     = nsets;
+      wq.next      = 0;
+      wq.do_remove = do_remove;
+      wq.status    = eslOK;
+      wq.errbuf[0] = '\0';
+      if(pthread_mutex_init(&wq.mutex, NULL) != 0) ESL_XFAIL(eslESYS, errbuf, "mutex init failed");
+      ESL_ALLOC(threadA, sizeof(pthread_t) * nthreads);
+      for(t = 0; t < nthreads; t++) { 
+        if(pthread_create(&(threadA[t]), NULL, overlap_thread, &wq) != 0) { 
+          /* let the threads we did create finish, then fail */
+          for(i = 0; i < t; i++) pthread_join(threadA[i], NULL);
+          pthread_mutex_destroy(&wq.mutex);
+          ESL_XFAIL(eslESYS, errbuf, "cm_tophits_RemoveOrMarkOverlaps() failed to create thread");
+        }
+      }
+      for(t = 0; t < nthreads; t++) pthread_join(threadA[t], NULL);
+      pthread_mutex_destroy(&wq.mutex);
+      free(threadA);
+      free(wq.setA);
+      if(wq.status != eslOK) ESL_FAIL(wq.status, errbuf, "%s", wq.errbuf);
+      return eslOK;
+    }
+    /* else only one set needs work, do it serially below */
+    for(i = 0; i < nsets; i++) { 
+      if((status = remove_or_mark_overlaps_one_set(th, wq.setA[2*i], wq.setA[2*i+1], do_remove, errbuf)) != eslOK) goto ERROR;
+    }
+    if(wq.setA != NULL) free(wq.setA);
+    return eslOK;
+  }
+#endif
+
   i = 0;
   while(i < th->N) { 
-    j = i+1;
-    while(j < th->N && 
-	  ((! do_remove) || (th->hit[j]->cm_idx  == th->hit[i]->cm_idx))  &&
-	  th->hit[j]->seq_idx == th->hit[i]->seq_idx &&
-	  th->hit[j]->in_rc   == th->hit[i]->in_rc   && 
-	  ((! do_clans_only) || (th->hit[j]->clan_idx == th->hit[i]->clan_idx))) { 
-      j++;
-    }
-    if(j != (i+1) &&                                         /* more than one hit in set i..j-1 */
-       ((! do_clans_only) || th->hit[i]->clan_idx != -1)) {  /* we're not only marking overlaps within same clan OR 
-                                                              * we are and all hits are in same clan, this way if 
-                                                              * do_clans_only is TRUE we won't remove overlaps between
-                                                              * hits in families that are not members of any clan */
+    j = next_overlap_set(th, i, do_remove, do_clans_only, &do_set);
+    if(do_set) { 
       /* Hits i to j-1 form a set of hits that all share cm_idx (if
        * 'do_remove == TRUE'), seq_idx, in_rc and clan_idx (if
-       * 'do_clans_only == TRUE'). Remove overlaps from this set in 1 of 2
-       * ways, depending on length of source sequence and number of
-       * hits.  remove_overlaps_one_seq_fast() will need to allocate a
-       * char array of size srcL, but it is significantly faster when
-       * nhits is big. If (do_remove) is FALSE then we need about 16X
-       * more memory in 'one_seq_fast()' method so our srcL_limit is
-       * 16-fold lower (calc'ed above).
-       */ 
-      nhits = (j-1)-i+1;
-      if(nhits < 5000 || th->hit[i]->srcL > srcL_limit) { 
-        if((status = remove_or_mark_overlaps_one_seq_memeff(th, i, j-1, do_remove, errbuf)) != eslOK) return status;
-      }
-      else { /* use fast, non mem-efficient way if >= 5000 hits and L is < srcL_limit */
-        if((status = remove_or_mark_overlaps_one_seq_fast  (th, i, j-1, do_remove, errbuf)) != eslOK) return status;
-      }
+       * 'do_clans_only == TRUE'). 
+       */
+      if((status = remove_or_mark_overlaps_one_set(th, i, j-1, do_remove, errbuf)) != eslOK) return status;
     }
     i = j; /* skip ahead to begin next set */
   }
@@ -1240,6 +1602,151 @@ cm_tophits_RemoveOrMarkOverlaps(CM_TOPHITS *th, int do_clans_only, char *errbuf)
     cm_tophits_Dump(stdout, th);*/
 
   return eslOK;
+
+#ifdef HMMER_THREADS
+ ERROR:
+  if(threadA  != NULL) free(threadA);
+  if(wq.setA  != NULL) free(wq.setA);
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "cm_tophits_RemoveOrMarkOverlaps(), out of memory");
+  return status;
+#endif
+}
+
+/* Function:  cm_tophits_RemoveResolvedDuplicates()
+ * Synopsis:  Discard hits from one window that are sure to be removed as overlaps.
+ *
+ * Purpose:   During a search, discard hits <hit_start..th->N-1> that
+ *            are guaranteed to be removed later as duplicates by
+ *            cm_tophits_RemoveOrMarkOverlaps() and free their names,
+ *            accessions, descriptions and alignment displays. On
+ *            hit-dense targets with relaxed thresholds most hits are
+ *            redundant copies found in overlapping windows and
+ *            pipeline passes, so calling this after each window keeps
+ *            the hit list close to the size of the final list instead
+ *            of letting it grow with every duplicate.
+ *
+ *            All hits <hit_start..th->N-1> must be from the same
+ *            target sequence, with positions already updated relative
+ *            to the full sequence (cm_tophits_UpdateHitPositions()).
+ *            The caller guarantees that no hit that is not yet in
+ *            <th> (from a later window, or a window searched by a
+ *            different worker) can include any position in
+ *            <res_from..res_to>; usually this is the window minus the
+ *            residues it shares with its neighboring windows.
+ *
+ *            Hits are examined in the same order overlap removal will
+ *            use (model, strand, then score). A hit that lies
+ *            entirely within <res_from..res_to> and overlaps no
+ *            higher scoring hit that is still unresolved is resolved:
+ *            it will survive overlap removal. A hit that overlaps a
+ *            resolved surviving hit will be removed no matter what
+ *            other hits are found later, so we discard it now. All
+ *            other hits are left unresolved and kept.
+ *
+ *            Surviving hits are shifted down in <th->unsrt> and their
+ *            <hit_idx> values are reset, so this must be called
+ *            before any sorting or overlap markup of <th>.
+ *
+ * Returns:   <eslOK> on success, <ret_nremoved> (optional) is set to
+ *            the number of hits discarded.
+ *            <eslEINVAL> if hits are not all from the same sequence,
+ *            errbuf filled.
+ *
+ * Throws:    <eslEMEM> on allocation failure, errbuf filled.
+ */
+int
+cm_tophits_RemoveResolvedDuplicates(CM_TOPHITS *th, int64_t hit_start, int64_t res_from, int64_t res_to, int64_t *ret_nremoved, char *errbuf)
+{
+  int       status;
+  CM_HIT  **sorted  = NULL;  /* [0..n-1] ptrs to hits hit_start..N-1, sorted for overlap removal */
+  char     *covered = NULL;  /* [0..span-1] 0: not covered, 1: covered by a resolved surviving hit, 2: by an unresolved hit */
+  char     *discard = NULL;  /* [0..n-1] TRUE to discard hit hit_start+i */
+  int64_t   n       = (int64_t) th->N - hit_start;
+  int64_t   nremoved = 0;
+  int64_t   minpos, maxpos, span;
+  int64_t   i, j, pos, min, max;
+  int       saw_open;
+  char      state;
+
+  if (n < 2) { 
+    if (ret_nremoved != NULL) *ret_nremoved = 0;
+    return eslOK;
+  }
+
+  minpos = maxpos = th->unsrt[hit_start].start;
+  for (i = hit_start; i < th->N; i++) { 
+    if (th->unsrt[i].seq_idx != th->unsrt[hit_start].seq_idx) ESL_FAIL(eslEINVAL, errbuf, "removing resolved duplicate hits, seq_idx is inconsistent, hit %" PRId64, i);
+    minpos = ESL_MIN(minpos, ESL_MIN(th->unsrt[i].start, th->unsrt[i].stop));
+    maxpos = ESL_MAX(maxpos, ESL_MAX(th->unsrt[i].start, th->unsrt[i].stop));
+  }
+  span = maxpos - minpos + 1;
+
+  ESL_ALLOC(sorted,  sizeof(CM_HIT *) * n);
+  ESL_ALLOC(discard, sizeof(char)     * n);
+  ESL_ALLOC(covered, sizeof(char)     * span);
+  for (i = 0; i < n; i++) { 
+    sorted[i]  = th->unsrt + hit_start + i;
+    discard[i] = FALSE;
+  }
+  qsort(sorted, n, sizeof(CM_HIT *), hit_sorter_for_overlap_removal);
+
+  for (i = 0; i < n; i++) { 
+    /* new model or strand: overlaps between sets don't count */
+    if (i == 0 || sorted[i]->cm_idx != sorted[i-1]->cm_idx || sorted[i]->in_rc != sorted[i-1]->in_rc) { 
+      memset(covered, 0, sizeof(char) * span);
+    }
+    if (sorted[i]->flags & CM_HIT_IS_REMOVED_DUPLICATE) continue;
+
+    min = ESL_MIN(sorted[i]->start, sorted[i]->stop) - minpos;
+    max = ESL_MAX(sorted[i]->start, sorted[i]->stop) - minpos;
+    saw_open = FALSE;
+    for (pos = min; pos <= max; pos++) { 
+      if (covered[pos] == 1) break;
+      if (covered[pos] == 2) saw_open = TRUE;
+    }
+    if (pos <= max) { 
+      /* overlaps a resolved surviving hit: will be removed */
+      discard[sorted[i] - th->unsrt - hit_start] = TRUE;
+      nremoved++;
+    }
+    else { 
+      state = (saw_open || min + minpos < res_from || max + minpos > res_to) ? 2 : 1;
+      for (pos = min; pos <= max; pos++) covered[pos] = state;
+    }
+  }
+
+  /* free the discarded hits and shift survivors down */
+  if (nremoved > 0) { 
+    for (i = hit_start, j = hit_start; i < th->N; i++) { 
+      if (discard[i - hit_start]) { 
+	if (th->unsrt[i].name != NULL) free(th->unsrt[i].name);
+	if (th->unsrt[i].acc  != NULL) free(th->unsrt[i].acc);
+	if (th->unsrt[i].desc != NULL) free(th->unsrt[i].desc);
+	if (th->unsrt[i].ad   != NULL) cm_alidisplay_Destroy(th->unsrt[i].ad);
+      }
+      else { 
+	if (i != j) th->unsrt[j] = th->unsrt[i];
+	th->unsrt[j].hit_idx = j;
+	j++;
+      }
+    }
+    th->N = j;
+    /* reset pointers in sorted list (not really nec because we're not sorted) */
+    for (i = 0; i < th->N; i++) th->hit[i] = th->unsrt + i;
+  }
+
+  if (ret_nremoved != NULL) *ret_nremoved = nremoved;
+  free(sorted);
+  free(discard);
+  free(covered);
+  return eslOK;
+
+ ERROR:
+  if (sorted  != NULL) free(sorted);
+  if (discard != NULL) free(discard);
+  if (covered != NULL) free(covered);
+  ESL_FAIL(status, errbuf, "removing resolved duplicate hits, out of memory");
+  return status; /* NOT REACHED */
 }
 
 /* Function:  cm_tophits_UpdateHitPositions()
@@ -1308,6 +1815,753 @@ cm_tophits_RemoveOrMarkOverlaps(CM_TOPHITS *th, int do_clans_only, char *errbuf)
   return eslOK;
 }
 
+/* Function:  cm_tophits_Serialize()
+ * Synopsis:  Serialize a hit list into a memory buffer.
+ *
+ * Purpose:   Write the hits in <th>, in their unsorted order, in
+ *            Infernal's binary hit list format to buffer <*buf>
+ *            of allocated size <*nalloc>, reallocating it if
+ *            necessary, and return the number of bytes written in
+ *            <*ret_n>. Read them back with cm_tophits_Deserialize()
+ *            (or, if written to a file, cm_tophits_ReadBinary()).
+ *
+ *            The format is a header (a magic number, which also
+ *            detects a byte order mismatch, the format version
+ *            <CM_TOPHITS_BIN_VERSION>, <flags>, and the number of
+ *            hits, reported hits and included hits) followed by
+ *            one record per hit, prefixed by its length, so a
+ *            reader can skip fields appended by a later version.
+ *            Strings are length-prefixed. Each hit's alignment
+ *            display is included if it has one (<hit->ad> may be
+ *            NULL, e.g. if alignment was deferred). If <flags>
+ *            includes <CM_TOPHITS_BIN_COMPRESS>, the alignment
+ *            display strings of each hit are compressed with a
+ *            simple LZ77 scheme, unless that doesn't make them
+ *            smaller; alignment lines, with their long runs of
+ *            gaps, structure and posterior probability characters,
+ *            typically compress 2-4 fold.
+ *
+ *            Numbers are written in the byte order of the host, so
+ *            the format is only portable between machines of the
+ *            same endianness (as for binary CM files); MPI is
+ *            assumed to run on such machines.
+ *
+ * Returns:   <eslOK> on success; <*buf> may have been reallocated and
+ *            <*nalloc> may have been increased.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <eslERANGE> if the
+ *            hit list would take more than INT_MAX bytes. In either
+ *            case <*buf> and <*nalloc> remain valid.
+ */
+int
+cm_tophits_Serialize(CM_TOPHITS *th, uint32_t flags, char **buf, int *nalloc, int *ret_n)
+{
+  int      status;
+  int      pos = 0;
+  uint64_t i;
+
+  if ((status = bin_reserve(buf, nalloc, pos, TH_BIN_HEADER_SIZE)) != eslOK) return status;
+  th_bin_header_put(*buf, &pos, th, flags);
+  for (i = 0; i < th->N; i++) { 
+    if ((status = hit_serialize(&(th->unsrt[i]), flags, buf, nalloc, &pos)) != eslOK) return status;
+  }
+  *ret_n = pos;
+  return eslOK;
+}
+
+/* Function:  cm_tophits_Deserialize()
+ * Synopsis:  Read a serialized hit list from a buffer, and append it.
+ *
+ * Purpose:   Read the hit list serialized by cm_tophits_Serialize()
+ *            in the first <n> bytes of <buf>, and append its hits to
+ *            <th>, updating their hit indices as cm_tophits_Merge()
+ *            does. <th> is unsorted upon return, unless it was empty
+ *            and at most one hit was read.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEFORMAT> if <buf> doesn't start with a hit list 
+ *            header of a version we can read, and <eslEOD> if the 
+ *            data ends prematurely or is corrupt; in either case
+ *            <errbuf> contains an error message and the hits read
+ *            before the failure remain in <th>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+cm_tophits_Deserialize(char *buf, int n, CM_TOPHITS *th, char *errbuf)
+{
+  int      status;
+  int      pos = 0;
+  uint64_t i;
+  uint64_t N, nreported, nincluded;
+  uint64_t N0 = th->N; /* offset for hit indices of hits we read */
+  CM_HIT  *hit;
+
+  if ((status = th_bin_header_get(buf, n, &pos, &N, &nreported, &nincluded, errbuf)) != eslOK) return status;
+  for (i = 0; i < N; i++) { 
+    if ((status = cm_tophits_CreateNextHit(th, &hit)) != eslOK) return status;
+    if ((status = hit_deserialize(buf, n, &pos, hit)) != eslOK) { 
+      th->N--; /* hit was freed by hit_deserialize() */
+      if (status == eslEMEM) return status;
+      ESL_FAIL(status, errbuf, "failed to read hit %" PRIu64 " of %" PRIu64, i+1, N);
+    }
+    if(hit->hit_idx  != -1) hit->hit_idx  += N0;
+    if(hit->any_oidx != -1) hit->any_oidx += N0;
+    if(hit->win_oidx != -1) hit->win_oidx += N0;
+  }
+  th->nreported += nreported;
+  th->nincluded += nincluded;
+
+  return eslOK;
+}
+
+/* Function:  cm_tophits_WriteBinary()
+ * Synopsis:  Save a hit list in binary format.
+ *
+ * Purpose:   Write the hits in <th>, in their unsorted order, to
+ *            open binary stream <fp>, in the format of 
+ *            cm_tophits_Serialize() with flags <flags>. Hits are
+ *            serialized one at a time, so we never hold a second
+ *            copy of the full list in memory. Read the hits back
+ *            with cm_tophits_ReadBinary(). Used to save the hits of a
+ *            partially completed search in a cmsearch checkpoint
+ *            file, and those of each query with cmsearch --hitsout.
+ *
+ * Returns:   <eslOK> on success;
+ *            <eslFAIL> if a write fails due to system error, such
+ *            as a filled disk.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+cm_tophits_WriteBinary(FILE *fp, CM_TOPHITS *th, uint32_t flags)
+{
+  int      status;
+  char    *buf    = NULL;
+  int      nalloc = 0;
+  int      pos;
+  uint64_t i;
+
+  if ((status = bin_reserve(&buf, &nalloc, 0, TH_BIN_HEADER_SIZE)) != eslOK) goto ERROR;
+  pos = 0;
+  th_bin_header_put(buf, &pos, th, flags);
+  if (fwrite(buf, sizeof(char), pos, fp) != pos) { status = eslFAIL; goto ERROR; }
+  for (i = 0; i < th->N; i++) { 
+    pos = 0;
+    if ((status = hit_serialize(&(th->unsrt[i]), flags, &buf, &nalloc, &pos)) != eslOK) goto ERROR;
+    if (fwrite(buf, sizeof(char), pos, fp) != pos) { status = eslFAIL; goto ERROR; }
+  }
+  free(buf);
+  return eslOK;
+
+ ERROR:
+  if (buf != NULL) free(buf);
+  return status;
+}
+
+/* Function:  cm_tophits_ReadBinary()
+ * Synopsis:  Read a hit list saved in binary format, and append it.
+ *
+ * Purpose:   Read a list of hits written by cm_tophits_WriteBinary()
+ *            from open binary stream <fp> and append them to hit list
+ *            <th>, updating their hit indices as cm_tophits_Merge()
+ *            does. <th> is unsorted upon return, unless it was empty
+ *            and at most one hit was read.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEFORMAT> if the data at the current position of <fp>
+ *            isn't a hit list of a version we can read, and <eslEOD>
+ *            if a read fails, likely because the file was truncated;
+ *            in either case <errbuf> contains an error message and the
+ *            hits read before the failure remain in <th>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+cm_tophits_ReadBinary(FILE *fp, CM_TOPHITS *th, char *errbuf)
+{
+  int      status;
+  char    *buf    = NULL;
+  int      nalloc = 0;
+  int      pos;
+  uint32_t len;
+  uint64_t i;
+  uint64_t N, nreported, nincluded;
+  uint64_t N0 = th->N; /* offset for hit indices of hits we read */
+  CM_HIT  *hit;
+
+  if ((status = bin_reserve(&buf, &nalloc, 0, TH_BIN_HEADER_SIZE)) != eslOK) goto ERROR;
+  if (fread(buf, sizeof(char), TH_BIN_HEADER_SIZE, fp) != TH_BIN_HEADER_SIZE) ESL_XFAIL(eslEOD, errbuf, "failed to read hit list header");
+  pos = 0;
+  if ((status = th_bin_header_get(buf, TH_BIN_HEADER_SIZE, &pos, &N, &nreported, &nincluded, errbuf)) != eslOK) goto ERROR;
+
+  for (i = 0; i < N; i++) { 
+    /* read the record, with its length, and deserialize it */
+    if (! fread((char *) &len, sizeof(uint32_t), 1, fp) || len > INT_MAX - sizeof(uint32_t)) ESL_XFAIL(eslEOD, errbuf, "failed to read hit %" PRIu64 " of %" PRIu64, i+1, N);
+    if ((status = bin_reserve(&buf, &nalloc, 0, sizeof(uint32_t) + len)) != eslOK) goto ERROR;
+    memcpy(buf, &len, sizeof(uint32_t));
+    if (fread(buf + sizeof(uint32_t), sizeof(char), len, fp) != len) ESL_XFAIL(eslEOD, errbuf, "failed to read hit %" PRIu64 " of %" PRIu64, i+1, N);
+
+    if ((status = cm_tophits_CreateNextHit(th, &hit)) != eslOK) goto ERROR;
+    pos = 0;
+    if ((status = hit_deserialize(buf, sizeof(uint32_t) + len, &pos, hit)) != eslOK) { 
+      th->N--; /* hit was freed by hit_deserialize() */
+      if (status == eslEMEM) goto ERROR;
+      ESL_XFAIL(status, errbuf, "failed to read hit %" PRIu64 " of %" PRIu64, i+1, N);
+    }
+    if(hit->hit_idx  != -1) hit->hit_idx  += N0;
+    if(hit->any_oidx != -1) hit->any_oidx += N0;
+    if(hit->win_oidx != -1) hit->win_oidx += N0;
+  }
+  th->nreported += nreported;
+  th->nincluded += nincluded;
+
+  free(buf);
+  return eslOK;
+
+ ERROR:
+  if (buf != NULL) free(buf);
+  return status;
+}
+
+/* th_bin_header_put(), th_bin_header_get()
+ *
+ * Write/read the header of a binary hit list: magic, version, flags
+ * (uint32_t), then number of hits, reported hits and included hits
+ * (uint64_t); TH_BIN_HEADER_SIZE bytes in all. th_bin_header_put()
+ * requires that <buf> has room for the header at <*pos>.
+ * th_bin_header_get() returns <eslOK> on success, <eslEFORMAT> if the
+ * magic or version are wrong and <eslEOD> if <buf> is too short, with
+ * an error message in <errbuf>.
+ */
+static void
+th_bin_header_put(char *buf, int *pos, CM_TOPHITS *th, uint32_t flags)
+{
+  uint32_t version = CM_TOPHITS_BIN_VERSION;
+
+  bin_put(buf, pos, &v1_thmagic,       sizeof(uint32_t));
+  bin_put(buf, pos, &version,          sizeof(uint32_t));
+  bin_put(buf, pos, &flags,            sizeof(uint32_t));
+  bin_put(buf, pos, &(th->N),          sizeof(uint64_t));
+  bin_put(buf, pos, &(th->nreported),  sizeof(uint64_t));
+  bin_put(buf, pos, &(th->nincluded),  sizeof(uint64_t));
+}
+
+static int
+th_bin_header_get(char *buf, int n, int *pos, uint64_t *ret_N, uint64_t *ret_nreported, uint64_t *ret_nincluded, char *errbuf)
+{
+  uint32_t magic, version, flags;
+
+  if (bin_get(buf, n, pos, &magic, sizeof(uint32_t)) != eslOK) ESL_FAIL(eslEOD, errbuf, "failed to read hit list header");
+  if (magic == v1_thswap)  ESL_FAIL(eslEFORMAT, errbuf, "hit list was saved on a machine with a different byte order");
+  if (magic != v1_thmagic) ESL_FAIL(eslEFORMAT, errbuf, "data is not a binary hit list");
+  if (bin_get(buf, n, pos, &version, sizeof(uint32_t)) != eslOK) ESL_FAIL(eslEOD, errbuf, "failed to read hit list header");
+  if (version > CM_TOPHITS_BIN_VERSION) ESL_FAIL(eslEFORMAT, errbuf, "hit list format version %u is newer than this version of Infernal can read (%d)", version, CM_TOPHITS_BIN_VERSION);
+  if (bin_get(buf, n, pos, &flags,         sizeof(uint32_t)) != eslOK ||
+      bin_get(buf, n, pos, ret_N,          sizeof(uint64_t)) != eslOK ||
+      bin_get(buf, n, pos, ret_nreported,  sizeof(uint64_t)) != eslOK ||
+      bin_get(buf, n, pos, ret_nincluded,  sizeof(uint64_t)) != eslOK) {
+    ESL_FAIL(eslEOD, errbuf, "failed to read hit list header");
+  }
+  return eslOK;
+}
+
+/* hit_serialize()
+ * 
+ * Append the binary record for hit <hit> to <*buf>, starting at
+ * <*pos>, and advance <*pos> past it, reallocating <*buf> if
+ * necessary. The record is a uint32_t length, then the hit's fields
+ * in fixed width types, its strings as a uint32_t length (including
+ * the '\0', 0 for NULL) followed by the string, and a code for its
+ * alignment display: 0 for none, or 1 or 2 if the display follows
+ * with its strings stored as is or compressed with lz_compress(),
+ * respectively. Alignment display strings are all in <ad->mem>, so
+ * we store that and the offsets of each string in it. Returns
+ * <eslOK> on success; throws <eslEMEM> or <eslERANGE>, as
+ * bin_reserve() does.
+ */
+static int
+hit_serialize(CM_HIT *hit, uint32_t flags, char **buf, int *nalloc, int *pos)
+{
+  int            status;
+  CM_ALIDISPLAY *ad = hit->ad;
+  int64_t        n;         /* upper bound on record size */
+  int            lenpos;    /* position of record length in <*buf> */
+  int            codepos;   /* position of alignment display code in <*buf> */
+  uint32_t       len;
+  uint8_t        code;
+  int32_t        offsetA[16];
+  int32_t        zlen;
+
+  n = sizeof(uint32_t) + HIT_BIN_FIXED_SIZE + 3 * sizeof(uint32_t) + sizeof(uint8_t);
+  if (hit->name != NULL) n += strlen(hit->name) + 1;
+  if (hit->acc  != NULL) n += strlen(hit->acc)  + 1;
+  if (hit->desc != NULL) n += strlen(hit->desc) + 1;
+  if (ad        != NULL) n += AD_BIN_FIXED_SIZE + sizeof(int32_t) + LZ_BOUND(ad->memsize);
+  if ((status = bin_reserve(buf, nalloc, *pos, n)) != eslOK) return status;
+
+  lenpos = *pos;
+  *pos  += sizeof(uint32_t);
+  bin_put_i64(*buf, pos, hit->start);
+  bin_put_i64(*buf, pos, hit->stop);
+  bin_put_i32(*buf, pos, hit->in_rc);
+  bin_put_i32(*buf, pos, hit->root);
+  bin_put_i32(*buf, pos, hit->mode);
+  bin_put_i64(*buf, pos, hit->cm_idx);
+  bin_put_i32(*buf, pos, hit->clan_idx);
+  bin_put_i64(*buf, pos, hit->seq_idx);
+  bin_put_i32(*buf, pos, hit->pass_idx);
+  bin_put_i64(*buf, pos, hit->hit_idx);
+  bin_put    (*buf, pos, &(hit->score),  sizeof(float));
+  bin_put    (*buf, pos, &(hit->bias),   sizeof(float));
+  bin_put    (*buf, pos, &(hit->pvalue), sizeof(double));
+  bin_put    (*buf, pos, &(hit->evalue), sizeof(double));
+  bin_put_i32(*buf, pos, hit->has_evalue);
+  bin_put    (*buf, pos, &(hit->flags),  sizeof(uint32_t));
+  bin_put_i64(*buf, pos, hit->srcL);
+  bin_put_i32(*buf, pos, hit->hmmonly);
+  bin_put_i32(*buf, pos, hit->glocal);
+  bin_put_i64(*buf, pos, hit->any_oidx);
+  bin_put_i64(*buf, pos, hit->win_oidx);
+  bin_put    (*buf, pos, &(hit->any_bitE), sizeof(double));
+  bin_put    (*buf, pos, &(hit->win_bitE), sizeof(double));
+  bin_put_string(*buf, pos, hit->name);
+  bin_put_string(*buf, pos, hit->acc);
+  bin_put_string(*buf, pos, hit->desc);
+
+  codepos = *pos;
+  *pos   += sizeof(uint8_t);
+  code    = 0;
+  if (ad != NULL) { 
+    offsetA[0]  = (ad->rfline    == NULL) ? -1 : ad->rfline    - ad->mem;
+    offsetA[1]  = (ad->ncline    == NULL) ? -1 : ad->ncline    - ad->mem;
+    offsetA[2]  = (ad->csline    == NULL) ? -1 : ad->csline    - ad->mem;
+    offsetA[3]  = (ad->model     == NULL) ? -1 : ad->model     - ad->mem;
+    offsetA[4]  = (ad->mline     == NULL) ? -1 : ad->mline     - ad->mem;
+    offsetA[5]  = (ad->aseq      == NULL) ? -1 : ad->aseq      - ad->mem;
+    offsetA[6]  = (ad->ppline    == NULL) ? -1 : ad->ppline    - ad->mem;
+    offsetA[7]  = (ad->aseq_el   == NULL) ? -1 : ad->aseq_el   - ad->mem;
+    offsetA[8]  = (ad->rfline_el == NULL) ? -1 : ad->rfline_el - ad->mem;
+    offsetA[9]  = (ad->ppline_el == NULL) ? -1 : ad->ppline_el - ad->mem;
+    offsetA[10] = (ad->cmname    == NULL) ? -1 : ad->cmname    - ad->mem;
+    offsetA[11] = (ad->cmacc     == NULL) ? -1 : ad->cmacc     - ad->mem;
+    offsetA[12] = (ad->cmdesc    == NULL) ? -1 : ad->cmdesc    - ad->mem;
+    offsetA[13] = (ad->sqname    == NULL) ? -1 : ad->sqname    - ad->mem;
+    offsetA[14] = (ad->sqacc     == NULL) ? -1 : ad->sqacc     - ad->mem;
+    offsetA[15] = (ad->sqdesc    == NULL) ? -1 : ad->sqdesc    - ad->mem;
+    bin_put    (*buf, pos, offsetA, sizeof(int32_t) * 16);
+    bin_put_i32(*buf, pos, ad->N);
+    bin_put_i32(*buf, pos, ad->N_el);
+    bin_put_i32(*buf, pos, ad->cfrom_emit);
+    bin_put_i32(*buf, pos, ad->cto_emit);
+    bin_put_i32(*buf, pos, ad->cfrom_span);
+    bin_put_i32(*buf, pos, ad->cto_span);
+    bin_put_i32(*buf, pos, ad->clen);
+    bin_put_i64(*buf, pos, ad->sqfrom);
+    bin_put_i64(*buf, pos, ad->sqto);
+    bin_put    (*buf, pos, &(ad->sc),           sizeof(float));
+    bin_put    (*buf, pos, &(ad->avgpp),        sizeof(float));
+    bin_put    (*buf, pos, &(ad->gc),           sizeof(float));
+    bin_put    (*buf, pos, &(ad->tau),          sizeof(double));
+    bin_put    (*buf, pos, &(ad->matrix_Mb),    sizeof(float));
+    bin_put    (*buf, pos, &(ad->elapsed_secs), sizeof(double));
+    bin_put_i32(*buf, pos, ad->hmmonly);
+    bin_put_i32(*buf, pos, ad->memsize);
+
+    code = 1;
+    if (flags & CM_TOPHITS_BIN_COMPRESS) { 
+      zlen = lz_compress(ad->mem, ad->memsize, *buf + *pos + sizeof(int32_t));
+      if (zlen < ad->memsize) { 
+        bin_put_i32(*buf, pos, zlen);
+        *pos += zlen;
+        code  = 2;
+      }
+    }
+    if (code == 1) bin_put(*buf, pos, ad->mem, ad->memsize);
+  }
+  memcpy(*buf + codepos, &code, sizeof(uint8_t));
+
+  len = *pos - lenpos - sizeof(uint32_t);
+  memcpy(*buf + lenpos, &len, sizeof(uint32_t));
+  return eslOK;
+}
+
+/* hit_deserialize()
+ * 
+ * Read a hit record written by hit_serialize() that starts at
+ * <*pos> in <buf> of length <n> into <hit>, and advance <*pos> to
+ * the end of the record (skipping any fields a later version of
+ * the format may have appended). Returns <eslOK> on success,
+ * <eslEOD> if the record extends past <n> or is corrupt (including
+ * a string that isn't NUL-terminated inside the record), <eslEMEM>
+ * on allocation failure. Upon failure, any memory allocated for the
+ * hit is freed and <hit> has no strings or alignment display.
+ */
+static int
+hit_deserialize(char *buf, int n, int *pos, CM_HIT *hit)
+{
+  int            status;
+  uint32_t       len;
+  int            end;       /* position in <buf> just past the record */
+  uint8_t        code;
+  int32_t        offsetA[16];
+  int32_t        zlen;
+  int64_t        sqfrom, sqto;
+  int            k;
+  CM_ALIDISPLAY *ad = NULL;
+
+  hit->name = hit->acc = hit->desc = NULL;
+  hit->ad   = NULL;
+
+  status = eslEOD;
+  if (bin_get(buf, n, pos, &len, sizeof(uint32_t)) != eslOK || len > n - *pos) goto ERROR;
+  end = *pos + len;
+  n   = end; /* don't read past the record */
+
+  if (bin_get_i64(buf, n, pos, &(hit->start))       != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->stop))        != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->in_rc))       != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->root))        != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->mode))        != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->cm_idx))      != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->clan_idx))    != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->seq_idx))     != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->pass_idx))    != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->hit_idx))     != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->score),  sizeof(float))  != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->bias),   sizeof(float))  != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->pvalue), sizeof(double)) != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->evalue), sizeof(double)) != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->has_evalue))  != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->flags),  sizeof(uint32_t)) != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->srcL))        != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->hmmonly))     != eslOK) goto ERROR;
+  if (bin_get_int(buf, n, pos, &(hit->glocal))      != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->any_oidx))    != eslOK) goto ERROR;
+  if (bin_get_i64(buf, n, pos, &(hit->win_oidx))    != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->any_bitE), sizeof(double)) != eslOK) goto ERROR;
+  if (bin_get    (buf, n, pos, &(hit->win_bitE), sizeof(double)) != eslOK) goto ERROR;
+  if ((status = bin_get_string(buf, n, pos, &(hit->name))) != eslOK) goto ERROR;
+  if ((status = bin_get_string(buf, n, pos, &(hit->acc)))  != eslOK) goto ERROR;
+  if ((status = bin_get_string(buf, n, pos, &(hit->desc))) != eslOK) goto ERROR;
+
+  status = eslEOD;
+  if (bin_get(buf, n, pos, &code, sizeof(uint8_t)) != eslOK || code > 2) goto ERROR;
+  if (code > 0) { 
+    ESL_ALLOC(ad, sizeof(CM_ALIDISPLAY));
+    ad->mem = NULL;
+    status = eslEOD;
+    if (bin_get    (buf, n, pos, offsetA, sizeof(int32_t) * 16) != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->N))          != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->N_el))       != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->cfrom_emit)) != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->cto_emit))   != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->cfrom_span)) != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->cto_span))   != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->clen))       != eslOK) goto ERROR;
+    if (bin_get_i64(buf, n, pos, &sqfrom)           != eslOK) goto ERROR;
+    if (bin_get_i64(buf, n, pos, &sqto)             != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->sc),           sizeof(float))  != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->avgpp),        sizeof(float))  != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->gc),           sizeof(float))  != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->tau),          sizeof(double)) != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->matrix_Mb),    sizeof(float))  != eslOK) goto ERROR;
+    if (bin_get    (buf, n, pos, &(ad->elapsed_secs), sizeof(double)) != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->hmmonly))    != eslOK) goto ERROR;
+    if (bin_get_int(buf, n, pos, &(ad->memsize))    != eslOK) goto ERROR;
+    ad->sqfrom = sqfrom;
+    ad->sqto   = sqto;
+    if (ad->memsize <= 0) goto ERROR;
+    for (k = 0; k < 16; k++) if (offsetA[k] < -1 || offsetA[k] >= ad->memsize) goto ERROR;
+
+    ESL_ALLOC(ad->mem, sizeof(char) * ad->memsize);
+    status = eslEOD;
+    if (code == 2) { 
+      if (bin_get_i32(buf, n, pos, &zlen) != eslOK || zlen < 0 || zlen > n - *pos) goto ERROR;
+      if (lz_decompress(buf + *pos, zlen, ad->mem, ad->memsize) != eslOK) goto ERROR;
+      *pos += zlen;
+    }
+    else { 
+      if (bin_get(buf, n, pos, ad->mem, ad->memsize) != eslOK) goto ERROR;
+    }
+    /* every string in ad->mem is NUL-terminated and all offsets are
+     * < memsize, so a terminator at the end of mem guarantees none of
+     * them runs past it */
+    if (ad->mem[ad->memsize-1] != '\0') goto ERROR;
+
+    ad->rfline    = (offsetA[0]  == -1) ? NULL : ad->mem + offsetA[0];
+    ad->ncline    = (offsetA[1]  == -1) ? NULL : ad->mem + offsetA[1];
+    ad->csline    = (offsetA[2]  == -1) ? NULL : ad->mem + offsetA[2];
+    ad->model     = (offsetA[3]  == -1) ? NULL : ad->mem + offsetA[3];
+    ad->mline     = (offsetA[4]  == -1) ? NULL : ad->mem + offsetA[4];
+    ad->aseq      = (offsetA[5]  == -1) ? NULL : ad->mem + offsetA[5];
+    ad->ppline    = (offsetA[6]  == -1) ? NULL : ad->mem + offsetA[6];
+    ad->aseq_el   = (offsetA[7]  == -1) ? NULL : ad->mem + offsetA[7];
+    ad->rfline_el = (offsetA[8]  == -1) ? NULL : ad->mem + offsetA[8];
+    ad->ppline_el = (offsetA[9]  == -1) ? NULL : ad->mem + offsetA[9];
+    ad->cmname    = (offsetA[10] == -1) ? NULL : ad->mem + offsetA[10];
+    ad->cmacc     = (offsetA[11] == -1) ? NULL : ad->mem + offsetA[11];
+    ad->cmdesc    = (offsetA[12] == -1) ? NULL : ad->mem + offsetA[12];
+    ad->sqname    = (offsetA[13] == -1) ? NULL : ad->mem + offsetA[13];
+    ad->sqacc     = (offsetA[14] == -1) ? NULL : ad->mem + offsetA[14];
+    ad->sqdesc    = (offsetA[15] == -1) ? NULL : ad->mem + offsetA[15];
+    hit->ad = ad;
+  }
+
+  *pos = end;
+  return eslOK;
+
+ ERROR:
+  if (ad        != NULL) { if (ad->mem != NULL) free(ad->mem); free(ad); }
+  if (hit->name != NULL) free(hit->name);
+  if (hit->acc  != NULL) free(hit->acc);
+  if (hit->desc != NULL) free(hit->desc);
+  hit->name = hit->acc = hit->desc = NULL;
+  hit->ad   = NULL;
+  return status;
+}
+
+/* bin_reserve()
+ * 
+ * Make sure buffer <*buf> of allocated size <*nalloc> has room for
+ * <n> more bytes after the first <pos>, reallocating it (at least
+ * doubling it) if not. Returns <eslOK> on success; throws <eslEMEM>
+ * on allocation failure, or <eslERANGE> if more than INT_MAX bytes
+ * would be needed. In either case <*buf> and <*nalloc> are
+ * unchanged.
+ */
+static int
+bin_reserve(char **buf, int *nalloc, int pos, int64_t n)
+{
+  int      status;
+  int64_t  newsize;
+  void    *tmp;
+
+  if (*buf != NULL && pos + n <= *nalloc) return eslOK;
+  if (pos + n > INT_MAX) ESL_EXCEPTION(eslERANGE, "binary hit list too large");
+
+  newsize = ESL_MAX(pos + n, 2 * (int64_t) *nalloc);
+  newsize = ESL_MIN(newsize, INT_MAX);
+  ESL_RALLOC(*buf, tmp, sizeof(char) * newsize);
+  *nalloc = newsize;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* bin_put(), bin_put_i32(), bin_put_i64(), bin_put_string()
+ * 
+ * Write <size> bytes from <src>, an integer as a fixed width 32 or
+ * 64 bit integer, or a string (see hit_serialize()) to <buf> at
+ * <*pos>, and advance <*pos> past it. The caller must have made
+ * sure <buf> is large enough with bin_reserve().
+ */
+static void
+bin_put(char *buf, int *pos, const void *src, size_t size)
+{
+  memcpy(buf + *pos, src, size);
+  *pos += size;
+}
+
+static void
+bin_put_i32(char *buf, int *pos, int32_t x)
+{
+  bin_put(buf, pos, &x, sizeof(int32_t));
+}
+
+static void
+bin_put_i64(char *buf, int *pos, int64_t x)
+{
+  bin_put(buf, pos, &x, sizeof(int64_t));
+}
+
+static void
+bin_put_string(char *buf, int *pos, char *s)
+{
+  uint32_t len = (s == NULL) ? 0 : strlen(s) + 1;
+
+  bin_put(buf, pos, &len, sizeof(uint32_t));
+  if (len > 0) bin_put(buf, pos, s, len);
+}
+
+/* bin_get(), bin_get_i32(), bin_get_int(), bin_get_i64(), bin_get_string()
+ * 
+ * Read <size> bytes into <dest>, a 32 bit integer (into an int32_t
+ * or an int), a 64 bit integer, or a string from <buf> of length <n>
+ * at <*pos>, and advance <*pos> past it. Return <eslOK> on success,
+ * <eslEOD> if there aren't enough bytes left in <buf>, or (for a
+ * string) it isn't '\0' terminated. bin_get_string() also returns
+ * <eslEMEM> on allocation failure; <*ret_s> is malloc'ed here.
+ */
+static int
+bin_get(char *buf, int n, int *pos, void *dest, size_t size)
+{
+  if (size > n - *pos) return eslEOD;
+  memcpy(dest, buf + *pos, size);
+  *pos += size;
+  return eslOK;
+}
+
+static int
+bin_get_i32(char *buf, int n, int *pos, int32_t *ret_x)
+{
+  return bin_get(buf, n, pos, ret_x, sizeof(int32_t));
+}
+
+static int
+bin_get_int(char *buf, int n, int *pos, int *ret_x)
+{
+  int32_t x;
+
+  if (bin_get(buf, n, pos, &x, sizeof(int32_t)) != eslOK) return eslEOD;
+  *ret_x = x;
+  return eslOK;
+}
+
+static int
+bin_get_i64(char *buf, int n, int *pos, int64_t *ret_x)
+{
+  return bin_get(buf, n, pos, ret_x, sizeof(int64_t));
+}
+
+static int
+bin_get_string(char *buf, int n, int *pos, char **ret_s)
+{
+  int       status;
+  char     *s = NULL;
+  uint32_t  len;
+
+  if (bin_get(buf, n, pos, &len, sizeof(uint32_t)) != eslOK || len > n - *pos) { status = eslEOD; goto ERROR; }
+  if (len > 0) { 
+    if (buf[*pos + len - 1] != '\0') { status = eslEOD; goto ERROR; }
+    ESL_ALLOC(s, sizeof(char) * len);
+    bin_get(buf, n, pos, s, len);
+  }
+  *ret_s = s;
+  return eslOK;
+
+ ERROR:
+  if (s != NULL) free(s);
+  *ret_s = NULL;
+  return status;
+}
+
+/* lz_compress(), lz_decompress()
+ * 
+ * A simple LZ77 compressor for alignment display strings, in the
+ * style of LZ4: the data is a series of sequences, each a token byte
+ * with the number of literal bytes that follow in its high 4 bits
+ * and the length of a match to earlier output (minus LZ_MINMATCH) in
+ * its low 4 bits, either of which is continued in extra bytes of 255
+ * (and a final byte < 255) if it is 15; then the literals; then the
+ * match offset as two bytes, least significant first, and any extra
+ * match length bytes. The last sequence has only literals. Matches
+ * are found greedily with a hash table of the positions of 4-mers.
+ *
+ * lz_compress() compresses the <n> bytes of <src> into <dst>, which
+ * must have room for LZ_BOUND(<n>) bytes, and returns the number of
+ * bytes written. lz_decompress() decompresses the <n> bytes of
+ * <src> into <dst> and returns <eslOK> if that gives exactly
+ * <dstlen> bytes, else <eslEOD>.
+ */
+static int
+lz_compress(const char *src, int n, char *dst)
+{
+  int      htab[LZ_HASHSIZE];
+  int      i, anchor, ref, mlen, h;
+  int      op = 0;
+  uint32_t seq;
+
+  for (h = 0; h < LZ_HASHSIZE; h++) htab[h] = -1;
+  i = anchor = 0;
+  while (i + LZ_MINMATCH <= n) { 
+    memcpy(&seq, src + i, sizeof(uint32_t));
+    h = (seq * 2654435761U) >> (32 - LZ_HASHBITS);
+    ref     = htab[h];
+    htab[h] = i;
+    if (ref < 0 || i - ref > 65535 || memcmp(src + ref, src + i, LZ_MINMATCH) != 0) { i++; continue; }
+
+    for (mlen = LZ_MINMATCH; i + mlen < n && src[ref + mlen] == src[i + mlen]; mlen++) ;
+    op    += lz_put_sequence(dst + op, src + anchor, i - anchor, i - ref, mlen);
+    i     += mlen;
+    anchor = i;
+  }
+  op += lz_put_sequence(dst + op, src + anchor, n - anchor, 0, 0);
+  return op;
+}
+
+static int
+lz_decompress(const char *src, int n, char *dst, int dstlen)
+{
+  const unsigned char *s  = (const unsigned char *) src;
+  int                  ip = 0;
+  int                  op = 0;
+  int                  token, len, off, k;
+
+  while (ip < n) { 
+    token = s[ip++];
+    /* literals */
+    len = token >> 4;
+    if (len == 15) { 
+      do { 
+        if (ip >= n || len > dstlen) return eslEOD;
+        len += s[ip];
+      } while (s[ip++] == 255);
+    }
+    if (len > n - ip || len > dstlen - op) return eslEOD;
+    memcpy(dst + op, src + ip, len);
+    ip += len;
+    op += len;
+    if (ip == n) break; /* last sequence has only literals */
+
+    /* match */
+    if (n - ip < 2) return eslEOD;
+    off = s[ip] | (s[ip+1] << 8);
+    ip += 2;
+    len = (token & 15) + LZ_MINMATCH;
+    if ((token & 15) == 15) { 
+      do { 
+        if (ip >= n || len > dstlen) return eslEOD;
+        len += s[ip];
+      } while (s[ip++] == 255);
+    }
+    if (off == 0 || off > op || len > dstlen - op) return eslEOD;
+    for (k = 0; k < len; k++, op++) dst[op] = dst[op - off]; /* may overlap, byte by byte */
+  }
+  return (op == dstlen) ? eslOK : eslEOD;
+}
+
+/* lz_put_sequence()
+ * 
+ * Write one lz_compress() sequence of the <nlit> literals in <lit>
+ * followed by a match of length <mlen> at offset <off> (none if
+ * <mlen> is 0) to <dst>, and return the number of bytes written.
+ */
+static int
+lz_put_sequence(char *dst, const char *lit, int nlit, int off, int mlen)
+{
+  int op = 1;
+  int x;
+
+  dst[0] = (char) ((ESL_MIN(nlit, 15) << 4) | ((mlen > 0) ? ESL_MIN(mlen - LZ_MINMATCH, 15) : 0));
+  if (nlit >= 15) { 
+    for (x = nlit - 15; x >= 255; x -= 255) dst[op++] = (char) 255;
+    dst[op++] = (char) x;
+  }
+  memcpy(dst + op, lit, nlit);
+  op += nlit;
+  if (mlen > 0) { 
+    dst[op++] = (char) (off & 0xff);
+    dst[op++] = (char) ((off >> 8) & 0xff);
+    if (mlen - LZ_MINMATCH >= 15) { 
+      for (x = mlen - LZ_MINMATCH - 15; x >= 255; x -= 255) dst[op++] = (char) 255;
+      dst[op++] = (char) x;
+    }
+  }
+  return op;
+}
+
 /*---------------- end, CM_TOPHITS object -----------------------*/
 
 /*****************************************************************
@@ -1828,7 +3082,7 @@ cm_tophits_HitAlignmentStatistics(FILE *ofp, CM_TOPHITS *th, int used_hb, int us
   int64_t hmmonly_naln = 0;                        /* total number alignments */
 
   for(h = 0; h < th->N; h++) { 
-    if(th->unsrt[h].ad->hmmonly) { 
+    if(th->unsrt[h].ad != NULL && th->unsrt[h].ad->hmmonly) { 
       hmmonly_naln++;
       /* we don't have stats on time, Mb used, so we can't summarize them */
     }
@@ -2972,6 +4226,14 @@ cm_hit_Dump(FILE *fp, const CM_HIT *h)
   so we expect top hits list time to be negligible for typical hmmsearch/hmmscan runs.
   
   If needed, we do have opportunity for optimization, however - especially in memory handling.
+
+  To compare overlap removal/markup against the O(N^2) method on a
+  few long, hit-dense sequences, with 4 threads:
+  ./benchmark-cm-tophits -X 4 -L 50000000 --memeff --cpu 4
+
+  To time merging lists that were each sorted beforehand (as threaded
+  cmsearch workers do) against sorting the merged list:
+  ./benchmark-cm-tophits -M 16 -N 100000 --presort
  */
 #include "esl_config.h"
 #include "p7_config.h"
@@ -3000,6 +4262,9 @@ static ESL_OPTIONS options[] = {
   { "-Z",        eslARG_INT,    "100", NULL, NULL,  NULL,  NULL, NULL, "length of hits (fixed)",                           0 },
   { "-L",        eslARG_INT, "100000", NULL, NULL,  NULL,  NULL, NULL, "length of target sequences",                       0 },
   { "-v",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "dump hit list after removing overlaps",            0 },
+  { "--cpu",     eslARG_INT,      "0", NULL,"n>=0", NULL,  NULL, NULL, "number of threads for removing/marking overlaps",  0 },
+  { "--memeff",  eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "also time O(N^2) overlap method, verify same result", 0 },
+  { "--presort", eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "sort each list before merging, verify same order",   0 },
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 static char usage[]  = "[-options]";
@@ -3030,6 +4295,15 @@ main(int argc, char **argv)
   int             i,j;
   int             nhits;
   int             nhits_unmarked;
+  int             ncpus    = esl_opt_GetInteger(go, "--cpu");
+  int             step;
+  CM_HIT        **orderA   = NULL;
+  int             nsets;
+  int             do_set;
+  int64_t         a, b;
+  uint32_t       *flagsA   = NULL;
+  int64_t        *any_oidxA= NULL;
+  int64_t        *win_oidxA= NULL;
   int             status;
   char            errbuf[eslERRBUFSIZE];
 
@@ -3075,12 +4349,22 @@ main(int argc, char **argv)
   esl_stopwatch_Display(stdout, w, "# CPU time hit creation:                                  ");
   esl_stopwatch_Start(w);
 
-  /* then merge them into one big list in h[0] */
-  for (j = 1; j < M; j++)
-    {
-      cm_tophits_Merge(h[0], h[j]);
-      cm_tophits_Destroy(h[j]);
-    }      
+  /* optionally sort each list first, like threaded cmsearch workers do, 
+   * so the merge below is a k-way merge of sorted lists 
+   */
+  if(esl_opt_GetBoolean(go, "--presort")) { 
+    for (j = 0; j < M; j++) cm_tophits_SortForOverlapRemoval(h[j]);
+    esl_stopwatch_Stop(w);
+    esl_stopwatch_Display(stdout, w, "# CPU time sorting each list (in parallel in cmsearch):   ");
+    esl_stopwatch_Start(w);
+  }
+
+  /* then merge them into one big list in h[0], pairwise in a balanced tree */
+  for (step = 1; step < M; step *= 2)
+    for (j = 0; j+step < M; j += 2*step)
+      cm_tophits_Merge(h[j], h[j+step]);
+  for (j = 1; j < M; j++) cm_tophits_Destroy(h[j]);
+
   esl_stopwatch_Stop(w);
   esl_stopwatch_Display(stdout, w, "# CPU time cm_tophits_Merge():                            ");
   esl_stopwatch_Start(w);
@@ -3089,11 +4373,24 @@ main(int argc, char **argv)
 
   esl_stopwatch_Stop(w);
   esl_stopwatch_Display(stdout, w, "# CPU time cm_tophits_SortForOverlapRemoval():            ");
+
+  /* with --presort, make sure the merged order is identical to a full sort */
+  if(esl_opt_GetBoolean(go, "--presort")) { 
+    ESL_ALLOC(orderA, sizeof(CM_HIT *) * h[0]->N);
+    for (i = 0; i < h[0]->N; i++) orderA[i] = h[0]->hit[i];
+    h[0]->is_sorted_for_overlap_removal = FALSE;
+    esl_stopwatch_Start(w);
+    cm_tophits_SortForOverlapRemoval(h[0]);
+    esl_stopwatch_Stop(w);
+    esl_stopwatch_Display(stdout, w, "# CPU time full sort, for comparison:                     ");
+    for (i = 0; i < h[0]->N; i++) if(orderA[i] != h[0]->hit[i]) cm_Fail("merged sorted lists differ from full sort at hit %d", i);
+    printf("# merged sorted lists identical to full sort\n");
+  }
   esl_stopwatch_Start(w);
 
   if(esl_opt_GetBoolean(go, "-v")) cm_tophits_Dump(stdout, h[0]);
 
-  if((status = cm_tophits_RemoveOrMarkOverlaps(h[0], /*do_clans_only=*/FALSE, errbuf)) != eslOK) cm_Fail(errbuf);
+  if((status = cm_tophits_RemoveOrMarkOverlapsParallel(h[0], /*do_clans_only=*/FALSE, ncpus, errbuf)) != eslOK) cm_Fail(errbuf);
 
   esl_stopwatch_Stop(w);
   esl_stopwatch_Display(stdout, w, "# CPU time cm_tophits_RemoveOrMarkOverlaps() (removing):  ");
@@ -3105,7 +4402,7 @@ main(int argc, char **argv)
   esl_stopwatch_Display(stdout, w, "# CPU time cm_tophits_SortForOverlapMarkup():             ");
   esl_stopwatch_Start(w);
 
-  if((status = cm_tophits_RemoveOrMarkOverlaps(h[0], /*do_clans=*/FALSE, errbuf)) != eslOK) cm_Fail(errbuf);
+  if((status = cm_tophits_RemoveOrMarkOverlapsParallel(h[0], /*do_clans=*/FALSE, ncpus, errbuf)) != eslOK) cm_Fail(errbuf);
 
   if(esl_opt_GetBoolean(go, "-v")) cm_tophits_Dump(stdout, h[0]);
 
@@ -3132,12 +4429,57 @@ main(int argc, char **argv)
     }
   }
 
+  /* optionally, redo overlap removal and markup with the O(N^2)
+   * method alone, and make sure we get the same result
+   */
+  if(esl_opt_GetBoolean(go, "--memeff")) { 
+    ESL_ALLOC(flagsA,    sizeof(uint32_t) * h[0]->N);
+    ESL_ALLOC(any_oidxA, sizeof(int64_t)  * h[0]->N);
+    ESL_ALLOC(win_oidxA, sizeof(int64_t)  * h[0]->N);
+    for(i = 0; i < h[0]->N; i++) { 
+      flagsA[i]    = h[0]->unsrt[i].flags;
+      any_oidxA[i] = h[0]->unsrt[i].any_oidx;
+      win_oidxA[i] = h[0]->unsrt[i].win_oidx;
+      h[0]->unsrt[i].flags   &= ~(CM_HIT_IS_REMOVED_DUPLICATE | CM_HIT_IS_MARKED_OVERLAP);
+      h[0]->unsrt[i].any_oidx = -1;
+      h[0]->unsrt[i].win_oidx = -1;
+    }
+    cm_tophits_SortForOverlapRemoval(h[0]);
+    esl_stopwatch_Start(w);
+
+    for(a = 0, nsets = 0; a < h[0]->N; a = b, nsets++) { 
+      b = next_overlap_set(h[0], a, /*do_remove=*/TRUE, /*do_clans_only=*/FALSE, &do_set);
+      if(do_set && (status = remove_or_mark_overlaps_one_seq_memeff(h[0], a, b-1, /*do_remove=*/TRUE, errbuf)) != eslOK) cm_Fail(errbuf);
+    }
+
+    esl_stopwatch_Stop(w);
+    esl_stopwatch_Display(stdout, w, "# CPU time O(N^2) overlap method (removing):              ");
+    cm_tophits_SortForOverlapMarkup(h[0], FALSE);
+    esl_stopwatch_Start(w);
+
+    for(a = 0; a < h[0]->N; a = b) { 
+      b = next_overlap_set(h[0], a, /*do_remove=*/FALSE, /*do_clans_only=*/FALSE, &do_set);
+      if(do_set && (status = remove_or_mark_overlaps_one_seq_memeff(h[0], a, b-1, /*do_remove=*/FALSE, errbuf)) != eslOK) cm_Fail(errbuf);
+    }
+
+    esl_stopwatch_Stop(w);
+    esl_stopwatch_Display(stdout, w, "# CPU time O(N^2) overlap method (marking):               ");
+
+    for(i = 0; i < h[0]->N; i++) { 
+      if(h[0]->unsrt[i].flags    != flagsA[i])    cm_Fail("O(N^2) overlap method flags differ for hit %d", i);
+      if(h[0]->unsrt[i].any_oidx != any_oidxA[i]) cm_Fail("O(N^2) overlap method any_oidx differs for hit %d", i);
+      if(h[0]->unsrt[i].win_oidx != win_oidxA[i]) cm_Fail("O(N^2) overlap method win_oidx differs for hit %d", i);
+    }
+    printf("# O(N^2) overlap method gives identical results (%d model/seq/strand sets)\n", nsets);
+  }
+
   printf("# number of lists:               %d\n", M);
   printf("# sequence length                %d\n", L);
   printf("# number of sequences            %d\n", X);
   printf("# number of models               %d\n", Y);
   printf("# initial number of hits         %d\n", N*M);
   printf("# hit length                     %d\n", hitlen);
+  printf("# number of threads              %d\n", ncpus);
   printf("# number of non-removed hits     %d\n", nhits);
   printf("# number of non-marked  hits     %d\n", nhits_unmarked);
 
@@ -3153,6 +4495,10 @@ main(int argc, char **argv)
   if (cm_idxes  != NULL) free(cm_idxes);
   if (starts    != NULL) free(starts);
   if (stops     != NULL) free(stops);
+  if (orderA    != NULL) free(orderA);
+  if (flagsA    != NULL) free(flagsA);
+  if (any_oidxA != NULL) free(any_oidxA);
+  if (win_oidxA != NULL) free(win_oidxA);
   if (h         != NULL) free(h);
   return status;
 }
@@ -3210,10 +4556,17 @@ main(int argc, char **argv)
   CM_TOPHITS     *h3       = NULL;
   CM_TOPHITS     *h4       = NULL;
   CM_TOPHITS     *h5       = NULL;
+  CM_TOPHITS     *h6       = NULL;
+  CM_TOPHITS     *h7       = NULL;
+  CM_TOPHITS     *h8       = NULL;
+  CM_TOPHITS     *h9       = NULL;
+  CM_TOPHITS     *h6c      = NULL;
+  CM_TOPHITS     *h7c      = NULL;
   char            name[]   = "not_unique_name";
   char            acc[]    = "not_unique_acc";
   char            desc[]   = "Test description for the purposes of making the test driver allocate space";
   CM_HIT         *hit = NULL;
+  CM_HIT         *hit2 = NULL;
   int             i;
   int             status;
   char            errbuf[eslERRBUFSIZE];
@@ -3493,8 +4846,8 @@ main(int argc, char **argv)
    * with a fabricated example of a rare case where they're not identical.
    * We do this in two passes, the first pass will only do 5 hits and 
    * will use the function remove_or_mark_overlaps_one_seq_memeff(),
-   * the second will do 5005 hits and so will use the function 
-   * remove_or_mark_overlaps_one_seq_fast().
+   * the second will do 10005 hits and so will use the function 
+   * remove_or_mark_overlaps_one_seq_tree().
    */
   int p, z;
   for(p = 0; p <= 1; p++) { 
@@ -3596,6 +4949,60 @@ main(int argc, char **argv)
     
   } /* end of 'for(p = 0; p <= 1; p++)' */
 
+  /* Merging lists that are each sorted must give the same order as 
+   * sorting the merged list, with few sequences, models and scores
+   * so there are many ties in the leading sort keys.
+   */
+  h6 = cm_tophits_Create();
+  h7 = cm_tophits_Create();
+  h8 = cm_tophits_Create();
+  for (i = 0; i < 3*N; i++) { 
+    cm_tophits_CreateNextHit(h8, &hit);
+    hit->start   = esl_rnd_Roll(r, 20) + 1;
+    hit->stop    = esl_rnd_Roll(r, 20) + 1;
+    hit->in_rc   = (hit->start > hit->stop) ? TRUE : FALSE;
+    hit->score   = (float) esl_rnd_Roll(r, 3);
+    hit->evalue  = (double) esl_rnd_Roll(r, 3);
+    hit->seq_idx = esl_rnd_Roll(r, 2);
+    hit->cm_idx  = esl_rnd_Roll(r, 2);
+    hit->srcL    = 20;
+    cm_tophits_CreateNextHit((i%3 == 0) ? h6 : h7, &hit2);
+    hit2->start   = hit->start;
+    hit2->stop    = hit->stop;
+    hit2->in_rc   = hit->in_rc;
+    hit2->score   = hit->score;
+    hit2->evalue  = hit->evalue;
+    hit2->seq_idx = hit->seq_idx;
+    hit2->cm_idx  = hit->cm_idx;
+    hit2->srcL    = hit->srcL;
+  }
+  for (p = 0; p < 3; p++) { 
+    /* Merge() modifies the hits of the list merged in, so merge fresh clones of h6 and h7 each pass */
+    h6c = cm_tophits_Create();
+    h7c = cm_tophits_Create();
+    for (i = 0; i < h6->N; i++) cm_tophits_CloneHitMostly(h6, i, h6c);
+    for (i = 0; i < h7->N; i++) cm_tophits_CloneHitMostly(h7, i, h7c);
+    if     (p == 0) { cm_tophits_SortForOverlapRemoval(h6c); cm_tophits_SortForOverlapRemoval(h7c); cm_tophits_SortForOverlapRemoval(h8); }
+    else if(p == 1) { cm_tophits_SortByEvalue(h6c);          cm_tophits_SortByEvalue(h7c);          cm_tophits_SortByEvalue(h8); }
+    else            { cm_tophits_SortByPosition(h6c);        cm_tophits_SortByPosition(h7c);        cm_tophits_SortByPosition(h8); }
+    h9 = cm_tophits_Create();
+    cm_tophits_Merge(h9, h6c); /* h9 is empty, so it takes h6c's order */
+    cm_tophits_Merge(h9, h7c);
+    cm_tophits_Destroy(h6c);
+    cm_tophits_Destroy(h7c);
+    if (h9->N != h8->N) esl_fatal("sorted merge failed, wrong number of hits (pass %d)", p+1);
+    if ((p == 0 && ! h9->is_sorted_for_overlap_removal) || 
+        (p == 1 && ! h9->is_sorted_by_evalue)           ||
+        (p == 2 && ! h9->is_sorted_by_position))        esl_fatal("sorted merge failed, not sorted (pass %d)", p+1);
+    for (i = 0; i < h8->N; i++) { 
+      if (h9->hit[i]->start   != h8->hit[i]->start   || h9->hit[i]->stop   != h8->hit[i]->stop   || 
+          h9->hit[i]->score   != h8->hit[i]->score   || h9->hit[i]->evalue != h8->hit[i]->evalue || 
+          h9->hit[i]->seq_idx != h8->hit[i]->seq_idx || h9->hit[i]->cm_idx != h8->hit[i]->cm_idx) 
+        esl_fatal("sorted merge failed, hit %d differs (pass %d)", i, p+1);
+    }
+    cm_tophits_Destroy(h9);
+  }
+
   if (cm_tophits_GetMaxNameLength(h1) != strlen(name)) esl_fatal("GetMaxNameLength() failed");
 
   cm_tophits_Destroy(h1);
@@ -3603,6 +5010,9 @@ main(int argc, char **argv)
   cm_tophits_Destroy(h3);
   cm_tophits_Destroy(h4);
   cm_tophits_Destroy(h5);
+  cm_tophits_Destroy(h6);
+  cm_tophits_Destroy(h7);
+  cm_tophits_Destroy(h8);
   esl_randomness_Destroy(r);
   esl_getopts_Destroy(go);
   return eslOK;
@@ -27,6 +27,12 @@
 #include "esl_tree.h"
 #include "esl_vectorops.h"
 
+#ifdef HMMER_THREADS
+#include <unistd.h>
+#include "esl_threads.h"
+#include "esl_workqueue.h"
+#endif /*HMMER_THREADS*/
+
 #include "hmmer.h"
 
 #include "infernal.h"
@@ -44,6 +50,9 @@ static ESL_OPTIONS options[] = {
   { "-o",        eslARG_OUTFILE,FALSE, NULL, NULL,      NULL,      NULL,        NULL, "direct summary output to file <f>, not stdout",            1 },
   { "-O",        eslARG_OUTFILE,FALSE, NULL, NULL,      NULL,      NULL,        NULL, "resave consensus/insert column annotated MSA to file <f>", 1 },
   { "--devhelp", eslARG_NONE,   NULL,  NULL, NULL,      NULL,      NULL,        NULL, "show list of otherwise hidden developer/expert options",   1 },
+#ifdef HMMER_THREADS 
+  { "--cpu",     eslARG_INT,    NULL,"INFERNAL_NCPU","n>=0",NULL,  NULL,        NULL, "number of parallel CPU workers to use for multithreads",   1 },
+#endif
 
   /* Expert model construction options */
   /* name          type            default  env  range       toggles       reqs        incomp  help  docgroup*/
@@ -166,6 +175,19 @@ static ESL_OPTIONS options[] = {
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
+#ifdef HMMER_THREADS
+/* ALIGN_INFO: a worker thread realigning the sequences of the MSA
+ * during --refine, with its own copy of the CM.
+ */
+typedef struct {
+  ESL_WORK_QUEUE   *queue;
+  CM_t             *cm;          /* a clone of the current CM */
+  CM_ALNDATA      **dataA;       /* array of CM_ALNDATA objects with ptrs to sqs, parsetrees, scores */
+  int               n;           /* size of dataA */
+  float             mxsize;      /* max size (Mb) of allowable DP mx */
+} ALIGN_INFO;
+#endif /*HMMER_THREADS*/
+
 /* struct cfg_s : "Global" application configuration shared by all threads/processes
  * 
  * This structure is passed to routines within main.c, as a means of semi-encapsulation
@@ -198,6 +220,7 @@ struct cfg_s {
   int           nnamed;		/* number of alignments that had their own names */
   int           ncm_total;      /* which # CM this is that we're constructing (we may build > 1 per file) */
   ESL_RANDOMNESS *r;            /* source of randomness, only created if --gibbs enabled */
+  int           calib_ncpus;    /* number of threads to calibrate filter HMMs with, 0 for none */
   
   /* optional files used for building additional filter p7 HMMs */
   P7_BG        *fp7_bg;         /* background model for additional P7s */
@@ -214,8 +237,47 @@ struct cfg_s {
   FILE         *cdfp;           /* if --cdump, output file handle for dumping clustered MSAs */
   FILE         *refinefp;       /* if --refine, output file handle for dumping refined MSAs */
   FILE         *rdfp;           /* if --rfile, output file handle for dumping intermediate MSAs during iterative refinement */
+
+  /* cluster MSAs, if --ctarget, --cmaxid or --call */
+  ESL_MSA     **cmsa;           /* [0..ncmsa-1] MSAs of the clusters of the current MSA, NULL if none */
+  int           ncmsa;          /* number of cluster MSAs in cmsa */
+  int           cmsa_idx;       /* index of the next cluster MSA in cmsa to build a CM from */
+
+#ifdef HMMER_THREADS
+  /* worker threads for realigning during --refine, only if ncpus > 0 */
+  int             ncpus;          /* number of worker threads, 0 if we realign serially */
+  ESL_THREADS    *align_threads;
+  ESL_WORK_QUEUE *align_queue;
+  ALIGN_INFO     *align_info;     /* [0..ncpus-1] */
+  ESL_SQ        **align_sqA;      /* [0..2*ncpus-1] sequences initially in <align_queue> */
+#endif
 };
 
+#ifdef HMMER_THREADS
+/* BUILD_WORKUNIT: an MSA to build a CM from and, once a worker 
+ * thread has built it, the CM, its guide tree and parsetrees.
+ */
+typedef struct {
+  int            idx;           /* index of this unit, CMs are output in order of idx; -1 if no work */
+  int            nali;          /* which # alignment the MSA is in the file */
+  int            ncm;           /* which # CM this is */
+  int            calib_ncpus;   /* number of threads to calibrate the filter HMM with */
+  ESL_MSA       *msa;
+  CM_t          *cm;
+  Parsetree_t   *mtr;
+  Parsetree_t  **tr;
+} BUILD_WORKUNIT;
+
+/* BUILD_INFO: a worker thread building CMs from MSAs, with its own
+ * copy of the configuration.
+ */
+typedef struct {
+  ESL_WORK_QUEUE    *queue;
+  const ESL_GETOPTS *go;
+  struct cfg_s       cfg;       /* a copy of the master's cfg, with its own fp7_bg and fp7_bld */
+} BUILD_INFO;
+#endif /*HMMER_THREADS*/
+
 static char usage[]  = "[-options] <cmfile_out> <msafile>";
 static char banner[] = "covariance model construction from multiple sequence alignments";
 
@@ -223,6 +285,9 @@ static void   master(const ESL_GETOPTS *go, struct cfg_s *cfg);
 static void   process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfile, char **ret_alifile);
 static void   output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *alifile);
 static int    init_cfg(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf);
+static int    create_fp7_builder(const ESL_GETOPTS *go, const ESL_ALPHABET *abc, char *errbuf, P7_BG **ret_bg, P7_BUILDER **ret_bld);
+static int    next_msa(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, ESL_MSA **ret_msa);
+static int    output_and_free(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, int msaidx, int cmidx, ESL_MSA *msa, CM_t *cm, Parsetree_t *mtr, Parsetree_t **tr);
 static int    process_build_workunit(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, ESL_MSA *msa, CM_t **ret_cm, Parsetree_t **ret_mtr, Parsetree_t ***ret_msa_tr);
 static int    output_result(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, int msaidx, int cmidx, ESL_MSA *msa, CM_t *cm, Parsetree_t *mtr, Parsetree_t **tr);
 static int    check_and_clean_msa(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, ESL_MSA *msa);
@@ -253,6 +318,13 @@ static int    dump_emission_info(FILE *fp, CM_t *cm, char *errbuf);
 static P7_PRIOR * p7_prior_Read(FILE *fp);
 static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
 
+#ifdef HMMER_THREADS
+static void   thread_master(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, int ncpus);
+static void   build_thread(void *arg);
+static int    align_block(const struct cfg_s *cfg, char *errbuf, CM_t *cm, ESL_SQ_BLOCK *sq_block, CM_ALNDATA ***ret_dataA);
+static void   align_thread(void *arg);
+#endif /*HMMER_THREADS*/
+
  int
  main(int argc, char **argv)
  {
@@ -283,6 +355,7 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
    cfg.r          = NULL;	           /* created (possibly) in init_cfg() */
    cfg.fp7_bg     = NULL;                   /* created (possibly) in init_cfg() */
    cfg.fp7_bld    = NULL;                   /* created (possibly) in init_cfg() */
+   cfg.calib_ncpus = 0;                     /* set in master() */
    /* optional output files, opened in init_cfg(), if at all */
    cfg.cfp        = NULL;
    cfg.escfp      = NULL;
@@ -294,6 +367,18 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
    cfg.cdfp       = NULL;
    cfg.refinefp   = NULL;
    cfg.rdfp       = NULL;
+   /* cluster MSAs, created in next_msa(), if at all */
+   cfg.cmsa       = NULL;
+   cfg.ncmsa      = 0;
+   cfg.cmsa_idx   = 0;
+#ifdef HMMER_THREADS
+   /* workers for --refine, created in master(), if at all */
+   cfg.ncpus         = 0;
+   cfg.align_threads = NULL;
+   cfg.align_queue   = NULL;
+   cfg.align_info    = NULL;
+   cfg.align_sqA     = NULL;
+#endif
 
    if (esl_opt_IsOn(go, "--informat")) {
      cfg.fmt = esl_msafile_EncodeFormat(esl_opt_GetString(go, "--informat"));
@@ -430,115 +515,547 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
    Parsetree_t  *new_mtr;
    Parsetree_t **new_tr;
    ESL_MSA      *new_msa;
-   /* cluster option related variables */
-   int          do_cluster; /* TRUE if --ctarget || --cmaxid || --call */
-   int          do_ctarget; /* TRUE if --ctarget */
-   int          do_cmindiff; /* TRUE if --cmaxid  */
-   int          do_call;    /* TRUE if --call */
-   int          nc;         /* number of clusters, only != 0 if do_ctarget */
-   float        mindiff;    /* minimum fractional diff b/t clusters, only != 0. if do_cmindiff */
-   int          ncm = 1;    /* number of CMs to be built for current MSA */
-   int          c   = 0;    /* counter over CMs built for a single MSA */
-   ESL_MSA    **cmsa;       /* pointer to cluster MSAs to build CMs from */
+   int          ncpus = 0;  /* number of worker threads */
+#ifdef HMMER_THREADS
+   int          k;          /* counter over workers */
+#endif
 
    if ((status = init_cfg(go, cfg, errbuf)) != eslOK) cm_Fail(errbuf);
+
+#ifdef HMMER_THREADS
+   if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+   else                           esl_threads_CPUCount(&ncpus);
+#endif
    output_header(cfg->ofp, go, cfg->cmfile, cfg->alifile);
+   /* when we build CMs one at a time, calibrate each filter HMM with all threads */
+   cfg->calib_ncpus = ncpus;
 
    cfg->nali = 0;
    cfg->ncm_total = 0;
 
-   do_ctarget  = esl_opt_IsOn(go, "--ctarget");
-   do_cmindiff = esl_opt_IsOn(go, "--cmaxid");
-   do_call     = esl_opt_GetBoolean(go, "--call");
-   do_cluster = (do_ctarget || do_cmindiff || do_call) ? TRUE : FALSE;
-   if((do_ctarget + do_cmindiff + do_call) > TRUE) cm_Fail("More than one of --ctarget, --cmaxid, --call were enabled, shouldn't happen.");
-
-   nc      = do_ctarget  ? esl_opt_GetInteger(go, "--ctarget")    : 0;
-   mindiff = do_cmindiff ? (1. - esl_opt_GetReal(go, "--cmaxid")) : 0.;
+#ifdef HMMER_THREADS
+   /* With threads, we build CMs from different MSAs in parallel,
+    * unless --refine is used, then we build them one at a time but
+    * realign the sequences in parallel at each iteration of the
+    * refinement. Verbose and --cfile output is written while each CM
+    * is being built, so with those we also build one at a time.
+    */
+   if (ncpus > 0 && (! esl_opt_IsOn(go, "--refine")) && (! cfg->be_verbose) && cfg->cfp == NULL) { 
+     thread_master(go, cfg, errbuf, ncpus);
+     if(cfg->fullmat != NULL) FreeMat(cfg->fullmat);
+     return;
+   }
+   /* with --gibbs, alignments are sampled with cfg->r, in order; don't realign in parallel */
+   if (ncpus > 0 && esl_opt_IsOn(go, "--refine") && (! esl_opt_GetBoolean(go, "--gibbs"))) { 
+     cfg->ncpus         = ncpus;
+     cfg->align_threads = esl_threads_Create(&align_thread);
+     cfg->align_queue   = esl_workqueue_Create(ncpus * 2);
+     ESL_ALLOC(cfg->align_info, sizeof(ALIGN_INFO) * ncpus);
+     ESL_ALLOC(cfg->align_sqA,  sizeof(ESL_SQ *)   * ncpus * 2);
+     for (k = 0; k < ncpus * 2; k++) { 
+       if((cfg->align_sqA[k] = esl_sq_CreateDigital(cfg->abc)) == NULL)                     cm_Fail("Failed to allocate a sequence");
+       if((status = esl_workqueue_Init(cfg->align_queue, cfg->align_sqA[k])) != eslOK) cm_Fail("Failed to add sequence to work queue");
+     }
+     for (k = 0; k < ncpus; k++) { 
+       cfg->align_info[k].queue  = cfg->align_queue;
+       cfg->align_info[k].cm     = NULL;
+       cfg->align_info[k].dataA  = NULL;
+       cfg->align_info[k].n      = 0;
+       cfg->align_info[k].mxsize = esl_opt_GetReal(go, "--mxsize");
+     }
+   }
+#endif
 
-   while ((status = esl_msafile_Read(cfg->afp, &msa)) != eslEOF)
+   while ((status = next_msa(go, cfg, errbuf, &msa)) == eslOK)
      {
-       if (status != eslOK) esl_msafile_ReadFailure(cfg->afp, status);
-       cfg->nali++;  
-
-       if(set_msa_name(go, cfg, errbuf, msa) != eslOK) cm_Fail(errbuf);
-       if(msa->name == NULL)                           cm_Fail("Error naming MSA");
-       ncm = 1;     /* default: only build 1 CM for each MSA in alignment file */
-
-       if(do_cluster) /* divide input MSA into clusters, and build CM from each cluster */
-	 {
-	   if((status = MSADivide(msa, do_call, do_cmindiff, do_ctarget, mindiff, nc,
-				  esl_opt_GetBoolean(go, "--corig"), &ncm, &cmsa, errbuf)) != eslOK) cm_Fail(errbuf);
-	   esl_msa_Destroy(msa); /* we've copied the master msa into cmsa[ncm], we can delete this copy */
-	 }
-       for(c = 0; c < ncm; c++)
-	 {
-	   cfg->ncm_total++;  
-	   if(do_cluster) {
-	       msa = cmsa[c];
-	       if(esl_opt_GetString(go, "--cdump") != NULL) { 
-		 if((status = esl_msafile_Write(cfg->cdfp, msa, eslMSAFILE_STOCKHOLM)) != eslOK)
-		   cm_Fail("--cdump related esl_msafile_Write() call failed.");
-	       }
-	   }
-
-	   /* if being verbose, print some stuff about what we're about to do.
-	    */
-	   if (cfg->be_verbose) {
-	     fprintf(cfg->ofp, "Alignment:           %s\n",           msa->name);
-	     fprintf(cfg->ofp, "Number of sequences: %d\n",           msa->nseq);
-	     fprintf(cfg->ofp, "Number of columns:   %" PRId64 "\n",  msa->alen);
-	     if(esl_opt_GetString(go, "--rsearch") != NULL)
-	       printf ("RIBOSUM Matrix:      %s\n",  cfg->fullmat->name);
-	     fputs("", cfg->ofp);
-	     fflush(cfg->ofp);
-	   }
-
-	   /* msa -> cm */
-	   if ((status = process_build_workunit(go, cfg, errbuf, msa, &cm, &mtr, &tr)) != eslOK) cm_Fail(errbuf);
-	   /* optionally, iterate over cm -> parsetrees -> msa -> cm ... until convergence, via EM or Gibbs */
-	   if ( esl_opt_IsOn(go, "--refine")) {
-	     fprintf(cfg->ofp, "#\n");
-	     fprintf(cfg->ofp, "# Refining MSA for CM: %s (aln: %4d cm: %6d)\n", cm->name, cfg->nali, cfg->ncm_total);
-	     if ((status = refine_msa(go, cfg, errbuf, cm, msa, tr, &new_cm, &new_msa, &new_mtr, &new_tr, &niter)) != eslOK) cm_Fail(errbuf);
-	     if(cm != new_cm) FreeCM(cm); 
-	     cm = new_cm; 
-	     if (niter > 1) { /* if niter == 1, we didn't make a new mtr, or tr, so we don't free them */
-	       for(i = 0; i < msa->nseq; i++) FreeParsetree(tr[i]);
-	       free(tr);
-	       tr = new_tr;
-	       FreeParsetree(mtr);
-	       mtr = new_mtr;
-	       esl_msa_Destroy(msa);
-	       msa = new_msa;
-	     } 
-	   }	  
-	   /* output cm */
-	   if ((status = output_result(go, cfg, errbuf, cfg->nali, cfg->ncm_total, msa,  cm, mtr, tr)) != eslOK) cm_Fail(errbuf);
-
-	   if(cfg->be_verbose) { 
-	     fprintf(cfg->ofp, "\n");
-	     SummarizeCM(cfg->ofp, cm);  
-	     fprintf(cfg->ofp, "//\n");
-	   }
-
-	   FreeCM(cm);
-	   fflush(cfg->cmoutfp);
-
-	   if(tr != NULL) {
-	     for(i = 0; i < msa->nseq; i++) FreeParsetree(tr[i]);
-	     free(tr);
-	   }
-	   if(mtr != NULL) FreeParsetree(mtr);
+       /* if being verbose, print some stuff about what we're about to do.
+	*/
+       if (cfg->be_verbose) {
+	 fprintf(cfg->ofp, "Alignment:           %s\n",           msa->name);
+	 fprintf(cfg->ofp, "Number of sequences: %d\n",           msa->nseq);
+	 fprintf(cfg->ofp, "Number of columns:   %" PRId64 "\n",  msa->alen);
+	 if(esl_opt_GetString(go, "--rsearch") != NULL)
+	   printf ("RIBOSUM Matrix:      %s\n",  cfg->fullmat->name);
+	 fputs("", cfg->ofp);
+	 fflush(cfg->ofp);
+       }
 
+       /* msa -> cm */
+       if ((status = process_build_workunit(go, cfg, errbuf, msa, &cm, &mtr, &tr)) != eslOK) cm_Fail(errbuf);
+       /* optionally, iterate over cm -> parsetrees -> msa -> cm ... until convergence, via EM or Gibbs */
+       if ( esl_opt_IsOn(go, "--refine")) {
+	 fprintf(cfg->ofp, "#\n");
+	 fprintf(cfg->ofp, "# Refining MSA for CM: %s (aln: %4d cm: %6d)\n", cm->name, cfg->nali, cfg->ncm_total);
+	 if ((status = refine_msa(go, cfg, errbuf, cm, msa, tr, &new_cm, &new_msa, &new_mtr, &new_tr, &niter)) != eslOK) cm_Fail(errbuf);
+	 if(cm != new_cm) FreeCM(cm); 
+	 cm = new_cm; 
+	 if (niter > 1) { /* if niter == 1, we didn't make a new mtr, or tr, so we don't free them */
+	   for(i = 0; i < msa->nseq; i++) FreeParsetree(tr[i]);
+	   free(tr);
+	   tr = new_tr;
+	   FreeParsetree(mtr);
+	   mtr = new_mtr;
 	   esl_msa_Destroy(msa);
-	 }
+	   msa = new_msa;
+	 } 
+       }	  
+       /* output cm */
+       if ((status = output_and_free(go, cfg, errbuf, cfg->nali, cfg->ncm_total, msa, cm, mtr, tr)) != eslOK) cm_Fail(errbuf);
      }
-   if(do_cluster) free(cmsa);
+   if (status != eslEOF) cm_Fail(errbuf);
+
+#ifdef HMMER_THREADS
+   if (cfg->align_threads != NULL) { 
+     esl_workqueue_Reset(cfg->align_queue);
+     for (k = 0; k < ncpus * 2; k++) esl_sq_Destroy(cfg->align_sqA[k]);
+     for (k = 0; k < ncpus; k++) if(cfg->align_info[k].cm != NULL) FreeCM(cfg->align_info[k].cm);
+     esl_workqueue_Destroy(cfg->align_queue);
+     esl_threads_Destroy(cfg->align_threads);
+     free(cfg->align_sqA);
+     free(cfg->align_info);
+     cfg->align_threads = NULL;
+   }
+#endif
    if(cfg->fullmat != NULL) FreeMat(cfg->fullmat);
    return;
+
+#ifdef HMMER_THREADS
+  ERROR:
+   cm_Fail("Memory allocation error.");
+   return;
+#endif
  }
 
+ /* next_msa()
+  * Read the next MSA to build a CM from into <*ret_msa>, name it and,
+  * if clustering (--ctarget, --cmaxid or --call), divide it into
+  * clusters, each of which we return in turn before reading the next
+  * MSA. Updates <cfg->nali> and <cfg->ncm_total>, the indices of the
+  * MSA in the file and of the CM we'll build.
+  *
+  * Returns eslOK on success, eslEOF if there are no more MSAs, or
+  * an error status with a message in <errbuf>.
+  */
+ static int
+ next_msa(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, ESL_MSA **ret_msa)
+ {
+   int      status;
+   ESL_MSA *msa = NULL;
+   int      do_ctarget  = esl_opt_IsOn(go, "--ctarget");
+   int      do_cmindiff = esl_opt_IsOn(go, "--cmaxid");
+   int      do_call     = esl_opt_GetBoolean(go, "--call");
+   int      nc          = do_ctarget  ? esl_opt_GetInteger(go, "--ctarget")    : 0;   /* number of clusters, only != 0 if do_ctarget */
+   float    mindiff     = do_cmindiff ? (1. - esl_opt_GetReal(go, "--cmaxid")) : 0.;  /* minimum fractional diff b/t clusters, only != 0. if do_cmindiff */
+
+   if((do_ctarget + do_cmindiff + do_call) > TRUE) ESL_FAIL(eslEINCOMPAT, errbuf, "More than one of --ctarget, --cmaxid, --call were enabled, shouldn't happen.");
+
+   /* read the next alignment, unless we have clusters left from the previous one */
+   if (cfg->cmsa == NULL || cfg->cmsa_idx == cfg->ncmsa) { 
+     if (cfg->cmsa != NULL) { free(cfg->cmsa); cfg->cmsa = NULL; }
+     if ((status = esl_msafile_Read(cfg->afp, &msa)) == eslEOF) { *ret_msa = NULL; return eslEOF; }
+     if (status != eslOK) esl_msafile_ReadFailure(cfg->afp, status);
+     cfg->nali++;  
+
+     if(set_msa_name(go, cfg, errbuf, msa) != eslOK) return eslFAIL;
+     if(msa->name == NULL)                           ESL_FAIL(eslFAIL, errbuf, "Error naming MSA");
+
+     if(do_ctarget || do_cmindiff || do_call) /* divide input MSA into clusters, and build CM from each cluster */
+       {
+	 if((status = MSADivide(msa, do_call, do_cmindiff, do_ctarget, mindiff, nc,
+				esl_opt_GetBoolean(go, "--corig"), &(cfg->ncmsa), &(cfg->cmsa), errbuf)) != eslOK) return status;
+	 esl_msa_Destroy(msa); /* we've copied the master msa into cmsa[ncm], we can delete this copy */
+	 cfg->cmsa_idx = 0;
+       }
+     else { /* default: only build 1 CM for each MSA in alignment file */
+       cfg->ncm_total++;
+       *ret_msa = msa;
+       return eslOK;
+     }
+   }
+
+   msa = cfg->cmsa[cfg->cmsa_idx++];
+   cfg->ncm_total++;
+   if(esl_opt_GetString(go, "--cdump") != NULL) { 
+     if((status = esl_msafile_Write(cfg->cdfp, msa, eslMSAFILE_STOCKHOLM)) != eslOK)
+       ESL_FAIL(status, errbuf, "--cdump related esl_msafile_Write() call failed.");
+   }
+   *ret_msa = msa;
+   return eslOK;
+ }
+
+ /* output_and_free()
+  * Output the CM <cm> built from <msa>, the <cmidx>'th CM, built
+  * from the <msaidx>'th alignment in the file, then free it, its
+  * guide tree <mtr>, parsetrees <tr> and <msa>.
+  */
+ static int
+ output_and_free(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, int msaidx, int cmidx, ESL_MSA *msa, CM_t *cm, Parsetree_t *mtr, Parsetree_t **tr)
+ {
+   int status;
+   int i;
+
+   if ((status = output_result(go, cfg, errbuf, msaidx, cmidx, msa, cm, mtr, tr)) != eslOK) return status;
+
+   if(cfg->be_verbose) { 
+     fprintf(cfg->ofp, "\n");
+     SummarizeCM(cfg->ofp, cm);  
+     fprintf(cfg->ofp, "//\n");
+   }
+
+   FreeCM(cm);
+   fflush(cfg->cmoutfp);
+
+   if(tr != NULL) {
+     for(i = 0; i < msa->nseq; i++) FreeParsetree(tr[i]);
+     free(tr);
+   }
+   if(mtr != NULL) FreeParsetree(mtr);
+
+   esl_msa_Destroy(msa);
+   return eslOK;
+ }
+
+#ifdef HMMER_THREADS
+ /* thread_master()
+  * Build CMs from the MSAs in parallel with <ncpus> worker threads,
+  * each building a CM from one MSA at a time. Up to 2*<ncpus> MSAs
+  * are read ahead and built at once; CMs are output in the same
+  * order as they would be without threads, each once it and all the
+  * CMs before it are built, so the CM file and the output are the
+  * same. We read one MSA ahead of those we dispatch, so if there's
+  * only a single CM to build, its worker can calibrate its filter
+  * HMM with <ncpus> threads while the other workers are idle.
+  */
+ static void
+ thread_master(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, int ncpus)
+ {
+   int              status;
+   int              i;
+   int              rstatus = eslOK;  /* status from next_msa() */
+   ESL_MSA         *msa     = NULL;   /* the MSA read ahead, NULL once we've read them all */
+   int              nali    = 0;      /* cfg->nali when <msa> was read */
+   int              ncm     = 0;      /* cfg->ncm_total when <msa> was read */
+   int              ndisp   = 0;      /* number of work units dispatched thus far, next one gets index <ndisp> */
+   int              nout    = 0;      /* number of CMs output thus far, CM <nout> is next to output */
+   BUILD_WORKUNIT  *wuA     = NULL;   /* [0..nwu-1] work units passed through the queue */
+   BUILD_WORKUNIT **idleA   = NULL;   /* [0..nidle-1] work units held by the master, ready to be filled */
+   BUILD_WORKUNIT **doneA   = NULL;   /* [0..nwu-1] built work units waiting to be output, unit <idx> is doneA[idx % nwu] */
+   BUILD_WORKUNIT  *wu      = NULL;   /* a work unit */
+   int              nwu     = 2 * ncpus; /* number of work units */
+   int              nidle   = 0;      /* number of work units in idleA */
+   int              nbusy   = 0;      /* number of work units dispatched and not yet returned */
+   void            *new_wu  = NULL;   /* work unit returned from the queue */
+   BUILD_INFO      *info    = NULL;   /* the worker info */
+   ESL_THREADS     *threadObj = NULL;
+   ESL_WORK_QUEUE  *queue     = NULL;
+
+   ESL_ALLOC(wuA,   sizeof(BUILD_WORKUNIT)   * nwu);
+   ESL_ALLOC(idleA, sizeof(BUILD_WORKUNIT *) * nwu);
+   ESL_ALLOC(doneA, sizeof(BUILD_WORKUNIT *) * nwu);
+   ESL_ALLOC(info,  sizeof(BUILD_INFO)       * ncpus);
+
+   threadObj = esl_threads_Create(&build_thread);
+   queue     = esl_workqueue_Create(nwu);
+   for(i = 0; i < nwu; i++) { 
+     wuA[i].idx = -1;
+     wuA[i].calib_ncpus = 0;
+     wuA[i].msa = NULL;
+     wuA[i].cm  = NULL;
+     wuA[i].mtr = NULL;
+     wuA[i].tr  = NULL;
+     doneA[i]   = NULL;
+     if((status = esl_workqueue_Init(queue, &(wuA[i]))) != eslOK) cm_Fail("Failed to add work unit to work queue");
+   }
+   /* each worker gets its own copy of the configuration, with its
+    * own p7 filter background and builder, which are modified while
+    * building a filter HMM
+    */
+   for(i = 0; i < ncpus; i++) { 
+     info[i].queue = queue;
+     info[i].go    = go;
+     info[i].cfg   = *cfg;
+     if((status = create_fp7_builder(go, cfg->abc, errbuf, &(info[i].cfg.fp7_bg), &(info[i].cfg.fp7_bld))) != eslOK) cm_Fail(errbuf);
+     esl_threads_AddThread(threadObj, &info[i]);
+   }
+   esl_threads_WaitForStart(threadObj);
+
+   if((rstatus = next_msa(go, cfg, errbuf, &msa)) != eslOK && rstatus != eslEOF) cm_Fail(errbuf);
+   nali = cfg->nali;
+   ncm  = cfg->ncm_total;
+
+   for(;;) { 
+     /* dispatch the MSA we read ahead and read the next one, if we've got a work unit to put it in */
+     if(msa != NULL && nidle > 0) { 
+       wu = idleA[--nidle];
+       wu->idx  = ndisp++;
+       wu->nali = nali;
+       wu->ncm  = ncm;
+       wu->msa  = msa;
+       if((rstatus = next_msa(go, cfg, errbuf, &msa)) != eslOK && rstatus != eslEOF) cm_Fail(errbuf);
+       nali = cfg->nali;
+       ncm  = cfg->ncm_total;
+       /* if this is the only CM, no other worker will be busy */
+       wu->calib_ncpus = (wu->idx == 0 && msa == NULL) ? ncpus : 0;
+       if((status = esl_workqueue_ReaderUpdate(queue, wu, NULL)) != eslOK) cm_Fail("Work queue reader failed");
+       nbusy++;
+       continue;
+     }
+     if(msa == NULL && nbusy == 0) break;
+
+     /* wait for a work unit, either unused or returned by a worker */
+     if((status = esl_workqueue_ReaderUpdate(queue, NULL, &new_wu)) != eslOK) cm_Fail("Work queue reader failed");
+     wu = (BUILD_WORKUNIT *) new_wu;
+     if(wu->idx == -1) { idleA[nidle++] = wu; continue; }
+
+     doneA[wu->idx % nwu] = wu;
+     nbusy--;
+     /* output all built CMs we can, in order */
+     while((wu = doneA[nout % nwu]) != NULL && wu->idx == nout) { 
+       if((status = output_and_free(go, cfg, errbuf, wu->nali, wu->ncm, wu->msa, wu->cm, wu->mtr, wu->tr)) != eslOK) cm_Fail(errbuf);
+       doneA[nout % nwu] = NULL;
+       wu->idx = -1;
+       wu->msa = NULL;
+       wu->cm  = NULL;
+       wu->mtr = NULL;
+       wu->tr  = NULL;
+       idleA[nidle++] = wu;
+       nout++;
+     }
+   }
+
+   /* send a work unit with no work to all workers signaling them to stop */
+   for(i = 0; i < ncpus; i++) { 
+     if(nidle == 0) { 
+       if((status = esl_workqueue_ReaderUpdate(queue, NULL, &new_wu)) != eslOK) cm_Fail("Work queue reader failed");
+       idleA[nidle++] = (BUILD_WORKUNIT *) new_wu;
+     }
+     wu = idleA[--nidle];
+     wu->idx = -1;
+     if((status = esl_workqueue_ReaderUpdate(queue, wu, NULL)) != eslOK) cm_Fail("Work queue reader failed");
+   }
+   esl_threads_WaitForFinish(threadObj);
+   esl_workqueue_Complete(queue);  
+
+   esl_workqueue_Reset(queue); 
+   esl_workqueue_Destroy(queue);
+   esl_threads_Destroy(threadObj);
+   for(i = 0; i < ncpus; i++) { 
+     p7_bg_Destroy(info[i].cfg.fp7_bg);
+     p7_builder_Destroy(info[i].cfg.fp7_bld);
+   }
+   free(info);
+   free(wuA);
+   free(idleA);
+   free(doneA);
+   return;
+
+  ERROR:
+   cm_Fail("Memory allocation error.");
+   return;
+ }
+
+ /* build_thread()
+  * 
+  * Receive a work unit from the master, build a 
+  * CM from its MSA and store it in the work unit.
+  */
+ static void 
+ build_thread(void *arg)
+ {
+   int             status;
+   int             workeridx;
+   BUILD_INFO     *info;
+   ESL_THREADS    *obj;
+   BUILD_WORKUNIT *wu = NULL;
+   void           *new_wu;
+   char            errbuf[eslERRBUFSIZE];
+
+#ifdef HAVE_FLUSH_ZERO_MODE
+   /* In order to avoid the performance penalty dealing with sub-normal
+    * values in the floating point calculations, set the processor flag
+    * so sub-normals are "flushed" immediately to zero.
+    * On OS X, need to reset this flag for each thread
+    * (see TW notes 05/08/10 for details)
+    */
+   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+
+   obj = (ESL_THREADS *) arg;
+   esl_threads_Started(obj, &workeridx);
+
+   info = (BUILD_INFO *) esl_threads_GetData(obj, workeridx);
+
+   status = esl_workqueue_WorkerUpdate(info->queue, NULL, &new_wu);
+   if (status != eslOK) cm_Fail("Work queue worker failed");
+
+   /* loop until we receive a work unit with no work */
+   wu = (BUILD_WORKUNIT *) new_wu;
+   while (wu->idx != -1) { 
+     /* error messages refer to the alignment by its index in the file */
+     info->cfg.nali      = wu->nali;
+     info->cfg.ncm_total = wu->ncm;
+     info->cfg.calib_ncpus = wu->calib_ncpus;
+     if((status = process_build_workunit(info->go, &(info->cfg), errbuf, wu->msa, &(wu->cm), &(wu->mtr), &(wu->tr))) != eslOK) cm_Fail(errbuf);
+
+     status = esl_workqueue_WorkerUpdate(info->queue, wu, &new_wu);
+     if (status != eslOK) cm_Fail("Work queue worker failed");
+     wu = (BUILD_WORKUNIT *) new_wu;
+   }
+
+   status = esl_workqueue_WorkerUpdate(info->queue, wu, NULL);
+   if (status != eslOK) cm_Fail("Work queue worker failed");
+
+   esl_threads_Finished(obj, workeridx);
+   return;
+ }
+
+ /* align_block()
+  * Align the sequences in <sq_block> to <cm> in parallel with the
+  * <cfg->ncpus> worker threads set up in master() for --refine, each
+  * aligning one sequence at a time with its own clone of <cm>. The
+  * same as DispatchSqBlockAlignment(), which we use without threads:
+  * <*ret_dataA> is a newly created array of the alignment data for
+  * each sequence, in the order of <sq_block>.
+  *
+  * Returns eslOK on success, or an error status with a message in
+  * <errbuf>.
+  */
+ static int
+ align_block(const struct cfg_s *cfg, char *errbuf, CM_t *cm, ESL_SQ_BLOCK *sq_block, CM_ALNDATA ***ret_dataA)
+ {
+   int          status;
+   int          i, k;           /* counters over sequences, workers */
+   ESL_SQ      *sq       = NULL;
+   void        *new_sq   = NULL;
+   ESL_SQ      *empty_sq = NULL;
+   CM_ALNDATA **dataA    = NULL;
+   ALIGN_INFO  *info     = cfg->align_info;
+
+   ESL_ALLOC(dataA, sizeof(CM_ALNDATA *) * ESL_MAX(1, sq_block->count)); // avoid 0 malloc
+   for(i = 0; i < sq_block->count; i++) dataA[i] = NULL;
+
+   /* the CM changes at each iteration of the refinement, give each worker a clone of it */
+   for(k = 0; k < cfg->ncpus; k++) { 
+     if(info[k].cm != NULL) FreeCM(info[k].cm);
+     info[k].cm = NULL;
+     if((status = cm_Clone(cm, errbuf, &(info[k].cm))) != eslOK) goto ERROR;
+   }
+   for(k = 0; k < cfg->ncpus; k++) esl_threads_AddThread(cfg->align_threads, &(info[k]));
+
+   esl_workqueue_Reset(cfg->align_queue);
+   esl_threads_WaitForStart(cfg->align_threads);
+
+   status = esl_workqueue_ReaderUpdate(cfg->align_queue, NULL, &new_sq);
+   if (status != eslOK) cm_Fail("Work queue reader failed");
+
+   for(i = 0; i < sq_block->count; i++) { 
+     sq    = sq_block->list + i;
+     sq->W = sq_block->first_seqidx + i; 
+     /* we overload sq->W w/seqidx (the original value is irrelevant in this context) */
+     status = esl_workqueue_ReaderUpdate(cfg->align_queue, sq, &new_sq);
+     if (status != eslOK) cm_Fail("Work queue reader failed");
+   }
+
+   /* now send a empty sq to all workers signaling them to stop */
+   empty_sq = esl_sq_Create();
+   for(k = 0; k < cfg->ncpus; k++) { 
+     status = esl_workqueue_ReaderUpdate(cfg->align_queue, empty_sq, &new_sq);
+     if (status != eslOK) cm_Fail("Work queue reader failed");
+   }
+   status = esl_workqueue_ReaderUpdate(cfg->align_queue, new_sq, NULL);
+
+   /* wait for all the threads to complete */
+   esl_threads_WaitForFinish(cfg->align_threads);
+   esl_workqueue_Complete(cfg->align_queue);  
+   esl_sq_Destroy(empty_sq);
+
+   /* collect the workers' alignment data in the original (input) order */
+   for(k = 0; k < cfg->ncpus; k++) { 
+     for(i = 0; i < info[k].n; i++) dataA[info[k].dataA[i]->idx - sq_block->first_seqidx] = info[k].dataA[i];
+     if(info[k].dataA != NULL) free(info[k].dataA);
+     info[k].dataA = NULL;
+     info[k].n     = 0;
+   }
+
+   *ret_dataA = dataA;
+   return eslOK;
+
+  ERROR:
+   if(dataA != NULL) free(dataA);
+   *ret_dataA = NULL;
+   if(status == eslEMEM) ESL_FAIL(status, errbuf, "align_block(), out of memory");
+   return status;
+ }
+
+ /* align_thread()
+  * 
+  * Receive sequences from the master, align 
+  * them and store their alignment data.
+  */
+ static void 
+ align_thread(void *arg)
+ {
+   int          status;
+   int          j;
+   int          workeridx;
+   ALIGN_INFO  *info;
+   ESL_THREADS *obj;
+   ESL_SQ      *sq = NULL;
+   void        *new_sq = NULL;
+   char         errbuf[eslERRBUFSIZE];
+   int          nalloc    = 0;
+   int          allocsize = 1000;
+
+#ifdef HAVE_FLUSH_ZERO_MODE
+   /* In order to avoid the performance penalty dealing with sub-normal
+    * values in the floating point calculations, set the processor flag
+    * so sub-normals are "flushed" immediately to zero.
+    * On OS X, need to reset this flag for each thread
+    * (see TW notes 05/08/10 for details)
+    */
+   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+
+   obj = (ESL_THREADS *) arg;
+   esl_threads_Started(obj, &workeridx);
+
+   info = (ALIGN_INFO *) esl_threads_GetData(obj, workeridx);
+
+   status = esl_workqueue_WorkerUpdate(info->queue, NULL, &new_sq);
+   if (status != eslOK) cm_Fail("Work queue worker failed");
+
+   /* loop until all sequences have been processed, as DispatchSqBlockAlignment() does */
+   sq = (ESL_SQ *) new_sq;
+   while (sq->L != -1) { 
+     if(info->n == nalloc) { 
+       ESL_REALLOC(info->dataA, sizeof(CM_ALNDATA *) * (nalloc + allocsize));
+       for(j = nalloc; j < nalloc + allocsize; j++) info->dataA[j] = NULL;
+       nalloc += allocsize;
+     }
+     /* sq->W has been overloaded, it is the sequence index, defined in align_block() */
+     status = DispatchSqAlignment(info->cm, errbuf, sq, sq->W, info->mxsize, TRMODE_UNKNOWN, 
+				  (info->cm->align_opts & CM_ALIGN_TRUNC) ? PLI_PASS_5P_AND_3P_FORCE : PLI_PASS_STD_ANY, 
+				  FALSE, NULL, NULL, NULL, &(info->dataA[info->n])); /* FALSE: info->cm->cp9b not valid */
+     if(status != eslOK) cm_Fail(errbuf);
+     info->n++;
+
+     status = esl_workqueue_WorkerUpdate(info->queue, sq, &new_sq);
+     if (status != eslOK) cm_Fail("Work queue worker failed");
+     sq = (ESL_SQ *) new_sq;
+   }
+
+   status = esl_workqueue_WorkerUpdate(info->queue, sq, NULL);
+   if (status != eslOK) cm_Fail("Work queue worker failed");
+
+   esl_threads_Finished(obj, workeridx);
+   return;
+
+  ERROR:
+   cm_Fail("out of memory");
+   return; /* NEVERREACHED */
+ }
+#endif /*HMMER_THREADS*/
+
 
  static void
  process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfile, char **ret_alifile)
@@ -726,6 +1243,9 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
   if (esl_opt_IsUsed(go, "--pend"))        { fprintf(ofp, "# aggregate probability of local end:                 %g\n", esl_opt_GetReal(go, "--pend")); }
   if (esl_opt_IsUsed(go, "--pebegin"))     { fprintf(ofp, "# set all local begins as equiprobable:               yes\n"); }
   if (esl_opt_IsUsed(go, "--pfend"))       { fprintf(ofp, "# set all local end probs to:                         %g\n", esl_opt_GetReal(go, "--pfend")); }
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--cpu"))         { fprintf(ofp, "# number of worker threads:                           %d\n", esl_opt_GetInteger(go, "--cpu")); }
+#endif
 
    fprintf(ofp, "# - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -\n");
 
@@ -832,26 +1352,7 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
      }
 
    /* set up objects for building additional p7 models to filter with, if nec */
-   cfg->fp7_bg = p7_bg_Create(cfg->abc);
-   /* create the P7_BUILDER, pass NULL as the <go> argument, this sets all parameters to default */
-   cfg->fp7_bld = p7_builder_Create(NULL, cfg->abc);
-   cfg->fp7_bld->w_len = -1;
-   cfg->fp7_bld->w_beta = p7_DEFAULT_WINDOW_BETA;
-   if(esl_opt_IsUsed(go, "--p7prior")) {
-     FILE *pfp;
-     if (cfg->fp7_bld->prior != NULL) p7_prior_Destroy(cfg->fp7_bld->prior);
-     if ((pfp = fopen(esl_opt_GetString(go, "--p7prior"), "r")) == NULL) cm_Fail("Failed to open p7 prior file %s\n", esl_opt_GetString(go, "--p7prior"));
-     if((cfg->fp7_bld->prior = p7_prior_Read(pfp)) == NULL) {
-       cm_Fail("Failed to parse p7 prior file %s\n", esl_opt_GetString(go, "--p7prior"));
-     }
-     fclose(pfp);
-   }
-   else if(! esl_opt_GetBoolean(go, "--p7hprior")) { 
-     /* create the default Infernal p7 prior */
-     if (cfg->fp7_bld->prior != NULL) p7_prior_Destroy(cfg->fp7_bld->prior);
-     cfg->fp7_bld->prior = cm_p7_prior_CreateNucleic();
-   }
-   cfg->fp7_bld->re_target = esl_opt_IsOn(go, "--p7ere") ?  esl_opt_GetReal(go, "--p7ere") : DEFAULT_ETARGET_HMMFILTER;
+   if((status = create_fp7_builder(go, cfg->abc, errbuf, &(cfg->fp7_bg), &(cfg->fp7_bld))) != eslOK) return status;
 
    /* open output files */
    /* optionally, open count vector file */
@@ -918,6 +1419,44 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
    return eslOK;
  }
 
+ /* create_fp7_builder()
+  * Create the background model <*ret_bg> and P7_BUILDER <*ret_bld>
+  * used for building and calibrating the additional p7 filter HMMs.
+  * Both are modified as each filter HMM is built, so each worker
+  * thread creates its own.
+  */
+ static int
+ create_fp7_builder(const ESL_GETOPTS *go, const ESL_ALPHABET *abc, char *errbuf, P7_BG **ret_bg, P7_BUILDER **ret_bld)
+ {
+   P7_BG      *bg  = NULL;
+   P7_BUILDER *bld = NULL;
+
+   if((bg = p7_bg_Create(abc)) == NULL) ESL_FAIL(eslEMEM, errbuf, "Failed to create p7 background model: probably out of memory");
+   /* create the P7_BUILDER, pass NULL as the <go> argument, this sets all parameters to default */
+   if((bld = p7_builder_Create(NULL, abc)) == NULL) ESL_FAIL(eslEMEM, errbuf, "Failed to create p7 builder: probably out of memory");
+   bld->w_len = -1;
+   bld->w_beta = p7_DEFAULT_WINDOW_BETA;
+   if(esl_opt_IsUsed(go, "--p7prior")) {
+     FILE *pfp;
+     if (bld->prior != NULL) p7_prior_Destroy(bld->prior);
+     if ((pfp = fopen(esl_opt_GetString(go, "--p7prior"), "r")) == NULL) cm_Fail("Failed to open p7 prior file %s\n", esl_opt_GetString(go, "--p7prior"));
+     if((bld->prior = p7_prior_Read(pfp)) == NULL) {
+       cm_Fail("Failed to parse p7 prior file %s\n", esl_opt_GetString(go, "--p7prior"));
+     }
+     fclose(pfp);
+   }
+   else if(! esl_opt_GetBoolean(go, "--p7hprior")) { 
+     /* create the default Infernal p7 prior */
+     if (bld->prior != NULL) p7_prior_Destroy(bld->prior);
+     bld->prior = cm_p7_prior_CreateNucleic();
+   }
+   bld->re_target = esl_opt_IsOn(go, "--p7ere") ?  esl_opt_GetReal(go, "--p7ere") : DEFAULT_ETARGET_HMMFILTER;
+
+   *ret_bg  = bg;
+   *ret_bld = bld;
+   return eslOK;
+ }
+
  /* A work unit consists of one multiple alignment, <msa>.
   * The job is to turn it into a new CM, returned in <*ret_cm>.
   * 
@@ -1072,6 +1611,12 @@ static P7_PRIOR * cm_p7_prior_CreateNucleic(void);
        }
 
        /* 1. cm -> parsetrees */
+#ifdef HMMER_THREADS
+       if(cfg->ncpus > 0) { 
+	 if((status = align_block(cfg, errbuf, cm, sq_block, &dataA)) != eslOK) return status;
+       }
+       else
+#endif
        if((status = DispatchSqBlockAlignment(cm, errbuf, sq_block, esl_opt_GetReal(go, "--mxsize"), NULL, NULL, cfg->r, &dataA)) != eslOK) return status;
 
        /* sum parse scores and check for convergence */
@@ -2089,12 +2634,13 @@ build_and_calibrate_p7_filter(const ESL_GETOPTS *go, const struct cfg_s *cfg, ch
   }
 
   /* calibrate the HMM filter */
-  if((status = cm_p7_Calibrate(fhmm, errbuf, 
-			       lmsvL, lvitL, lfwdL, gfwdL,                 /* length of sequences to search for local (lL) and glocal (gL) modes */    
-			       lmsvN, lvitN, lfwdN, gfwdN,                 /* number of seqs to search for each alg */
-			       lftailp,                                    /* fraction of tail mass to fit for local Fwd */
-			       gftailp,                                    /* fraction of tail mass to fit for glocal Fwd */
-			       &agfmu, &agflambda))  
+  if((status = cm_p7_CalibrateParallel(fhmm, errbuf, 
+				       lmsvL, lvitL, lfwdL, gfwdL,                 /* length of sequences to search for local (lL) and glocal (gL) modes */    
+				       lmsvN, lvitN, lfwdN, gfwdN,                 /* number of seqs to search for each alg */
+				       lftailp,                                    /* fraction of tail mass to fit for local Fwd */
+				       gftailp,                                    /* fraction of tail mass to fit for glocal Fwd */
+				       cfg->calib_ncpus,                           /* number of threads */
+				       &agfmu, &agflambda))  
      != eslOK) ESL_FAIL(status, errbuf, "Error calibrating additional p7 HMM");
 
   if((status = cm_p7_hmm_SetConsensus(fhmm)) != eslOK) ESL_FAIL(status, errbuf, "Unable to set the HMM filter consensus annotation");
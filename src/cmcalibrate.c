@@ -62,8 +62,71 @@ typedef struct {
   int64_t           nhits;     /* number of hits in scA                   */
   float             cutoff;    /* minimum hit score to keep               */
   int               nequals;   /* number of '=' to print for current mode */
+  int               cm_id;     /* w/--multi: 2*cmi + (1 if local), identifies CM <cm> was cloned from, -1 if none */
 } WORKER_INFO;
 
+/* CKPT_MODE: the scores of the hits found in the search of one model
+ * in one exp tail mode, saved to the checkpoint file with --ckpt and
+ * read back with --resume, so a resumed calibration can skip the search.
+ */
+typedef struct {
+  int               cmi;       /* index of the model, 0..ncm-1            */
+  int               exp_mode;  /* exp tail mode, 0..EXP_NMODES-1          */
+  char             *name;      /* name of the model                       */
+  int               nsearched; /* number of sequences searched            */
+  int64_t           nhits;     /* number of hits in scA                   */
+  float            *scA;       /* [0..nhits-1] scores of hits             */
+} CKPT_MODE;
+
+#define CKPT_MAGIC 0xe3f9c6d5  /* first four bytes of a cmcalibrate checkpoint file */
+
+#ifdef HMMER_THREADS
+/* w/--multi, models are calibrated concurrently. Each model's random
+ * sequences are split into chunks for each of the EXP_NMODES modes,
+ * and each (model, mode, chunk) triplet is a task. The master keeps
+ * up to <nwindow> models loaded at once, dispatches pending tasks
+ * most expensive first (by the forecast_time() cost model), and fits
+ * each model's histograms in file order once all of its tasks are
+ * complete.
+ */
+typedef struct {
+  int             cmi;         /* index of this CM in the CM file */
+  CM_t           *gcm;         /* CM configured for glocal modes */
+  CM_t           *lcm;         /* CM configured for local modes */
+  ESL_SQ_BLOCK   *sq_block;    /* sequences to search, maybe shared by all models */
+  int             owns_block;  /* TRUE if we must free <sq_block> with this model */
+  double          psec;        /* predicted running time, from forecast_time() */
+  int             nper;        /* number of sequences per task */
+  int             nchunks;     /* number of tasks per mode */
+  float         **scAA;        /* [0..EXP_NMODES*nchunks-1] hit scores from each task, in sequence order */
+  int64_t        *nhitsA;      /* [0..EXP_NMODES*nchunks-1] number of hits in each scAA[] */
+  int             nleft;       /* number of tasks not yet completed */
+  int             is_started;  /* TRUE once first task has been dispatched */
+  ESL_STOPWATCH  *w;           /* times model from first dispatched task until it is fit */
+} MULTI_MODEL;
+
+typedef struct {
+  int             cmi;         /* index of CM */
+  int             exp_mode;    /* exp tail mode */
+  int             chunk;       /* chunk index, sequences chunk*nper..(chunk+1)*nper-1 */
+  double          cost;        /* predicted running time of this task */
+} MULTI_TASK;
+
+typedef struct {
+  int             cmi;         /* index of CM, -1 if this unit carries no work */
+  int             exp_mode;    /* exp tail mode */
+  int             chunk;       /* chunk index */
+  CM_t           *cm;          /* master's configured CM, cloned (not modified) by worker */
+  ESL_SQ_BLOCK   *sq_block;    /* sequences to search */
+  int             sidx;        /* first sequence in sq_block->list to search */
+  int             eidx;        /* one past final sequence to search */
+  float          *scA;         /* scores of hits found */
+  int64_t         nhits;       /* number of hits in scA */
+} MULTI_WORKUNIT;
+
+#define MULTI_TASK_SEC 2.0  /* target predicted single CPU running time of a --multi task, in seconds */
+#endif /*HMMER_THREADS*/
+
 #if defined (HMMER_THREADS) && defined (HAVE_MPI)
 #define CPUOPTS "--mpi,--forecast,--memreq"
 #define MPIOPTS "--cpu,--forecast,--memreq"
@@ -72,6 +135,26 @@ typedef struct {
 #define MPIOPTS "--forecast,--memreq"
 #endif
 
+#if   defined (HMMER_THREADS) && defined (HAVE_MPI)
+#define ADAPTOPTS "--mpi,--multi"
+#elif defined (HMMER_THREADS)
+#define ADAPTOPTS "--multi"
+#elif defined (HAVE_MPI)
+#define ADAPTOPTS "--mpi"
+#else
+#define ADAPTOPTS NULL
+#endif
+
+#if   defined (HMMER_THREADS) && defined (HAVE_MPI)
+#define CKPTOPTS "--mpi,--multi,--forecast,--memreq"
+#elif defined (HMMER_THREADS)
+#define CKPTOPTS "--multi,--forecast,--memreq"
+#elif defined (HAVE_MPI)
+#define CKPTOPTS "--mpi,--forecast,--memreq"
+#else
+#define CKPTOPTS "--forecast,--memreq"
+#endif
+
 static ESL_OPTIONS options[] = {
   /* name                  type    default   env             range    toggles         reqs      incomp  help  docgroup*/
   { "-h",           eslARG_NONE,     FALSE,  NULL,            NULL,      NULL,         NULL,      NULL, "show brief help on version and usage",         1 },
@@ -85,6 +168,7 @@ static ESL_OPTIONS options[] = {
   { "--gtailn",     eslARG_INT,       "250", NULL,        "n>=100",      NULL,         NULL, "--tailp", "fit the top <n> hits/Mb in histogram for glocal modes [df: 250]", 3 },
   { "--ltailn",     eslARG_INT,       "750", NULL,        "n>=100",      NULL,         NULL, "--tailp", "fit the top <n> hits/Mb in histogram for  local modes [df: 750]", 3 },
   { "--tailp",      eslARG_REAL,       NULL, NULL,     "0.0<x<0.6",      NULL,         NULL,      NULL, "set fraction of histogram tail to fit to exp tail to <x>",        3 },
+  { "--adapt",      eslARG_REAL,       NULL, NULL,       "0.<x<1.",      NULL,         NULL, ADAPTOPTS, "stop each mode once lambda's 95% CI is within <x> (-L is max)",  3 },
   /* Optional output files */
   { "--hfile",      eslARG_OUTFILE,    NULL, NULL,            NULL,      NULL,         NULL,      NULL, "save fitted score histogram(s) to file <f>",            4 },
   { "--sfile",      eslARG_OUTFILE,    NULL, NULL,            NULL,      NULL,         NULL,      NULL, "save survival plot to file <f>",                        4 },
@@ -98,8 +182,11 @@ static ESL_OPTIONS options[] = {
   { "--nonull3",    eslARG_NONE,      FALSE, NULL,            NULL,      NULL,         NULL,      NULL, "turn OFF the NULL3 post hoc additional null model",           5 },
   { "--random",     eslARG_NONE,       NULL, NULL,            NULL,      NULL,         NULL,      NULL, "use GC content of random null background model of CM",        5 },
   { "--gc",         eslARG_INFILE,     NULL, NULL,            NULL,      NULL,         NULL,      NULL, "use GC content distribution from file <f>",                   5 },
+  { "--ckpt",       eslARG_OUTFILE,    NULL, NULL,            NULL,      NULL,         NULL,  CKPTOPTS, "save scores of each model/mode to checkpoint file <f>",       5 },
+  { "--resume",     eslARG_NONE,      FALSE, NULL,            NULL,      NULL,     "--ckpt",      NULL, "w/--ckpt, resume calibration from checkpoint file <f>",       5 },
 #ifdef HMMER_THREADS 
   { "--cpu",        eslARG_INT,     NULL,"INFERNAL_NCPU",   "n>=0",      NULL,         NULL,   CPUOPTS, "number of parallel CPU workers to use for multithreads",            5 },
+  { "--multi",      eslARG_NONE,    FALSE,  NULL,      NULL,      NULL,        NULL,     CPUOPTS, "calibrate multiple models and modes concurrently",                  5 },
 #endif
 #ifdef HAVE_MPI
   { "--mpi",        eslARG_NONE,    FALSE,  NULL,      NULL,      NULL,        NULL,     MPIOPTS, "run as an MPI parallel program",                                    5 },  
@@ -157,6 +244,7 @@ struct cfg_s {
   FILE            *qfp;               /* optional output for exp tail QQ file */
   FILE            *ffp;               /* optional output for exp tail fit file */
   FILE            *xfp;               /* optional output for exp tail fit scores */
+  int              do_wallclock;      /* TRUE to time forecasts with elapsed time (w/--multi, other threads are busy) */
 };
 
 static char usage[]  = "[-options] <cmfile>";
@@ -169,6 +257,12 @@ static int  serial_loop  (WORKER_INFO *info, char *errbuf, ESL_SQ_BLOCK *sq_bloc
 #define BLOCK_SIZE 150
 static int  thread_loop(WORKER_INFO *info, char *errbuf, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQ_BLOCK *sq_block);
 static void pipeline_thread(void *arg);
+static void multi_master(ESL_GETOPTS *go, struct cfg_s *cfg);
+static void multi_thread(void *arg);
+static int  multi_load_model(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, CM_t *cm, int ncpus, int available_ncpus, ESL_SQ_BLOCK *shared_block, 
+			     MULTI_MODEL **ret_mdl, MULTI_TASK **taskA, int *ntasks, int *ntalloc);
+static int  multi_fit_model(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, MULTI_MODEL *mdl);
+static void multi_free_model(MULTI_MODEL *mdl);
 #endif /*HMMER_THREADS*/
 
 #ifdef HAVE_MPI
@@ -189,7 +283,12 @@ static int  init_master_cfg (const ESL_GETOPTS *go, struct cfg_s *cfg, char *err
 static int  init_shared_cfg (const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf);
 static int  initialize_cm   (const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, CM_t *cm, int do_local);
 static int  initialize_stats(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf);
-static int  fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *scores, int nscores, int exp_mode, double *ret_mu, double *ret_lambda, int *ret_nrandhits, float *ret_tailp);
+static int  fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *scores, int nscores, int nseq, int exp_mode, double *ret_mu, double *ret_lambda, int *ret_nrandhits, float *ret_tailp);
+static int  adapt_search_length(const ESL_GETOPTS *go, const struct cfg_s *cfg, int64_t nhits, int nseq, int exp_mode);
+static int  ckpt_open(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, CKPT_MODE ***ret_modeA, int *ret_nmode, FILE **ret_fp);
+static int  ckpt_write_mode(FILE *fp, int cmi, int exp_mode, char *name, int nsearched, int64_t nhits, float *scA);
+static int  ckpt_read_mode(FILE *fp, CKPT_MODE **ret_mode);
+static void ckpt_free_mode(CKPT_MODE *mode);
 static int  get_random_dsq(const struct cfg_s *cfg, char *errbuf, CM_t *cm, int L, ESL_RANDOMNESS *r, ESL_DSQ **ret_dsq);
 static int  set_dnull(struct cfg_s *cfg, CM_t *cm, char *errbuf);
 static void print_calibration_column_headings(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, CM_t *cm, int available_ncpus);
@@ -246,6 +345,7 @@ main(int argc, char **argv)
   cfg.qfp          = NULL; /* remains NULL for mpi workers */
   cfg.ffp          = NULL; /* remains NULL for mpi workers */
   cfg.xfp          = NULL; /* remains NULL for mpi workers */
+  cfg.do_wallclock = FALSE;
 
   ESL_ALLOC(cfg.expAA,  sizeof(ExpInfo_t **) * cfg.cmalloc); /* this will grow if needed */
   ESL_ALLOC(cfg.namesA, sizeof(char       *) * cfg.cmalloc); /* this will grow if needed */
@@ -299,6 +399,10 @@ main(int argc, char **argv)
   else
 #endif /*HAVE_MPI*/
     {
+#ifdef HMMER_THREADS
+      if(esl_opt_GetBoolean(go, "--multi")) multi_master(go, &cfg);
+      else
+#endif
       serial_master(go, &cfg);
     }
 
@@ -357,6 +461,9 @@ main(int argc, char **argv)
     if (sigprocmask(SIG_UNBLOCK, &blocksigs, NULL) != 0) cm_Fail("system error during rewrite of CM file.");
     free(cfg.tmpfile);
     cfg.tmpfile = NULL;
+
+    /* the calibrated CM file is saved, we won't need the checkpoint */
+    if (esl_opt_IsOn(go, "--ckpt")) remove(esl_opt_GetString(go, "--ckpt"));
     
     /* master specific cleaning */
     if (cfg.hfp || cfg.sfp || cfg.qfp || cfg.ffp || cfg.xfp) printf("#\n");
@@ -446,6 +553,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   double   total_asec   = 0.;     /* actual    number of seconds for calibrating all CMs */
   int      ncpus        = 0;      /* number of CPUs working */
   int      nequals;               /* number of '=' to output to progress bar for this mode */
+  int      nprinted;              /* number of '=' printed thus far for this mode */
   int64_t  merged_nhits = 0;      /* number of hits reported thus far, for all seqs */
   float   *merged_scA = NULL;     /* [0..merged_nhits-1] hit scores for all seqs */
   int      ins_v_cyk;             /* ratio of predicted inside versus cyk running time */
@@ -453,7 +561,14 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   int      tmp_nrandhits;         /* temporary number of rand hits found */
   float    tmp_tailp;             /* temporary tail mass probability fit to an exponential */
   int      available_ncpus = 1;   /* number of CPUs available */
+  int      nsearched;             /* number of sequences searched thus far in this mode */
+  int      nseq;                  /* number of sequences to have searched after current round, 0 when done */
   ESL_SQ_BLOCK *sq_block  = NULL; /* block of sequences */
+  ESL_SQ_BLOCK  round_block;      /* view of the sequences in sq_block to search in current round */
+  FILE         *ckpt_fp    = NULL; /* open checkpoint file, only if --ckpt */
+  CKPT_MODE   **ckpt_modeA = NULL; /* w/--resume: [0..ckpt_nmode-1] model/modes calibrated before the checkpoint, in order */
+  int           ckpt_nmode = 0;    /* number of model/modes in ckpt_modeA */
+  int           ckpt_idx;          /* index of current model/mode in ckpt_modeA */
 
   /* variables needed for threaded implementation */
   ESL_SQ         **init_sqA  = NULL; /* for initializing workers */
@@ -465,6 +580,9 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 #endif
   
   if ((status = init_master_cfg(go, cfg, errbuf)) != eslOK) cm_Fail(errbuf);
+  if (esl_opt_IsOn(go, "--ckpt")) { 
+    if ((status = ckpt_open(go, cfg, errbuf, &ckpt_modeA, &ckpt_nmode, &ckpt_fp)) != eslOK) cm_Fail(errbuf);
+  }
 
 #ifdef HMMER_THREADS
   /* initialize thread data */
@@ -541,7 +659,10 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       total_psec += psec;
       print_forecasted_time(go, cfg, errbuf, cm, psec);
       
-      if((status = generate_sequences(go, cfg, errbuf, cm, &sq_block))           != eslOK) cm_Fail(errbuf);
+      /* w/--resume, we don't need sequences if all modes were calibrated before the checkpoint */
+      if((cmi+1) * EXP_NMODES > ckpt_nmode) { 
+        if((status = generate_sequences(go, cfg, errbuf, cm, &sq_block))         != eslOK) cm_Fail(errbuf);
+      }
       
       if(! esl_opt_IsUsed(go, "--forecast")) { 
 	esl_stopwatch_Start(cfg->w);
@@ -584,41 +705,69 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 	  }
 	  fflush(stdout);
 	  
-	  /* initialize worker info */
-	  for (i = 0; i < infocnt; ++i) {
-	    if(info[i].scA != NULL) free(info[i].scA);
-	    info[i].scA     = NULL;
-	    info[i].nhits   = 0;
-	    info[i].cutoff  = cfg->sc_cutoff;
-	    info[i].nequals = nequals;
+	  /* search the sequences, in a single round unless --adapt, in which
+	   * case we search in rounds until the tail fit is precise enough 
+	   */
+	  merged_nhits = 0;
+	  nsearched    = 0;
+	  nprinted     = 0;
+	  nseq         = esl_opt_IsOn(go, "--adapt") ? ESL_MAX(1, cfg->N / 10) : cfg->N;
+	  ckpt_idx     = cmi * EXP_NMODES + exp_mode;
+	  if(ckpt_idx < ckpt_nmode) { /* w/--resume, scores were saved before the checkpoint, skip the search */
+	    if(strcmp(ckpt_modeA[ckpt_idx]->name, cm->name) != 0) cm_Fail("Checkpoint file %s was saved by a calibration of different models, model %d is %s not %s", esl_opt_GetString(go, "--ckpt"), cmi+1, cm->name, ckpt_modeA[ckpt_idx]->name);
+	    merged_scA   = ckpt_modeA[ckpt_idx]->scA;
+	    merged_nhits = ckpt_modeA[ckpt_idx]->nhits;
+	    nsearched    = ckpt_modeA[ckpt_idx]->nsearched;
+	    ckpt_modeA[ckpt_idx]->scA = NULL; /* merged_scA is freed below */
+	    nseq         = 0;
+	  }
+	  while(nseq > 0) { 
+	    round_block        = *sq_block;
+	    round_block.list  += nsearched;
+	    round_block.count  = nseq - nsearched;
+	    /* initialize worker info */
+	    for (i = 0; i < infocnt; ++i) {
+	      if(info[i].scA != NULL) free(info[i].scA);
+	      info[i].scA     = NULL;
+	      info[i].nhits   = 0;
+	      info[i].cutoff  = cfg->sc_cutoff;
+	      info[i].nequals = (int) ((float) nequals * nseq / cfg->N) - nprinted;
 #ifdef HMMER_THREADS
-	    if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
+	      if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
 #endif
-	  }
+	    }
+	    nprinted += info[0].nequals;
 	  
 #ifdef HMMER_THREADS
-	  if (ncpus > 0)  status = thread_loop(info, errbuf, threadObj, queue, sq_block);
-	  else            status = serial_loop(info, errbuf, sq_block);
+	    if (ncpus > 0)  status = thread_loop(info, errbuf, threadObj, queue, &round_block);
+	    else            status = serial_loop(info, errbuf, &round_block);
 #else
-	  status = serial_loop(info, errbuf, sq_block);
+	    status = serial_loop(info, errbuf, &round_block);
 #endif
-	  if(status != eslOK) cm_Fail(errbuf);
+	    if(status != eslOK) cm_Fail(errbuf);
 	  
-	  merged_nhits = 0;
-	  for (i = 0; i < infocnt; ++i) {
-	    if(info[i].nhits > 0) { 
-	      ESL_REALLOC(merged_scA, sizeof(float) * (merged_nhits + info[i].nhits)); /* this works even if merged_scA == NULL */
-	      for(h = 0; h < info[i].nhits; h++) merged_scA[(merged_nhits+h)] = info[i].scA[h];
-	      merged_nhits += info[i].nhits;
+	    for (i = 0; i < infocnt; ++i) {
+	      if(info[i].nhits > 0) { 
+		ESL_REALLOC(merged_scA, sizeof(float) * (merged_nhits + info[i].nhits)); /* this works even if merged_scA == NULL */
+		for(h = 0; h < info[i].nhits; h++) merged_scA[(merged_nhits+h)] = info[i].scA[h];
+		merged_nhits += info[i].nhits;
+	      }
 	    }
+	    nsearched = nseq;
+	    nseq      = esl_opt_IsOn(go, "--adapt") ? adapt_search_length(go, cfg, merged_nhits, nsearched, exp_mode) : 0;
+	  }
+	  while(nprinted < nequals) { putchar('='); fflush(stdout); nprinted++; } /* if --adapt stopped early, or w/--resume */
+
+	  if(ckpt_fp != NULL && ckpt_idx >= ckpt_nmode) { 
+	    if((status = ckpt_write_mode(ckpt_fp, cmi, exp_mode, cm->name, nsearched, merged_nhits, merged_scA)) != eslOK) cm_Fail("Failed to write checkpoint file %s", esl_opt_GetString(go, "--ckpt"));
 	  }
 	  
 	  if(cfg->ffp != NULL) { 
 	    fprintf(cfg->ffp, "# CM: %s\n", cm->name);
 	    fprintf(cfg->ffp, "# mode: %12s\n", DescribeExpMode(exp_mode));
 	  }
-	  if((status = fit_histogram(go, cfg, errbuf, merged_scA, merged_nhits, exp_mode, &tmp_mu, &tmp_lambda, &tmp_nrandhits, &tmp_tailp)) != eslOK) cm_Fail(errbuf);
-	  SetExpInfo(cfg->expAA[cmi][exp_mode], tmp_lambda, tmp_mu, (double) (cfg->L * cfg->N), tmp_nrandhits, tmp_tailp);
+	  if((status = fit_histogram(go, cfg, errbuf, merged_scA, merged_nhits, nsearched, exp_mode, &tmp_mu, &tmp_lambda, &tmp_nrandhits, &tmp_tailp)) != eslOK) cm_Fail(errbuf);
+	  SetExpInfo(cfg->expAA[cmi][exp_mode], tmp_lambda, tmp_mu, (double) cfg->L * (double) nsearched, tmp_nrandhits, tmp_tailp);
 	  if(merged_scA != NULL) { free(merged_scA); merged_scA = NULL; }
 
 	} /* end of for(exp_mode = 0; exp_mode < EXP_NMODES; exp_mode++) */
@@ -639,7 +788,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       if(info[i].cm  != NULL) { FreeCM(info[i].cm); info[i].cm = NULL;  }
       if(info[i].scA != NULL) { free(info[i].scA);  info[i].scA = NULL; }
     }
-    if(sq_block != NULL) esl_sq_DestroyBlock(sq_block);
+    if(sq_block != NULL) { esl_sq_DestroyBlock(sq_block); sq_block = NULL; }
 
     fflush(stdout);
 
@@ -647,6 +796,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     qhstatus = cm_file_Read(cfg->cmfp, TRUE, &(cfg->abc), &cm);
   } /* end of while(qhstatus == eslOK) */
   if(qhstatus != eslEOF) cm_Fail(cfg->cmfp->errbuf);
+  if(ckpt_nmode > cfg->ncm * EXP_NMODES) cm_Fail("Checkpoint file %s was saved by a calibration of more models than in %s", esl_opt_GetString(go, "--ckpt"), cfg->cmfile);
   
   if(esl_opt_IsUsed(go, "--memreq")) print_required_memory_tail(available_ncpus);
   else if(cfg->ncm > 1)              print_total_time(go, total_asec, total_psec);
@@ -666,6 +816,11 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   }
 #endif
   if(info != NULL) { free(info); info = NULL; }
+  if(ckpt_fp != NULL) fclose(ckpt_fp);
+  if(ckpt_modeA != NULL) { 
+    for(i = 0; i < ckpt_nmode; i++) ckpt_free_mode(ckpt_modeA[i]);
+    free(ckpt_modeA);
+  }
 
   return;
       
@@ -693,7 +848,7 @@ serial_loop(WORKER_INFO *info, char *errbuf, ESL_SQ_BLOCK *sq_block)
   if(info->scA != NULL) free(info->scA);
 
   /* determine how many sequences we need to complete to print a '=' to progress bar */
-  equalcnt = (int) (((float) sq_block->count / (float) info->nequals) + 0.9999999);
+  equalcnt = (info->nequals > 0) ? (int) (((float) sq_block->count / (float) info->nequals) + 0.9999999) : sq_block->count + 1;
   equalcnt = ESL_MAX(equalcnt, 1);
   equalidx = equalcnt;
 
@@ -740,7 +895,7 @@ thread_loop(WORKER_INFO *info, char *errbuf, ESL_THREADS *obj, ESL_WORK_QUEUE *q
   esl_threads_WaitForStart(obj);
 
   /* determine how many sequences we need to complete to print a '=' to progress bar */
-  equalcnt = (int) (((float) sq_block->count / (float) info->nequals) + 0.9999999);
+  equalcnt = (info->nequals > 0) ? (int) (((float) sq_block->count / (float) info->nequals) + 0.9999999) : sq_block->count + 1;
   equalcnt = ESL_MAX(equalcnt, 1);
   equalidx = equalcnt;
 
@@ -847,6 +1002,461 @@ pipeline_thread(void *arg)
   cm_Fail("out of memory");
   return;  /* NEVERREACHED */
 }
+
+/* multi_master()
+ * The --multi version of cmcalibrate: calibrate multiple models
+ * and exp tail modes concurrently with a task queue.
+ *
+ * serial_master() parallelizes over sequences for a single model
+ * and mode at a time, which leaves most threads idle at the end of
+ * each mode when a model is small. Here, the master reads and
+ * configures models ahead of the workers, splits each of their
+ * modes into tasks (chunks of sequences) and keeps the workers busy
+ * with tasks from up to <nwindow> models at once, most expensive
+ * (as predicted by forecast_time()) first. Workers clone and cache
+ * the configured CM for the current task. All scores for each mode
+ * are collected in sequence order and histograms are fit in model
+ * order, so the exp tail parameters and output files are identical
+ * to those from serial_master().
+ *
+ * A master can only return if it's successful. All errors are handled immediately and fatally with cm_Fail().
+ */
+static void
+multi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  int      status;                /* Easel status */
+  int      qhstatus = eslOK;      /* status from cm_file_Read() */
+  char     errbuf[eslERRBUFSIZE];  /* for printing error messages */
+  CM_t    *cm    = NULL;          /* the CM */
+  int      i, t;                  /* counters */
+  int      best;                  /* index of most expensive pending task */
+  double   total_psec   = 0.;     /* predicted number of seconds for calibrating all CMs */
+  int      ncpus        = 0;      /* number of CPUs working */
+  int      available_ncpus = 1;   /* number of CPUs available */
+  int      nwindow;               /* max number of models loaded at once */
+  int      nread  = 0;            /* number of models read and loaded thus far */
+  int      nfit   = 0;            /* number of models fit and freed thus far, model <nfit> is next to fit */
+  MULTI_MODEL     **mdlA    = NULL; /* [0..nwindow-1] loaded models, model <cmi> is mdlA[cmi % nwindow] */
+  MULTI_MODEL      *mdl     = NULL; /* a model */
+  MULTI_TASK       *taskA   = NULL; /* [0..ntasks-1] tasks not yet dispatched */
+  int               ntasks  = 0;    /* number of pending tasks */
+  int               ntalloc = 0;    /* number of tasks allocated in taskA */
+  MULTI_WORKUNIT   *wuA     = NULL; /* [0..nwu-1] work units passed through the queue */
+  MULTI_WORKUNIT  **idleA   = NULL; /* [0..nidle-1] work units held by the master, ready to be filled */
+  MULTI_WORKUNIT   *wu      = NULL; /* a work unit */
+  int               nwu;            /* number of work units */
+  int               nidle   = 0;    /* number of work units in idleA */
+  int               nbusy   = 0;    /* number of work units dispatched and not yet returned */
+  void             *new_wu  = NULL; /* work unit returned from the queue */
+  ESL_SQ_BLOCK     *shared_block = NULL; /* sequences shared by all models, unless --seed 0 */
+  ESL_STOPWATCH    *w       = NULL; /* times all calibrations */
+  WORKER_INFO      *info    = NULL; /* the worker info */
+  ESL_THREADS      *threadObj = NULL;
+  ESL_WORK_QUEUE   *queue     = NULL;
+
+  if      (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+  else                                esl_threads_CPUCount(&ncpus);
+  if (ncpus == 0) { /* no threads, nothing to schedule */
+    serial_master(go, cfg);
+    return;
+  }
+  esl_threads_CPUCount(&available_ncpus);
+
+  if ((status = init_master_cfg(go, cfg, errbuf)) != eslOK) cm_Fail(errbuf);
+  cfg->do_wallclock = TRUE; /* forecasts are timed while workers are searching */
+  if((w = esl_stopwatch_Create()) == NULL) cm_Fail("Memory allocation error, stopwatch could not be created.");
+
+  nwindow = 2 * ncpus;
+  nwu     = 2 * ncpus;
+  ESL_ALLOC(mdlA,  sizeof(MULTI_MODEL *)    * nwindow);
+  ESL_ALLOC(wuA,   sizeof(MULTI_WORKUNIT)   * nwu);
+  ESL_ALLOC(idleA, sizeof(MULTI_WORKUNIT *) * nwu);
+  ESL_ALLOC(info,  sizeof(WORKER_INFO)      * ncpus);
+  for(i = 0; i < nwindow; i++) mdlA[i] = NULL;
+
+  threadObj = esl_threads_Create(&multi_thread);
+  queue     = esl_workqueue_Create(nwu);
+  for(i = 0; i < nwu; i++) { 
+    wuA[i].cmi      = -1;
+    wuA[i].cm       = NULL;
+    wuA[i].sq_block = NULL;
+    wuA[i].scA      = NULL;
+    wuA[i].nhits    = 0;
+    if((status = esl_workqueue_Init(queue, &(wuA[i]))) != eslOK) cm_Fail("Failed to add work unit to work queue");
+  }
+  for(i = 0; i < ncpus; i++) { 
+    info[i].queue   = queue;
+    info[i].cm      = NULL;
+    info[i].scA     = NULL;
+    info[i].nhits   = 0;
+    info[i].cutoff  = cfg->sc_cutoff;
+    info[i].nequals = 0;
+    info[i].cm_id   = -1;
+    esl_threads_AddThread(threadObj, &info[i]);
+  }
+  esl_threads_WaitForStart(threadObj);
+
+  /* <cfg->abc> is not known 'til first CM is read. Could be DNA or RNA*/
+  qhstatus = cm_file_Read(cfg->cmfp, TRUE, &(cfg->abc), &cm);
+
+  if (qhstatus == eslOK) {
+    /* One-time initializations after alphabet <abc> becomes known */
+    output_header(stdout, go, cfg->cmfile, available_ncpus, ncpus);
+    if((status = CreateGenomicHMM(cfg->abc, errbuf, &(cfg->ghmm_sA), &(cfg->ghmm_tAA), &(cfg->ghmm_eAA), &cfg->ghmm_nstates)) != eslOK) cm_Fail("unable to create generative HMM\n%s", errbuf);
+    if((status = set_dnull(cfg, cm, errbuf)) != eslOK) cm_Fail("unable to create set_dnull\n%s\n", errbuf);
+    print_calibration_column_headings(go, cfg, errbuf, cm, available_ncpus);
+    /* unless --seed 0, generate_sequences() reseeds the RNG so every
+     * model searches the same sequences, generate them only once */
+    if(esl_opt_GetInteger(go, "--seed") != 0) { 
+      if((status = generate_sequences(go, cfg, errbuf, cm, &shared_block)) != eslOK) cm_Fail(errbuf);
+    }
+  }
+
+  esl_stopwatch_Start(w);
+  for(;;) { 
+    /* read and configure more models if we're running low on tasks */
+    while(qhstatus == eslOK && (nread - nfit) < nwindow && ntasks < nwu) { 
+      if((status = multi_load_model(go, cfg, errbuf, cm, ncpus, available_ncpus, shared_block, &(mdlA[nread % nwindow]), &taskA, &ntasks, &ntalloc)) != eslOK) cm_Fail(errbuf);
+      total_psec += mdlA[nread % nwindow]->psec;
+      nread++;
+      cm = NULL; /* now owned by the model */
+      qhstatus = cm_file_Read(cfg->cmfp, TRUE, &(cfg->abc), &cm);
+    }
+
+    if(ntasks > 0 && nidle > 0) { 
+      /* dispatch the most expensive pending task */
+      best = 0;
+      for(t = 1; t < ntasks; t++) if(taskA[t].cost > taskA[best].cost) best = t;
+      mdl = mdlA[taskA[best].cmi % nwindow];
+      wu  = idleA[--nidle];
+      wu->cmi      = taskA[best].cmi;
+      wu->exp_mode = taskA[best].exp_mode;
+      wu->chunk    = taskA[best].chunk;
+      wu->cm       = ExpModeIsLocal(wu->exp_mode) ? mdl->lcm : mdl->gcm;
+      wu->sq_block = mdl->sq_block;
+      wu->sidx     = wu->chunk * mdl->nper;
+      wu->eidx     = ESL_MIN(wu->sidx + mdl->nper, mdl->sq_block->count);
+      wu->scA      = NULL;
+      wu->nhits    = 0;
+      taskA[best] = taskA[--ntasks];
+      if(! mdl->is_started) { esl_stopwatch_Start(mdl->w); mdl->is_started = TRUE; }
+      if((status = esl_workqueue_ReaderUpdate(queue, wu, NULL)) != eslOK) cm_Fail("Work queue reader failed");
+      nbusy++;
+      continue;
+    }
+    if(ntasks == 0 && nbusy == 0) break;
+
+    /* wait for a work unit, either unused or returned by a worker */
+    if((status = esl_workqueue_ReaderUpdate(queue, NULL, &new_wu)) != eslOK) cm_Fail("Work queue reader failed");
+    wu = (MULTI_WORKUNIT *) new_wu;
+    if(wu->cmi != -1) { 
+      mdl = mdlA[wu->cmi % nwindow];
+      mdl->scAA  [wu->exp_mode * mdl->nchunks + wu->chunk] = wu->scA;
+      mdl->nhitsA[wu->exp_mode * mdl->nchunks + wu->chunk] = wu->nhits;
+      mdl->nleft--;
+      wu->cmi   = -1;
+      wu->scA   = NULL;
+      wu->nhits = 0;
+      nbusy--;
+      /* fit all complete models we can, in order */
+      while(nfit < nread && mdlA[nfit % nwindow]->nleft == 0) { 
+	if((status = multi_fit_model(go, cfg, errbuf, mdlA[nfit % nwindow])) != eslOK) cm_Fail(errbuf);
+	multi_free_model(mdlA[nfit % nwindow]);
+	mdlA[nfit % nwindow] = NULL;
+	nfit++;
+      }
+    }
+    idleA[nidle++] = wu;
+  }
+  esl_stopwatch_Stop(w);
+  if(qhstatus != eslEOF) cm_Fail(cfg->cmfp->errbuf);
+  if(cfg->ncm > 1) print_total_time(go, w->elapsed, total_psec);
+
+  /* send a work unit with no work to all workers signaling them to stop */
+  for(i = 0; i < ncpus; i++) { 
+    if(nidle == 0) { 
+      if((status = esl_workqueue_ReaderUpdate(queue, NULL, &new_wu)) != eslOK) cm_Fail("Work queue reader failed");
+      idleA[nidle++] = (MULTI_WORKUNIT *) new_wu;
+    }
+    wu = idleA[--nidle];
+    wu->cmi = -1;
+    if((status = esl_workqueue_ReaderUpdate(queue, wu, NULL)) != eslOK) cm_Fail("Work queue reader failed");
+  }
+  esl_threads_WaitForFinish(threadObj);
+  esl_workqueue_Complete(queue);  
+
+  esl_workqueue_Reset(queue); 
+  esl_workqueue_Destroy(queue);
+  esl_threads_Destroy(threadObj);
+  if(shared_block != NULL) esl_sq_DestroyBlock(shared_block);
+  if(taskA        != NULL) free(taskA);
+  free(mdlA);
+  free(wuA);
+  free(idleA);
+  free(info);
+  esl_stopwatch_Destroy(w);
+
+  return;
+      
+ ERROR:
+  cm_Fail("Memory allocation error.");
+  return;
+}
+
+/* multi_thread()
+ * 
+ * Receive a work unit from the master, clone its CM
+ * (unless we already have a clone of it), search its
+ * sequences and store scores of hits in the work unit.
+ */
+static void 
+multi_thread(void *arg)
+{
+  int             status;
+  int             workeridx;
+  WORKER_INFO    *info;
+  ESL_THREADS    *obj;
+  MULTI_WORKUNIT *wu = NULL;
+  void           *new_wu;
+  int             i, h;
+  int             cm_id;
+  CM_TOPHITS     *th = NULL;
+  char            errbuf[eslERRBUFSIZE];
+  
+#ifdef HAVE_FLUSH_ZERO_MODE
+  /* In order to avoid the performance penalty dealing with sub-normal
+   * values in the floating point calculations, set the processor flag
+   * so sub-normals are "flushed" immediately to zero.
+   * On OS X, need to reset this flag for each thread
+   * (see TW notes 05/08/10 for details)
+   */
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  status = esl_workqueue_WorkerUpdate(info->queue, NULL, &new_wu);
+  if (status != eslOK) cm_Fail("Work queue worker failed");
+
+  /* loop until we receive a work unit with no work */
+  wu = (MULTI_WORKUNIT *) new_wu;
+  while (wu->cmi != -1) { 
+    /* glocal and local modes of the same model use different CMs */
+    cm_id = 2 * wu->cmi + (ExpModeIsLocal(wu->exp_mode) ? 1 : 0);
+    if(info->cm == NULL || info->cm_id != cm_id) { 
+      if(info->cm != NULL) { FreeCM(info->cm); info->cm = NULL; }
+      if((status = cm_Clone(wu->cm, errbuf, &(info->cm))) != eslOK) cm_Fail(errbuf);
+      info->cm_id = cm_id;
+    }
+    if(ExpModeIsInside(wu->exp_mode)) info->cm->search_opts |=  CM_SEARCH_INSIDE;
+    else                              info->cm->search_opts &= ~CM_SEARCH_INSIDE;
+
+    for(i = wu->sidx; i < wu->eidx; i++) { 
+      if((status = process_search_workunit(info->cm, errbuf, wu->sq_block->list[i].dsq, wu->sq_block->list[i].L, info->cutoff, &th)) != eslOK) cm_Fail(errbuf);
+      /* append copy of hit scores to scA */
+      if(th->N > 0) { 
+	ESL_REALLOC(wu->scA, sizeof(float) * (wu->nhits + th->N)); /* this works even if wu->scA == NULL */
+	for(h = 0; h < th->N; h++) wu->scA[(wu->nhits+h)] = th->unsrt[h].score;
+	wu->nhits += th->N;
+      }
+      cm_tophits_Destroy(th);
+    }
+
+    status = esl_workqueue_WorkerUpdate(info->queue, wu, &new_wu);
+    if (status != eslOK) cm_Fail("Work queue worker failed");
+    wu = (MULTI_WORKUNIT *) new_wu;
+  }
+
+  status = esl_workqueue_WorkerUpdate(info->queue, wu, NULL);
+  if (status != eslOK) cm_Fail("Work queue worker failed");
+
+  if(info->cm != NULL) { FreeCM(info->cm); info->cm = NULL; }
+  esl_threads_Finished(obj, workeridx);
+  return;
+
+ ERROR: 
+  cm_Fail("out of memory");
+  return;  /* NEVERREACHED */
+}
+
+/* multi_load_model()
+ * 
+ * Prepare a newly read CM <cm> for --multi calibration: configure
+ * glocal and local copies of it, forecast its running time, get
+ * its sequences and add its tasks to <*taskA>. Steps that use the
+ * RNGs are performed in the same order as in serial_master().
+ *
+ * We split each mode's sequences into tasks of about
+ * MULTI_TASK_SEC predicted seconds each, but never into fewer than
+ * <ncpus> tasks, so a single expensive model still uses all workers.
+ * Without a forecast, each mode is split into <ncpus> tasks.
+ *
+ * <cm> becomes owned by the model. Returns eslOK on success, 
+ * and the new model in <*ret_mdl>.
+ */
+static int
+multi_load_model(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, CM_t *cm, int ncpus, int available_ncpus, ESL_SQ_BLOCK *shared_block, 
+		 MULTI_MODEL **ret_mdl, MULTI_TASK **taskA, int *ntasks, int *ntalloc)
+{
+  int          status;
+  MULTI_MODEL *mdl = NULL;
+  int          exp_mode, c;
+  int          cmi;
+  int          ins_v_cyk;
+  double       cyk_sec_per_seq; /* predicted single CPU seconds for searching one sequence with glocal CYK */
+  double       sec_per_seq;     /* predicted single CPU seconds for searching one sequence in current mode */
+
+  cfg->ncm++;
+  cmi = cfg->ncm-1;
+  if((status = expand_exp_and_name_arrays(cfg))                 != eslOK) ESL_FAIL(status, errbuf, "out of memory");
+  if((status = esl_strdup(cm->name, -1, &(cfg->namesA[cmi])))   != eslOK) ESL_FAIL(status, errbuf, "unable to duplicate CM name");
+
+  ESL_ALLOC(mdl, sizeof(MULTI_MODEL));
+  mdl->cmi        = cmi;
+  mdl->gcm        = cm;
+  mdl->lcm        = NULL;
+  mdl->sq_block   = NULL;
+  mdl->owns_block = FALSE;
+  mdl->scAA       = NULL;
+  mdl->nhitsA     = NULL;
+  mdl->is_started = FALSE;
+  if((mdl->w = esl_stopwatch_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+
+  /* clone the non-configured CM, and configure the two copies for glocal and local modes */
+  if((status = cm_Clone(mdl->gcm, errbuf, &(mdl->lcm)))                 != eslOK) goto ERROR;
+  if((status = initialize_cm(go, cfg, errbuf, mdl->gcm, FALSE))         != eslOK) goto ERROR;
+  if((status = initialize_stats(go, cfg, errbuf))                       != eslOK) goto ERROR;
+  if(! esl_opt_GetBoolean(go, "--noforecast")) { 
+    if((status = forecast_time(go, cfg, errbuf, mdl->gcm, ncpus, available_ncpus, &(mdl->psec), &ins_v_cyk)) != eslOK) goto ERROR; 
+  }
+  else { 
+    mdl->psec = 0.;
+    ins_v_cyk = INS_V_CYK_GUESS;
+  }
+  if((status = initialize_cm(go, cfg, errbuf, mdl->lcm, TRUE))          != eslOK) goto ERROR;
+
+  if(shared_block != NULL) { 
+    mdl->sq_block = shared_block;
+  }
+  else { 
+    if((status = generate_sequences(go, cfg, errbuf, mdl->gcm, &(mdl->sq_block))) != eslOK) goto ERROR;
+    mdl->owns_block = TRUE;
+  }
+
+  /* determine task size: psec is total time for all modes, divided by ncpus */
+  cyk_sec_per_seq = (mdl->psec * ncpus) / (2. * (1. + ins_v_cyk) * (double) cfg->N);
+  mdl->nper = (cfg->N + ncpus - 1) / ncpus;
+  if(cyk_sec_per_seq > 0.) mdl->nper = ESL_MIN(mdl->nper, (int) (MULTI_TASK_SEC / cyk_sec_per_seq));
+  mdl->nper    = ESL_MAX(mdl->nper, 1);
+  mdl->nchunks = (cfg->N + mdl->nper - 1) / mdl->nper;
+  mdl->nleft   = EXP_NMODES * mdl->nchunks;
+  ESL_ALLOC(mdl->scAA,   sizeof(float *) * mdl->nleft);
+  ESL_ALLOC(mdl->nhitsA, sizeof(int64_t) * mdl->nleft);
+  for(c = 0; c < mdl->nleft; c++) { mdl->scAA[c] = NULL; mdl->nhitsA[c] = 0; }
+
+  if(*ntasks + mdl->nleft > *ntalloc) { 
+    *ntalloc = *ntasks + mdl->nleft + 128;
+    ESL_REALLOC(*taskA, sizeof(MULTI_TASK) * (*ntalloc));
+  }
+  for(exp_mode = 0; exp_mode < EXP_NMODES; exp_mode++) { 
+    sec_per_seq = (cyk_sec_per_seq > 0.) ? cyk_sec_per_seq : 1.;
+    if(ExpModeIsInside(exp_mode)) sec_per_seq *= ins_v_cyk;
+    for(c = 0; c < mdl->nchunks; c++) { 
+      (*taskA)[*ntasks].cmi      = cmi;
+      (*taskA)[*ntasks].exp_mode = exp_mode;
+      (*taskA)[*ntasks].chunk    = c;
+      (*taskA)[*ntasks].cost     = sec_per_seq * (ESL_MIN((c+1) * mdl->nper, cfg->N) - c * mdl->nper);
+      (*ntasks)++;
+    }
+  }
+
+  *ret_mdl = mdl;
+  return eslOK;
+
+ ERROR:
+  if(mdl != NULL) multi_free_model(mdl);
+  else            FreeCM(cm);
+  *ret_mdl = NULL;
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "out of memory");
+  return status;
+}
+
+/* multi_fit_model()
+ * 
+ * All tasks for model <mdl> are complete: fit the histogram for
+ * each mode, with scores in sequence order, set cfg->expAA and
+ * print the model's line of the progress table.
+ */
+static int
+multi_fit_model(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, MULTI_MODEL *mdl)
+{
+  int      status;
+  int      exp_mode, c, i;
+  int64_t  h;
+  int64_t  merged_nhits;         /* number of hits for all seqs in current mode */
+  float   *merged_scA = NULL;    /* [0..merged_nhits-1] hit scores for all seqs in current mode */
+  double   tmp_mu, tmp_lambda;   /* temporary mu and lambda used for setting exp tails */
+  int      tmp_nrandhits;        /* temporary number of rand hits found */
+  float    tmp_tailp;            /* temporary tail mass probability fit to an exponential */
+  char     time_buf[128];        /* string for printing elapsed time (safely holds up to 10^14 years) */
+
+  for(exp_mode = 0; exp_mode < EXP_NMODES; exp_mode++) { 
+    merged_nhits = 0;
+    for(c = exp_mode * mdl->nchunks; c < (exp_mode+1) * mdl->nchunks; c++) merged_nhits += mdl->nhitsA[c];
+    if(merged_nhits > 0) ESL_ALLOC(merged_scA, sizeof(float) * merged_nhits);
+    merged_nhits = 0;
+    for(c = exp_mode * mdl->nchunks; c < (exp_mode+1) * mdl->nchunks; c++) { 
+      for(h = 0; h < mdl->nhitsA[c]; h++) merged_scA[merged_nhits++] = mdl->scAA[c][h];
+      if(mdl->scAA[c] != NULL) { free(mdl->scAA[c]); mdl->scAA[c] = NULL; }
+    }
+
+    if(cfg->ffp != NULL) { 
+      fprintf(cfg->ffp, "# CM: %s\n", mdl->gcm->name);
+      fprintf(cfg->ffp, "# mode: %12s\n", DescribeExpMode(exp_mode));
+    }
+    if((status = fit_histogram(go, cfg, errbuf, merged_scA, merged_nhits, cfg->N, exp_mode, &tmp_mu, &tmp_lambda, &tmp_nrandhits, &tmp_tailp)) != eslOK) goto ERROR;
+    SetExpInfo(cfg->expAA[mdl->cmi][exp_mode], tmp_lambda, tmp_mu, (double) (cfg->L * cfg->N), tmp_nrandhits, tmp_tailp);
+    if(merged_scA != NULL) { free(merged_scA); merged_scA = NULL; }
+  }
+
+  esl_stopwatch_Stop(mdl->w);
+  print_forecasted_time(go, cfg, errbuf, mdl->gcm, mdl->psec);
+  for(i = 0; i < 40; i++) putchar('=');
+  FormatTimeString(time_buf, mdl->w->elapsed, FALSE);
+  printf("]  %12s\n", time_buf);
+  fflush(stdout);
+
+  return eslOK;
+
+ ERROR:
+  if(merged_scA != NULL) free(merged_scA);
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "out of memory");
+  return status;
+}
+
+/* multi_free_model()
+ * Free a MULTI_MODEL.
+ */
+static void
+multi_free_model(MULTI_MODEL *mdl)
+{
+  int c;
+
+  if(mdl->gcm    != NULL) FreeCM(mdl->gcm);
+  if(mdl->lcm    != NULL) FreeCM(mdl->lcm);
+  if(mdl->owns_block && mdl->sq_block != NULL) esl_sq_DestroyBlock(mdl->sq_block);
+  if(mdl->scAA   != NULL) { 
+    for(c = 0; c < EXP_NMODES * mdl->nchunks; c++) if(mdl->scAA[c] != NULL) free(mdl->scAA[c]);
+    free(mdl->scAA);
+  }
+  if(mdl->nhitsA != NULL) free(mdl->nhitsA);
+  if(mdl->w      != NULL) esl_stopwatch_Destroy(mdl->w);
+  free(mdl);
+  return;
+}
 #endif   /* HMMER_THREADS */
 
 #ifdef HAVE_MPI
@@ -1102,7 +1712,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 #if DEBUGMPI
       printf("about to call fit_histogram, %" PRId64 " hits\n", merged_nhits);
 #endif 
-      if((status = fit_histogram(go, cfg, errbuf, merged_scA, merged_nhits, exp_mode, &tmp_mu, &tmp_lambda, &tmp_nrandhits, &tmp_tailp)) != eslOK) mpi_failure(errbuf);
+      if((status = fit_histogram(go, cfg, errbuf, merged_scA, merged_nhits, cfg->N, exp_mode, &tmp_mu, &tmp_lambda, &tmp_nrandhits, &tmp_tailp)) != eslOK) mpi_failure(errbuf);
       SetExpInfo(cfg->expAA[cmi][exp_mode], tmp_lambda, tmp_mu, (double) (cfg->L * cfg->N), tmp_nrandhits, tmp_tailp);
       
       /* clear hits */
@@ -1399,6 +2009,7 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, int available_ncpu
   if (esl_opt_IsUsed(go, "--gtailn"))    {     fprintf(ofp, "# number of hits/Mb to fit (glocal):           %d\n", esl_opt_GetInteger(go, "--gtailn")); }
   if (esl_opt_IsUsed(go, "--ltailn"))    {     fprintf(ofp, "# number of hits/Mb to fit (local):            %d\n", esl_opt_GetInteger(go, "--ltailn")); }
   if (esl_opt_IsUsed(go, "--tailp"))     {     fprintf(ofp, "# fraction of histogram tail to fit:           %g\n", esl_opt_GetReal(go, "--tailp")); }
+  if (esl_opt_IsUsed(go, "--adapt"))     {     fprintf(ofp, "# adaptive length, lambda CI half-width:       %g\n", esl_opt_GetReal(go, "--adapt")); }
 
   if (esl_opt_IsUsed(go, "--hfile"))     {     fprintf(ofp, "# saving fitted score histograms to file:      %s\n", esl_opt_GetString(go, "--hfile")); }
   if (esl_opt_IsUsed(go, "--sfile"))     {     fprintf(ofp, "# saving survival plot to file:                %s\n", esl_opt_GetString(go, "--sfile")); }
@@ -1415,6 +2026,8 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, int available_ncpu
   if (esl_opt_IsUsed(go, "--nonull3"))   {     fprintf(ofp, "# null3 bias corrections:                      off\n"); }
   if (esl_opt_IsUsed(go, "--random"))    {     fprintf(ofp, "# generating seqs with cm->null (usually iid): yes\n"); }
   if (esl_opt_IsUsed(go, "--gc"))        {     fprintf(ofp, "# nucleotide distribution from file:           %s\n", esl_opt_GetString(go, "--gc")); }
+  if (esl_opt_IsUsed(go, "--ckpt"))      {     fprintf(ofp, "# checkpoint file:                             %s\n", esl_opt_GetString(go, "--ckpt")); }
+  if (esl_opt_IsUsed(go, "--resume"))    {     fprintf(ofp, "# resume from checkpoint:                      on\n"); }
   /* output number of processors being used, unless --forecast or --memreq is used */
   int output_ncpu = FALSE;
   if ((! esl_opt_IsUsed(go, "--forecast")) && (! esl_opt_IsUsed(go, "--memreq"))) { 
@@ -1423,6 +2036,7 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, int available_ncpu
 #endif 
 #ifdef HMMER_THREADS
     if (! output_ncpu)                       {  fprintf(ofp, "# number of worker threads:                    %d%s\n", ncpus, (esl_opt_IsUsed(go, "--cpu") ? " [--cpu]" : "")); output_ncpu = TRUE; }
+    if (esl_opt_IsUsed(go, "--multi") && ncpus > 0) { fprintf(ofp, "# calibrating models/modes concurrently:       yes\n"); }
 #endif 
     if (! output_ncpu)                       {  fprintf(ofp, "# number of worker threads:                    0 [serial mode; threading unavailable]\n"); }
   }
@@ -1636,10 +2250,11 @@ initialize_stats(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf)
 
 /* fit_histogram()
  * Create, fill and fit the tail of a histogram to an exponential tail. Data to fill the histogram
- * is given as <scores>.
+ * is given as <scores>, the hits found in the first <nseq> sequences (<nseq> is cfg->N
+ * unless --adapt).
  */
 static int
-fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *scores, int nscores, int exp_mode, double *ret_mu, double *ret_lambda, int *ret_nrandhits, float *ret_tailp)
+fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *scores, int nscores, int nseq, int exp_mode, double *ret_mu, double *ret_lambda, int *ret_nrandhits, float *ret_tailp)
 {
   int status;
   double mu;
@@ -1691,14 +2306,14 @@ fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *sco
   }
   else { /* number of hits is per Mb and specific to local or glocal fits */
     if(ExpModeIsLocal(exp_mode)) { /* local mode */
-      nhits_to_fit = (float) esl_opt_GetInteger(go, "--ltailn") * ((cfg->N * cfg->L) / 1000000.);
+      nhits_to_fit = (float) esl_opt_GetInteger(go, "--ltailn") * ((nseq * cfg->L) / 1000000.);
       tailp = nhits_to_fit / (float) h->n;
-      if(tailp > 1.) ESL_FAIL(eslERANGE, errbuf, "--ltailn <n>=%d cannot be used, there's only %.3f hits per Mb in the histogram! Lower <n> or use --tailp.", esl_opt_GetInteger(go, "--ltailn"), (h->n / ((float) cfg->N * ((float) cfg->L) / 1000000.)));
+      if(tailp > 1.) ESL_FAIL(eslERANGE, errbuf, "--ltailn <n>=%d cannot be used, there's only %.3f hits per Mb in the histogram! Lower <n> or use --tailp.", esl_opt_GetInteger(go, "--ltailn"), (h->n / ((float) nseq * ((float) cfg->L) / 1000000.)));
     }
     else { /* glocal mode */
-      nhits_to_fit = (float) esl_opt_GetInteger(go, "--gtailn") * ((cfg->N * cfg->L) / 1000000.);
+      nhits_to_fit = (float) esl_opt_GetInteger(go, "--gtailn") * ((nseq * cfg->L) / 1000000.);
       tailp = nhits_to_fit / (float) h->n;
-      if(tailp > 1.) ESL_FAIL(eslERANGE, errbuf, "--gtailn <n>=%d cannot be used, there's only %.3f hits per Mb in the histogram! Lower <n> or use --tailp.", esl_opt_GetInteger(go, "--gtailn"), (h->n / ((float) cfg->N * ((float) cfg->L) / 1000000.)));
+      if(tailp > 1.) ESL_FAIL(eslERANGE, errbuf, "--gtailn <n>=%d cannot be used, there's only %.3f hits per Mb in the histogram! Lower <n> or use --tailp.", esl_opt_GetInteger(go, "--gtailn"), (h->n / ((float) nseq * ((float) cfg->L) / 1000000.)));
     }
   }
 
@@ -1731,6 +2346,213 @@ fit_histogram(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, float *sco
   return eslOK;
 }
 
+/* adapt_search_length()
+ * w/--adapt: decide if we've searched enough sequences in the
+ * current mode. The ML estimate of lambda from the <n> hits in the
+ * fitted tail has an approximate 95% confidence interval of
+ * lambda * (1 +/- 1.96/sqrt(n)), we're done once 1.96/sqrt(n) is
+ * at most <x> from --adapt or all cfg->N sequences are searched.
+ * <n> is determined as in fit_histogram(), from the <nhits> hits
+ * found in the first <nseq> sequences.
+ *
+ * Returns 0 if we're done, else the total number of sequences to
+ * have searched after the next round, predicted from the current
+ * number of tail hits per sequence.
+ */
+static int
+adapt_search_length(const ESL_GETOPTS *go, const struct cfg_s *cfg, int64_t nhits, int nseq, int exp_mode)
+{
+  double ntail;    /* number of hits fit_histogram() would fit to the tail */
+  double ntarget;  /* number of tail hits we need */
+  int    next;     /* number of sequences to have searched after next round */
+
+  if(nseq >= cfg->N) return 0;
+
+  if(esl_opt_IsOn(go, "--tailp")) { 
+    ntail = esl_opt_GetReal(go, "--tailp") * (double) nhits;
+  }
+  else { 
+    ntail = (double) esl_opt_GetInteger(go, (ExpModeIsLocal(exp_mode) ? "--ltailn" : "--gtailn")) * ((nseq * cfg->L) / 1000000.);
+    if(ntail > (double) nhits) ntail = 0.; /* too few hits to fit yet */
+  }
+  ntarget  = 1.96 / esl_opt_GetReal(go, "--adapt");
+  ntarget *= ntarget;
+  if(ntail > 1. && ntail >= ntarget) return 0;
+
+  next = (ntail > 1.) ? (int) ceil((double) nseq * ntarget / ntail) : 2 * nseq;
+  next = ESL_MAX(next, nseq + 1);
+  next = ESL_MIN(next, cfg->N);
+  return next;
+}
+
+/* ckpt_open()
+ * Open the checkpoint file <f> of --ckpt <f> for appending the
+ * scores of each model/mode as its calibration completes. With
+ * --resume, first read the model/modes saved in <f> by an
+ * interrupted calibration and return them, in order, in
+ * <ret_modeA> and <ret_nmode>. A truncated final record (the
+ * calibration was killed while saving it) is ignored, and <f> is
+ * rewritten without it before it's reopened.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if <f> can't be read or written, or was saved by a
+ * calibration with a different number of sequences (cfg->N, set by
+ * -L), sequence length (cfg->L) or --seed.
+ */
+static int
+ckpt_open(const ESL_GETOPTS *go, const struct cfg_s *cfg, char *errbuf, CKPT_MODE ***ret_modeA, int *ret_nmode, FILE **ret_fp)
+{
+  int         status;
+  char       *ckptfile = esl_opt_GetString(go, "--ckpt");
+  char       *tmpfile  = NULL;   /* we write <ckptfile> to here, then rename it */
+  FILE       *fp       = NULL;
+  CKPT_MODE **modeA    = NULL;
+  CKPT_MODE  *mode     = NULL;
+  int         nmode    = 0;
+  int         nalloc   = 0;
+  uint32_t    magic;
+  int         hdrA[3];           /* N, L and --seed of this calibration */
+  int         ckpt_hdrA[3];      /* N, L and --seed of calibration that saved <ckptfile> */
+  int         i;
+
+  hdrA[0] = cfg->N;
+  hdrA[1] = cfg->L;
+  hdrA[2] = esl_opt_GetInteger(go, "--seed");
+
+  if(esl_opt_GetBoolean(go, "--resume")) { 
+    if((fp = fopen(ckptfile, "rb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open checkpoint file %s", ckptfile);
+    if(! fread((char *) &magic, sizeof(uint32_t), 1, fp) || magic != CKPT_MAGIC) ESL_XFAIL(eslFAIL, errbuf, "%s is not a cmcalibrate checkpoint file", ckptfile);
+    if(fread((char *) ckpt_hdrA, sizeof(int), 3, fp) != 3)                      ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file %s is truncated", ckptfile);
+    if(ckpt_hdrA[0] != hdrA[0] || ckpt_hdrA[1] != hdrA[1] || ckpt_hdrA[2] != hdrA[2]) ESL_XFAIL(eslFAIL, errbuf, "Checkpoint %s: saved with N=%d L=%d --seed %d, this run has N=%d L=%d --seed %d", 
+                                                                                                            ckptfile, ckpt_hdrA[0], ckpt_hdrA[1], ckpt_hdrA[2], hdrA[0], hdrA[1], hdrA[2]);
+    while((status = ckpt_read_mode(fp, &mode)) == eslOK) { 
+      if(mode->cmi != nmode / EXP_NMODES || mode->exp_mode != nmode % EXP_NMODES) { 
+	ckpt_free_mode(mode);
+	ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file %s is corrupt", ckptfile);
+      }
+      if(nmode == nalloc) { 
+	nalloc += EXP_NMODES * 10;
+	ESL_REALLOC(modeA, sizeof(CKPT_MODE *) * nalloc);
+      }
+      modeA[nmode++] = mode;
+    }
+    if(status == eslEMEM) ESL_XFAIL(eslEMEM, errbuf, "Out of memory reading checkpoint file %s", ckptfile);
+    fclose(fp);
+    fp = NULL;
+  }
+
+  /* (re)write the file with only complete records, via a temporary
+   * file, so we have a valid checkpoint at all times 
+   */
+  ESL_ALLOC(tmpfile, sizeof(char) * (strlen(ckptfile) + 5));
+  sprintf(tmpfile, "%s.tmp", ckptfile);
+  if((fp = fopen(tmpfile, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open checkpoint file %s for writing", tmpfile);
+  magic = CKPT_MAGIC;
+  if(fwrite((char *) &magic, sizeof(uint32_t), 1, fp) != 1 || fwrite((char *) hdrA, sizeof(int), 3, fp) != 3) ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  for(i = 0; i < nmode; i++) { 
+    if(ckpt_write_mode(fp, modeA[i]->cmi, modeA[i]->exp_mode, modeA[i]->name, modeA[i]->nsearched, modeA[i]->nhits, modeA[i]->scA) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  }
+  status = fclose(fp);
+  fp = NULL;
+  if(status != 0)                        ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  if(rename(tmpfile, ckptfile) != 0)     ESL_XFAIL(eslFAIL, errbuf, "Failed to rename checkpoint file %s to %s", tmpfile, ckptfile);
+  if((fp = fopen(ckptfile, "ab")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open checkpoint file %s for writing", ckptfile);
+
+  free(tmpfile);
+  *ret_modeA = modeA;
+  *ret_nmode = nmode;
+  *ret_fp    = fp;
+  return eslOK;
+
+ ERROR:
+  if(fp      != NULL) fclose(fp);
+  if(tmpfile != NULL) free(tmpfile);
+  if(modeA   != NULL) { 
+    for(i = 0; i < nmode; i++) ckpt_free_mode(modeA[i]);
+    free(modeA);
+  }
+  *ret_modeA = NULL;
+  *ret_nmode = 0;
+  *ret_fp    = NULL;
+  return status;
+}
+
+/* ckpt_write_mode()
+ * Append the <nhits> scores <scA> of the search of model <cmi>,
+ * named <name>, in exp tail mode <exp_mode> to open checkpoint file
+ * <fp>, and flush it so the record survives if we're killed.
+ *
+ * Returns eslOK on success, eslFAIL if the write fails.
+ */
+static int
+ckpt_write_mode(FILE *fp, int cmi, int exp_mode, char *name, int nsearched, int64_t nhits, float *scA)
+{
+  int len = strlen(name) + 1;
+
+  if(fwrite((char *) &cmi,       sizeof(int),     1,   fp) != 1   ||
+     fwrite((char *) &exp_mode,  sizeof(int),     1,   fp) != 1   ||
+     fwrite((char *) &len,       sizeof(int),     1,   fp) != 1   ||
+     fwrite((char *) name,       sizeof(char),    len, fp) != len ||
+     fwrite((char *) &nsearched, sizeof(int),     1,   fp) != 1   ||
+     fwrite((char *) &nhits,     sizeof(int64_t), 1,   fp) != 1) return eslFAIL;
+  if(nhits > 0 && fwrite((char *) scA, sizeof(float), nhits, fp) != nhits) return eslFAIL;
+  if(fflush(fp) != 0) return eslFAIL;
+
+  return eslOK;
+}
+
+/* ckpt_read_mode()
+ * Read the next record written by ckpt_write_mode() from open
+ * checkpoint file <fp> into a new CKPT_MODE object <ret_mode>.
+ *
+ * Returns eslOK on success, eslEOF if there are no more records,
+ * eslEOD if the record is truncated, eslEMEM on allocation failure.
+ */
+static int
+ckpt_read_mode(FILE *fp, CKPT_MODE **ret_mode)
+{
+  int        status;
+  CKPT_MODE *mode = NULL;
+  int        len;
+
+  ESL_ALLOC(mode, sizeof(CKPT_MODE));
+  mode->name = NULL;
+  mode->scA  = NULL;
+
+  if(! fread((char *) &(mode->cmi), sizeof(int), 1, fp)) { status = eslEOF; goto ERROR; }
+  if(! fread((char *) &(mode->exp_mode), sizeof(int), 1, fp) || 
+     ! fread((char *) &len,              sizeof(int), 1, fp) || len < 1) { status = eslEOD; goto ERROR; }
+  ESL_ALLOC(mode->name, sizeof(char) * len);
+  if(fread((char *) mode->name, sizeof(char), len, fp) != len || mode->name[len-1] != '\0' ||
+     ! fread((char *) &(mode->nsearched), sizeof(int),     1, fp) ||
+     ! fread((char *) &(mode->nhits),     sizeof(int64_t), 1, fp) || mode->nhits < 0) { status = eslEOD; goto ERROR; }
+  if(mode->nhits > 0) { 
+    ESL_ALLOC(mode->scA, sizeof(float) * mode->nhits);
+    if(fread((char *) mode->scA, sizeof(float), mode->nhits, fp) != mode->nhits) { status = eslEOD; goto ERROR; }
+  }
+
+  *ret_mode = mode;
+  return eslOK;
+
+ ERROR:
+  ckpt_free_mode(mode);
+  *ret_mode = NULL;
+  return status;
+}
+
+/* ckpt_free_mode()
+ * Free a CKPT_MODE object.
+ */
+static void
+ckpt_free_mode(CKPT_MODE *mode)
+{
+  if(mode == NULL) return;
+  if(mode->name != NULL) free(mode->name);
+  if(mode->scA  != NULL) free(mode->scA);
+  free(mode);
+  return;
+}
+
 /* Function: get_random_dsq()
  * Date:     EPN, Tue Sep 11 08:31:47 2007
  * 
@@ -2147,14 +2969,14 @@ int forecast_time(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, CM_t *
   esl_stopwatch_Start(cfg->w);
   if((status = process_search_workunit(cm, errbuf, dsq, L, cfg->sc_cutoff, NULL)) != eslOK) cm_Fail(errbuf);
   esl_stopwatch_Stop(cfg->w);
-  cyk_sec_per_res = cfg->w->user * (Mc_per_res_corr / Mc);
+  cyk_sec_per_res = (cfg->do_wallclock ? cfg->w->elapsed : cfg->w->user) * (Mc_per_res_corr / Mc);
 
   /* search it again, with glocal Inside */
   cm->search_opts |= CM_SEARCH_INSIDE;
   esl_stopwatch_Start(cfg->w);
   if((status = process_search_workunit(cm, errbuf, dsq, L, cfg->sc_cutoff, NULL)) != eslOK) cm_Fail(errbuf);
   esl_stopwatch_Stop(cfg->w);
-  ins_sec_per_res = cfg->w->user * (Mc_per_res_corr / Mc);
+  ins_sec_per_res = (cfg->do_wallclock ? cfg->w->elapsed : cfg->w->user) * (Mc_per_res_corr / Mc);
 
   /* restore original search_opts */
   cm->search_opts = orig_search_opts;
@@ -99,8 +99,8 @@ typedef struct {
  * options which are actually incompatible with a lot of other
  * options. 
  *
- * #define ICWMAX   "--nohmm,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--noF6,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--F6,--ftau,--fsums,--fqdb,--fbeta,--fnonbanded,--nocykenv,--cykenvx,--tau,--sums,--nonbanded,--rt1,--rt2,--rt3,--ns,--maxtau,--onepass"
- * #define ICWNOHMM "--max,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--ftau,--fsums,--tau,--sums,--rt1,--rt2,--rt3,--ns,--maxtau,--onepass"
+ * #define ICWMAX   "--nohmm,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--noF6,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--F6,--ftau,--fsums,--fqdb,--fbeta,--fnonbanded,--nocykenv,--cykenvx,--tau,--sums,--nonbanded,--rt1,--rt2,--rt3,--ns,--maxtau,--onepass,--shortpass"
+ * #define ICWNOHMM "--max,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--ftau,--fsums,--tau,--sums,--rt1,--rt2,--rt3,--ns,--maxtau,--onepass,--shortpass"
  * #define ICWMID   "--max,--nohmm,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--doF1b,--noF2b,--F1,--F1b,--F2,--F2b"
  * #define ICWDF    "--max,--nohmm,--mid,--rfam,--FZ"
  * #define ICWRFAM  "--max,--nohmm,--mid,--default,--FZ"
@@ -166,6 +166,7 @@ static ESL_OPTIONS options[] = {
   { "--clanin",     eslARG_INFILE,  NULL, NULL, NULL,    NULL, "--fmt",NULL,                           "read clan information from file <f>",                              7 },
   { "--oclan",      eslARG_NONE,   FALSE, NULL, NULL,    NULL, "--fmt,--clanin",NULL,                  "w/'--fmt 2' and '--tblout', only mark overlaps within clans",      7 },
   { "--oskip",      eslARG_NONE,   FALSE, NULL, NULL,    NULL, "--fmt",NULL,                           "w/'--fmt 2' and '--tblout', do not output lower scoring overlaps", 7 },
+  { "--deferali",   eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "BOGUS OPTION, NEVER ALLOWED",    999 },
 #ifdef HMMER_THREADS 
   { "--cpu",        eslARG_INT, NULL,"INFERNAL_NCPU","n>=0",NULL,  NULL,  CPUOPTS,                     "number of parallel CPU workers to use for multithreads",           7 },
 #endif
@@ -187,6 +188,8 @@ static ESL_OPTIONS options[] = {
   { "--noF3b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn off the HMM Fwd composition bias filter",               101 },
   { "--noF4b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn off the HMM glocal Fwd composition bias filter",        101 },
   { "--doF5b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn on  the HMM per-envelope composition bias filter",      101 },
+  { "--lcmask",     eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF1",         "mask low complexity regions (score > <x> bits) before SSV",  101 },
+  { "--lcw",        eslARG_INT,     "64", NULL, "n>=8",  NULL,"--lcmask", NULL,         "with --lcmask, set low complexity window length to <n>",     101 },
   { "--F1",         eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF1",         "Stage 1 (SSV) threshold:         promote hits w/ P <= <x>",  101 },
   { "--F1b",        eslARG_REAL,   FALSE, NULL, "x>0",   NULL,"--doF1b", NULL,          "Stage 1 (MSV) bias threshold:    promote hits w/ P <= <x>",  101 },
   { "--F2",         eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF2",         "Stage 2 (Vit) threshold:         promote hits w/ P <= <x>",  101 },
@@ -250,6 +253,7 @@ static ESL_OPTIONS options[] = {
   { "--seed",       eslARG_INT,    "181", NULL, "n>=0",  NULL,  NULL,  NULL,                   "set RNG seed to <n> (if 0: one-time arbitrary seed)",           108 },
   { "--block",      eslARG_INT,     NULL, NULL, "n>0",   NULL,  NULL,  NULL,                   "set block size (number of models per worker/thread) to <n>",    108 },
   { "--onepass",    eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,"--nohmm,--qdb,--fqdb",   "use CM only for best scoring HMM pass for full seq envelopes",  108 },
+  { "--shortpass",  eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,"-g,--nohmm,--qdb,--fqdb,--notrunc,--anytrunc,--onlytrunc,--5trunc,--3trunc", "search seqs <= W with both ends in one truncated pass, one envelope", 108 },
   { "--onlytrunc",  eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,              "allow only truncated hits, anywhere within sequences",          108 },
   { "--5trunc",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,              "allow truncated hits only at 5' ends of sequences",             108 },
   { "--3trunc",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,              "allow truncated hits only at 3' ends of sequences",             108 },
@@ -330,6 +334,7 @@ typedef struct {
 
 static void mpi_failure(char *format, ...);
 static int  mpi_next_block(CM_FILE *cmfp, BLOCK_LIST *list, int64_t bsize, uint64_t idx0, MSV_BLOCK *block);
+static int  mpi_wait_ready(CM_TOPHITS *th, char **buf, int *nalloc);
 #endif /* HAVE_MPI */
 
 int
@@ -661,11 +666,11 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 
       /* Sort by sequence index/position and remove duplicates found because we searched overlapping chunks */
       cm_tophits_SortForOverlapRemoval(tinfo[0].th);
-      if((status = cm_tophits_RemoveOrMarkOverlaps(tinfo[0].th, FALSE, errbuf)) != eslOK) cm_Fail(errbuf);
+      if((status = cm_tophits_RemoveOrMarkOverlapsParallel(tinfo[0].th, FALSE, ncpus, errbuf)) != eslOK) cm_Fail(errbuf);
 
       /* Resort in order to markup overlapping hits from different models (only within clans if --oclan) */
       cm_tophits_SortForOverlapMarkup(tinfo[0].th, esl_opt_GetBoolean(go, "--oclan"));
-      if((status = cm_tophits_RemoveOrMarkOverlaps(tinfo[0].th, esl_opt_GetBoolean(go, "--oclan"), errbuf)) != eslOK) cm_Fail(errbuf);
+      if((status = cm_tophits_RemoveOrMarkOverlapsParallel(tinfo[0].th, esl_opt_GetBoolean(go, "--oclan"), ncpus, errbuf)) != eslOK) cm_Fail(errbuf);
 
       /* Resort: by score (usually) or by position (if in special 'terminate after F3' mode) */
       if(tinfo[0].pli->do_trm_F3) cm_tophits_SortByPosition(tinfo[0].th);
@@ -1414,24 +1419,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 	/* Main loop: */
 	while ((hstatus = mpi_next_block(cmfp, list, bsize, cm_idx, &block)) == eslOK)
 	{
-	  if (MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
-	    mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
-	  
-	  MPI_Get_count(&mpistatus, MPI_PACKED, &size);
-	  if (mpi_buf == NULL || size > mpi_size) {
-	    void *tmp;
-	    ESL_RALLOC(mpi_buf, tmp, sizeof(char) * size);
-	    mpi_size = size; 
-	  }
-	  
-	  dest = mpistatus.MPI_SOURCE;
-	  MPI_Recv(mpi_buf, size, MPI_PACKED, dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpistatus);
-	  
-	  if (mpistatus.MPI_TAG == INFERNAL_ERROR_TAG)
-	    mpi_failure("MPI client %d raised error:\n%s\n", dest, mpi_buf);
-	  if (mpistatus.MPI_TAG != INFERNAL_READY_TAG)
-	    mpi_failure("Unexpected tag %d from %d\n", mpistatus.MPI_TAG, dest);
-	  
+	  dest = mpi_wait_ready(th, &mpi_buf, &mpi_size);
 	  MPI_Send(&block, 4, MPI_LONG_LONG_INT, dest, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD);
           cm_idx += block.count;
 	}
@@ -1447,26 +1435,10 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 	block.length = 0;
 	block.count  = 0;
 	
-	/* wait for all workers to finish up their work blocks */
+	/* wait for all workers to ask for a block after their final one */
 	for (i = 1; i < cfg->nproc; ++i)
 	  {
-	    if (MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
-	      mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
-	    
-	    MPI_Get_count(&mpistatus, MPI_PACKED, &size);
-	    if (mpi_buf == NULL || size > mpi_size) {
-	      void *tmp;
-	      ESL_RALLOC(mpi_buf, tmp, sizeof(char) * size);
-	      mpi_size = size; 
-	    }
-	    
-	    dest = mpistatus.MPI_SOURCE;
-	    MPI_Recv(mpi_buf, size, MPI_PACKED, dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpistatus);
-	    
-	    if (mpistatus.MPI_TAG == INFERNAL_ERROR_TAG)
-	      mpi_failure("MPI client %d raised error:\n%s\n", dest, mpi_buf);
-	    if (mpistatus.MPI_TAG != INFERNAL_READY_TAG)
-	      mpi_failure("Unexpected tag %d from %d\n", mpistatus.MPI_TAG, dest);
+	    mpi_wait_ready(th, &mpi_buf, &mpi_size);
 	  }
 
 	for (dest = 1; dest < cfg->nproc; ++dest) {
@@ -1477,24 +1449,27 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 	cm_file_Close(cmfp);
       } /* end of (in_rc = 0..1) loop (in top or bottom strand) */
 
-      /* receive and merge the results */
+      /* receive and merge the results, each worker sends the hits from
+       * its final blocks (if we haven't already received them) and
+       * then its pipeline statistics */
       for (dest = 1; dest < cfg->nproc; ++dest)
 	{
 	  CM_PIPELINE     *mpi_pli   = NULL;
-	  CM_TOPHITS      *mpi_th    = NULL;
 
 	  /* wait for the results */
-	  if ((status = cm_tophits_MPIRecv(dest, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &mpi_th)) != eslOK)
-	    mpi_failure("Unexpected error %d receiving tophits from %d", status, dest);
+	  while(TRUE) { 
+	    if (MPI_Probe(dest, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
+	      mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
+	    if (mpistatus.MPI_TAG != INFERNAL_TOPHITS_TAG) break;
+	    if ((status = cm_tophits_MPIStreamRecv(dest, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, th)) != eslOK)
+	      mpi_failure("Unexpected error %d receiving tophits from %d", status, dest);
+	  }
 
 	  if ((status = cm_pipeline_MPIRecv(dest, INFERNAL_PIPELINE_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, go, &mpi_pli)) != eslOK)
 	    mpi_failure("Unexpected error %d receiving pipeline from %d", status, dest);
 
-	  cm_tophits_Merge(th, mpi_th);
 	  cm_pipeline_Merge(pli, mpi_pli);
-	  
 	  cm_pipeline_Destroy(mpi_pli, NULL);
-	  cm_tophits_Destroy(mpi_th);
 	}
       
       if(pli->do_top && pli->do_bot) { 
@@ -1683,6 +1658,11 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
 
   MPI_Status       mpistatus;
   char             errbuf[eslERRBUFSIZE];
+  MSV_BLOCK        next_block;                   /* block of models we've asked for while searching the current one */
+  MPI_Request      block_req;                    /* receive for <next_block> */
+  char            *hits_buf  = NULL;             /* buffer for sending hits, separate from <mpi_buf> */
+  int              hits_size = 0;                /* size of <hits_buf> */
+  MPI_Request      hits_req  = MPI_REQUEST_NULL; /* send of the previous block's hits */
 
   READER_INFO     *rinfo = NULL;                 /* arrays of stored MSV info, we don't have to reread for each sequence */
   int64_t          nmodels;                      /* number of models in CM file            */
@@ -1798,6 +1778,11 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
             /* Determine if we need to read the MSV info from the file or not */
             int      do_read = (rinfo->omA[cm_idx] == NULL) ? TRUE : FALSE;
 
+	    /* ask for the next block of models now, so it arrives while we search this one */
+	    status = 0;
+	    MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
+	    MPI_Irecv(&next_block, 4, MPI_LONG_LONG_INT, 0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &block_req);
+
 	    if(do_read) { 
               hstatus = cm_p7_oprofile_Position(cmfp, block.offset);
               if (hstatus != eslOK) mpi_failure("Cannot position optimized model to %ld\n", block.offset);
@@ -1944,19 +1929,20 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
 	    /* lets do a little bit of sanity checking here to make sure the blocks are the same */
 	    if (block.length != length) mpi_failure("Block length mismatch - expected %ld found %ld at offset %ld\n", block.length, length, block.offset);
 	    
-	    /* inform the master we need another block of sequences */
-	    status = 0;
-	    MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
-	    
-	    /* wait for the next block of sequences */
-	    MPI_Recv(&block, 4, MPI_LONG_LONG_INT, 0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpistatus);
+	    /* start sending this block's hits to the master, and free them */
+	    if ((status = cm_tophits_MPIStreamSend(th, 0, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &hits_buf, &hits_size, &hits_req)) != eslOK)
+	      mpi_failure("Failed to send hits, error status code: %d\n", status);
+	    cm_tophits_Reuse(th);
+
+	    /* get the next block of models, it has probably arrived already */
+	    MPI_Wait(&block_req, &mpistatus);
+	    block = next_block;
 	  }
 	cm_file_Close(cmfp);
       } /* end loop over in_rc (reverse complement) */
       esl_stopwatch_Stop(w);
       
-      /* Send the top hits back to the master. */
-      cm_tophits_MPISend(th, 0, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD,  &mpi_buf, &mpi_size);
+      /* We've sent the top hits back to the master as we found them, send the pipeline statistics. */
       cm_pipeline_MPISend(pli, 0, INFERNAL_PIPELINE_TAG, MPI_COMM_WORLD,  &mpi_buf, &mpi_size);
       
       cm_pipeline_Destroy(pli, NULL);
@@ -1971,7 +1957,9 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
   status = 0;
   MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_TERMINATING_TAG, MPI_COMM_WORLD);
 
-  if (mpi_buf != NULL) free(mpi_buf);
+  MPI_Wait(&hits_req, &mpistatus);
+  if (mpi_buf  != NULL) free(mpi_buf);
+  if (hits_buf != NULL) free(hits_buf);
 
   p7_bg_Destroy(bg);
 
@@ -2156,6 +2144,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--noF3b"))      { puts("Failed to parse command line: Option --max is incompatible with option --noF3b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF4b"))      { puts("Failed to parse command line: Option --max is incompatible with option --noF4b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF5b"))      { puts("Failed to parse command line: Option --max is incompatible with option --doF5b");      goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))     { puts("Failed to parse command line: Option --max is incompatible with option --lcmask");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1"))         { puts("Failed to parse command line: Option --max is incompatible with option --F1");         goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1b"))        { puts("Failed to parse command line: Option --max is incompatible with option --F1b");        goto ERROR; }
     if(esl_opt_IsUsed(go, "--F2"))         { puts("Failed to parse command line: Option --max is incompatible with option --F2");         goto ERROR; }
@@ -2186,6 +2175,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --max is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --max is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --max is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --max is incompatible with option --shortpass");  goto ERROR; }
   }
   if(esl_opt_IsUsed(go, "--nohmm")) { 
     if(esl_opt_IsUsed(go, "--max"))        { puts("Failed to parse command line: Option --nohmm is incompatible with option --max");        goto ERROR; }
@@ -2201,6 +2191,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--noF3b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --noF3b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF4b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --noF4b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF5b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --doF5b");      goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --lcmask");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1"))         { puts("Failed to parse command line: Option --nohmm is incompatible with option --F1");         goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1b"))        { puts("Failed to parse command line: Option --nohmm is incompatible with option --F1b");        goto ERROR; }
     if(esl_opt_IsUsed(go, "--F2"))         { puts("Failed to parse command line: Option --nohmm is incompatible with option --F2");         goto ERROR; }
@@ -2224,6 +2215,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --nohmm is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --nohmm is incompatible with option --shortpass");  goto ERROR; }
   }
   if(esl_opt_IsUsed(go, "--mid")) { 
     if(esl_opt_IsUsed(go, "--max"))      { puts("Failed to parse command line: Option --mid is incompatible with option --max");   goto ERROR; }
@@ -2231,6 +2223,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--rfam"))     { puts("Failed to parse command line: Option --mid is incompatible with option --rfam");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--FZ"))       { puts("Failed to parse command line: Option --mid is incompatible with option --FZ");    goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF1"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF1");  goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))   { puts("Failed to parse command line: Option --mid is incompatible with option --lcmask"); goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF2"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF2");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF3"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF3");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF1b"))    { puts("Failed to parse command line: Option --mid is incompatible with option --doF1b"); goto ERROR; }
@@ -2302,6 +2295,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --hmmonly is incompatible with option --shortpass");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--mxsize"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --mxsize");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--smxsize"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --smxsize");    goto ERROR; }
     if(esl_opt_IsUsed(go, "--nonull3"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --nonull3");    goto ERROR; }
@@ -2367,6 +2361,7 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *seqfile, int
   if (esl_opt_IsUsed(go, "--acyk"))       fprintf(ofp, "# use CYK to align hits:                 on\n");
   if (esl_opt_IsUsed(go, "--wcx"))        fprintf(ofp, "# W set as <x> * cm->clen:               <x>=%g\n", esl_opt_GetReal(go, "--wcx"));
   if (esl_opt_IsUsed(go, "--onepass"))    fprintf(ofp, "# using CM for best HMM pass only:       on\n");
+  if (esl_opt_IsUsed(go, "--shortpass"))  fprintf(ofp, "# short seqs searched in one pass:       on\n");
   if (esl_opt_IsUsed(go, "--toponly"))    fprintf(ofp, "# search top-strand only:                on\n");
   if (esl_opt_IsUsed(go, "--bottomonly")) fprintf(ofp, "# search bottom-strand only:             on\n");
   if (esl_opt_IsUsed(go, "--qformat"))    fprintf(ofp, "# query <seqfile> format asserted:       %s\n", esl_opt_GetString(go,  "--qformat"));
@@ -2389,6 +2384,8 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *seqfile, int
   if (esl_opt_IsUsed(go, "--noF3b"))      fprintf(ofp, "# HMM Fwd biased comp filter:            off\n");
   if (esl_opt_IsUsed(go, "--noF4b"))      fprintf(ofp, "# HMM gFwd biased comp filter:           off\n");
   if (esl_opt_IsUsed(go, "--doF5b"))      fprintf(ofp, "# HMM per-envelope biased comp filter:   on\n");
+  if (esl_opt_IsUsed(go, "--lcmask"))     fprintf(ofp, "# low complexity mask before SSV:        score > %g bits\n", esl_opt_GetReal(go, "--lcmask"));
+  if (esl_opt_IsUsed(go, "--lcw"))        fprintf(ofp, "# low complexity mask window length:     %d\n", esl_opt_GetInteger(go, "--lcw"));
   if (esl_opt_IsUsed(go, "--F1"))         fprintf(ofp, "# HMM MSV filter P threshold:            <= %g\n", esl_opt_GetReal(go, "--F1"));
   if (esl_opt_IsUsed(go, "--F1b"))        fprintf(ofp, "# HMM MSV bias P threshold:              <= %g\n", esl_opt_GetReal(go, "--F1b"));
   if (esl_opt_IsUsed(go, "--F2"))         fprintf(ofp, "# HMM Vit filter P threshold:            <= %g\n", esl_opt_GetReal(go, "--F2"));
@@ -3003,6 +3000,49 @@ int mpi_next_block(CM_FILE *cmfp, BLOCK_LIST *list, int64_t bsize, uint64_t idx0
  ERROR:
   return eslEMEM;
 }
+
+/* mpi_wait_ready()
+ * Wait for a worker to report it's ready for another block of
+ * models, and return its rank. Workers send back the hits from each
+ * block as soon as they finish it, add any that arrive while we wait
+ * to <th>.
+ */
+int mpi_wait_ready(CM_TOPHITS *th, char **buf, int *nalloc)
+{
+  int         status;
+  int         dest;
+  int         size;
+  MPI_Status  mpistatus;
+
+  while(TRUE) { 
+    if (MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
+      mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
+    dest = mpistatus.MPI_SOURCE;
+
+    if (mpistatus.MPI_TAG != INFERNAL_TOPHITS_TAG) break;
+    if ((status = cm_tophits_MPIStreamRecv(dest, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, buf, nalloc, th)) != eslOK)
+      mpi_failure("Unexpected error %d receiving tophits from %d", status, dest);
+  }
+
+  MPI_Get_count(&mpistatus, MPI_PACKED, &size);
+  if (*buf == NULL || size > *nalloc) {
+    void *tmp;
+    ESL_RALLOC(*buf, tmp, sizeof(char) * size);
+    *nalloc = size; 
+  }
+  MPI_Recv(*buf, size, MPI_PACKED, dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpistatus);
+	  
+  if (mpistatus.MPI_TAG == INFERNAL_ERROR_TAG)
+    mpi_failure("MPI client %d raised error:\n%s\n", dest, *buf);
+  if (mpistatus.MPI_TAG != INFERNAL_READY_TAG)
+    mpi_failure("Unexpected tag %d from %d\n", mpistatus.MPI_TAG, dest);
+
+  return dest;
+
+ ERROR:
+  mpi_failure("Out of memory");
+  return -1;
+}
 #endif /* HAVE_MPI */
 
 /*****************************************************************
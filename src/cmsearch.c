@@ -8,9 +8,12 @@
 #include "p7_config.h"
 #include "config.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "easel.h"
 #include "esl_alphabet.h"
@@ -29,7 +32,6 @@
 #endif /*HAVE_MPI*/
 
 #ifdef HMMER_THREADS
-#include <unistd.h>
 #include "esl_threads.h"
 #include "esl_workqueue.h"
 #endif /*HMMER_THREADS*/
@@ -38,6 +40,76 @@
 
 #include "infernal.h"
 
+/* DEFERRED_ALI: reported hits whose alignments were deferred until
+ * after thresholding (--deferali), and the subsequence of the target
+ * each will be aligned to. Shared by all workers in the post-search
+ * alignment pass; each hit is aligned by exactly one worker.
+ */
+typedef struct {
+  CM_HIT  **hitA;        /* [0..nhit-1] hits to align, sorted by seq_idx, then end position */
+  ESL_SQ  **sqA;         /* [0..nhit-1] subsequence for hitA[i], revcomp'ed if hitA[i]->in_rc */
+  int64_t  *fromA;       /* [0..nhit-1] first position of sqA[i] in its source sequence */
+  int64_t  *toA;         /* [0..nhit-1] final position of sqA[i] in its source sequence */
+  int64_t   nhit;        /* number of hits to align */
+  int       nworkers;    /* number of workers aligning hits, worker w aligns hits w, w+nworkers... */
+} DEFERRED_ALI;
+
+/* CKPT: progress of a search, saved to a checkpoint file with --ckpt
+ * and read back with --resume. Queries 1..cm_idx-1 are complete. If
+ * cm_name is non-NULL, the search of query cm_idx was in progress,
+ * and the accounting and hits of each worker's pipeline follow the
+ * header in the file.
+ */
+typedef struct {
+  int64_t   nseqs;       /* number of sequences in the target database */
+  int64_t   nres;        /* number of residues in the target database */
+  int64_t   cm_idx;      /* index of the query in progress, 1..ncm+1 */
+  char     *cm_name;     /* name of query <cm_idx>, NULL if its search hadn't started */
+  int64_t   offA[4];     /* size of -o, -A, --tblout, --hitsout outputs before query <cm_idx>'s, -1 if unused or stdout */
+  FILE     *fp;          /* open checkpoint file, positioned after the header, only if read with --resume */
+} CKPT;
+
+#define CKPT_MAGIC 0xe3f9c6d5  /* first and final four bytes of a cmsearch checkpoint file */
+
+/* A --hitsout file holds the results of a search before overlap
+ * removal and thresholding, so that the results of independent
+ * searches of parts of a target database can be combined with
+ * --merge: a header (HITS_MAGIC, name of the target database, its
+ * size Z, how Z was set, and which shard of the database was
+ * searched with --shard, 0 of 0 if all of it), then for each query
+ * its name, pipeline accounting (cm_pli_WriteAccounting()) and hit
+ * list (cm_tophits_WriteBinary()), then HITS_MAGIC again, showing
+ * that the search was complete.
+ */
+#define HITS_MAGIC 0xe8e9f4f3  /* "hits" + 0x80808080; first and final four bytes of a --hitsout file */
+
+/* A target sequence's length and offset in the file, from SSI, for
+ * splitting the database into --shard's. 
+ */
+typedef struct {
+  int64_t   L;           /* sequence length */
+  off_t     offset;      /* offset of the sequence's record in the file */
+} SHARD_SEQ;
+
+/* DBIDX: the number, lengths and offsets of the sequences in a
+ * target database, in the order they occur in the file. With
+ * --dbidx, it's saved to the file <seqdb>.cmdbi when <seqdb> is
+ * first read to determine its size, and read back instead of
+ * reading <seqdb> again for as long as <seqdb>'s format, size and
+ * modification time are those recorded in the index: a header
+ * (DBIDX_MAGIC, those three, the number of sequences and residues),
+ * the length of each sequence, the offset of each sequence, then
+ * DBIDX_MAGIC again.
+ */
+typedef struct {
+  int64_t   nseqs;       /* number of sequences */
+  int64_t   nres;        /* total number of residues */
+  int64_t  *L;           /* [0..nseqs-1] length of each sequence */
+  int64_t  *offset;      /* [0..nseqs-1] offset of each sequence's record in the file, -1 if unknown (gzipped file) */
+} DBIDX;
+
+#define DBIDX_MAGIC 0xe4e2e9f8  /* "dbix" + 0x80808080; first and final four bytes of a --dbidx file */
+
 typedef struct {
 #ifdef HMMER_THREADS
   ESL_WORK_QUEUE   *queue;
@@ -54,6 +126,8 @@ typedef struct {
   P7_SCOREDATA     *msvdata;     /* MSV/SSV specific data structure */
   float            *p7_evparam;  /* [0..CM_p7_NEVPARAM] E-value parameters */
   float             smxsize;     /* max size (Mb) of allowable scan mx (only relevant if --nohmm or --max) */
+  int               do_lowmem;   /* TRUE to discard resolved duplicate hits after each window (--lowmem) */
+  DEFERRED_ALI     *dali;        /* hits to align after the search (--deferali), shared by all workers */
 } WORKER_INFO;
 
 #define REPOPTS     "-E,-T,--cut_ga,--cut_nc,--cut_tc"
@@ -73,8 +147,8 @@ typedef struct {
  * options which are actually incompatible with a lot of other
  * options. 
  *
- * #define ICWMAX   "--nohmm,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--noF6,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--F6,--ftau,--fsums,--fqdb,--fbeta,--fnonbanded,--nocykenv,--cykenvx,--tau,--sums,--nonbanded,--rt1,--rt2,--rt3,--ns,--maxtau,--anytrunc,--onlytrunc,--5trunc,--3trunc,--onepass"
- * #define ICWNOHMM "--max,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--ftau,--fsums,--tau,--sums,--rt1,--rt2,--rt3,--ns,--maxtau,--anytrunc,--onlytrunc,--5trunc,--3trunc,--onepass"
+ * #define ICWMAX   "--nohmm,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--noF6,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--F6,--ftau,--fsums,--fqdb,--fbeta,--fnonbanded,--nocykenv,--cykenvx,--tau,--sums,--nonbanded,--rt1,--rt2,--rt3,--ns,--maxtau,--anytrunc,--onlytrunc,--5trunc,--3trunc,--onepass,--shortpass"
+ * #define ICWNOHMM "--max,--mid,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--noF4,--doF1b,--noF2b,--noF3b,--noF4b,--doF5b,--F1,--F1b,--F2,--F2b,--F3,--F3b,--F4,--F4b,--F5,--ftau,--fsums,--tau,--sums,--rt1,--rt2,--rt3,--ns,--maxtau,--anytrunc,--onlytrunc,--5trunc,--3trunc,--onepass,--shortpass"
  * #define ICWMID   "--max,--nohmm,--default,--rfam,--FZ,--noF1,--noF2,--noF3,--doF1b,--noF2b,--F1,--F1b,--F2,--F2b"
  * #define ICWDF    "--max,--nohmm,--mid,--rfam,--FZ"
  * #define ICWRFAM  "--max,--nohmm,--mid,--default,--FZ"
@@ -89,6 +163,16 @@ typedef struct {
 #define MPIOPTS     NULL
 #endif
 
+#ifdef HAVE_MPI
+#define CKPTOPTS    "--mpi"
+#define MERGEOPTS   "--mpi,--ckpt,--hitsout,--deferali,--dbidx"
+#define SHARDOPTS   "--mpi,--merge"
+#else
+#define CKPTOPTS    NULL
+#define MERGEOPTS   "--ckpt,--hitsout,--deferali,--dbidx"
+#define SHARDOPTS   "--merge"
+#endif
+
 static ESL_OPTIONS options[] = {
   /* name           type      default  env  range     toggles   reqs   incomp            help                                                          docgroup*/
   { "-h",           eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,            "show brief help on version and usage",                          1 },
@@ -100,6 +184,7 @@ static ESL_OPTIONS options[] = {
   { "-o",           eslARG_OUTFILE, NULL, NULL, NULL,    NULL,  NULL,  NULL,            "direct output to file <f>, not stdout",                        2 },
   { "-A",           eslARG_OUTFILE, NULL, NULL, NULL,    NULL,  NULL,  NULL,            "save multiple alignment of all significant hits to file <s>",  2 },
   { "--tblout",     eslARG_OUTFILE, NULL, NULL, NULL,    NULL,  NULL,  NULL,            "save parseable table of hits to file <s>",                     2 },
+  { "--hitsout",    eslARG_OUTFILE, NULL, NULL, NULL,    NULL,  NULL,  "--deferali",    "save binary hit lists to file <f>, for merging with --merge",  2 },
   { "--acc",        eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,            "prefer accessions over names in output",                       2 },
   { "--noali",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,            "don't output alignments, so output is smaller",                2 },
   { "--notextw",    eslARG_NONE,    NULL, NULL, NULL,    NULL,  NULL, "--textw",        "unlimit ASCII text output line width",                         2 },
@@ -141,6 +226,14 @@ static ESL_OPTIONS options[] = {
   { "--toponly",    eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "only search the top strand",                                     7 },
   { "--bottomonly", eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "only search the bottom strand",                                  7 },
   { "--tformat",    eslARG_STRING,  NULL, NULL, NULL,    NULL,  NULL,  NULL,                           "assert target <seqdb> is in format <s>: no autodetection",       7 },
+  { "--lowmem",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "discard redundant overlapping hits during search to save memory", 7 },
+  { "--deferali",   eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  "--trmF3",                      "only align hits after thresholding, not during search",          7 },
+  { "--ckpt",       eslARG_OUTFILE, NULL, NULL, NULL,    NULL,  NULL,  CKPTOPTS,                       "save search progress to checkpoint file <f>",                    7 },
+  { "--ckptmb",     eslARG_REAL,  "100.", NULL, "x>0",   NULL,"--ckpt", NULL,                          "w/--ckpt, save a checkpoint after each <x> Mb of target searched", 7 },
+  { "--resume",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,"--ckpt", NULL,                          "w/--ckpt, resume search from checkpoint file <f>",               7 },
+  { "--merge",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  MERGEOPTS,                      "merge --hitsout files given in place of <seqdb>, don't search",  7 },
+  { "--shard",      eslARG_STRING,  NULL, NULL, NULL,    NULL,"--hitsout", SHARDOPTS,                  "search only shard <s>=<i>/<n> of <seqdb> (needs SSI), for --merge", 7 },
+  { "--dbidx",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "save/reuse <seqdb> seq lengths and offsets in index <seqdb>.cmdbi", 7 },
   { "--glist",      eslARG_INFILE,  NULL, NULL, NULL,    NULL,  NULL,  NULL,                           "BOGUS OPTION, NEVER ALLOWED",    999 },
   { "--clanin",     eslARG_INFILE,  NULL, NULL, NULL,    NULL,  NULL,  NULL,                           "BOGUS OPTION, NEVER ALLOWED",    999 },
   { "--oclan",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  NULL,                           "BOGUS OPTION, NEVER ALLOWED",    999 },
@@ -166,6 +259,8 @@ static ESL_OPTIONS options[] = {
   { "--noF3b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn off the HMM Fwd composition bias filter",               101 },
   { "--noF4b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn off the HMM glocal Fwd composition bias filter",        101 },
   { "--doF5b",      eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL, NULL,             "turn on  the HMM per-envelope composition bias filter",      101 },
+  { "--lcmask",     eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF1",         "mask low complexity regions (score > <x> bits) before SSV",  101 },
+  { "--lcw",        eslARG_INT,     "64", NULL, "n>=8",  NULL,"--lcmask", NULL,         "with --lcmask, set low complexity window length to <n>",     101 },
   { "--F1",         eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF1",         "Stage 1 (SSV) threshold:         promote hits w/ P <= <x>",  101 },
   { "--F1b",        eslARG_REAL,   FALSE, NULL, "x>0",   NULL,"--doF1b", NULL,          "Stage 1 (MSV) bias threshold:    promote hits w/ P <= <x>",  101 },
   { "--F2",         eslARG_REAL,   FALSE, NULL, "x>0",   NULL,  NULL, "--noF2",         "Stage 2 (Vit) threshold:         promote hits w/ P <= <x>",  101 },
@@ -228,6 +323,7 @@ static ESL_OPTIONS options[] = {
   { "--seed",       eslARG_INT,    "181", NULL, "n>=0",  NULL,  NULL,  NULL,                 "set RNG seed to <n> (if 0: one-time arbitrary seed)",           108 },
   { "--block",      eslARG_INT,     NULL, NULL, "n>0",   NULL,  NULL,  NULL,                 "BOGUS OPTION, NEVER ALLOWED",                                   999 },
   { "--onepass",    eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,"--nohmm,--qdb,--fqdb", "use CM only for best scoring HMM pass for full seq envelopes",  108 },
+  { "--shortpass",  eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,"-g,--nohmm,--qdb,--fqdb,--notrunc,--anytrunc,--onlytrunc,--5trunc,--3trunc", "search seqs <= W with both ends in one truncated pass, one envelope", 108 },
   { "--onlytrunc",  eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,    "allow only truncated hits, anywhere within sequences",                  108 },
   { "--5trunc",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,    "allow truncated hits only at 5' ends of sequences",                     108 },
   { "--3trunc",     eslARG_NONE,   FALSE, NULL, NULL,    NULL,  NULL,  TRUNCOPTS,    "allow truncated hits only at 3' ends of sequences",                     108 },
@@ -258,12 +354,13 @@ static char usage[]  = "[options] <cmfile> <seqdb>";
 static char banner[] = "search CM(s) against a sequence database";
 
 static int  serial_master(ESL_GETOPTS *go, struct cfg_s *cfg);
-static int  serial_loop  (WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL);
+static int  serial_loop  (WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL, int64_t seq_end);
 
 #ifdef HMMER_THREADS
 #define BLOCK_SIZE 1000
-static int  thread_loop(WORKER_INFO *info, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, int64_t *srcL);
+static int  thread_loop(WORKER_INFO *info, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, int64_t *srcL, int64_t seq_end);
 static void pipeline_thread(void *arg);
+static void align_thread(void *arg);
 #endif /*HMMER_THREADS*/
 
 #ifdef HAVE_MPI
@@ -276,12 +373,39 @@ static int  output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *
 
 /* Functions to avoid code duplication for common tasks */
 static int          open_dbfile(ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, ESL_SQFILE **ret_dbfp);
-static int          dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr, char *errbuf, int64_t **ret_srcL, int64_t *ret_nseqs);
+static int          dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr, char *errbuf, int64_t **ret_srcL, int64_t **ret_offset, int64_t *ret_nseqs);
 static WORKER_INFO *create_info(const ESL_GETOPTS *go);
 static int          clone_info(ESL_GETOPTS *go, WORKER_INFO *src_info, WORKER_INFO *dest_infoA, int dest_infocnt, char *errbuf);
 static void         free_info(WORKER_INFO *info);
 static int          configure_cm(WORKER_INFO *info);
 static int          setup_hmm_filter(ESL_GETOPTS *go, WORKER_INFO *info);
+static int          prune_window_hits(WORKER_INFO *info, int64_t hit_start, int64_t from, int64_t to, int64_t L);
+static int          collect_deferred_hits(CM_TOPHITS *th, ESL_SQFILE *dbfp, const ESL_ALPHABET *abc, int64_t *srcL, char *errbuf, DEFERRED_ALI **ret_dali);
+static int          align_deferred_hit(WORKER_INFO *info, int64_t i);
+static void         free_deferred_ali(DEFERRED_ALI *dali);
+static int          deferred_hit_sorter(const void *vh1, const void *vh2);
+static CKPT        *ckpt_create(void);
+static void         ckpt_destroy(CKPT *ckpt);
+static void         ckpt_set_offsets(CKPT *ckpt, FILE *ofp, FILE *afp, FILE *tblfp, FILE *hitsfp);
+static int          ckpt_write(char *ckptfile, CKPT *ckpt, WORKER_INFO *info, int nlists, char *errbuf);
+static int          ckpt_read(char *ckptfile, char *errbuf, CKPT **ret_ckpt);
+static int          ckpt_restore(CKPT *ckpt, char *cm_name, WORKER_INFO *info, char *errbuf);
+static int          ckpt_reopen_output(char *filename, int64_t offset, char *errbuf, FILE **ret_fp);
+static int          ckpt_skip_seqs(ESL_SQFILE *dbfp, int64_t nskip, char *errbuf);
+static int          hits_write_header(FILE *fp, char *dbfile, int64_t Z, enum cm_zsetby_e Z_setby, int shard_idx, int nshards);
+static int          hits_write_query(FILE *fp, char *cm_name, CM_PIPELINE *pli, CM_TOPHITS *th);
+static int          hits_write_tail(FILE *fp);
+static int          hits_open(char *hitsfile, char *errbuf, FILE **ret_fp, char **ret_dbfile, int64_t *ret_Z, enum cm_zsetby_e *ret_Z_setby, int *ret_shard_idx, int *ret_nshards);
+static int          hits_read_query(FILE *fp, char *hitsfile, char *cm_name, int do_offset, CM_PIPELINE *pli, CM_TOPHITS *th, char *errbuf);
+static int          hits_read_tail(FILE *fp, char *hitsfile, char *errbuf);
+static int          merge_open(ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, FILE ***ret_hitsfpA, int *ret_nhitsfiles, int *ret_sharded);
+static int          parse_shard(char *shard, int *ret_shard_idx, int *ret_nshards);
+static int          shard_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE *dbfp, int shard_idx, int nshards, char *errbuf, int64_t **ret_srcL, int64_t *ret_first, int64_t *ret_end, off_t *ret_first_offset);
+static int          shard_seq_sorter(const void *vh1, const void *vh2);
+static int          dbidx_stat(char *dbfile, int64_t *ret_size, int64_t *ret_mtime);
+static int          dbidx_read(char *dbfile, int format, int64_t size, int64_t mtime, DBIDX **ret_idx);
+static int          dbidx_write(char *dbfile, int format, int64_t size, int64_t mtime, DBIDX *idx);
+static void         dbidx_destroy(DBIDX *idx);
 
 #ifdef HAVE_MPI
 
@@ -323,6 +447,54 @@ typedef struct mpi_block_list_s {
   int              nalloc;    /* number of blocks elements allocated */
 } MPI_BLOCK_LIST;
 
+/* MIN_SPLIT_SIZE: blocks are never split into pieces smaller than
+ * this many residues (or 4 * ncontext, if that's larger), see
+ * mpi_split_block().
+ */
+#define MIN_SPLIT_SIZE (10000)
+/* MAX_WORKER_BLOCKS: maximum number of blocks a worker holds, the
+ * one it's searching plus the ones it's been sent ahead of time, so
+ * it can start on the next block as soon as it finishes the current
+ * one. Only one block at a time is sent once all sequences have been
+ * inspected, so the remaining residues can be shared evenly.
+ */
+#define MAX_WORKER_BLOCKS (2)
+typedef struct mpi_worker_s {
+  /* The master's view of a worker's progress on its current block,
+   * used to balance the load at the end of the search for each
+   * query. Once all sequences have been inspected, the remaining
+   * blocks are split into smaller pieces as they are handed out, and
+   * when none remain, the busy worker expected to finish last is
+   * asked to donate the unsearched sequences at the end of its block
+   * (or the block it was sent ahead of time, if any) to an idle
+   * worker.
+   */
+  int       nblocks;        /* number of blocks worker holds (1 before it has reported ready) */
+  int       nsent;          /* number of blocks sent to worker for current CM */
+  int       can_split;      /* FALSE if worker failed to donate part of its current block */
+  int       split_pending;  /* TRUE if worker has been asked to donate and hasn't replied */
+  int64_t   blockL;         /* residues in worker's blocks, less those it donated */
+  double    t0;             /* MPI_Wtime() when worker started its current block */
+} MPI_WORKER;
+
+typedef struct mpi_worker_comm_s {
+  /* A worker's non-blocking receives. One is always posted for the
+   * next block, so the master can send it while we're still
+   * searching the current one, and one for a request to donate part
+   * of our block. Hits are sent back to the master with non-blocking
+   * sends as each block is finished.
+   */
+  MPI_Request  block_req;   /* receive for next block */
+  char        *block_buf;   /* buffer <block_req> receives into, holds one packed MPI_BLOCK */
+  int          block_n;     /* size of <block_buf> */
+  MPI_Request  split_req;   /* receive for request to donate */
+  int          split_nsent; /* buffer <split_req> receives into, number of blocks master has sent us */
+  int          nrecv;       /* number of blocks we've received for current CM */
+  MPI_Request  hits_req;    /* send of previous batch of hits */
+  char        *hits_buf;    /* buffer <hits_req> sends from */
+  int          hits_n;      /* size of <hits_buf> */
+} MPI_WORKER_COMM;
+
 /* workunit tags used by the MPI master/slave processes */
 #define INFERNAL_ERROR_TAG          1
 #define INFERNAL_BLOCK_TAG          2
@@ -330,6 +502,9 @@ typedef struct mpi_block_list_s {
 #define INFERNAL_TOPHITS_TAG        4
 #define INFERNAL_TERMINATING_TAG    5
 #define INFERNAL_READY_TAG          6
+#define INFERNAL_SPLIT_TAG          7
+#define INFERNAL_DONATED_TAG        8
+#define INFERNAL_RETURNED_TAG       9
 
 static void mpi_failure(char *format, ...);
 static int  mpi_open_dbfile_ssi(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE *dbfp, char *errbuf);
@@ -339,8 +514,15 @@ static int  mpi_add_blocks(ESL_SQFILE *dbfp, ESL_SQ *sq, int64_t ncontext, char
 static int  mpi_inspect_next_sequence_using_ssi(ESL_SQFILE *dbfp, ESL_SQ *sq, int64_t ncontext, int64_t pkey_idx, char *errbuf, 
 						MPI_BLOCK_LIST *block_list, int64_t *ret_noverlap);
 
+static int  mpi_split_block(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t headL, int64_t minL, int64_t ncontext, int at_seq_ends, 
+			    char *errbuf, MPI_BLOCK **ret_tail, int64_t *ret_noverlap);
+static int  mpi_worker_donate(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t pkey_idx, int64_t readL, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc);
+static int  mpi_worker_answer_split(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t pkey_idx, int64_t readL, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc);
+static int  mpi_worker_recv_block(ESL_SQFILE *dbfp, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc, MPI_BLOCK **ret_block);
+
 static MPI_BLOCK      *create_mpi_block();
 static MPI_BLOCK_LIST *create_mpi_block_list();
+static int             prepend_mpi_block(MPI_BLOCK_LIST *list, MPI_BLOCK *block);
 static void            free_mpi_block_list(MPI_BLOCK_LIST *list);
 #if eslDEBUGLEVEL >= 1
 /* useful only for debugging */
@@ -438,6 +620,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   FILE            *ofp      = stdout;            /* results output file (-o)                        */
   FILE            *afp      = NULL;              /* alignment output file (-A)                      */
   FILE            *tblfp    = NULL;              /* output stream for tabular hits (--tblout)       */
+  FILE            *hitsfp   = NULL;              /* binary hit lists output file (--hitsout)        */
   CM_FILE         *cmfp;		         /* open input CM file stream                       */
   CM_t            *cm       = NULL;              /* covariance model                                */
   ESL_SQFILE      *dbfp     = NULL;              /* open input sequence file                        */
@@ -450,6 +633,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   int              qhstatus = eslOK;
   int              sstatus  = eslOK;
   int              i;
+  int              step;                         /* for merging worker hit lists pairwise */
 
   int              ncpus    = 0;
 
@@ -458,13 +642,34 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   int              infocnt       = 0;            /* number of worker infos */
 
   int64_t         *srcL = NULL;                  /* [0..pli->nseqs-1] full length of each target sequence read */
+  int64_t         *dboff = NULL;                 /* [0..pli->nseqs-1] offset of each target sequence in the file, -1 if unknown; NULL with --shard */
   int64_t          nseqs_expected = 0;           /* nseqs read in first pass, pli->nseqs should equal this at end of function */
   double           eZ;                           /* effective database size */
   int              nbps;                         /* number of basepairs in current CM */
+  DEFERRED_ALI    *dali     = NULL;              /* hits to align after thresholding, only used if --deferali */
+  int64_t          h;                            /* counter over deferred hits */
+  int              p;                            /* counter over pipeline passes */
+  int64_t          seq_end;                      /* search ends after this many target seqs (all, unless --ckpt) */
+  int64_t          prv_nseqs;                    /* number of target seqs searched before current segment */
+  int64_t          seg_nres;                     /* number of residues in current segment */
+  int64_t          nres;                         /* number of residues in target database, only computed if --ckpt */
+  double           ckpt_nres = 0.;               /* with --ckpt, number of residues to search between checkpoints */
+  char            *ckptfile  = NULL;             /* checkpoint file, only used if --ckpt */
+  CKPT            *ckpt      = NULL;             /* search progress, only used if --ckpt */
+  int              do_resume = FALSE;            /* TRUE if resuming from <ckptfile> and we haven't reached its query yet */
+  int              do_merge  = esl_opt_GetBoolean(go, "--merge"); /* TRUE to merge --hitsout files instead of searching */
+  FILE           **hitsfpA   = NULL;             /* [0..nhitsfiles-1] open --hitsout files we're merging, only if --merge */
+  int              nhitsfiles = 0;               /* number of --hitsout files we're merging */
+  int              sharded    = FALSE;           /* TRUE if merging --hitsout files saved with --shard */
+  int              shard_idx  = 0;               /* with --shard, index of the shard we're searching, 1..nshards */
+  int              nshards    = 0;               /* with --shard, number of shards, 0 if not sharded */
+  int64_t          shard_first = 0;              /* index of first target seq we search, 0 unless --shard */
+  off_t            shard_offset = 0;             /* with --shard, offset of seq <shard_first> in the target file */
 
 #ifdef HMMER_THREADS
   ESL_SQ_BLOCK    *block    = NULL;
   ESL_THREADS     *threadObj= NULL;
+  ESL_THREADS     *alignObj = NULL;
   ESL_WORK_QUEUE  *queue    = NULL;
 #endif
   char             errbuf[eslERRBUFSIZE];
@@ -476,24 +681,47 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   if (esl_opt_GetBoolean(go, "--notextw")) textw = 0;
   else                                     textw = esl_opt_GetInteger(go, "--textw");
 
-  /* Open the database file */
-  if((status = open_dbfile(go, cfg, errbuf, &dbfp)) != eslOK) esl_fatal(errbuf); 
+  /* Open the database file, or with --merge, the --hitsout files we're merging */
+  if(do_merge) { if((status = merge_open(go, cfg, errbuf, &hitsfpA, &nhitsfiles, &sharded)) != eslOK) cm_Fail(errbuf); }
+  else         { if((status = open_dbfile(go, cfg, errbuf, &dbfp))                != eslOK) esl_fatal(errbuf); }
 
   /* Open the query CM file */
   if((status = cm_file_Open(cfg->cmfile, NULL, FALSE, &(cmfp), errbuf)) != eslOK) cm_Fail(errbuf);
 
-  /* Open the results output files */
-  if (esl_opt_IsOn(go, "-o"))           { if ((ofp       = fopen(esl_opt_GetString(go, "-o"),          "w")) == NULL) cm_Fail("Failed to open output file %s for writing\n",         esl_opt_GetString(go, "-o")); }
-  if (esl_opt_IsOn(go, "-A"))           { if ((afp       = fopen(esl_opt_GetString(go, "-A"),          "w")) == NULL) cm_Fail("Failed to open alignment file %s for writing\n", esl_opt_GetString(go, "-A")); }
-  if (esl_opt_IsOn(go, "--tblout"))     { if ((tblfp     = fopen(esl_opt_GetString(go, "--tblout"),    "w")) == NULL) cm_Fail("Failed to open tabular output file %s for writing\n", esl_opt_GetString(go, "--tblout")); }
+  /* Read the checkpoint we're resuming from, if any; before we open the output files */
+  if (esl_opt_IsOn(go, "--ckpt")) { 
+    ckptfile  = esl_opt_GetString(go, "--ckpt");
+    ckpt_nres = esl_opt_GetReal(go, "--ckptmb") * 1000000.;
+    do_resume = esl_opt_GetBoolean(go, "--resume");
+    if(do_resume) { if((status = ckpt_read(ckptfile, errbuf, &ckpt)) != eslOK) cm_Fail(errbuf); }
+    else          { if((ckpt = ckpt_create()) == NULL) cm_Fail("Out of memory"); }
+  }
+
+  /* Open the results output files; if resuming, reopen them and
+   * discard any output written after the checkpoint was saved 
+   */
+  if (do_resume) { 
+    if (esl_opt_IsOn(go, "-o"))         { if ((status = ckpt_reopen_output(esl_opt_GetString(go, "-o"),       ckpt->offA[0], errbuf, &ofp))   != eslOK) cm_Fail(errbuf); }
+    if (esl_opt_IsOn(go, "-A"))         { if ((status = ckpt_reopen_output(esl_opt_GetString(go, "-A"),       ckpt->offA[1], errbuf, &afp))   != eslOK) cm_Fail(errbuf); }
+    if (esl_opt_IsOn(go, "--tblout"))   { if ((status = ckpt_reopen_output(esl_opt_GetString(go, "--tblout"), ckpt->offA[2], errbuf, &tblfp)) != eslOK) cm_Fail(errbuf); }
+    if (esl_opt_IsOn(go, "--hitsout"))  { if ((status = ckpt_reopen_output(esl_opt_GetString(go, "--hitsout"), ckpt->offA[3], errbuf, &hitsfp)) != eslOK) cm_Fail(errbuf); }
+  }
+  else { 
+    if (esl_opt_IsOn(go, "-o"))         { if ((ofp       = fopen(esl_opt_GetString(go, "-o"),          "w")) == NULL) cm_Fail("Failed to open output file %s for writing\n",         esl_opt_GetString(go, "-o")); }
+    if (esl_opt_IsOn(go, "-A"))         { if ((afp       = fopen(esl_opt_GetString(go, "-A"),          "w")) == NULL) cm_Fail("Failed to open alignment file %s for writing\n", esl_opt_GetString(go, "-A")); }
+    if (esl_opt_IsOn(go, "--tblout"))   { if ((tblfp     = fopen(esl_opt_GetString(go, "--tblout"),    "w")) == NULL) cm_Fail("Failed to open tabular output file %s for writing\n", esl_opt_GetString(go, "--tblout")); }
+    if (esl_opt_IsOn(go, "--hitsout"))  { if ((hitsfp    = fopen(esl_opt_GetString(go, "--hitsout"),   "wb")) == NULL) cm_Fail("Failed to open hits output file %s for writing\n", esl_opt_GetString(go, "--hitsout")); }
+  }
 
 #ifdef HMMER_THREADS
   /* initialize thread data */
   if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
   else                                   esl_threads_CPUCount(&ncpus);
+  if (do_merge) ncpus = 0; /* nothing to search */
   if (ncpus > 0) {
     threadObj = esl_threads_Create(&pipeline_thread);
     queue = esl_workqueue_Create(ncpus * 2);
+    if(esl_opt_GetBoolean(go, "--deferali")) alignObj = esl_threads_Create(&align_thread);
   }
 #endif
 
@@ -504,30 +732,60 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   qhstatus = cm_file_Read(cmfp, TRUE, &abc, &cm);
 
   if (qhstatus == eslOK) {
-    /* One-time initializations after alphabet <abc> becomes known */
-    output_header(ofp, go, cfg->cmfile, cfg->dbfile, ncpus);
-    dbfp->abc = abc;
-    
-    /* Determine database size and sequence lengths (do this here and
-     * not earlier b/c it may take a little while so we make sure we
-     * get this far first) by reading the file (we purposefully don't
-     * use SSI even if it exists, as it's not significantly faster;
-     * xref: ~nawrockie/notebook/12_0221_inf_pipeline_finalize/00LOG,
-     * Feb 24). If -Z is enabled, we still need to read the sequence
-     * file to get seq lengths, we'll set Z in
-     * dbsize_and_seq_lengths() and then overwrite it based on <x>
-     * from -Z <x>.
+    /* One-time initializations after alphabet <abc> becomes known;
+     * if resuming, the header is already in the output file 
+     */
+    if((! do_resume) || ofp == stdout) output_header(ofp, go, cfg->cmfile, cfg->dbfile, ncpus);
+
+    /* with --merge, there's no database to search, merge_open() set Z 
+     * from the --hitsout files and there are no sequences to read 
      */
-    if ((! esl_sqfile_IsRewindable(dbfp)) && dbfp->data.ascii.do_gzip == FALSE) { 
+    if(! do_merge) { 
+      dbfp->abc = abc;
+
+      /* Determine database size and sequence lengths (do this here and
+       * not earlier b/c it may take a little while so we make sure we
+       * get this far first) by reading the file (we purposefully don't
+       * use SSI even if it exists, as it's not significantly faster;
+       * xref: ~nawrockie/notebook/12_0221_inf_pipeline_finalize/00LOG,
+       * Feb 24). If -Z is enabled, we still need to read the sequence
+       * file to get seq lengths, we'll set Z in
+       * dbsize_and_seq_lengths() and then overwrite it based on <x>
+       * from -Z <x>. With --shard, we only read our shard of the 
+       * file, so we do use SSI, see shard_seq_lengths(). With
+       * --dbidx, the sizes are read from the <seqdb>.cmdbi index
+       * instead, if it's up to date, and we only read the file once.
+       */
+      if ((! esl_sqfile_IsRewindable(dbfp)) && dbfp->data.ascii.do_gzip == FALSE) { 
 	cm_Fail("Target sequence file %s isn't rewindable, cmsearch needs to be able to rewind it", cfg->dbfile);
-    }
-    if((status = dbsize_and_seq_lengths(go, cfg, &dbfp, errbuf, &srcL, &nseqs_expected)) != eslOK) { 
-      cm_Fail("Parse failed (sequence file %s):\n%s\n", dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+      }
+      if (esl_opt_GetBoolean(go, "--deferali") && (! esl_sqfile_IsRewindable(dbfp))) { 
+        cm_Fail("Target sequence file %s isn't rewindable, --deferali requires a rewindable file", cfg->dbfile);
+      }
+      if(esl_opt_IsOn(go, "--shard")) { 
+        parse_shard(esl_opt_GetString(go, "--shard"), &shard_idx, &nshards); /* validated in process_commandline() */
+        if((status = shard_seq_lengths(go, cfg, dbfp, shard_idx, nshards, errbuf, &srcL, &shard_first, &nseqs_expected, &shard_offset)) != eslOK) cm_Fail(errbuf);
+      }
+      else if((status = dbsize_and_seq_lengths(go, cfg, &dbfp, errbuf, &srcL, &dboff, &nseqs_expected)) != eslOK) { 
+        cm_Fail("Parse failed (sequence file %s):\n%s\n", dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+      }
     }
     if(esl_opt_IsUsed(go, "-Z")) { /* -Z enabled, use that size */
       cfg->Z       = (int64_t) (esl_opt_GetReal(go, "-Z") * 1000000.); 
       cfg->Z_setby = CM_ZSETBY_OPTION; 
     }
+    if(hitsfp != NULL && (! do_resume)) { 
+      if((status = hits_write_header(hitsfp, cfg->dbfile, cfg->Z, cfg->Z_setby, shard_idx, nshards)) != eslOK) cm_Fail("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout"));
+    }
+    if(ckpt != NULL) { 
+      for(nres = 0, h = shard_first; h < nseqs_expected; h++) nres += srcL[h];
+      if(do_resume && (ckpt->nseqs != nseqs_expected || ckpt->nres != nres)) { 
+        cm_Fail("Checkpoint file %s was saved by a search of a different target database (%" PRId64 " seqs, %" PRId64 " residues; %s has %" PRId64 " seqs, %" PRId64 " residues)", 
+                ckptfile, ckpt->nseqs, ckpt->nres, cfg->dbfile, nseqs_expected, nres);
+      }
+      ckpt->nseqs = nseqs_expected;
+      ckpt->nres  = nres;
+    }
 
     for (i = 0; i < infocnt; ++i)    {
       info[i].pli          = NULL;
@@ -535,6 +793,8 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       info[i].cm           = NULL;
       info[i].om           = NULL;
       info[i].bg           = NULL;
+      info[i].do_lowmem    = esl_opt_GetBoolean(go, "--lowmem");
+      info[i].dali         = NULL;
       ESL_ALLOC(info[i].p7_evparam, sizeof(float) * CM_p7_NEVPARAM);
 #ifdef HMMER_THREADS
       info[i].queue        = queue;
@@ -555,6 +815,13 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   /* Outer loop: over each query CM in <cmfile>. */
   while (qhstatus == eslOK) {
     cm_idx++;
+
+    /* if resuming, skip queries that were complete when the checkpoint was saved */
+    if(do_resume && cm_idx < ckpt->cm_idx) { 
+      FreeCM(cm);
+      qhstatus = cm_file_Read(cmfp, TRUE, &abc, &cm);
+      continue;
+    }
     esl_stopwatch_Start(w);
     
     /* create a new template info, and point it to the cm we just read */
@@ -580,12 +847,23 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     }
        
     /* seqfile may need to be rewound (multiquery mode) */
-    if (cm_idx > 1) {
+    if (dbfp != NULL && cm_idx > 1) {
       if (! esl_sqfile_IsRewindable(dbfp))
 	esl_fatal("Target sequence file %s isn't rewindable; can't search it with multiple queries", cfg->dbfile);
       esl_sqfile_Position(dbfp, 0);
     }
 
+    /* with --shard, skip to the first sequence of our shard; the 
+     * search indexes target seqs from <shard_first>, so hits have 
+     * the same sequence indices as in a search of the full database
+     */
+    if (shard_first > 0 && shard_first < nseqs_expected) { 
+      if(esl_sqfile_Position(dbfp, shard_offset) != eslOK) cm_Fail("Failed to position target sequence file %s at shard %d of %d", cfg->dbfile, shard_idx, nshards);
+    }
+
+    /* with --ckpt, remember where this query's output starts */
+    if(ckpt != NULL) ckpt_set_offsets(ckpt, ofp, afp, tblfp, hitsfp);
+
     fprintf(ofp, "Query:       %s  [CLEN=%d]\n", tinfo->cm->name, tinfo->cm->clen);
     if (tinfo->cm->acc)  fprintf(ofp, "Accession:   %s\n", tinfo->cm->acc);
     if (tinfo->cm->desc) fprintf(ofp, "Description: %s\n", tinfo->cm->desc);
@@ -609,29 +887,70 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
                                    -1, NULL)) != eslOK) { /* -1 is for clan_idx, irrelevant in this context */
 	cm_Fail(info[i].pli->errbuf);
       }
+    }
 
-#ifdef HMMER_THREADS
-      if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
-#endif
+    if(ckpt != NULL) { 
+      /* if resuming, pick up the search of this query where the checkpoint left it */
+      if(do_resume) { 
+        if((status = ckpt_restore(ckpt, tinfo->cm->name, &(info[0]), errbuf)) != eslOK) cm_Fail(errbuf);
+        if(dboff != NULL && info[0].pli->nseqs < nseqs_expected && dboff[info[0].pli->nseqs] >= 0) { /* jump straight to the first seq we haven't searched */
+          if(esl_sqfile_Position(dbfp, (off_t) dboff[info[0].pli->nseqs]) != eslOK) cm_Fail("Failed to position target sequence file %s at sequence %" PRId64, cfg->dbfile, info[0].pli->nseqs+1);
+        }
+        else if((status = ckpt_skip_seqs(dbfp, info[0].pli->nseqs - shard_first, errbuf)) != eslOK) cm_Fail(errbuf);
+        do_resume = FALSE;
+      }
+      ckpt->cm_idx = cm_idx;
+      if(ckpt->cm_name != NULL) free(ckpt->cm_name);
+      if((status = esl_strdup(tinfo->cm->name, -1, &(ckpt->cm_name))) != eslOK) cm_Fail("Out of memory");
+    }
+
+    /* With --merge, read this query's accounting and hits from each
+     * --hitsout file instead of searching; <nseqs_expected> is 0, so 
+     * the search loop below is skipped.
+     */
+    for(i = 0; i < nhitsfiles; i++) { 
+      if((status = hits_read_query(hitsfpA[i], esl_opt_GetArg(go, i+2), tinfo->cm->name, (! sharded), info[0].pli, info[0].th, errbuf)) != eslOK) cm_Fail(errbuf);
     }
 
+    if(info[0].pli->nseqs == 0) info[0].pli->nseqs = shard_first; /* unless resuming */
+
+    /* Search the target database. With --ckpt, we search it in
+     * segments of consecutive sequences with about <ckpt_nres>
+     * residues each, and save a checkpoint after each segment. 
+     */
+    while(info[0].pli->nseqs < nseqs_expected) { 
+      prv_nseqs = info[0].pli->nseqs;
+      seq_end   = nseqs_expected;
+      if(ckpt != NULL) { 
+        for(seq_end = prv_nseqs, seg_nres = 0; seq_end < nseqs_expected && seg_nres < ckpt_nres; seq_end++) seg_nres += srcL[seq_end];
+      }
 #ifdef HMMER_THREADS
-    if (ncpus > 0)  sstatus = thread_loop(info, threadObj, queue, dbfp, srcL);
-    else            sstatus = serial_loop(info, dbfp, srcL);
+      if (ncpus > 0) { 
+        for (i = 0; i < infocnt; ++i) esl_threads_AddThread(threadObj, &info[i]);
+        sstatus = thread_loop(info, threadObj, queue, dbfp, srcL, seq_end);
+      }
+      else sstatus = serial_loop(info, dbfp, srcL, seq_end);
 #else
-    sstatus = serial_loop(info, dbfp, srcL);
+      sstatus = serial_loop(info, dbfp, srcL, seq_end);
 #endif
-    switch(sstatus) {
-    case eslEFORMAT:
-      esl_fatal("Parse failed (sequence file %s):\n%s\n",
-		dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
-      break;
-    case eslEOF:
-      /* do nothing */
-      break;
-    default:
-      esl_fatal("Unexpected error %d reading sequence file %s", sstatus, dbfp->filename);
+      switch(sstatus) {
+      case eslEFORMAT:
+	esl_fatal("Parse failed (sequence file %s):\n%s\n",
+		  dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+	break;
+      case eslEOF:
+	/* do nothing */
+	break;
+      default:
+	esl_fatal("Unexpected error %d reading sequence file %s", sstatus, dbfp->filename);
+      }
+      if(info[0].pli->nseqs < seq_end) break; /* file ended before we expected it to */
+
+      if(ckpt != NULL && info[0].pli->nseqs < nseqs_expected) { 
+	if((status = ckpt_write(ckptfile, ckpt, info, infocnt, errbuf)) != eslOK) cm_Fail(errbuf);
+      }
     }
+    info[0].pli->nseqs -= shard_first; /* count only our shard's seqs */
 
     /* we need to re-compute e-values before merging (when list will be sorted) */
     for (i = 0; i < infocnt; ++i) { 
@@ -640,16 +959,29 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       cm_tophits_ComputeEvalues(info[i].th, eZ, 0);
     }
 
-    /* merge the search results */
+    /* merge the search results; if threaded, each worker has sorted
+     * its own hits for overlap removal, merging them pairwise in a
+     * balanced tree keeps the merged list sorted (a k-way merge)
+     */
+    for (step = 1; step < infocnt; step *= 2) { 
+      for (i = 0; i+step < infocnt; i += 2*step) { 
+        cm_tophits_Merge(info[i].th, info[i+step].th);
+      }
+    }
     for (i = 1; i < infocnt; ++i) {
-      cm_tophits_Merge(info[0].th,   info[i].th);
       cm_pipeline_Merge(info[0].pli, info[i].pli);
-      free_info(&info[i]);
+      /* with --deferali, we'll need the worker's CM for alignment below */
+      if(! info[0].pli->do_defer_ali) free_info(&info[i]);
+    }
+
+    /* with --hitsout, save the hits before overlap removal and thresholding */
+    if(hitsfp != NULL) { 
+      if((status = hits_write_query(hitsfp, tinfo->cm->name, info[0].pli, info[0].th)) != eslOK) cm_Fail("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout"));
     }
 
     /* Sort by sequence index/position and remove duplicates */
     cm_tophits_SortForOverlapRemoval(info[0].th);
-    if((status = cm_tophits_RemoveOrMarkOverlaps(info[0].th, FALSE, errbuf)) != eslOK) cm_Fail(errbuf);
+    if((status = cm_tophits_RemoveOrMarkOverlapsParallel(info[0].th, FALSE, ncpus, errbuf)) != eslOK) cm_Fail(errbuf);
 
     /* Resort: by score (usually) or by position (if in special 'terminate after F3' mode) */
     if(info[0].pli->do_trm_F3) cm_tophits_SortByPosition(info[0].th);
@@ -658,6 +990,44 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     /* Enforce threshold */
     cm_tophits_Threshold(info[0].th, info[0].pli);
 
+    /* Align the hits we'll report, if we deferred alignment until now */
+    if(info[0].pli->do_defer_ali) { 
+      if((status = collect_deferred_hits(info[0].th, dbfp, abc, srcL, errbuf, &dali)) != eslOK) cm_Fail(errbuf);
+      dali->nworkers = infocnt;
+      for (i = 0; i < infocnt; ++i) {
+	info[i].dali = dali;
+	if(i > 0) { /* these were merged into info[0].pli above, zero them so we only add alignments from here on */
+	  for(p = 0; p < NPLI_PASSES; p++) info[i].pli->acct[p].n_aln_hb = info[i].pli->acct[p].n_aln_dccyk = 0;
+	}
+      }
+#ifdef HMMER_THREADS
+      if (ncpus > 0) { 
+	for (i = 0; i < infocnt; ++i) esl_threads_AddThread(alignObj, &info[i]);
+	esl_threads_WaitForStart(alignObj);
+	esl_threads_WaitForFinish(alignObj);
+      }
+      else { 
+	for (h = 0; h < dali->nhit; h++) { 
+	  if((status = align_deferred_hit(&(info[0]), h)) != eslOK) cm_Fail(info[0].pli->errbuf);
+	}
+      }
+#else
+      for (h = 0; h < dali->nhit; h++) { 
+	if((status = align_deferred_hit(&(info[0]), h)) != eslOK) cm_Fail(info[0].pli->errbuf);
+      }
+#endif
+      for (i = 1; i < infocnt; ++i) {
+	for(p = 0; p < NPLI_PASSES; p++) { 
+	  info[0].pli->acct[p].n_aln_hb    += info[i].pli->acct[p].n_aln_hb;
+	  info[0].pli->acct[p].n_aln_dccyk += info[i].pli->acct[p].n_aln_dccyk;
+	}
+	free_info(&info[i]);
+      }
+      info[0].dali = NULL;
+      free_deferred_ali(dali);
+      dali = NULL;
+    }
+
     /* tally up total number of hits and target coverage */
     for (i = 0; i < info->th->N; i++) {
       if ((info[0].th->hit[i]->flags & CM_HIT_IS_REPORTED) || (info[0].th->hit[i]->flags & CM_HIT_IS_INCLUDED)) { 
@@ -715,6 +1085,15 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     }
     fprintf(ofp, "//\n");
 
+    /* with --ckpt, save a checkpoint with this query complete */
+    if(ckpt != NULL) { 
+      ckpt->cm_idx = cm_idx+1;
+      if(ckpt->cm_name != NULL) free(ckpt->cm_name);
+      ckpt->cm_name = NULL;
+      ckpt_set_offsets(ckpt, ofp, afp, tblfp, hitsfp);
+      if((status = ckpt_write(ckptfile, ckpt, NULL, 0, errbuf)) != eslOK) cm_Fail(errbuf);
+    }
+
     free_info(tinfo);
     free(tinfo);
     free_info(&(info[0]));
@@ -727,6 +1106,10 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   case eslEOF:       /* do nothing. EOF is what we want. */                                               break;
   default:           cm_Fail("Unexpected error (%d) in reading CMs from %s\n%s", qhstatus, cfg->cmfile, cmfp->errbuf);
   }
+  if(ckpt != NULL && ckpt->cm_idx > cm_idx+1) cm_Fail("Checkpoint file %s was saved by a search with more query CMs than in %s", ckptfile, cfg->cmfile);
+  for(i = 0; i < nhitsfiles; i++) { 
+    if((status = hits_read_tail(hitsfpA[i], esl_opt_GetArg(go, i+2), errbuf)) != eslOK) cm_Fail(errbuf);
+  }
 
 #ifdef HMMER_THREADS
   if (ncpus > 0) {
@@ -736,22 +1119,30 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     }
     esl_workqueue_Destroy(queue);
     esl_threads_Destroy(threadObj);
+    if(alignObj != NULL) esl_threads_Destroy(alignObj);
   }
 #endif
 
   /* Terminate outputs... any last words?
    */
   if (tblfp)         cm_tophits_TabularTail(tblfp,    "cmsearch", CM_SEARCH_SEQS, cfg->cmfile, cfg->dbfile, go);
+  if (hitsfp)        { if(hits_write_tail(hitsfp) != eslOK) cm_Fail("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout")); }
   fprintf(ofp, "[ok]\n");
 
   esl_stopwatch_Stop(mw);
   if(esl_opt_GetBoolean(go, "--verbose")) esl_stopwatch_Display(stdout, mw, "# Total CPU time:");
 
   free(info);
-  if(srcL != NULL) free(srcL);
+  if(srcL  != NULL) free(srcL);
+  if(dboff != NULL) free(dboff);
 
   cm_file_Close(cmfp);
-  esl_sqfile_Close(dbfp);
+  if(dbfp != NULL) esl_sqfile_Close(dbfp);
+  if(hitsfpA != NULL) { 
+    for(i = 0; i < nhitsfiles; i++) fclose(hitsfpA[i]);
+    free(hitsfpA);
+    free(cfg->dbfile); /* set by merge_open() */
+  }
   esl_alphabet_Destroy(abc);
   if(w  != NULL) esl_stopwatch_Destroy(w);
   if(mw != NULL) esl_stopwatch_Destroy(mw);
@@ -759,6 +1150,13 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   if (ofp != stdout) fclose(ofp);
   if (afp)           fclose(afp);
   if (tblfp)         fclose(tblfp);
+  if (hitsfp)        { if(fclose(hitsfp) != 0) cm_Fail("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout")); }
+
+  /* the search is complete, we won't need the checkpoint */
+  if (ckpt != NULL) { 
+    remove(ckptfile);
+    ckpt_destroy(ckpt);
+  }
 
   return eslOK;
 
@@ -772,15 +1170,18 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
  * Read the sequence file one window of CM_MAX_RESIDUE_COUNT
  * residues (or one sequence, if seqlen < CM_MAX_RESIDUE_COUNT)
  * at a time. Search the top strand of the window, then revcomp it and
- * search the bottom strand.
+ * search the bottom strand. Starts with sequence info->pli->nseqs
+ * and returns eslEOF once sequence <seq_end>-1 has been searched
+ * (or the file ends).
  */
 static int
-serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
+serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL, int64_t seq_end)
 {
   int       status;
   int       wstatus;
   int       prv_pli_ntophits;    /* number of top hits before each cm_Pipeline() */
-  int64_t   seq_idx = 0;
+  int       prv_win_ntophits;    /* number of top hits before each window */
+  int64_t   seq_idx = info->pli->nseqs;
   ESL_SQ   *dbsq    = esl_sq_CreateDigital(info->cm->abc);
 
   wstatus = esl_sqio_ReadWindow(dbfp, info->pli->maxW, CM_MAX_RESIDUE_COUNT, dbsq);
@@ -788,6 +1189,7 @@ serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
 
   while(wstatus == eslEOD) { /* this block is only necessary to chew up zero-length sequences */
     info->pli->nseqs++;
+    if(info->pli->nseqs >= seq_end) { wstatus = eslEOF; break; }
     esl_sq_Reuse(dbsq);
     wstatus = esl_sqio_ReadWindow(dbfp, info->pli->maxW, CM_MAX_RESIDUE_COUNT, dbsq);
     seq_idx++;
@@ -799,6 +1201,7 @@ serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
     if(dbsq->start == 1) dbsq->L = srcL[seq_idx-1];
     
     cm_pli_NewSeq(info->pli, dbsq, seq_idx-1);
+    prv_win_ntophits = info->th->N;
 
     if (info->pli->do_top) { 
       prv_pli_ntophits = info->th->N;
@@ -836,6 +1239,9 @@ serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
       esl_sq_ReverseComplement(dbsq);
     }
 
+    /* with --lowmem, discard this window's hits that are sure to be removed as duplicates */
+    if((status = prune_window_hits(info, prv_win_ntophits, dbsq->start, dbsq->end, srcL[seq_idx-1])) != eslOK) cm_Fail(info->pli->errbuf);
+
     wstatus = esl_sqio_ReadWindow(dbfp, info->pli->maxW, CM_MAX_RESIDUE_COUNT, dbsq);
     /*printf("SER just read seq %ld (%40s) %10ld..%10ld\n", seq_idx, dbsq->name, dbsq->start, dbsq->end);*/
     while (wstatus == eslEOD) { 
@@ -843,6 +1249,7 @@ serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
        * (this is while() instead of if() so that we will skip zero-length sequences)
        */
       info->pli->nseqs++;
+      if(info->pli->nseqs >= seq_end) { wstatus = eslEOF; break; }
       esl_sq_Reuse(dbsq);
       wstatus = esl_sqio_ReadWindow(dbfp, info->pli->maxW, CM_MAX_RESIDUE_COUNT, dbsq);
       seq_idx++; /* because we started reading a new sequence, or reached EOF */
@@ -855,8 +1262,15 @@ serial_loop(WORKER_INFO *info, ESL_SQFILE *dbfp, int64_t *srcL)
 }
  
 #ifdef HMMER_THREADS
+/* thread_loop()
+ * 
+ * Read blocks of sequence windows and hand them to the worker
+ * threads. Starts with sequence info->pli->nseqs and returns eslEOF
+ * once sequence <seq_end>-1 has been read and searched (or the file
+ * ends).
+ */
 static int
-thread_loop(WORKER_INFO *info, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, int64_t *srcL)
+thread_loop(WORKER_INFO *info, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, int64_t *srcL, int64_t seq_end)
 {
   int           status  = eslOK;
   int           sstatus = eslOK;
@@ -889,7 +1303,13 @@ thread_loop(WORKER_INFO *info, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFI
        * overlap should be retained in the ReadWindow step. */
     }
 
-    sstatus = esl_sqio_ReadBlock(dbfp, block, CM_MAX_RESIDUE_COUNT, /*max_sequences=*/-1, TRUE);  // SRE: is it ok to pass -1 for max_seqs? That's a new arg to ReadBlock().
+    if (prv_block_complete && info->pli->nseqs >= seq_end) { /* don't read past <seq_end> */
+      block->count = 0;
+      sstatus      = eslEOF;
+    }
+    else { 
+      sstatus = esl_sqio_ReadBlock(dbfp, block, CM_MAX_RESIDUE_COUNT, /*max_sequences=*/(int) ESL_MIN(seq_end - info->pli->nseqs, INT_MAX), TRUE);
+    }
 
     if (sstatus == eslOK) { /* we read a block */
       if(! block->complete) { 
@@ -960,6 +1380,7 @@ pipeline_thread(void *arg)
   ESL_SQ_BLOCK  *block = NULL;
   void          *newBlock;
   int            prv_pli_ntophits;    /* number of top hits before each cm_Pipeline() */
+  int            prv_win_ntophits;    /* number of top hits before each window */
 
 #ifdef HAVE_FLUSH_ZERO_MODE
   /* In order to avoid the performance penalty dealing with sub-normal
@@ -987,6 +1408,7 @@ pipeline_thread(void *arg)
       ESL_SQ *dbsq = block->list + i;
 
       cm_pli_NewSeq(info->pli, dbsq, block->first_seqidx + i);
+      prv_win_ntophits = info->th->N;
 
       if (info->pli->do_top) { 
 	prv_pli_ntophits = info->th->N;
@@ -1022,6 +1444,9 @@ pipeline_thread(void *arg)
 	 * of the sequence, which they would be if we did nothing). */
 	esl_sq_ReverseComplement(dbsq);
       }
+
+      /* with --lowmem, discard this window's hits that are sure to be removed as duplicates */
+      if((status = prune_window_hits(info, prv_win_ntophits, dbsq->start, dbsq->end, dbsq->L)) != eslOK) cm_Fail(info->pli->errbuf);
     }
 
     status = esl_workqueue_WorkerUpdate(info->queue, block, &newBlock);
@@ -1033,6 +1458,47 @@ pipeline_thread(void *arg)
   status = esl_workqueue_WorkerUpdate(info->queue, block, NULL);
   if (status != eslOK) esl_fatal("Work queue worker failed");
 
+  /* sort our hits now, in parallel with the other workers, so the
+   * master only has to merge the sorted lists 
+   */
+  cm_tophits_SortForOverlapRemoval(info->th);
+
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+
+/* align_thread()
+ * 
+ * After the search is complete and hits have been thresholded 
+ * (--deferali), align this worker's share of the deferred hits 
+ * in info->dali: hits w, w+nworkers, w+2*nworkers... for worker
+ * index w. Each worker uses its own CM, so alignments can proceed
+ * in parallel, and each hit's CM_ALIDISPLAY is only written by
+ * the worker that aligns it.
+ */
+static void 
+align_thread(void *arg)
+{
+  int            status;
+  int            workeridx;
+  int64_t        i;
+  WORKER_INFO   *info;
+  ESL_THREADS   *obj;
+
+#ifdef HAVE_FLUSH_ZERO_MODE
+  /* set the processor flag so sub-normals are flushed to zero, see pipeline_thread() */
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  for (i = workeridx; i < info->dali->nhit; i += info->dali->nworkers) { 
+    if((status = align_deferred_hit(info, i)) != eslOK) cm_Fail("deferred hit alignment failed unexpectedly with status code %d\n%s\n", status, info->pli->errbuf);
+  }
+
   esl_threads_Finished(obj, workeridx);
   return;
 }
@@ -1063,6 +1529,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   FILE            *ofp      = stdout;            /* results output file (-o)                        */
   FILE            *afp      = NULL;              /* alignment output file (-A)                                */
   FILE            *tblfp    = NULL;              /* output stream for tabular per-seq (--tblout)    */
+  FILE            *hitsfp   = NULL;              /* binary hit lists output file (--hitsout)        */
 
   CM_FILE         *cmfp;		         /* open input CM file stream                       */
   ESL_SQFILE      *dbfp     = NULL;              /* open input sequence file                        */
@@ -1096,11 +1563,28 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   int64_t          noverlap = 0;             /* number of overlapping residues in one block */
   int64_t          tot_noverlap = 0;         /* number of overlapping residues in all blocks for one CM */
   int              nbps;                     /* number of basepairs in current CM */
+  MPI_WORKER      *wstate = NULL;            /* [1..nproc-1] progress of each worker on its current block */
+  int              nbusy;                    /* number of workers searching a block */
+  int              npending;                 /* number of requests to donate part of a block we haven't heard back on */
+  int              victim;                   /* worker we'll ask to donate part of its block */
+  int64_t          minL;                     /* minimum size of a block we'll split off */
+  int64_t          queueL;                   /* number of residues in blocks left to hand out */
+  int64_t          shareL;                   /* even share of <queueL> per worker */
+  MPI_BLOCK       *tail_block = NULL;        /* block split off of the end of <cur_block> */
+  double           doneL, doneT;             /* residues in, and seconds spent on, completed blocks for one CM */
+  double           progress[2];              /* residues in, and seconds spent on, one worker's previous block */
+  double           rate;                     /* residues searched per second by one worker, <doneL> / <doneT> */
+  double           finish, max_finish = 0.;  /* estimated time a worker will finish its block */
+  int              pos;                      /* position in <mpi_buf> */
+  int              k;                        /* number of blocks we're filling each worker up to */
+  int              have_blocks;              /* FALSE once we've run out of blocks to hand out */
 
   w  = esl_stopwatch_Create();
   mw = esl_stopwatch_Create();
   esl_stopwatch_Start(mw);
 
+  ESL_ALLOC(wstate, sizeof(MPI_WORKER) * cfg->nproc);
+
   if (esl_opt_GetBoolean(go, "--notextw")) textw = 0;
   else                                     textw = esl_opt_GetInteger(go, "--textw");
 
@@ -1122,6 +1606,9 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   if (esl_opt_IsOn(go, "--tblout") && (tblfp = fopen(esl_opt_GetString(go, "--tblout"), "w")) == NULL)
     mpi_failure("Failed to open tabular per-seq output file %s for writing\n", esl_opt_GetString(go, "--tblout"));
 
+  if (esl_opt_IsOn(go, "--hitsout") && (hitsfp = fopen(esl_opt_GetString(go, "--hitsout"), "wb")) == NULL)
+    mpi_failure("Failed to open hits output file %s for writing\n", esl_opt_GetString(go, "--hitsout"));
+
   /* allocate and initialize <info> which will hold the CMs, HMMs, etc. */
   if((info = create_info(go)) == NULL) mpi_failure("Out of memory");
 
@@ -1155,6 +1642,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     
     /* One-time initializations after alphabet <abc> becomes known */
     output_header(ofp, go, cfg->cmfile, cfg->dbfile, cfg->nproc);
+    if(hitsfp != NULL && hits_write_header(hitsfp, cfg->dbfile, cfg->Z, cfg->Z_setby, 0, 0) != eslOK) mpi_failure("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout"));
     dbsq = esl_sq_CreateDigital(abc);
   }
 
@@ -1209,6 +1697,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     sstatus = eslOK;
     tot_noverlap = noverlap = 0;
     tot_nseq     = nseq     = 0;
+    doneL        = doneT    = 0.;
 #ifdef HAVE_MPI
     /* process --sidx and --eidx, if nec */
     if(esl_opt_IsUsed(go, "--sidx")) { /* start searching at sequence index <n> from --sidx <n> */
@@ -1228,96 +1717,196 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     }
     /*printf("searching seqs %ld to %ld\n", pkey_idx, final_pkey_idx);*/
 #endif
-    /* Main loop: */
-    while((pkey_idx <= final_pkey_idx) && 
-	  ((sstatus = mpi_add_blocks(dbfp, dbsq, info->pli->maxW, errbuf, final_pkey_idx, block_list, &pkey_idx, &noverlap, &nseq)) == eslOK))
-      {
-	tot_noverlap += noverlap;
-	tot_nseq     += nseq;
-	
-	cur_block = block_list->blocks[0];
-	
-	while(cur_block != NULL && cur_block->complete) { 
-	  /* cur_block points to a valid, complete block, send it to a worker */
-	  if (MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
-	    mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
-	  
-	  MPI_Get_count(&mpistatus, MPI_PACKED, &size);
-	  if (mpi_buf == NULL || size > mpi_size) {
-	    void *tmp;
-	    ESL_RALLOC(mpi_buf, tmp, sizeof(char) * size);
-	    mpi_size = size; 
+    for (dest = 1; dest < cfg->nproc; dest++) { 
+      /* each worker will report it's ready for its first block */
+      wstate[dest].nblocks       = 1;
+      wstate[dest].nsent         = 0;
+      wstate[dest].can_split     = FALSE;
+      wstate[dest].split_pending = FALSE;
+      wstate[dest].blockL        = 0;
+      wstate[dest].t0            = MPI_Wtime();
+    }
+    nbusy    = cfg->nproc-1;
+    npending = 0;
+    minL     = ESL_MAX(MIN_SPLIT_SIZE, 4 * info->pli->maxW);
+
+    /* Main loop: hand out blocks to workers until each holds
+     * MAX_WORKER_BLOCKS (idle workers first), then wait for a worker
+     * to send back hits, to report it's finished a block, or to
+     * return part of its blocks it was asked to donate.
+     */
+    while(TRUE) { 
+      have_blocks = TRUE;
+      for(k = 1; k <= MAX_WORKER_BLOCKS && have_blocks; k++) { 
+	for(dest = 1; dest < cfg->nproc && have_blocks; dest++) { 
+	  if(wstate[dest].nblocks >= k) continue;
+
+	  /* make sure the front block is complete, adding blocks until it is, unless we've inspected all sequences */
+	  while(pkey_idx <= final_pkey_idx && (! block_list->blocks[0]->complete)) { 
+	    if((sstatus = mpi_add_blocks(dbfp, dbsq, info->pli->maxW, errbuf, final_pkey_idx, block_list, &pkey_idx, &noverlap, &nseq)) != eslOK) mpi_failure(errbuf);
+	    tot_noverlap += noverlap;
+	    tot_nseq     += nseq;
 	  }
-	  
-	  dest = mpistatus.MPI_SOURCE;
-	  MPI_Recv(mpi_buf, size, MPI_PACKED, dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpistatus);
-	    
-	  if (mpistatus.MPI_TAG == INFERNAL_ERROR_TAG)
-	    mpi_failure("MPI client %d raised error:\n%s\n", dest, mpi_buf);
-	  if (mpistatus.MPI_TAG != INFERNAL_READY_TAG)
-	    mpi_failure("Unexpected tag %d from %d\n", mpistatus.MPI_TAG, dest);
-	  
-	  mpi_block_send(cur_block, dest, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
-	  
-	  /* Free the block we just sent, and remove it from block_list 
-	   * by swapping pointers and decrementing N. Then update cur_block. */
-	  free(cur_block);
+	  if(block_list->N == 0)                   { have_blocks = FALSE; continue; } /* no more blocks */
+	  if(k > 1 && pkey_idx > final_pkey_idx)   { have_blocks = FALSE; continue; } /* in the tail, only idle workers get a block */
+
+	  /* remove the front block from block_list */
+	  cur_block = block_list->blocks[0];
 	  for(i = 0; i < (block_list->N-1); i++) { 
 	    block_list->blocks[i] = block_list->blocks[i+1];
 	  }
 	  block_list->blocks[(block_list->N-1)] = NULL;
 	  block_list->N--;
-	  cur_block = block_list->blocks[0];
+
+	  /* If all sequences have been inspected, we're in the tail of
+	   * the search. Send at most an even share of the remaining
+	   * residues over all workers, and put the rest of the block back
+	   * on the front of the list. The pieces get smaller as the list
+	   * shrinks, so workers finish at about the same time even if
+	   * some blocks are much slower to search than others.
+	   */
+	  if(pkey_idx > final_pkey_idx) { 
+	    queueL = cur_block->blockL;
+	    for(i = 0; i < block_list->N; i++) queueL += block_list->blocks[i]->blockL;
+	    shareL = (queueL + cfg->nproc - 2) / (cfg->nproc - 1);
+	    if(cur_block->blockL > shareL) { 
+	      if((status = mpi_split_block(dbfp, cur_block, shareL, minL, info->pli->maxW, FALSE, errbuf, &tail_block, &noverlap)) != eslOK) mpi_failure(errbuf);
+	      if(tail_block != NULL) { 
+		if(prepend_mpi_block(block_list, tail_block) != eslOK) mpi_failure("Out of memory");
+		tot_noverlap += noverlap;
+		tail_block = NULL;
+	      }
+	    }
+	  }
+	
+	  mpi_block_send(cur_block, dest, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
+	  if(wstate[dest].nblocks == 0) { 
+	    wstate[dest].t0 = MPI_Wtime();
+	    nbusy++;
+	  }
+	  wstate[dest].nblocks++;
+	  wstate[dest].nsent++;
+	  wstate[dest].can_split = TRUE;
+	  wstate[dest].blockL   += cur_block->blockL;
+	  free(cur_block);
+	  cur_block = NULL;
 	}
       }
-    if(sstatus != eslOK) mpi_failure(errbuf);
-    
-    /* create an empty block to send to workers */
-    cur_block = create_mpi_block();
-    cur_block->complete = TRUE;
-    
-    /* wait for all workers to finish up their work blocks */
-    for (i = 1; i < cfg->nproc; ++i) {
+      if(nbusy == 0 && npending == 0) break; /* all workers are idle, so we've handed out all blocks */
+
+      /* If a worker is idle and there are no blocks left to hand out,
+       * ask the busy worker we expect to finish last to donate the
+       * unsearched sequences at the end of its block, or the block
+       * it was sent ahead of time. We estimate finish times from the
+       * search rate workers have reported for the blocks they've
+       * completed, or from the block sizes if no block has been
+       * completed yet. The request tells the worker how many blocks
+       * we've sent it, so it knows if one is on its way.
+       */
+      if(nbusy < (cfg->nproc-1) && block_list->N == 0 && npending == 0) { 
+	rate   = (doneT > 0.) ? doneL / doneT : 0.;
+	victim = -1;
+	for(dest = 1; dest < cfg->nproc; dest++) { 
+	  if(wstate[dest].nblocks > 0 && wstate[dest].can_split && (! wstate[dest].split_pending)) { 
+	    finish = (rate > 0.) ? wstate[dest].t0 + (double) wstate[dest].blockL / rate : (double) wstate[dest].blockL;
+	    if(victim == -1 || finish > max_finish) { 
+	      victim     = dest;
+	      max_finish = finish;
+	    }
+	  }
+	}
+	if(victim != -1) { 
+	  MPI_Send(&(wstate[victim].nsent), 1, MPI_INT, victim, INFERNAL_SPLIT_TAG, MPI_COMM_WORLD);
+	  wstate[victim].split_pending = TRUE;
+	  npending++;
+	}
+      }
+
+      /* wait for a worker to report */
       if (MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpistatus) != 0) 
 	mpi_failure("MPI error %d receiving message from %d\n", mpistatus.MPI_SOURCE);
-      
+      dest = mpistatus.MPI_SOURCE;
+
+      if (mpistatus.MPI_TAG == INFERNAL_TOPHITS_TAG) { 
+	/* hits from a block <dest> has finished, add them straight to our list */
+	if((status = cm_tophits_MPIStreamRecv(dest, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, info->th)) != eslOK) 
+	  mpi_failure("Unexpected error %d receiving tophits from %d", status, dest);
+	continue;
+      }
+
+      if (mpistatus.MPI_TAG == INFERNAL_DONATED_TAG || mpistatus.MPI_TAG == INFERNAL_RETURNED_TAG) { 
+	/* the rest of <dest>'s block, or the block it hadn't started
+	 * yet, to hand out to an idle worker; empty if it had nothing
+	 * left to donate */
+	if((status = mpi_block_recv(dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &cur_block)) != eslOK) 
+	  mpi_failure("Failed to receive donated block from %d, error status code: %d\n", dest, status);
+	wstate[dest].split_pending = FALSE;
+	npending--;
+	if(cur_block->blockL > 0) { 
+	  if(mpistatus.MPI_TAG == INFERNAL_RETURNED_TAG) { 
+	    wstate[dest].nblocks--;
+	    if(wstate[dest].nblocks == 0) nbusy--;
+	  }
+	  wstate[dest].blockL -= cur_block->blockL;
+	  cur_block->complete  = TRUE;
+	  if(prepend_mpi_block(block_list, cur_block) != eslOK) mpi_failure("Out of memory");
+	}
+	else { 
+	  wstate[dest].can_split = FALSE;
+	  free(cur_block);
+	}
+	cur_block = NULL;
+	continue;
+      }
+
       MPI_Get_count(&mpistatus, MPI_PACKED, &size);
       if (mpi_buf == NULL || size > mpi_size) {
 	void *tmp;
 	ESL_RALLOC(mpi_buf, tmp, sizeof(char) * size);
 	mpi_size = size; 
       }
-      
-      dest = mpistatus.MPI_SOURCE;
       MPI_Recv(mpi_buf, size, MPI_PACKED, dest, mpistatus.MPI_TAG, MPI_COMM_WORLD, &mpistatus);
-      
+	    
       if (mpistatus.MPI_TAG == INFERNAL_ERROR_TAG)
 	mpi_failure("MPI client %d raised error:\n%s\n", dest, mpi_buf);
       if (mpistatus.MPI_TAG != INFERNAL_READY_TAG)
 	mpi_failure("Unexpected tag %d from %d\n", mpistatus.MPI_TAG, dest);
+
+      /* the ready message reports the number of residues in, and the
+       * time spent on, the block the worker just finished; it starts
+       * on its next block, if we've already sent it one */
+      pos = 0;
+      if (MPI_Unpack(mpi_buf, size, &pos, progress, 2, MPI_DOUBLE, MPI_COMM_WORLD) != 0) mpi_failure("Failed to unpack progress report from %d\n", dest);
+      doneL += progress[0];
+      doneT += progress[1];
+      wstate[dest].nblocks--;
+      wstate[dest].t0 = MPI_Wtime();
+      if(wstate[dest].nblocks == 0) { 
+	wstate[dest].blockL = 0;
+	nbusy--;
+      }
+      else { 
+	wstate[dest].blockL -= (int64_t) progress[0];
+      }
     }
     
-    /* merge the results of the search results */
+    /* create an empty block to send to workers */
+    cur_block = create_mpi_block();
+    cur_block->complete = TRUE;
+    
+    /* merge the pipeline statistics, we've already received all the hits */
     for (dest = 1; dest < cfg->nproc; ++dest) { 
       CM_PIPELINE     *mpi_pli   = NULL;
-      CM_TOPHITS      *mpi_th    = NULL;
       
       /* send an empty block to signal the worker they are done */
       mpi_block_send(cur_block, dest, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
       
       /* wait for the results */
-      if ((status = cm_tophits_MPIRecv(dest, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &mpi_th)) != eslOK)
-	mpi_failure("Unexpected error %d receiving tophits from %d", status, dest);
-      
       if ((status = cm_pipeline_MPIRecv(dest, INFERNAL_PIPELINE_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, go, &mpi_pli)) != eslOK)
 	mpi_failure("Unexpected error %d receiving pipeline from %d", status, dest);
       
-      /*printf("RECEIVED TOPHITS (%ld hits) FROM %d\n", mpi_th->N, dest);*/
-      cm_tophits_Merge(info->th, mpi_th);
       cm_pipeline_Merge(info->pli, mpi_pli);
-      
       cm_pipeline_Destroy(mpi_pli, NULL);
-      cm_tophits_Destroy(mpi_th);
     }
     free(cur_block); cur_block = NULL;
 
@@ -1325,6 +1914,9 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     info->pli->nseqs = tot_nseq;
     if(info->pli->do_top && tot_noverlap > 0) cm_pli_AdjustNresForOverlaps(info->pli, tot_noverlap, FALSE); /* 'FALSE': we're not on bottom strand */
     if(info->pli->do_bot && tot_noverlap > 0) cm_pli_AdjustNresForOverlaps(info->pli, tot_noverlap, TRUE);  /* 'TRUE':  we are on bottom strand */
+
+    /* with --hitsout, save the hits before overlap removal and thresholding */
+    if(hitsfp != NULL && hits_write_query(hitsfp, info->cm->name, info->pli, info->th) != eslOK) mpi_failure("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout"));
     
     /* Sort by sequence index/position and remove duplicates */
     cm_tophits_SortForOverlapRemoval(info->th);
@@ -1434,6 +2026,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   /* Terminate outputs... any last words?
    */
   if (tblfp)    cm_tophits_TabularTail(tblfp,    "cmsearch", CM_SEARCH_SEQS, cfg->cmfile, cfg->dbfile, go);
+  if (hitsfp)   { if(hits_write_tail(hitsfp) != eslOK) mpi_failure("Failed to write hits output file %s", esl_opt_GetString(go, "--hitsout")); }
   fprintf(ofp, "[ok]\n");
 
   esl_stopwatch_Stop(mw);
@@ -1442,6 +2035,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   /* Cleanup - prepare for exit
    */
   free(block_list);
+  free(wstate);
   if (mpi_buf != NULL) free(mpi_buf);
 
   cm_file_Close(cmfp);
@@ -1454,6 +2048,7 @@ mpi_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   if (ofp != stdout) fclose(ofp);
   if (afp)           fclose(afp);
   if (tblfp)         fclose(tblfp);
+  if (hitsfp)        fclose(hitsfp);
 
   return eslOK;
 
@@ -1478,6 +2073,7 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
   int              status   = eslOK;
   int              hstatus  = eslOK;
   int              prv_pli_ntophits;             /* number of top hits before each cm_Pipeline() */
+  int              prv_win_ntophits;             /* number of top hits before each sequence (sub)block */
   ESL_SQ          *dbsq        = NULL;           /* one target sequence (digital)                   */
   int64_t          cm_idx   = 0;                 /* index of CM we're currently working with */
   double           eZ;                           /* effective database size */
@@ -1493,9 +2089,25 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
   int64_t          seq_from, seq_to;             /* start/end positions of a sequence */
   int64_t          readL;                        /* number of residues read in the current block */
   char            *pkey;                         /* a primary key from SSI */
+  double           progress[2];                  /* residues in, and seconds spent on, the previous block, reported to master */
+  double           t0;                           /* MPI_Wtime() when the current block was received */
+  MPI_WORKER_COMM  wc;                           /* our outstanding non-blocking receives and sends */
+  MPI_Status       mpistatus;
 
   w = esl_stopwatch_Create();
 
+  /* Post receives for our first block and for requests to donate part of a block,
+   * these are reposted as each completes, for as long as we're running. */
+  wc.block_buf = NULL;
+  wc.hits_buf  = NULL;
+  wc.hits_n    = 0;
+  wc.hits_req  = MPI_REQUEST_NULL;
+  wc.nrecv     = 0;
+  if((status = mpi_block_pack_size(NULL, MPI_COMM_WORLD, &(wc.block_n))) != eslOK) mpi_failure("Failed to determine block size");
+  if((wc.block_buf = malloc(sizeof(char) * wc.block_n)) == NULL) mpi_failure("Out of memory");
+  MPI_Irecv(wc.block_buf, wc.block_n, MPI_PACKED, 0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &(wc.block_req));
+  MPI_Irecv(&(wc.split_nsent), 1, MPI_INT, 0, INFERNAL_SPLIT_TAG, MPI_COMM_WORLD, &(wc.split_req));
+
   /* Open the database file */
   if((status = open_dbfile    (go, cfg, errbuf, &dbfp)) != eslOK) mpi_failure(errbuf); 
 
@@ -1531,9 +2143,9 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
     cm_idx++;
     esl_stopwatch_Start(w);
 
-    status = 0;
     /* inform the master we're ready for a block of sequences */
-    MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
+    progress[0] = progress[1] = 0.;
+    MPI_Send(progress, 2, MPI_DOUBLE, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
 
     /* Create processing pipeline and hit list */
     info->th  = cm_tophits_Create(); 
@@ -1548,14 +2160,23 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
       mpi_failure(info->pli->errbuf);
     }
 
+    /* E-values are computed for each block's hits before they're sent to the master */
+    if(info->pli->do_hmmonly_cur) eZ = info->pli->Z / (float) info->om->max_length;
+    else              	          eZ = info->cm->expA[info->pli->final_cm_exp_mode]->cur_eff_dbsize;
+
     /* receive a sequence info block from the master */
-    if((status = mpi_block_recv(0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &block)) != eslOK) mpi_failure("Failed to receive sequence block, error status code: %d\n", status); 
+    wc.nrecv = 0;
+    if((status = mpi_worker_recv_block(dbfp, &wc, errbuf, &mpi_buf, &mpi_size, &block)) != eslOK) mpi_failure(errbuf);
 
     while(block->first_idx != -1) { /* receipt of a block with first_idx == -1 signals us that we're done with the database */
-      readL = 0;
+      t0       = MPI_Wtime();
+      readL    = 0;
       pkey_idx = block->first_idx;
       while(pkey_idx <= block->final_idx) 
 	{ 
+	  /* if the master asked, give up the sequences at the end of the block, for an idle worker */
+	  if((status = mpi_worker_donate(dbfp, block, pkey_idx, readL, &wc, errbuf, &mpi_buf, &mpi_size)) != eslOK) mpi_failure(errbuf);
+
 	  /*printf("readL: %ld\n", readL);*/
 	  /* determine the primary key and length of the sequence */
 	  if((status = esl_ssi_FindNumber(dbfp->data.ascii.ssi, pkey_idx, NULL, NULL, NULL, &L, &pkey)) != eslOK) { 
@@ -1586,6 +2207,7 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
 	  /* tell pipeline we've got a new sequence (this updates info->pli->nres) */
 	  cm_pli_NewSeq(info->pli, dbsq, pkey_idx);
 	  readL += dbsq->n;
+	  prv_win_ntophits = info->th->N;
 
 	  /* search top strand */
 	  if (info->pli->do_top) { 
@@ -1614,6 +2236,9 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
 	     * so they're relative to the full-length original sequence (start < end). */
 	    cm_tophits_UpdateHitPositions(info->th, prv_pli_ntophits, seq_to, TRUE); /* note we use seq_to, not seq_from */
 	  }
+
+	  /* with --lowmem, discard this subsequence's hits that are sure to be removed as duplicates */
+	  if((status = prune_window_hits(info, prv_win_ntophits, seq_from, seq_to, L)) != eslOK) mpi_failure(info->pli->errbuf);
 	  esl_sq_Reuse(dbsq);
 
 	  pkey_idx++;
@@ -1623,23 +2248,24 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
       /* free the block we're finished with */
       free(block); block = NULL;
 
-      /* inform the master we need another block of sequences */
-      status = 0;
-      MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
+      /* start sending this block's hits to the master, and free them */
+      cm_tophits_ComputeEvalues(info->th, eZ, 0);
+      if((status = cm_tophits_MPIStreamSend(info->th, 0, INFERNAL_TOPHITS_TAG, MPI_COMM_WORLD, &(wc.hits_buf), &(wc.hits_n), &(wc.hits_req))) != eslOK) 
+	mpi_failure("Failed to send hits, error status code: %d\n", status);
+      cm_tophits_Reuse(info->th);
+
+      /* inform the master we need another block of sequences, and how long this one took */
+      progress[0] = (double) readL;
+      progress[1] = MPI_Wtime() - t0;
+      MPI_Send(progress, 2, MPI_DOUBLE, 0, INFERNAL_READY_TAG, MPI_COMM_WORLD);
 	
-      /* wait for the next block of sequences */
-      if((status = mpi_block_recv(0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &block)) != eslOK) mpi_failure("Failed to receive sequence block, error status code: %d\n", status); 
+      /* get the next block of sequences, the master may have already sent it */
+      if((status = mpi_worker_recv_block(dbfp, &wc, errbuf, &mpi_buf, &mpi_size, &block)) != eslOK) mpi_failure(errbuf);
     }   
     esl_stopwatch_Stop(w);
     /* free the final block which was empty */
     free(block); block = NULL;
 
-    /* compute E-values before sending back to master */
-    if(info->pli->do_hmmonly_cur) eZ = info->pli->Z / (float) info->om->max_length;
-    else              	          eZ = info->cm->expA[info->pli->final_cm_exp_mode]->cur_eff_dbsize;
-    cm_tophits_ComputeEvalues(info->th, eZ, 0);
-      
-    cm_tophits_MPISend(info->th,   0, INFERNAL_TOPHITS_TAG,  MPI_COMM_WORLD,  &mpi_buf, &mpi_size);
     cm_pipeline_MPISend(info->pli, 0, INFERNAL_PIPELINE_TAG, MPI_COMM_WORLD,  &mpi_buf, &mpi_size);
       
     free_info(info);
@@ -1660,7 +2286,16 @@ mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
   status = 0;
   MPI_Send(&status, 1, MPI_INT, 0, INFERNAL_TERMINATING_TAG, MPI_COMM_WORLD);
 
+  /* finish our last send of hits and cancel our receives, no more blocks are coming */
+  MPI_Wait(&(wc.hits_req), &mpistatus);
+  MPI_Cancel(&(wc.block_req));
+  MPI_Wait(&(wc.block_req), &mpistatus);
+  MPI_Cancel(&(wc.split_req));
+  MPI_Wait(&(wc.split_req), &mpistatus);
+
   if (mpi_buf != NULL) free(mpi_buf);
+  if (wc.block_buf != NULL) free(wc.block_buf);
+  if (wc.hits_buf  != NULL) free(wc.hits_buf);
 
   cm_file_Close(cmfp);
   esl_sqfile_Close(dbfp);
@@ -1686,6 +2321,8 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
   ESL_GETOPTS *go     = NULL;
   char        *devmsg = "*";
   int          do_dev = FALSE; /* set to TRUE if --devhelp used */
+  int          shard_idx;      /* with --shard, only for validating it */
+  int          nshards;
 
   if ((go = esl_getopts_Create(options))     == NULL)     cm_Fail("Internal failure creating options object");
   if (esl_opt_ProcessEnvironment(go)         != eslOK)  { printf("Failed to process environment: %s\n", go->errbuf); goto ERROR; }
@@ -1744,7 +2381,13 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     exit(0);
   }
 
-  if (esl_opt_ArgNumber(go)                  != 2)     { puts("Incorrect number of command line arguments.");     goto ERROR; }
+  /* with --merge, <seqdb> is replaced by one or more --hitsout files */
+  if (esl_opt_GetBoolean(go, "--merge")) { 
+    if (esl_opt_ArgNumber(go)                < 2)      { puts("Incorrect number of command line arguments.");     goto ERROR; }
+  }
+  else { 
+    if (esl_opt_ArgNumber(go)               != 2)      { puts("Incorrect number of command line arguments.");     goto ERROR; }
+  }
   if ((*ret_cmfile = esl_opt_GetArg(go, 1))  == NULL)  { puts("Failed to get <cmfile> argument on command line"); goto ERROR; }
   if ((*ret_seqfile = esl_opt_GetArg(go, 2)) == NULL)  { puts("Failed to get <seqdb> argument on command line");  goto ERROR; }
   
@@ -1758,6 +2401,12 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     goto ERROR;
   }    
 
+  /* --shard <s> must be <i>/<n> with 1 <= <i> <= <n> */
+  if (esl_opt_IsOn(go, "--shard") && parse_shard(esl_opt_GetString(go, "--shard"), &shard_idx, &nshards) != eslOK) { 
+    printf("Failed to parse command line: --shard <s> must be <i>/<n>, with 1 <= <i> <= <n>, not %s\n", esl_opt_GetString(go, "--shard"));
+    goto ERROR;
+  }    
+
   /* --beta only makes sense with --qdb, --nohmm or --max */
   if (esl_opt_IsUsed(go, "--beta") && (! esl_opt_GetBoolean(go, "--qdb")) && 
       (! esl_opt_GetBoolean(go, "--nohmm")) && (! esl_opt_GetBoolean(go, "--max"))) { 
@@ -1821,6 +2470,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--noF3b"))      { puts("Failed to parse command line: Option --max is incompatible with option --noF3b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF4b"))      { puts("Failed to parse command line: Option --max is incompatible with option --noF4b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF5b"))      { puts("Failed to parse command line: Option --max is incompatible with option --doF5b");      goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))     { puts("Failed to parse command line: Option --max is incompatible with option --lcmask");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1"))         { puts("Failed to parse command line: Option --max is incompatible with option --F1");         goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1b"))        { puts("Failed to parse command line: Option --max is incompatible with option --F1b");        goto ERROR; }
     if(esl_opt_IsUsed(go, "--F2"))         { puts("Failed to parse command line: Option --max is incompatible with option --F2");         goto ERROR; }
@@ -1851,6 +2501,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --max is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --max is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --max is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --max is incompatible with option --shortpass");  goto ERROR; }
   }
   if(esl_opt_IsUsed(go, "--nohmm")) { 
     if(esl_opt_IsUsed(go, "--max"))        { puts("Failed to parse command line: Option --nohmm is incompatible with option --max");        goto ERROR; }
@@ -1866,6 +2517,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--noF3b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --noF3b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF4b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --noF4b");      goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF5b"))      { puts("Failed to parse command line: Option --nohmm is incompatible with option --doF5b");      goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --lcmask");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1"))         { puts("Failed to parse command line: Option --nohmm is incompatible with option --F1");         goto ERROR; }
     if(esl_opt_IsUsed(go, "--F1b"))        { puts("Failed to parse command line: Option --nohmm is incompatible with option --F1b");        goto ERROR; }
     if(esl_opt_IsUsed(go, "--F2"))         { puts("Failed to parse command line: Option --nohmm is incompatible with option --F2");         goto ERROR; }
@@ -1889,6 +2541,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --nohmm is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --nohmm is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --nohmm is incompatible with option --shortpass");  goto ERROR; }
   }
   if(esl_opt_IsUsed(go, "--mid")) { 
     if(esl_opt_IsUsed(go, "--max"))      { puts("Failed to parse command line: Option --mid is incompatible with option --max");   goto ERROR; }
@@ -1896,6 +2549,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--rfam"))     { puts("Failed to parse command line: Option --mid is incompatible with option --rfam");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--FZ"))       { puts("Failed to parse command line: Option --mid is incompatible with option --FZ");    goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF1"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF1");  goto ERROR; }
+    if(esl_opt_IsUsed(go, "--lcmask"))   { puts("Failed to parse command line: Option --mid is incompatible with option --lcmask"); goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF2"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF2");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--noF3"))     { puts("Failed to parse command line: Option --mid is incompatible with option --noF3");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--doF1b"))    { puts("Failed to parse command line: Option --mid is incompatible with option --doF1b"); goto ERROR; }
@@ -1967,6 +2621,7 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--5trunc"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --5trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--3trunc"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --3trunc");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--onepass"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --onepass");    goto ERROR; }
+    if(esl_opt_IsUsed(go, "--shortpass"))  { puts("Failed to parse command line: Option --hmmonly is incompatible with option --shortpass");  goto ERROR; }
     if(esl_opt_IsUsed(go, "--mxsize"))     { puts("Failed to parse command line: Option --hmmonly is incompatible with option --mxsize");     goto ERROR; }
     if(esl_opt_IsUsed(go, "--smxsize"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --smxsize");    goto ERROR; }
     if(esl_opt_IsUsed(go, "--nonull3"))    { puts("Failed to parse command line: Option --hmmonly is incompatible with option --nonull3");    goto ERROR; }
@@ -1980,6 +2635,11 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_cmfi
     if(esl_opt_IsUsed(go, "--null2"))      { puts("Failed to parse command line: Option --hmmonly is incompatible with option --null2");      goto ERROR; }
   }
 
+#ifdef HAVE_MPI
+  /* --deferali aligns hits in serial_master() only, after the search */
+  if(esl_opt_IsUsed(go, "--deferali") && esl_opt_IsUsed(go, "--mpi")) { puts("Failed to parse command line: Option --deferali is incompatible with option --mpi"); goto ERROR; }
+#endif
+
   *ret_go = go;
   return;
   
@@ -2003,6 +2663,7 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *seqfile, int
   if (esl_opt_IsUsed(go, "-o"))           fprintf(ofp, "# output directed to file:               %s\n",             esl_opt_GetString(go, "-o"));
   if (esl_opt_IsUsed(go, "-A"))           fprintf(ofp, "# MSA of significant hits saved to file: %s\n",             esl_opt_GetString(go, "-A"));
   if (esl_opt_IsUsed(go, "--tblout"))     fprintf(ofp, "# tabular output of hits:                %s\n",             esl_opt_GetString(go, "--tblout"));
+  if (esl_opt_IsUsed(go, "--hitsout"))    fprintf(ofp, "# binary hit lists saved to file:        %s\n",             esl_opt_GetString(go, "--hitsout"));
   if (esl_opt_IsUsed(go, "--acc"))        fprintf(ofp, "# prefer accessions over names:          yes\n");
   if (esl_opt_IsUsed(go, "--noali"))      fprintf(ofp, "# show alignments in output:             no\n");
   if (esl_opt_IsUsed(go, "--notextw"))    fprintf(ofp, "# max ASCII text line length:            unlimited\n");
@@ -2034,9 +2695,18 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *seqfile, int
   if (esl_opt_IsUsed(go, "--acyk"))       fprintf(ofp, "# use CYK to align hits:                 on\n");
   if (esl_opt_IsUsed(go, "--wcx"))        fprintf(ofp, "# W set as <x> * cm->clen:               <x>=%g\n", esl_opt_GetReal(go, "--wcx"));
   if (esl_opt_IsUsed(go, "--onepass"))    fprintf(ofp, "# using CM for best HMM pass only:       on\n");
+  if (esl_opt_IsUsed(go, "--shortpass"))  fprintf(ofp, "# short seqs searched in one pass:       on\n");
   if (esl_opt_IsUsed(go, "--toponly"))    fprintf(ofp, "# search top-strand only:                on\n");
   if (esl_opt_IsUsed(go, "--bottomonly")) fprintf(ofp, "# search bottom-strand only:             on\n");
   if (esl_opt_IsUsed(go, "--tformat"))    fprintf(ofp, "# targ <seqdb> format asserted:          %s\n", esl_opt_GetString(go, "--tformat"));
+  if (esl_opt_IsUsed(go, "--lowmem"))     fprintf(ofp, "# discard redundant hits during search:  on\n");
+  if (esl_opt_IsUsed(go, "--deferali"))   fprintf(ofp, "# align hits after thresholding:         on\n");
+  if (esl_opt_IsUsed(go, "--ckpt"))       fprintf(ofp, "# checkpoint file:                       %s\n", esl_opt_GetString(go, "--ckpt"));
+  if (esl_opt_IsUsed(go, "--ckptmb"))     fprintf(ofp, "# Mb searched between checkpoints:       %g\n", esl_opt_GetReal(go, "--ckptmb"));
+  if (esl_opt_IsUsed(go, "--resume"))     fprintf(ofp, "# resume from checkpoint:                on\n");
+  if (esl_opt_IsUsed(go, "--merge"))      fprintf(ofp, "# number of --hitsout files merged:      %d\n",             esl_opt_ArgNumber(go) - 1);
+  if (esl_opt_IsUsed(go, "--shard"))      fprintf(ofp, "# search only database shard:            %s\n", esl_opt_GetString(go, "--shard"));
+  if (esl_opt_IsUsed(go, "--dbidx"))      fprintf(ofp, "# database index file:                   %s.cmdbi\n", seqfile);
 #ifdef HAVE_MPI
   if (esl_opt_IsUsed(go, "--stall"))     fprintf(ofp, "# MPI stall mode:                        on\n");
 #endif
@@ -2051,6 +2721,8 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *cmfile, char *seqfile, int
   if (esl_opt_IsUsed(go, "--noF3b"))      fprintf(ofp, "# HMM Fwd biased comp filter:            off\n");
   if (esl_opt_IsUsed(go, "--noF4b"))      fprintf(ofp, "# HMM gFwd biased comp filter:           off\n");
   if (esl_opt_IsUsed(go, "--doF5b"))      fprintf(ofp, "# HMM per-envelope biased comp filter:   on\n");
+  if (esl_opt_IsUsed(go, "--lcmask"))     fprintf(ofp, "# low complexity mask before SSV:        score > %g bits\n", esl_opt_GetReal(go, "--lcmask"));
+  if (esl_opt_IsUsed(go, "--lcw"))        fprintf(ofp, "# low complexity mask window length:     %d\n", esl_opt_GetInteger(go, "--lcw"));
   if (esl_opt_IsUsed(go, "--F1"))         fprintf(ofp, "# HMM MSV filter P threshold:            <= %g\n", esl_opt_GetReal(go, "--F1"));
   if (esl_opt_IsUsed(go, "--F1b"))        fprintf(ofp, "# HMM MSV bias P threshold:              <= %g\n", esl_opt_GetReal(go, "--F1b"));
   if (esl_opt_IsUsed(go, "--F2"))         fprintf(ofp, "# HMM Vit filter P threshold:            <= %g\n", esl_opt_GetReal(go, "--F2"));
@@ -2173,45 +2845,103 @@ open_dbfile(ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, ESL_SQFILE **ret_d
  *            (but not storing it), as well as sequence lengths.
  * Incept:    EPN, Mon Jun  6 09:17:32 2011
  *
+ * Purpose:   With --dbidx, if the index file <seqdb>.cmdbi is up
+ *            to date, the sizes are read from it and the database
+ *            isn't read at all. Otherwise the database is read
+ *            and, with --dbidx, the index is (re)written; failure
+ *            to write it isn't an error, the next search just
+ *            reads the database again.
  * 
  * Returns:   eslOK on success: 
  *               cfg->Z is set
  *               array of seq lengths returned in *ret_srcL
+ *               array of seq offsets in the file returned in *ret_offset,
+ *                 (-1 for each seq if the file is gzipped)
  *               # seqs returned in *ret_nseqs
  *            eslEFORMAT if database file is screwy.
  */
 static int
-dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr, char *errbuf, int64_t **ret_srcL, int64_t *ret_nseqs)
+dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr, char *errbuf, int64_t **ret_srcL, int64_t **ret_offset, int64_t *ret_nseqs)
 {
   int       status;
   ESL_SQ   *sq = NULL;
   int64_t   nres = 0;     /* total number of residues */
   /* variables used to store lengths of all target sequences */
   int64_t  *srcL        = NULL;    /* [0..nseqs-1] full length of each target sequence read */
+  int64_t  *offset      = NULL;    /* [0..nseqs-1] offset of each target sequence read */
   int64_t   nseqs       = 0;       /* total number of sequences */
   int64_t   nalloc_srcL = 0;       /* current allocation size of srcL */
   int       alloc_srcL  = 10000;   /* chunk size to increase allocation by for srcL */
   int64_t   i;                     /* counter */       
   char     *tmp_filename = NULL;   /* name of sqfile, used only if gzipped */
   int       tmp_fmt;               /* fmt of sqfile, used only if gzipped */
+  DBIDX    *idx          = NULL;   /* index read from <seqdb>.cmdbi, if --dbidx */
+  DBIDX     new_idx;               /* index to write to <seqdb>.cmdbi, if --dbidx */
+  int       do_dbidx     = FALSE;  /* TRUE to read or write <seqdb>.cmdbi */
+  int64_t   dbsize       = 0;      /* size of <seqdb> in bytes, if --dbidx */
+  int64_t   dbmtime      = 0;      /* modification time of <seqdb>, if --dbidx */
   
-  /* we'll only use this if seqfile is gzipped */
-  ESL_ALLOC(tmp_filename, sizeof(char) * (strlen((*dbfp_ptr)->filename) + 1));
-
-  sq = esl_sq_Create();
-  while ((status = esl_sqio_ReadInfo(*dbfp_ptr, sq)) == eslOK) { 
-    nres += sq->L;
-    if(nseqs == nalloc_srcL) { /* reallocate */
-      nalloc_srcL += alloc_srcL;
-      ESL_REALLOC(srcL, sizeof(int64_t) * nalloc_srcL);
-      for(i = nalloc_srcL-alloc_srcL; i < nalloc_srcL; i++) srcL[i] = -1; /* initialize */
-    }      
-    srcL[nseqs++] = sq->L;
-    esl_sq_Reuse(sq);
+  if(esl_opt_GetBoolean(go, "--dbidx") && (! (*dbfp_ptr)->data.ascii.do_stdin) && 
+     dbidx_stat((*dbfp_ptr)->filename, &dbsize, &dbmtime) == eslOK) { 
+    do_dbidx = TRUE;
+  }
+  if(do_dbidx && dbidx_read((*dbfp_ptr)->filename, (*dbfp_ptr)->format, dbsize, dbmtime, &idx) == eslOK) { 
+    /* the index is up to date, we don't need to read the file */
+    nseqs  = idx->nseqs;
+    nres   = idx->nres;
+    srcL   = idx->L;
+    offset = idx->offset;
+    free(idx);
+  }
+  else { 
+    /* we'll only use this if seqfile is gzipped */
+    ESL_ALLOC(tmp_filename, sizeof(char) * (strlen((*dbfp_ptr)->filename) + 1));
+
+    sq = esl_sq_Create();
+    while ((status = esl_sqio_ReadInfo(*dbfp_ptr, sq)) == eslOK) { 
+      nres += sq->L;
+      if(nseqs == nalloc_srcL) { /* reallocate */
+        nalloc_srcL += alloc_srcL;
+        ESL_REALLOC(srcL,   sizeof(int64_t) * nalloc_srcL);
+        ESL_REALLOC(offset, sizeof(int64_t) * nalloc_srcL);
+        for(i = nalloc_srcL-alloc_srcL; i < nalloc_srcL; i++) srcL[i] = offset[i] = -1; /* initialize */
+      }      
+      offset[nseqs] = ((*dbfp_ptr)->data.ascii.do_gzip) ? -1 : (int64_t) sq->roff; /* offsets in a gzipped file are useless */
+      srcL[nseqs++] = sq->L;
+      esl_sq_Reuse(sq);
+    }
+    if(status != eslEOF) goto ERROR; 
+
+    /* if we get here we've successfully read entire file */
+    if((*dbfp_ptr)->data.ascii.do_gzip == TRUE) { 
+      /* file is gzipped, close it and reopen it.  
+         we know we successfully opened it the first time, so a
+         failure to reopen is an exception, not a user-reportable
+         normal error. ENOTFOUND is the only normal error;
+         EFORMAT error can't occur because we know the format and
+         don't use autodetection.
+      */
+      strcpy(tmp_filename, (*dbfp_ptr)->filename);
+      tmp_fmt = (*dbfp_ptr)->format;
+      esl_sqfile_Close(*dbfp_ptr);
+      status = esl_sqfile_Open(tmp_filename, tmp_fmt, NULL, dbfp_ptr);
+      if      (status == eslENOTFOUND) ESL_EXCEPTION(eslENOTFOUND, "failed to reopen alignment file");
+      else if (status != eslOK)        ESL_FAIL(status, errbuf, "unexpected error when reopening sequence file");
+    }
+    else { 
+      /* file is not gzipped, easier case */
+      esl_sqfile_Position((*dbfp_ptr), 0);
+    }
+
+    if(do_dbidx) { 
+      new_idx.nseqs  = nseqs;
+      new_idx.nres   = nres;
+      new_idx.L      = srcL;
+      new_idx.offset = offset;
+      dbidx_write((*dbfp_ptr)->filename, (*dbfp_ptr)->format, dbsize, dbmtime, &new_idx); /* failure is ok, it's only a cache */
+    }
   }
-  if(status != eslEOF) goto ERROR; 
 
-  /* if we get here we've successfully read entire file */
   cfg->Z = nres;
   if((! esl_opt_GetBoolean(go, "--toponly")) && 
      (! esl_opt_GetBoolean(go, "--bottomonly"))) { 
@@ -2219,31 +2949,12 @@ dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr
   }
   cfg->Z_setby = CM_ZSETBY_FILEREAD;
 
-  if((*dbfp_ptr)->data.ascii.do_gzip == TRUE) { 
-    /* file is gzipped, close it and reopen it.  
-       we know we successfully opened it the first time, so a
-       failure to reopen is an exception, not a user-reportable
-       normal error. ENOTFOUND is the only normal error;
-       EFORMAT error can't occur because we know the format and
-       don't use autodetection.
-    */
-    strcpy(tmp_filename, (*dbfp_ptr)->filename);
-    tmp_fmt = (*dbfp_ptr)->format;
-    esl_sqfile_Close(*dbfp_ptr);
-    status = esl_sqfile_Open(tmp_filename, tmp_fmt, NULL, dbfp_ptr);
-    if      (status == eslENOTFOUND) ESL_EXCEPTION(eslENOTFOUND, "failed to reopen alignment file");
-    else if (status != eslOK)        ESL_FAIL(status, errbuf, "unexpected error when reopening sequence file");
-  }
-  else { 
-    /* file is not gzipped, easier case */
-    esl_sqfile_Position((*dbfp_ptr), 0);
-  }
-
   if(tmp_filename != NULL) free(tmp_filename);
   if(sq           != NULL) esl_sq_Destroy(sq);
 
-  *ret_srcL  = srcL;
-  *ret_nseqs = nseqs;
+  *ret_srcL   = srcL;
+  *ret_offset = offset;
+  *ret_nseqs  = nseqs;
 
   return eslOK;
 
@@ -2262,9 +2973,12 @@ dbsize_and_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE **dbfp_ptr
   }
   if(tmp_filename != NULL) free(tmp_filename);
   if(sq           != NULL) esl_sq_Destroy(sq);
+  if(srcL         != NULL) free(srcL);
+  if(offset       != NULL) free(offset);
 
-  *ret_srcL  = NULL;
-  *ret_nseqs = 0;
+  *ret_srcL   = NULL;
+  *ret_offset = NULL;
+  *ret_nseqs  = 0;
   return status;
 }
 
@@ -2293,7 +3007,9 @@ create_info(const ESL_GETOPTS *go)
   info->bg      = NULL;
   info->msvdata = NULL;
   ESL_ALLOC(info->p7_evparam, sizeof(float) * CM_p7_NEVPARAM);
-  info->smxsize = esl_opt_GetReal(go, "--smxsize");
+  info->smxsize   = esl_opt_GetReal(go, "--smxsize");
+  info->do_lowmem = esl_opt_GetBoolean(go, "--lowmem");
+  info->dali      = NULL;
   return info;
 
  ERROR: 
@@ -2471,32 +3187,1126 @@ setup_hmm_filter(ESL_GETOPTS *go, WORKER_INFO *info)
   return eslOK;
 }
 
-#ifdef HAVE_MPI
-/* mpi_failure()
- * Generate an error message.  If the clients rank is not 0, a
- * message is created with the error message and sent to the
- * master process for handling.
+/* Function:  prune_window_hits()
+ *
+ * Purpose:  If --lowmem was used, discard the hits <hit_start..th->N-1>
+ *           found in window <from>..<to> of a target sequence of 
+ *           length <L> that are already certain to be removed as
+ *           overlapping duplicates once the search is finished.
+ *
+ *           Each window shares at most pli->maxW residues with the
+ *           windows before and after it (in serial_loop() and
+ *           thread_loop() through esl_sqio_ReadWindow()'s context,
+ *           and in mpi_add_blocks() through <ncontext>), and those
+ *           windows may be searched by other workers, so only hits
+ *           outside the shared residues can be resolved here.
+ *
+ * Returns: <eslOK> on success. 
+ *          Other status codes from cm_tophits_RemoveResolvedDuplicates(),
+ *          with info->pli->errbuf filled.
  */
-static void
-mpi_failure(char *format, ...)
+int
+prune_window_hits(WORKER_INFO *info, int64_t hit_start, int64_t from, int64_t to, int64_t L)
 {
-  va_list  argp;
-  int      status = eslFAIL;
-  int      len;
-  int      rank;
-  char     str[512];
-
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  int64_t res_from = (from == 1) ? 1 : from + info->pli->maxW;
+  int64_t res_to   = (to   == L) ? L : to   - info->pli->maxW;
 
-  /* format the error mesg */
-  va_start(argp, format);
-  len = vsnprintf(str, sizeof(str), format, argp);
-  va_end(argp);
+  if((! info->do_lowmem) || res_from > res_to) return eslOK;
+  return cm_tophits_RemoveResolvedDuplicates(info->th, hit_start, res_from, res_to, NULL, info->pli->errbuf);
+}
 
-  /* make sure the error string is terminated */
-  str[sizeof(str)-1] = '\0';
+/* Function:  collect_deferred_hits()
+ *
+ * Purpose:  With --deferali, hits are not aligned during the search.
+ *           After the hits in <th> have been thresholded, collect
+ *           those that will be output (reported or included) and
+ *           still lack an alignment (HMM-only hits are aligned
+ *           during the search regardless), and fetch the
+ *           subsequence each will be aligned to by rereading the
+ *           target file <dbfp>. <srcL> gives the full length of
+ *           each target sequence, indexed by seq_idx.
+ *
+ *           Each subsequence is the hit plus one flanking residue
+ *           on each side (if they exist), so cm_alidisplay_Create()
+ *           can tell whether the hit includes the first or final
+ *           residue of its source sequence. Subsequences for
+ *           bottom strand hits are reverse complemented.
+ *
+ *           <dbfp> is read one window at a time, as in
+ *           serial_loop(), with enough context retained between
+ *           windows that each subsequence lies entirely within one
+ *           window. Reading stops after the final deferred hit's
+ *           window.
+ *
+ * Returns: <eslOK> on success, <*ret_dali> is the new DEFERRED_ALI,
+ *          which has <nhit> of 0 if there's nothing to align.
+ *          <eslEMEM> if out of memory, <eslEFORMAT> on a parse error,
+ *          <eslEINCONCEIVABLE> if a hit is not found in <dbfp>;
+ *          the esl_sqfile_Position() status if <dbfp> can't be 
+ *          rewound;
+ *          errbuf is filled and <*ret_dali> is NULL in all cases.
+ */
+int
+collect_deferred_hits(CM_TOPHITS *th, ESL_SQFILE *dbfp, const ESL_ALPHABET *abc, int64_t *srcL, char *errbuf, DEFERRED_ALI **ret_dali)
+{
+  int           status;
+  int           wstatus;
+  DEFERRED_ALI *dali    = NULL;
+  ESL_SQ       *dbsq    = NULL;
+  CM_HIT       *hit     = NULL;
+  int64_t       seq_idx = 0;    /* index of the sequence dbsq is a window of */
+  int64_t       C       = 0;    /* context to retain between windows, max length of any subsequence */
+  int64_t       h, i;
+
+  ESL_ALLOC(dali, sizeof(DEFERRED_ALI));
+  dali->hitA     = NULL;
+  dali->sqA      = NULL;
+  dali->fromA    = NULL;
+  dali->toA      = NULL;
+  dali->nhit     = 0;
+  dali->nworkers = 1;
+
+  ESL_ALLOC(dali->hitA, sizeof(CM_HIT *) * ESL_MAX(th->N, 1));
+  for (h = 0; h < th->N; h++) { 
+    hit = th->hit[h];
+    if(hit->ad == NULL && (hit->flags & (CM_HIT_IS_REPORTED | CM_HIT_IS_INCLUDED))) dali->hitA[dali->nhit++] = hit;
+  }
+  if(dali->nhit == 0) { *ret_dali = dali; return eslOK; }
+  qsort(dali->hitA, dali->nhit, sizeof(CM_HIT *), deferred_hit_sorter);
+
+  ESL_ALLOC(dali->sqA,   sizeof(ESL_SQ *) * dali->nhit);
+  ESL_ALLOC(dali->fromA, sizeof(int64_t)  * dali->nhit);
+  ESL_ALLOC(dali->toA,   sizeof(int64_t)  * dali->nhit);
+  for (i = 0; i < dali->nhit; i++) { 
+    hit = dali->hitA[i];
+    dali->sqA[i]   = NULL;
+    dali->fromA[i] = ESL_MAX(ESL_MIN(hit->start, hit->stop) - 1, 1);
+    dali->toA[i]   = ESL_MIN(ESL_MAX(hit->start, hit->stop) + 1, srcL[hit->seq_idx]);
+    C = ESL_MAX(C, dali->toA[i] - dali->fromA[i] + 1);
+  }
 
-  /* if the caller is the master, print the results and abort */
+  /* read the target file, extracting each subsequence from the first 
+   * window that includes its final position; because we sorted by
+   * final position and windows overlap by C residues, that window 
+   * includes the subsequence's first position too.
+   */
+  if((dbsq = esl_sq_CreateDigital(abc)) == NULL) ESL_XFAIL(eslEMEM, errbuf, "out of memory");
+  if((status = esl_sqfile_Position(dbfp, 0)) != eslOK) ESL_XFAIL(status, errbuf, "Failed to rewind target sequence file %s to align deferred hits", dbfp->filename);
+  i = 0;
+  while (i < dali->nhit) { 
+    wstatus = esl_sqio_ReadWindow(dbfp, C, CM_MAX_RESIDUE_COUNT, dbsq);
+    if(wstatus == eslEOD) { /* end of this sequence, move on to the next one */
+      seq_idx++;
+      esl_sq_Reuse(dbsq);
+      continue;
+    }
+    else if(wstatus == eslEFORMAT) ESL_XFAIL(eslEFORMAT, errbuf, "Parse failed (sequence file %s):\n%s\n", dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+    else if(wstatus != eslOK)      ESL_XFAIL(eslEINCONCEIVABLE, errbuf, "failed to find all deferred hits in sequence file %s", dbfp->filename);
+
+    while (i < dali->nhit && dali->hitA[i]->seq_idx == seq_idx && dali->toA[i] <= dbsq->end) { 
+      if(dali->fromA[i] < dbsq->start) ESL_XFAIL(eslEINCONCEIVABLE, errbuf, "deferred hit %" PRId64 "..%" PRId64 " spans two windows, this shouldn't happen", dali->hitA[i]->start, dali->hitA[i]->stop);
+      if((dali->sqA[i] = esl_sq_CreateDigitalFrom(abc, dbsq->name, dbsq->dsq + (dali->fromA[i] - dbsq->start), dali->toA[i] - dali->fromA[i] + 1, 
+						  dbsq->desc, dbsq->acc, NULL)) == NULL) ESL_XFAIL(eslEMEM, errbuf, "out of memory");
+      if(dali->hitA[i]->in_rc) esl_sq_ReverseComplement(dali->sqA[i]);
+      i++;
+    }
+    if(i < dali->nhit && dali->hitA[i]->seq_idx < seq_idx) ESL_XFAIL(eslEINCONCEIVABLE, errbuf, "failed to find deferred hit in sequence %s", dali->hitA[i]->name);
+  }
+  esl_sq_Destroy(dbsq);
+
+  *ret_dali = dali;
+  return eslOK;
+
+ ERROR:
+  if(dbsq != NULL) esl_sq_Destroy(dbsq);
+  if(dali != NULL) free_deferred_ali(dali);
+  *ret_dali = NULL;
+  if(status == eslEMEM) ESL_FAIL(status, errbuf, "collect_deferred_hits(): out of memory");
+  return status;
+}
+
+/* Function:  align_deferred_hit()
+ *
+ * Purpose:  Align deferred hit <i> in <info->dali> to <info->cm>,
+ *           to create its CM_ALIDISPLAY. The hit's coordinates are
+ *           temporarily converted to coordinates in the subsequence
+ *           we extracted for it, and the alignment's coordinates are
+ *           converted back to coordinates in the full source 
+ *           sequence, as cm_tophits_UpdateHitPositions() would have
+ *           done had we aligned the hit during the search.
+ *
+ * Returns: <eslOK> on success.
+ *          Other status codes from cm_pli_AlignHit(), with
+ *          info->pli->errbuf filled.
+ */
+int
+align_deferred_hit(WORKER_INFO *info, int64_t i)
+{
+  int           status;
+  DEFERRED_ALI *dali  = info->dali;
+  CM_HIT       *hit   = dali->hitA[i];
+  int64_t       start = hit->start;
+  int64_t       stop  = hit->stop;
+
+  if(hit->in_rc) { 
+    hit->start = dali->toA[i] - start + 1;
+    hit->stop  = dali->toA[i] - stop  + 1;
+  }
+  else { 
+    hit->start = start - dali->fromA[i] + 1;
+    hit->stop  = stop  - dali->fromA[i] + 1;
+  }
+  status = cm_pli_AlignHit(info->pli, info->cm, dali->sqA[i], hit);
+  hit->start = start;
+  hit->stop  = stop;
+  if(status != eslOK) return status;
+
+  if(hit->in_rc) { 
+    hit->ad->sqfrom = dali->toA[i] - hit->ad->sqfrom + 1;
+    hit->ad->sqto   = dali->toA[i] - hit->ad->sqto   + 1;
+  }
+  else { 
+    hit->ad->sqfrom += dali->fromA[i] - 1;
+    hit->ad->sqto   += dali->fromA[i] - 1;
+  }
+  return eslOK;
+}
+
+/* Function:  free_deferred_ali()
+ *
+ * Purpose:  Free a DEFERRED_ALI object. The hits it points to 
+ *           belong to a CM_TOPHITS and are not freed.
+ *
+ * Returns: void.
+ */
+void
+free_deferred_ali(DEFERRED_ALI *dali)
+{ 
+  int64_t i;
+
+  if(dali == NULL) return;
+  if(dali->sqA != NULL) { 
+    for (i = 0; i < dali->nhit; i++) if(dali->sqA[i] != NULL) esl_sq_Destroy(dali->sqA[i]);
+    free(dali->sqA);
+  }
+  if(dali->hitA  != NULL) free(dali->hitA);
+  if(dali->fromA != NULL) free(dali->fromA);
+  if(dali->toA   != NULL) free(dali->toA);
+  free(dali);
+
+  return;
+}
+
+/* deferred_hit_sorter(): qsort() callback for collect_deferred_hits(),
+ * sorts hits by sequence index, then by final position on the top strand.
+ */
+static int
+deferred_hit_sorter(const void *vh1, const void *vh2)
+{
+  CM_HIT *h1 = *((CM_HIT **) vh1);
+  CM_HIT *h2 = *((CM_HIT **) vh2);
+  int64_t to1 = ESL_MAX(h1->start, h1->stop);
+  int64_t to2 = ESL_MAX(h2->start, h2->stop);
+
+  if      (h1->seq_idx > h2->seq_idx) return  1;
+  else if (h1->seq_idx < h2->seq_idx) return -1;
+  else if (to1 > to2)                 return  1;
+  else if (to1 < to2)                 return -1;
+  return 0;
+}
+
+/* ckpt_create()
+ * Create and return a new CKPT object for a search that
+ * hasn't started, or NULL if an allocation fails.
+ */
+static CKPT *
+ckpt_create(void)
+{
+  int   status;
+  int   i;
+  CKPT *ckpt = NULL;
+
+  ESL_ALLOC(ckpt, sizeof(CKPT));
+  ckpt->nseqs   = 0;
+  ckpt->nres    = 0;
+  ckpt->cm_idx  = 1;
+  ckpt->cm_name = NULL;
+  ckpt->fp      = NULL;
+  for(i = 0; i < 4; i++) ckpt->offA[i] = -1;
+
+  return ckpt;
+
+ ERROR:
+  return NULL;
+}
+
+/* ckpt_destroy()
+ * Free a CKPT object, closing its checkpoint file if it's open.
+ */
+static void
+ckpt_destroy(CKPT *ckpt)
+{
+  if(ckpt == NULL) return;
+  if(ckpt->cm_name != NULL) free(ckpt->cm_name);
+  if(ckpt->fp      != NULL) fclose(ckpt->fp);
+  free(ckpt);
+  return;
+}
+
+/* ckpt_set_offsets()
+ * Record the current size of the -o, -A, --tblout and --hitsout
+ * output files in <ckpt>, so a resumed search can discard anything
+ * written after this point. Output to stdout can't be taken
+ * back, its offset is set as -1, as are those of unused files.
+ */
+static void
+ckpt_set_offsets(CKPT *ckpt, FILE *ofp, FILE *afp, FILE *tblfp, FILE *hitsfp)
+{
+  FILE *fpA[4];
+  int   i;
+
+  fpA[0] = ofp;
+  fpA[1] = afp;
+  fpA[2] = tblfp;
+  fpA[3] = hitsfp;
+  for(i = 0; i < 4; i++) { 
+    if(fpA[i] == NULL || fpA[i] == stdout) { 
+      ckpt->offA[i] = -1;
+    }
+    else { 
+      fflush(fpA[i]);
+      ckpt->offA[i] = (int64_t) ftello(fpA[i]);
+    }
+  }
+  return;
+}
+
+/* ckpt_write()
+ * Save the search progress in <ckpt> and the pipeline accounting
+ * and hits of the first <nlists> workers in <info> (<nlists> is 0
+ * between queries) to checkpoint file <ckptfile>. We write to a
+ * temporary file and then rename it, so <ckptfile> always holds a
+ * complete checkpoint even if we're killed while writing it.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the file can't be written.
+ */
+static int
+ckpt_write(char *ckptfile, CKPT *ckpt, WORKER_INFO *info, int nlists, char *errbuf)
+{
+  int       status;
+  FILE     *fp      = NULL;
+  char     *tmpfile = NULL;
+  uint32_t  magic   = CKPT_MAGIC;
+  int       len     = (ckpt->cm_name == NULL) ? 0 : strlen(ckpt->cm_name) + 1;
+  int       i;
+
+  ESL_ALLOC(tmpfile, sizeof(char) * (strlen(ckptfile) + 5));
+  sprintf(tmpfile, "%s.tmp", ckptfile);
+  if((fp = fopen(tmpfile, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open checkpoint file %s for writing", tmpfile);
+
+  if(fwrite((char *) &magic,          sizeof(uint32_t), 1,   fp) != 1   ||
+     fwrite((char *) &(ckpt->nseqs),  sizeof(int64_t),  1,   fp) != 1   ||
+     fwrite((char *) &(ckpt->nres),   sizeof(int64_t),  1,   fp) != 1   ||
+     fwrite((char *) &(ckpt->cm_idx), sizeof(int64_t),  1,   fp) != 1   ||
+     fwrite((char *) &len,            sizeof(int),      1,   fp) != 1   ||
+     (len > 0 && fwrite((char *) ckpt->cm_name, sizeof(char), len, fp) != len) ||
+     fwrite((char *) ckpt->offA,      sizeof(int64_t),  4,   fp) != 4   ||
+     fwrite((char *) &nlists,         sizeof(int),      1,   fp) != 1) { 
+    ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  }
+  for(i = 0; i < nlists; i++) { 
+    if(cm_pli_WriteAccounting(fp, info[i].pli) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+    if(cm_tophits_WriteBinary(fp, info[i].th, CM_TOPHITS_BIN_DEFAULT) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  }
+  if(fwrite((char *) &magic, sizeof(uint32_t), 1, fp) != 1) ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+
+  status = fclose(fp);
+  fp = NULL;
+  if(status != 0)                      ESL_XFAIL(eslFAIL, errbuf, "Failed to write checkpoint file %s", tmpfile);
+  if(rename(tmpfile, ckptfile) != 0)   ESL_XFAIL(eslFAIL, errbuf, "Failed to rename checkpoint file %s to %s", tmpfile, ckptfile);
+
+  free(tmpfile);
+  return eslOK;
+
+ ERROR:
+  if(fp      != NULL) fclose(fp);
+  if(tmpfile != NULL) free(tmpfile);
+  return eslFAIL;
+}
+
+/* ckpt_read()
+ * Open checkpoint file <ckptfile> and read the search progress
+ * saved in its header into a new CKPT object. The file is left open
+ * in <ret_ckpt>->fp, for ckpt_restore() to read the saved pipeline
+ * accounting and hits from.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the file can't be opened or isn't a checkpoint
+ * file.
+ */
+static int
+ckpt_read(char *ckptfile, char *errbuf, CKPT **ret_ckpt)
+{
+  int       status;
+  CKPT     *ckpt = NULL;
+  uint32_t  magic;
+  int       len;
+
+  if((ckpt = ckpt_create()) == NULL) ESL_XFAIL(eslEMEM, errbuf, "Out of memory");
+  if((ckpt->fp = fopen(ckptfile, "rb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open checkpoint file %s", ckptfile);
+
+  if(! fread((char *) &magic, sizeof(uint32_t), 1, ckpt->fp) || magic != CKPT_MAGIC) ESL_XFAIL(eslFAIL, errbuf, "%s is not a cmsearch checkpoint file", ckptfile);
+  if(! fread((char *) &(ckpt->nseqs),  sizeof(int64_t), 1, ckpt->fp) ||
+     ! fread((char *) &(ckpt->nres),   sizeof(int64_t), 1, ckpt->fp) ||
+     ! fread((char *) &(ckpt->cm_idx), sizeof(int64_t), 1, ckpt->fp) ||
+     ! fread((char *) &len,            sizeof(int),     1, ckpt->fp) || len < 0) { 
+    ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file %s is truncated or corrupt", ckptfile);
+  }
+  if(len > 0) { 
+    ESL_ALLOC(ckpt->cm_name, sizeof(char) * len);
+    if(fread((char *) ckpt->cm_name, sizeof(char), len, ckpt->fp) != len || ckpt->cm_name[len-1] != '\0') ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file %s is truncated or corrupt", ckptfile);
+  }
+  if(fread((char *) ckpt->offA, sizeof(int64_t), 4, ckpt->fp) != 4 || ckpt->cm_idx < 1) ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file %s is truncated or corrupt", ckptfile);
+
+  *ret_ckpt = ckpt;
+  return eslOK;
+
+ ERROR:
+  ckpt_destroy(ckpt);
+  *ret_ckpt = NULL;
+  return status;
+}
+
+/* ckpt_restore()
+ * Read the pipeline accounting and hits saved after the header of
+ * the checkpoint file open in <ckpt>->fp, for the search of query
+ * <cm_name>, and add them to worker <info>. Close the checkpoint
+ * file.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the checkpoint was saved during the search of
+ * a different query or the file is truncated or corrupt.
+ */
+static int
+ckpt_restore(CKPT *ckpt, char *cm_name, WORKER_INFO *info, char *errbuf)
+{
+  int       status;
+  uint32_t  magic;
+  int       nlists;
+  int       i;
+
+  if(ckpt->cm_name != NULL && strcmp(ckpt->cm_name, cm_name) != 0) { 
+    ESL_XFAIL(eslFAIL, errbuf, "Checkpoint was saved during search of query %s, but query %" PRId64 " is %s", ckpt->cm_name, ckpt->cm_idx, cm_name);
+  }
+  if(! fread((char *) &nlists, sizeof(int), 1, ckpt->fp) || nlists < 0) ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file is truncated or corrupt");
+  for(i = 0; i < nlists; i++) { 
+    if(cm_pli_ReadAccounting(ckpt->fp, info->pli) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file is truncated or corrupt");
+    if((status = cm_tophits_ReadBinary(ckpt->fp, info->th, errbuf)) != eslOK) { status = eslFAIL; goto ERROR; }
+  }
+  if(! fread((char *) &magic, sizeof(uint32_t), 1, ckpt->fp) || magic != CKPT_MAGIC) ESL_XFAIL(eslFAIL, errbuf, "Checkpoint file is truncated or corrupt");
+
+  fclose(ckpt->fp);
+  ckpt->fp = NULL;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* ckpt_reopen_output()
+ * Reopen output file <filename> of a search we're resuming, discard
+ * everything after its first <offset> bytes, which were written
+ * before the checkpoint was saved, and position it for appending.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the file wasn't an output file of the checkpointed
+ * search, is shorter than <offset>, or can't be truncated.
+ */
+static int
+ckpt_reopen_output(char *filename, int64_t offset, char *errbuf, FILE **ret_fp)
+{
+  int    status;
+  FILE  *fp = NULL;
+  off_t  size;
+
+  if(offset < 0)                             ESL_XFAIL(eslFAIL, errbuf, "Output file %s wasn't written to in the checkpointed search, use the same output options to resume", filename);
+  if((fp = fopen(filename, "r+")) == NULL)    ESL_XFAIL(eslFAIL, errbuf, "Failed to open output file %s to resume search", filename);
+  if(fseeko(fp, 0, SEEK_END) != 0 || (size = ftello(fp)) < 0) ESL_XFAIL(eslFAIL, errbuf, "Failed to determine size of output file %s", filename);
+  if(size < offset)                          ESL_XFAIL(eslFAIL, errbuf, "Output file %s is shorter than when the checkpoint was saved", filename);
+  if(ftruncate(fileno(fp), (off_t) offset) != 0) ESL_XFAIL(eslFAIL, errbuf, "Failed to truncate output file %s", filename);
+  if(fseeko(fp, (off_t) offset, SEEK_SET) != 0)   ESL_XFAIL(eslFAIL, errbuf, "Failed to set position in output file %s", filename);
+
+  *ret_fp = fp;
+  return eslOK;
+
+ ERROR:
+  if(fp != NULL) fclose(fp);
+  *ret_fp = NULL;
+  return status;
+}
+
+/* ckpt_skip_seqs()
+ * Skip the first <nskip> sequences of <dbfp>, which must be
+ * positioned at its beginning. These were searched before the
+ * checkpoint we're resuming from was saved.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the file has fewer than <nskip> sequences or
+ * can't be parsed.
+ */
+static int
+ckpt_skip_seqs(ESL_SQFILE *dbfp, int64_t nskip, char *errbuf)
+{
+  int      status = eslOK;
+  ESL_SQ  *sq     = esl_sq_Create();
+  int64_t  i;
+
+  for(i = 0; i < nskip; i++) { 
+    if((status = esl_sqio_ReadInfo(dbfp, sq)) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Failed to skip sequences already searched in %s:\n%s", dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+    esl_sq_Reuse(sq);
+  }
+  esl_sq_Destroy(sq);
+  return eslOK;
+
+ ERROR:
+  esl_sq_Destroy(sq);
+  return status;
+}
+
+/* hits_write_header()
+ * Write the header of a --hitsout file to <fp>: HITS_MAGIC, then
+ * the name of the target database <dbfile>, its size <Z>, how
+ * <Z> was set, <Z_setby>, and the shard of the database searched,
+ * <shard_idx> of <nshards> (0 of 0 if not sharded).
+ *
+ * Returns eslOK on success, eslFAIL if a write fails.
+ */
+static int
+hits_write_header(FILE *fp, char *dbfile, int64_t Z, enum cm_zsetby_e Z_setby, int shard_idx, int nshards)
+{
+  uint32_t magic = HITS_MAGIC;
+  int      len   = strlen(dbfile) + 1;
+  int      setby = (int) Z_setby;
+
+  if(fwrite((char *) &magic,     sizeof(uint32_t), 1,   fp) != 1   ||
+     fwrite((char *) &len,       sizeof(int),      1,   fp) != 1   ||
+     fwrite((char *) dbfile,     sizeof(char),     len, fp) != len ||
+     fwrite((char *) &Z,         sizeof(int64_t),  1,   fp) != 1   ||
+     fwrite((char *) &setby,     sizeof(int),      1,   fp) != 1   ||
+     fwrite((char *) &shard_idx, sizeof(int),      1,   fp) != 1   ||
+     fwrite((char *) &nshards,   sizeof(int),      1,   fp) != 1) { 
+    return eslFAIL;
+  }
+  return eslOK;
+}
+
+/* hits_write_query()
+ * Write the results of the search of query <cm_name> to the
+ * --hitsout file <fp>: the query name, the accounting of pipeline
+ * <pli> and the hits in <th>, before overlap removal and
+ * thresholding. The alignments of the hits are compressed, they
+ * make up most of the file.
+ *
+ * Returns eslOK on success, eslFAIL if a write fails.
+ */
+static int
+hits_write_query(FILE *fp, char *cm_name, CM_PIPELINE *pli, CM_TOPHITS *th)
+{
+  int len = strlen(cm_name) + 1;
+
+  if(fwrite((char *) &len,    sizeof(int),  1,   fp) != 1   ||
+     fwrite((char *) cm_name, sizeof(char), len, fp) != len) { 
+    return eslFAIL;
+  }
+  if(cm_pli_WriteAccounting(fp, pli)                          != eslOK) return eslFAIL;
+  if(cm_tophits_WriteBinary(fp, th, CM_TOPHITS_BIN_COMPRESS) != eslOK) return eslFAIL;
+  fflush(fp);
+  return eslOK;
+}
+
+/* hits_write_tail()
+ * Write the final HITS_MAGIC to --hitsout file <fp>, after the
+ * results of the final query, showing the search was complete.
+ *
+ * Returns eslOK on success, eslFAIL if the write fails.
+ */
+static int
+hits_write_tail(FILE *fp)
+{
+  uint32_t magic = HITS_MAGIC;
+
+  if(fwrite((char *) &magic, sizeof(uint32_t), 1, fp) != 1) return eslFAIL;
+  return eslOK;
+}
+
+/* hits_open()
+ * Open the --hitsout file <hitsfile> for reading and read its
+ * header: the name of the target database searched, which is
+ * returned in newly allocated <*ret_dbfile>, its size <*ret_Z>,
+ * how it was set <*ret_Z_setby>, and the shard searched,
+ * <*ret_shard_idx> of <*ret_nshards>. The file is returned open in
+ * <*ret_fp>, positioned at the results of the first query.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the file can't be opened or isn't a --hitsout
+ * file.
+ */
+static int
+hits_open(char *hitsfile, char *errbuf, FILE **ret_fp, char **ret_dbfile, int64_t *ret_Z, enum cm_zsetby_e *ret_Z_setby, int *ret_shard_idx, int *ret_nshards)
+{
+  int       status;
+  FILE     *fp     = NULL;
+  char     *dbfile = NULL;
+  uint32_t  magic;
+  int       len;
+  int64_t   Z;
+  int       setby;
+  int       shard_idx;
+  int       nshards;
+
+  if((fp = fopen(hitsfile, "rb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open hits file %s", hitsfile);
+  if(! fread((char *) &magic, sizeof(uint32_t), 1, fp) || magic != HITS_MAGIC) ESL_XFAIL(eslFAIL, errbuf, "%s is not a cmsearch --hitsout file", hitsfile);
+  if(! fread((char *) &len, sizeof(int), 1, fp) || len < 1) ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt", hitsfile);
+  ESL_ALLOC(dbfile, sizeof(char) * len);
+  if(fread((char *) dbfile, sizeof(char), len, fp) != len || dbfile[len-1] != '\0' ||
+     ! fread((char *) &Z,         sizeof(int64_t), 1, fp) ||
+     ! fread((char *) &setby,     sizeof(int),     1, fp) ||
+     ! fread((char *) &shard_idx, sizeof(int),     1, fp) ||
+     ! fread((char *) &nshards,   sizeof(int),     1, fp) || 
+     nshards < 0 || shard_idx < 0 || shard_idx > nshards || (nshards > 0 && shard_idx == 0)) { 
+    ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt", hitsfile);
+  }
+
+  *ret_fp        = fp;
+  *ret_dbfile    = dbfile;
+  *ret_Z         = Z;
+  *ret_Z_setby   = (enum cm_zsetby_e) setby;
+  *ret_shard_idx = shard_idx;
+  *ret_nshards   = nshards;
+  return eslOK;
+
+ ERROR:
+  if(fp     != NULL) fclose(fp);
+  if(dbfile != NULL) free(dbfile);
+  *ret_fp     = NULL;
+  *ret_dbfile = NULL;
+  return status;
+}
+
+/* hits_read_query()
+ * Read the results of the search of query <cm_name> from --hitsout
+ * file <fp> (named <hitsfile>, for error messages): add its
+ * pipeline accounting to <pli> and its hits to <th>. If
+ * <do_offset> is TRUE, the hits' sequence indices are offset by the
+ * number of sequences already in <pli>, so sequences from different
+ * files of a merge never share an index, and when each file holds
+ * the results for a consecutive stretch of a database, given in
+ * order, the indices are those of a search of the full database.
+ * Files saved with --shard already have those indices, <do_offset>
+ * is FALSE for them.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if the next results in <fp> are for a different
+ * query, or the file is truncated or corrupt.
+ */
+static int
+hits_read_query(FILE *fp, char *hitsfile, char *cm_name, int do_offset, CM_PIPELINE *pli, CM_TOPHITS *th, char *errbuf)
+{
+  int      status;
+  char    *name       = NULL;
+  int      len;
+  int64_t  seq_offset = do_offset ? pli->nseqs : 0;
+  uint64_t N0         = th->N;
+  uint64_t h;
+  char     thbuf[eslERRBUFSIZE]; /* error message from cm_tophits_ReadBinary() */
+
+  if(! fread((char *) &len, sizeof(int), 1, fp) || len < 1) ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt, or holds fewer queries than the CM file", hitsfile);
+  ESL_ALLOC(name, sizeof(char) * len);
+  if(fread((char *) name, sizeof(char), len, fp) != len || name[len-1] != '\0') ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt", hitsfile);
+  if(strcmp(name, cm_name) != 0) ESL_XFAIL(eslFAIL, errbuf, "Hits file %s holds results for query %s, but the next query in the CM file is %s", hitsfile, name, cm_name);
+
+  if(cm_pli_ReadAccounting(fp, pli) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt", hitsfile);
+  if((status = cm_tophits_ReadBinary(fp, th, thbuf)) != eslOK) { 
+    if(status == eslEMEM) goto ERROR;
+    ESL_XFAIL(eslFAIL, errbuf, "Hits file %s is truncated or corrupt: %s", hitsfile, thbuf);
+  }
+  for(h = N0; h < th->N; h++) th->unsrt[h].seq_idx += seq_offset;
+
+  free(name);
+  return eslOK;
+
+ ERROR:
+  if(name != NULL) free(name);
+  return status;
+}
+
+/* hits_read_tail()
+ * Read the final HITS_MAGIC from --hitsout file <fp> (named
+ * <hitsfile>, for error messages), after the results of the final
+ * query.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if it's missing, because the file holds results for
+ * more queries than the CM file, or the search that wrote it didn't
+ * finish.
+ */
+static int
+hits_read_tail(FILE *fp, char *hitsfile, char *errbuf)
+{
+  uint32_t magic;
+
+  if(! fread((char *) &magic, sizeof(uint32_t), 1, fp)) ESL_FAIL(eslFAIL, errbuf, "Hits file %s is incomplete, the search that saved it didn't finish", hitsfile);
+  if(magic != HITS_MAGIC)                               ESL_FAIL(eslFAIL, errbuf, "Hits file %s holds results for more queries than the CM file, or is corrupt", hitsfile);
+  return eslOK;
+}
+
+/* merge_open()
+ * With --merge, open each of the --hitsout files given on the
+ * command line in place of <seqdb> and read their headers. The
+ * files are returned open in <*ret_hitsfpA>, <*ret_nhitsfiles> of
+ * them. Set <cfg->dbfile> as the name of the target database
+ * searched, or a comma-separated list of the names if the files
+ * were saved by searches of different databases; it is newly
+ * allocated and must be freed by the caller.
+ *
+ * Also set <cfg->Z>. If the files were saved with --shard, they
+ * must be all <n> shards of the same database, each once, and each
+ * search used the size of the full database, which is what we
+ * use; <*ret_sharded> is returned TRUE. Otherwise, the files
+ * usually hold the results of searches of different parts of a
+ * database, and we compute E-values for the search of all of them,
+ * so <cfg->Z> is the sum of their sizes; unless they were all set
+ * with -Z, then it must have been the same in each search, and
+ * that's what we use. If -Z is used with --merge, it overrides
+ * <cfg->Z> after we return.
+ *
+ * Returns eslOK on success. Returns eslFAIL, with an error message
+ * in <errbuf>, if a file can't be opened or read, if sharded and
+ * unsharded files are mixed or shards are missing, or if the
+ * database sizes of the files can't be combined. 
+ */
+static int
+merge_open(ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf, FILE ***ret_hitsfpA, int *ret_nhitsfiles, int *ret_sharded)
+{
+  int               status;
+  FILE            **hitsfpA    = NULL;
+  int               nhitsfiles = esl_opt_ArgNumber(go) - 1;
+  char             *dbfile     = NULL;
+  char             *dbfiles    = NULL;
+  int64_t           Z;
+  enum cm_zsetby_e  Z_setby;
+  int               shard_idx;
+  int               nshards;
+  int               nshards0   = 0;    /* nshards of the first file */
+  int              *fileA      = NULL; /* with --shard, [1..nshards] index of file holding each shard, -1 if none */
+  int               noption    = 0;    /* number of files with Z set by -Z */
+  int               i;
+
+  ESL_ALLOC(hitsfpA, sizeof(FILE *) * nhitsfiles);
+  for(i = 0; i < nhitsfiles; i++) hitsfpA[i] = NULL;
+  cfg->Z = 0;
+
+  for(i = 0; i < nhitsfiles; i++) { 
+    if((status = hits_open(esl_opt_GetArg(go, i+2), errbuf, &(hitsfpA[i]), &dbfile, &Z, &Z_setby, &shard_idx, &nshards)) != eslOK) goto ERROR;
+    if(i == 0) { 
+      dbfiles      = dbfile;
+      dbfile       = NULL;
+      cfg->Z       = Z;
+      cfg->Z_setby = Z_setby;
+      nshards0     = nshards;
+      if(nshards > 0) { 
+        ESL_ALLOC(fileA, sizeof(int) * (nshards+1));
+        esl_vec_ISet(fileA, nshards+1, -1);
+      }
+    }
+    else { 
+      if(strcmp(dbfile, dbfiles) != 0) { /* only checks the first name, good enough for output */
+        if(nshards0 > 0) ESL_XFAIL(eslFAIL, errbuf, "Hits files %s and %s were saved by --shard searches of different databases", esl_opt_GetArg(go, 2), esl_opt_GetArg(go, i+2));
+        if((status = esl_strcat(&dbfiles, -1, ",",    1))  != eslOK) goto ERROR;
+        if((status = esl_strcat(&dbfiles, -1, dbfile, -1)) != eslOK) goto ERROR;
+      }
+      free(dbfile);
+      dbfile = NULL;
+      if(nshards != nshards0) { 
+        if(nshards0 == 0 || nshards == 0) ESL_XFAIL(eslFAIL, errbuf, "Hits files saved with and without --shard can't be merged");
+        ESL_XFAIL(eslFAIL, errbuf, "Hits files %s and %s were saved by searches of different numbers of shards", esl_opt_GetArg(go, 2), esl_opt_GetArg(go, i+2));
+      }
+      if(nshards > 0) { 
+        /* each shard's search used the size of the full database */
+        if(Z != cfg->Z && (! esl_opt_IsUsed(go, "-Z"))) { 
+          ESL_XFAIL(eslFAIL, errbuf, "Hits files %s and %s were saved by searches with different database sizes, use -Z to set the database size for the merge", esl_opt_GetArg(go, 2), esl_opt_GetArg(go, i+2));
+        }
+      }
+      else if(Z_setby == CM_ZSETBY_OPTION) { 
+        if(cfg->Z_setby == CM_ZSETBY_OPTION && Z != cfg->Z && (! esl_opt_IsUsed(go, "-Z"))) { 
+          ESL_XFAIL(eslFAIL, errbuf, "Hits files %s and %s were saved by searches with different -Z values, use -Z to set the database size for the merge", esl_opt_GetArg(go, 2), esl_opt_GetArg(go, i+2));
+        }
+      }
+      else { 
+        cfg->Z += Z;
+      }
+    }
+    if(nshards > 0) { 
+      if(fileA[shard_idx] != -1) ESL_XFAIL(eslFAIL, errbuf, "Hits files %s and %s both hold shard %d of %d", esl_opt_GetArg(go, fileA[shard_idx]+2), esl_opt_GetArg(go, i+2), shard_idx, nshards);
+      fileA[shard_idx] = i;
+    }
+    if(Z_setby == CM_ZSETBY_OPTION) noption++;
+  }
+  if(nshards0 > 0) { 
+    for(shard_idx = 1; shard_idx <= nshards0; shard_idx++) { 
+      if(fileA[shard_idx] == -1) ESL_XFAIL(eslFAIL, errbuf, "Hits file for shard %d of %d is missing", shard_idx, nshards0);
+    }
+  }
+  else if(noption > 0 && noption < nhitsfiles && (! esl_opt_IsUsed(go, "-Z"))) { 
+    ESL_XFAIL(eslFAIL, errbuf, "Some but not all of the hits files were saved by searches with -Z, use -Z to set the database size for the merge");
+  }
+
+  if(fileA != NULL) free(fileA);
+  cfg->dbfile     = dbfiles;
+  *ret_hitsfpA    = hitsfpA;
+  *ret_nhitsfiles = nhitsfiles;
+  *ret_sharded    = (nshards0 > 0) ? TRUE : FALSE;
+  return eslOK;
+
+ ERROR:
+  if(hitsfpA != NULL) { 
+    for(i = 0; i < nhitsfiles; i++) if(hitsfpA[i] != NULL) fclose(hitsfpA[i]);
+    free(hitsfpA);
+  }
+  if(fileA   != NULL) free(fileA);
+  if(dbfile  != NULL) free(dbfile);
+  if(dbfiles != NULL) free(dbfiles);
+  *ret_hitsfpA    = NULL;
+  *ret_nhitsfiles = 0;
+  *ret_sharded    = FALSE;
+  return status;
+}
+
+/* parse_shard()
+ * Parse the argument of --shard, <shard>, "<i>/<n>", into
+ * <*ret_shard_idx> (<i>) and <*ret_nshards> (<n>).
+ *
+ * Returns eslOK on success, eslEINVAL if <shard> isn't of that
+ * form with 1 <= <i> <= <n>.
+ */
+static int
+parse_shard(char *shard, int *ret_shard_idx, int *ret_nshards)
+{
+  int  shard_idx;
+  int  nshards;
+  char c;
+
+  if(sscanf(shard, "%d/%d%c", &shard_idx, &nshards, &c) != 2) return eslEINVAL;
+  if(nshards < 1 || shard_idx < 1 || shard_idx > nshards)      return eslEINVAL;
+
+  *ret_shard_idx = shard_idx;
+  *ret_nshards   = nshards;
+  return eslOK;
+}
+
+/* shard_seq_lengths()
+ * With --shard <shard_idx>/<nshards>, determine the target database
+ * size and sequence lengths from the SSI index of <dbfp>, instead of
+ * reading the file as dbsize_and_seq_lengths() does: every shard's
+ * search must use the size of the full database, so its E-values
+ * and size-dependent filter thresholds are those of a search of
+ * all of it, and we only want to read our own shard. <cfg->Z> is
+ * set, <*ret_srcL> is the length of every sequence in the database,
+ * in the order they occur in the file (SSI numbers primary keys in
+ * sorted order, not file order).
+ *
+ * The database is split into <nshards> runs of consecutive
+ * sequences, with about the same number of residues each; our
+ * shard is sequences <*ret_first>..<*ret_end>-1 (it is empty if a
+ * few very long sequences cover several shards' share of
+ * residues), and the first of them starts at offset
+ * <*ret_first_offset> of the file. Each job of a sharded search
+ * computes the same split.
+ *
+ * With --dbidx, the lengths and offsets are read from the
+ * <seqdb>.cmdbi index instead, if it's up to date, and SSI isn't
+ * needed. (We never write the index here, that would mean reading
+ * all of <seqdb>.)
+ *
+ * Returns eslOK on success. Returns an error status, with an error
+ * message in <errbuf>, if there's no valid SSI index for the file.
+ */
+static int
+shard_seq_lengths(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE *dbfp, int shard_idx, int nshards, char *errbuf, int64_t **ret_srcL, int64_t *ret_first, int64_t *ret_end, off_t *ret_first_offset)
+{
+  int         status;
+  SHARD_SEQ  *seqA  = NULL;
+  int64_t    *srcL  = NULL;
+  DBIDX      *idx   = NULL;
+  int64_t     dbsize, dbmtime;
+  int64_t     nseqs;
+  int64_t     nres  = 0;
+  int64_t     cres  = 0; /* number of residues before the current sequence */
+  int64_t     first = 0;
+  int64_t     end   = 0;
+  uint16_t    fh;
+  int64_t     i;
+
+  if (dbfp->data.ascii.do_gzip)  ESL_XFAIL(eslEINVAL, errbuf, "Reading gzipped sequence files is not supported with --shard.");
+  if (dbfp->data.ascii.do_stdin) ESL_XFAIL(eslEINVAL, errbuf, "Reading sequence files from stdin is not supported with --shard.");
+
+  if(esl_opt_GetBoolean(go, "--dbidx") && dbidx_stat(dbfp->filename, &dbsize, &dbmtime) == eslOK &&
+     dbidx_read(dbfp->filename, dbfp->format, dbsize, dbmtime, &idx) == eslOK && idx->nseqs > 0) { 
+    /* the index is up to date and already in file order */
+    nseqs = idx->nseqs;
+    ESL_ALLOC(seqA, sizeof(SHARD_SEQ) * nseqs);
+    ESL_ALLOC(srcL, sizeof(int64_t)   * nseqs);
+    for(i = 0; i < nseqs; i++) { 
+      seqA[i].L      = idx->L[i];
+      seqA[i].offset = (off_t) idx->offset[i];
+      nres += seqA[i].L;
+    }
+    dbidx_destroy(idx);
+    idx = NULL;
+  }
+  else { 
+    if(idx != NULL) { dbidx_destroy(idx); idx = NULL; }
+    status = esl_sqfile_OpenSSI(dbfp, NULL);
+    if      (status == eslEFORMAT) ESL_XFAIL(status, errbuf, "SSI index for database file is in incorrect format\n");
+    else if (status == eslERANGE)  ESL_XFAIL(status, errbuf, "SSI index for database file is in 64-bit format and we can't read it\n");
+    else if (status != eslOK)      ESL_XFAIL(status, errbuf, "Failed to open SSI index, use esl-sfetch to index the database file.\n");
+
+    nseqs = dbfp->data.ascii.ssi->nprimary;
+    if(nseqs == 0) ESL_XFAIL(eslEINVAL, errbuf, "SSI index for database file has no sequences.");
+    ESL_ALLOC(seqA, sizeof(SHARD_SEQ) * nseqs);
+    ESL_ALLOC(srcL, sizeof(int64_t)   * nseqs);
+    for(i = 0; i < nseqs; i++) { 
+      status = esl_ssi_FindNumber(dbfp->data.ascii.ssi, i, &fh, &(seqA[i].offset), NULL, &(seqA[i].L), NULL);
+      if(status == eslENOTFOUND) ESL_XFAIL(status, errbuf, "unable to find sequence %" PRId64 " in SSI index file, try re-indexing with esl-sfetch.", i);
+      if(status == eslEFORMAT)   ESL_XFAIL(status, errbuf, "SSI index for database file is in incorrect format.");
+      if(status != eslOK)        ESL_XFAIL(status, errbuf, "problem with SSI index for database file.");
+      if(fh != 0)                ESL_XFAIL(eslEINVAL, errbuf, "SSI index for database file indexes more than one file.");
+      nres += seqA[i].L;
+    }
+    qsort(seqA, nseqs, sizeof(SHARD_SEQ), shard_seq_sorter);
+  }
+
+  /* shard s is the sequences starting in the s'th 1/nshards of the residues */
+  for(i = 0; i < nseqs; i++) { 
+    srcL[i] = seqA[i].L;
+    if((double) cres * nshards < (double) nres * (shard_idx-1)) first = i+1;
+    if((double) cres * nshards < (double) nres * shard_idx)     end   = i+1;
+    cres += srcL[i];
+  }
+  if(shard_idx == nshards) end = nseqs; /* include any trailing zero-length sequences */
+
+  cfg->Z = nres;
+  if((! esl_opt_GetBoolean(go, "--toponly")) && 
+     (! esl_opt_GetBoolean(go, "--bottomonly"))) { 
+    cfg->Z *= 2; /* we're searching both strands */
+  }
+  cfg->Z_setby = CM_ZSETBY_SSIINFO;
+
+  *ret_first_offset = (first < nseqs) ? seqA[first].offset : 0;
+  free(seqA);
+  *ret_srcL  = srcL;
+  *ret_first = first;
+  *ret_end   = end;
+  return eslOK;
+
+ ERROR:
+  if(idx  != NULL) dbidx_destroy(idx);
+  if(seqA != NULL) free(seqA);
+  if(srcL != NULL) free(srcL);
+  *ret_srcL  = NULL;
+  *ret_first = 0;
+  *ret_end   = 0;
+  *ret_first_offset = 0;
+  return status;
+}
+
+/* shard_seq_sorter()
+ * qsort() comparison function for sorting SHARD_SEQs by offset,
+ * into the order they occur in the file.
+ */
+static int
+shard_seq_sorter(const void *vh1, const void *vh2)
+{
+  SHARD_SEQ *h1 = (SHARD_SEQ *) vh1;
+  SHARD_SEQ *h2 = (SHARD_SEQ *) vh2;
+
+  if      (h1->offset < h2->offset) return -1;
+  else if (h1->offset > h2->offset) return  1;
+  return 0;
+}
+
+/* dbidx_stat()
+ * Get the size in bytes and modification time of target database
+ * file <dbfile>, which a --dbidx index must match to be used.
+ *
+ * Returns eslOK on success, eslFAIL if the file can't be stat'ed.
+ */
+static int
+dbidx_stat(char *dbfile, int64_t *ret_size, int64_t *ret_mtime)
+{
+  struct stat st;
+
+  if(stat(dbfile, &st) != 0) { *ret_size = *ret_mtime = 0; return eslFAIL; }
+  *ret_size  = (int64_t) st.st_size;
+  *ret_mtime = (int64_t) st.st_mtime;
+  return eslOK;
+}
+
+/* dbidx_read()
+ * Read the --dbidx index of target database <dbfile>, from file
+ * <dbfile>.cmdbi, into a new DBIDX, if it was saved for a file of
+ * format <format>, with <size> bytes and modification time <mtime>.
+ *
+ * Returns eslOK on success. Returns eslENOTFOUND, and <*ret_idx> is
+ * NULL, if there's no index, or it's out of date, truncated or
+ * corrupt; the caller should read the database to rebuild it.
+ * Returns eslEMEM if an allocation fails.
+ */
+static int
+dbidx_read(char *dbfile, int format, int64_t size, int64_t mtime, DBIDX **ret_idx)
+{
+  int       status;
+  FILE     *fp      = NULL;
+  char     *idxfile = NULL;
+  DBIDX    *idx     = NULL;
+  uint32_t  magic;
+  int       fmt;
+  int64_t   isize, imtime;
+  int64_t   nres;
+  int64_t   i;
+
+  ESL_ALLOC(idxfile, sizeof(char) * (strlen(dbfile) + 7));
+  sprintf(idxfile, "%s.cmdbi", dbfile);
+  if((fp = fopen(idxfile, "rb")) == NULL) { status = eslENOTFOUND; goto ERROR; }
+
+  ESL_ALLOC(idx, sizeof(DBIDX));
+  idx->L      = NULL;
+  idx->offset = NULL;
+  if(! fread((char *) &magic,        sizeof(uint32_t), 1, fp) || magic  != DBIDX_MAGIC ||
+     ! fread((char *) &fmt,          sizeof(int),      1, fp) || fmt    != format      ||
+     ! fread((char *) &isize,        sizeof(int64_t),  1, fp) || isize  != size        ||
+     ! fread((char *) &imtime,       sizeof(int64_t),  1, fp) || imtime != mtime       ||
+     ! fread((char *) &(idx->nseqs), sizeof(int64_t),  1, fp) || idx->nseqs < 0        ||
+     ! fread((char *) &(idx->nres),  sizeof(int64_t),  1, fp)) { 
+    status = eslENOTFOUND; goto ERROR;
+  }
+  ESL_ALLOC(idx->L,      sizeof(int64_t) * (idx->nseqs+1)); /* +1 so nseqs==0 is ok */
+  ESL_ALLOC(idx->offset, sizeof(int64_t) * (idx->nseqs+1));
+  if(fread((char *) idx->L,      sizeof(int64_t),  idx->nseqs, fp) != idx->nseqs ||
+     fread((char *) idx->offset, sizeof(int64_t),  idx->nseqs, fp) != idx->nseqs ||
+     ! fread((char *) &magic,    sizeof(uint32_t), 1,          fp) || magic != DBIDX_MAGIC) { 
+    status = eslENOTFOUND; goto ERROR;
+  }
+  for(nres = 0, i = 0; i < idx->nseqs; i++) nres += idx->L[i];
+  if(nres != idx->nres) { status = eslENOTFOUND; goto ERROR; }
+
+  fclose(fp);
+  free(idxfile);
+  *ret_idx = idx;
+  return eslOK;
+
+ ERROR:
+  if(fp      != NULL) fclose(fp);
+  if(idxfile != NULL) free(idxfile);
+  if(idx     != NULL) dbidx_destroy(idx);
+  *ret_idx = NULL;
+  return status;
+}
+
+/* dbidx_write()
+ * Save <idx>, the --dbidx index of target database <dbfile>, a file
+ * of format <format> with <size> bytes and modification time <mtime>,
+ * to file <dbfile>.cmdbi. As with checkpoints, we write to a
+ * temporary file (named for our process, in case another search of
+ * the same database is doing the same) and then rename it, so a
+ * partially written index is never read.
+ *
+ * Returns eslOK on success, eslFAIL if the index can't be written,
+ * eslEMEM if an allocation fails.
+ */
+static int
+dbidx_write(char *dbfile, int format, int64_t size, int64_t mtime, DBIDX *idx)
+{
+  int       status;
+  FILE     *fp      = NULL;
+  char     *idxfile = NULL;
+  char     *tmpfile = NULL;
+  uint32_t  magic   = DBIDX_MAGIC;
+
+  ESL_ALLOC(idxfile, sizeof(char) * (strlen(dbfile) + 7));
+  ESL_ALLOC(tmpfile, sizeof(char) * (strlen(dbfile) + 32));
+  sprintf(idxfile, "%s.cmdbi", dbfile);
+  sprintf(tmpfile, "%s.cmdbi.%ld.tmp", dbfile, (long) getpid());
+  if((fp = fopen(tmpfile, "wb")) == NULL) { status = eslFAIL; goto ERROR; }
+
+  if(fwrite((char *) &magic,        sizeof(uint32_t), 1,          fp) != 1          ||
+     fwrite((char *) &format,       sizeof(int),      1,          fp) != 1          ||
+     fwrite((char *) &size,         sizeof(int64_t),  1,          fp) != 1          ||
+     fwrite((char *) &mtime,        sizeof(int64_t),  1,          fp) != 1          ||
+     fwrite((char *) &(idx->nseqs), sizeof(int64_t),  1,          fp) != 1          ||
+     fwrite((char *) &(idx->nres),  sizeof(int64_t),  1,          fp) != 1          ||
+     fwrite((char *) idx->L,        sizeof(int64_t),  idx->nseqs, fp) != idx->nseqs ||
+     fwrite((char *) idx->offset,   sizeof(int64_t),  idx->nseqs, fp) != idx->nseqs ||
+     fwrite((char *) &magic,        sizeof(uint32_t), 1,          fp) != 1) { 
+    status = eslFAIL; goto ERROR;
+  }
+  status = fclose(fp);
+  fp = NULL;
+  if(status != 0)                   { status = eslFAIL; goto ERROR; }
+  if(rename(tmpfile, idxfile) != 0) { status = eslFAIL; goto ERROR; }
+
+  free(idxfile);
+  free(tmpfile);
+  return eslOK;
+
+ ERROR:
+  if(fp      != NULL) fclose(fp);
+  if(tmpfile != NULL) remove(tmpfile);
+  if(idxfile != NULL) free(idxfile);
+  if(tmpfile != NULL) free(tmpfile);
+  return status;
+}
+
+/* dbidx_destroy()
+ * Free a DBIDX.
+ */
+static void
+dbidx_destroy(DBIDX *idx)
+{
+  if(idx == NULL) return;
+  if(idx->L      != NULL) free(idx->L);
+  if(idx->offset != NULL) free(idx->offset);
+  free(idx);
+  return;
+}
+
+#ifdef HAVE_MPI
+/* mpi_failure()
+ * Generate an error message.  If the clients rank is not 0, a
+ * message is created with the error message and sent to the
+ * master process for handling.
+ */
+static void
+mpi_failure(char *format, ...)
+{
+  va_list  argp;
+  int      status = eslFAIL;
+  int      len;
+  int      rank;
+  char     str[512];
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  /* format the error mesg */
+  va_start(argp, format);
+  len = vsnprintf(str, sizeof(str), format, argp);
+  va_end(argp);
+
+  /* make sure the error string is terminated */
+  str[sizeof(str)-1] = '\0';
+
+  /* if the caller is the master, print the results and abort */
   if (rank == 0) { 
     fprintf(stderr, "\nError: ");
     fprintf(stderr, "%s", str);
@@ -2538,6 +4348,12 @@ mpi_open_dbfile_ssi(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE *dbfp, char *
  * Synopsis:  Determine size of the database using SSI index. Only used in MPI mode.
  * Incept:    EPN, Mon Jun  6 09:17:32 2011
  *
+ * Purpose:   With --dbidx, if the <seqdb>.cmdbi index is up to 
+ *            date and has as many sequences as the SSI index, 
+ *            the size is read from it instead of stepping through
+ *            every sequence in the SSI index. The master never 
+ *            writes the index, as that means reading the database.
+ *
  * Returns:   eslOK on success. cfg->Z is set.
  *            Upon error, error status is returned and errbuf is filled.
  *          
@@ -2548,18 +4364,28 @@ mpi_dbsize_using_ssi(ESL_GETOPTS *go, struct cfg_s *cfg, ESL_SQFILE *dbfp, char
   int status;
   int64_t L;    
   int i;
+  DBIDX  *idx = NULL;
+  int64_t dbsize, dbmtime;
 
   if(dbfp->data.ascii.ssi == NULL) ESL_FAIL(status, errbuf, "SSI index failed to open");
 
-  /* step through sequence SSI file to get database size */
-  cfg->Z = 0;
-  for(i = 0; i < dbfp->data.ascii.ssi->nprimary; i++) { 
-    status = esl_ssi_FindNumber(dbfp->data.ascii.ssi, i, NULL, NULL, NULL, &L, NULL);
-    if(status == eslENOTFOUND) ESL_FAIL(status, errbuf, "unable to find sequence %d in SSI index file, try re-indexing with esl-sfetch.", i);
-    if(status == eslEFORMAT)   ESL_FAIL(status, errbuf, "SSI index for database file is in incorrect format.");
-    if(status != eslOK)        ESL_FAIL(status, errbuf, "problem with SSI index for database file.");
-    cfg->Z += L;
+  if(esl_opt_GetBoolean(go, "--dbidx") && dbidx_stat(dbfp->filename, &dbsize, &dbmtime) == eslOK &&
+     dbidx_read(dbfp->filename, dbfp->format, dbsize, dbmtime, &idx) == eslOK && idx->nseqs == dbfp->data.ascii.ssi->nprimary) { 
+    cfg->Z = idx->nres;
+  }
+  else { 
+    if(idx != NULL) { dbidx_destroy(idx); idx = NULL; }
+    /* step through sequence SSI file to get database size */
+    cfg->Z = 0;
+    for(i = 0; i < dbfp->data.ascii.ssi->nprimary; i++) { 
+      status = esl_ssi_FindNumber(dbfp->data.ascii.ssi, i, NULL, NULL, NULL, &L, NULL);
+      if(status == eslENOTFOUND) ESL_FAIL(status, errbuf, "unable to find sequence %d in SSI index file, try re-indexing with esl-sfetch.", i);
+      if(status == eslEFORMAT)   ESL_FAIL(status, errbuf, "SSI index for database file is in incorrect format.");
+      if(status != eslOK)        ESL_FAIL(status, errbuf, "problem with SSI index for database file.");
+      cfg->Z += L;
+    }
   }
+  if(idx != NULL) dbidx_destroy(idx);
   if((! esl_opt_GetBoolean(go, "--toponly")) && 
      (! esl_opt_GetBoolean(go, "--bottomonly"))) { 
     cfg->Z *= 2; /* we're searching both strands */
@@ -2793,6 +4619,250 @@ mpi_inspect_next_sequence_using_ssi(ESL_SQFILE *dbfp, ESL_SQ *sq, int64_t nconte
   ESL_FAIL(status, errbuf, "out of memory");
 }
 
+/* Function:  mpi_split_block()
+ * Synopsis:  Split a MPI_BLOCK in two.
+ *
+ * Purpose:   Split <block> into two blocks: <block> keeps about its
+ *            first <headL> residues and a new block <*ret_tail>
+ *            gets the rest. Neither block will have fewer than
+ *            <minL> residues.
+ *
+ *            If <at_seq_ends> is TRUE, <block> is only split between
+ *            two sequences, at the boundary closest to residue
+ *            <headL>. Otherwise <block> is split after exactly
+ *            <headL> residues, and if that's within a sequence the
+ *            tail block starts <ncontext> residues earlier, so the
+ *            two blocks overlap as consecutive blocks created by
+ *            mpi_inspect_next_sequence_using_ssi() do. The number
+ *            of overlapping residues is returned in <*ret_noverlap>.
+ *
+ * Returns:   <eslOK> on success; <*ret_tail> is the new, complete
+ *            block, or NULL if <block> can't be split, in which
+ *            case <block> is unchanged.
+ *            If !eslOK, errbuf is filled and caller should exit
+ *            with mpi_failure(): <eslENOTFOUND> if a sequence is
+ *            not in the SSI index, <eslEFORMAT> if the SSI index is
+ *            in the wrong format, <eslEMEM> if out of memory.
+ */
+int
+mpi_split_block(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t headL, int64_t minL, int64_t ncontext, int at_seq_ends, 
+		char *errbuf, MPI_BLOCK **ret_tail, int64_t *ret_noverlap)
+{
+  int        status;
+  int64_t    idx;             /* SSI primary key number of current sequence */
+  int64_t    L;               /* length of current sequence */
+  int64_t    from, to;        /* first, final position of current sequence in <block> */
+  int64_t    prvL = 0;        /* number of residues in <block> before current sequence */
+  int64_t    cutL = -1;       /* number of residues <block> will keep */
+  int64_t    cut_idx = -1;    /* final sequence <block> will keep */
+  int64_t    cut_to  = 0;     /* final position of sequence <cut_idx> <block> will keep */
+  int64_t    cut_L   = 0;     /* length of sequence <cut_idx> */
+  int64_t    noverlap = 0;    /* number of residues in both <block> and the tail block */
+  MPI_BLOCK *tail = NULL;
+
+  if(dbfp->data.ascii.ssi == NULL) ESL_FAIL(eslFAIL, errbuf, "No SSI index available (it should've been opened earlier)");
+  if(! at_seq_ends && (headL < minL || block->blockL - headL < minL)) { *ret_tail = NULL; if(ret_noverlap != NULL) *ret_noverlap = 0; return eslOK; }
+
+  for(idx = block->first_idx; idx <= block->final_idx; idx++) { 
+    status = esl_ssi_FindNumber(dbfp->data.ascii.ssi, idx, NULL, NULL, NULL, &L, NULL);
+    if(status == eslENOTFOUND) ESL_FAIL(status, errbuf, "unable to find sequence %ld in SSI index file, try re-indexing with esl-sfetch.", idx);
+    if(status == eslEFORMAT)   ESL_FAIL(status, errbuf, "SSI index for database file is in incorrect format.");
+    if(status != eslOK)        ESL_FAIL(status, errbuf, "problem with SSI index for database file.");
+    from = (idx == block->first_idx) ? block->first_from : 1;
+    to   = (idx == block->final_idx) ? block->final_to   : L;
+
+    if(at_seq_ends) { 
+      /* consider the boundary after this sequence, it's the closest so far if residue <headL> is in a later sequence */
+      prvL += to - from + 1;
+      if(idx < block->final_idx && prvL >= minL && block->blockL - prvL >= minL && 
+	 (cut_idx == -1 || llabs(prvL - headL) < llabs(cutL - headL))) { 
+	cutL    = prvL;
+	cut_idx = idx;
+	cut_to  = to;
+	cut_L   = L;
+      }
+      if(prvL >= headL && cut_idx != -1) break; /* later boundaries are farther away */
+    }
+    else { 
+      if(prvL + (to - from + 1) >= headL) { /* residue <headL> is in this sequence */
+	cutL    = headL;
+	cut_idx = idx;
+	cut_to  = from + (headL - prvL) - 1;
+	cut_L   = L;
+	break;
+      }
+      prvL += to - from + 1;
+    }
+  }
+  if(cut_idx == -1) { *ret_tail = NULL; if(ret_noverlap != NULL) *ret_noverlap = 0; return eslOK; }
+
+  if((tail = create_mpi_block()) == NULL) ESL_FAIL(eslEMEM, errbuf, "out of memory");
+  if(cut_to == cut_L) { /* split between two sequences */
+    tail->first_idx  = cut_idx+1;
+    tail->first_from = 1;
+  }
+  else { /* split within a sequence, the tail overlaps the end of <block> */
+    noverlap         = ESL_MIN(ncontext, cut_to);
+    tail->first_idx  = cut_idx;
+    tail->first_from = cut_to - noverlap + 1;
+  }
+  tail->final_idx = block->final_idx;
+  tail->final_to  = block->final_to;
+  tail->blockL    = block->blockL - cutL + noverlap;
+  tail->complete  = TRUE;
+
+  block->final_idx = cut_idx;
+  block->final_to  = cut_to;
+  block->blockL    = cutL;
+
+  *ret_tail = tail;
+  if(ret_noverlap != NULL) *ret_noverlap = noverlap;
+  return eslOK;
+}
+
+/* Function:  mpi_worker_donate()
+ * Synopsis:  Give the end of a worker's block back to the master.
+ *
+ * Purpose:   Check if the master has asked this worker to donate
+ *            part of its current block <block> for an idle worker,
+ *            and if so, answer with mpi_worker_answer_split().
+ *
+ * Returns:   <eslOK> on success, whether or not a donation was
+ *            requested. If !eslOK, errbuf is filled and caller
+ *            should exit with mpi_failure().
+ */
+int
+mpi_worker_donate(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t pkey_idx, int64_t readL, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc)
+{
+  int         flag;
+  MPI_Status  mpistatus;
+
+  if (MPI_Test(&(wc->split_req), &flag, &mpistatus) != 0) ESL_FAIL(eslESYS, errbuf, "MPI error testing for split request");
+  if (! flag) return eslOK;
+
+  return mpi_worker_answer_split(dbfp, block, pkey_idx, readL, wc, errbuf, buf, nalloc);
+}
+
+/* Function:  mpi_worker_answer_split()
+ * Synopsis:  Answer the master's request to donate part of a block.
+ *
+ * Purpose:   The master has asked this worker to donate part of its
+ *            blocks to an idle worker; <wc->split_req> has completed.
+ *
+ *            If the master has sent us a block we haven't started
+ *            yet, return it whole with tag INFERNAL_RETURNED_TAG.
+ *            Otherwise, split the unsearched part of our current
+ *            block <block>, which starts with sequence <pkey_idx>
+ *            after <readL> residues have been searched, at the
+ *            sequence boundary closest to its middle, and send the
+ *            second half to the master with tag
+ *            INFERNAL_DONATED_TAG. <block> is updated to end where
+ *            the donated block begins. If <block> is NULL (we're
+ *            idle) or has only one unsearched sequence, an empty
+ *            block is sent instead.
+ *
+ *            The receive for the next request is posted before
+ *            returning.
+ *
+ * Returns:   <eslOK> on success. If !eslOK, errbuf is filled and
+ *            caller should exit with mpi_failure().
+ */
+int
+mpi_worker_answer_split(ESL_SQFILE *dbfp, MPI_BLOCK *block, int64_t pkey_idx, int64_t readL, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc)
+{
+  int         status;
+  int         nsent;
+  int         tag  = INFERNAL_DONATED_TAG;
+  int         pos;
+  MPI_Status  mpistatus;
+  MPI_BLOCK  *rest = NULL;   /* unsearched part of <block> */
+  MPI_BLOCK  *tail = NULL;   /* block we'll donate */
+
+  nsent = wc->split_nsent;
+  if (MPI_Irecv(&(wc->split_nsent), 1, MPI_INT, 0, INFERNAL_SPLIT_TAG, MPI_COMM_WORLD, &(wc->split_req)) != 0) ESL_FAIL(eslESYS, errbuf, "MPI error posting receive for split request");
+
+  if(block != NULL && nsent > wc->nrecv) { 
+    /* the master has sent us our next block, give all of it back */
+    if (MPI_Wait(&(wc->block_req), &mpistatus) != 0) ESL_FAIL(eslESYS, errbuf, "MPI error receiving sequence block");
+    pos = 0;
+    if((status = mpi_block_unpack(wc->block_buf, wc->block_n, &pos, MPI_COMM_WORLD, &tail)) != eslOK) ESL_FAIL(status, errbuf, "Failed to unpack sequence block, error status code: %d\n", status);
+    if (MPI_Irecv(wc->block_buf, wc->block_n, MPI_PACKED, 0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &(wc->block_req)) != 0) ESL_XFAIL(eslESYS, errbuf, "MPI error posting receive for sequence block");
+    wc->nrecv++;
+    tag = INFERNAL_RETURNED_TAG;
+  }
+  else if(block != NULL && pkey_idx <= block->final_idx) { 
+    if((rest = create_mpi_block()) == NULL) ESL_FAIL(eslEMEM, errbuf, "out of memory");
+    rest->first_idx  = pkey_idx;
+    rest->first_from = (pkey_idx == block->first_idx) ? block->first_from : 1;
+    rest->final_idx  = block->final_idx;
+    rest->final_to   = block->final_to;
+    rest->blockL     = block->blockL - readL;
+    rest->complete   = TRUE;
+    if((status = mpi_split_block(dbfp, rest, rest->blockL / 2, 1, 0, TRUE, errbuf, &tail, NULL)) != eslOK) goto ERROR;
+    if(tail != NULL) { 
+      block->final_idx = rest->final_idx;
+      block->final_to  = rest->final_to;
+      block->blockL    = readL + rest->blockL;
+    }
+    free(rest); rest = NULL;
+  }
+  if(tail == NULL && (tail = create_mpi_block()) == NULL) ESL_FAIL(eslEMEM, errbuf, "out of memory");
+
+  if((status = mpi_block_send(tail, 0, tag, MPI_COMM_WORLD, buf, nalloc)) != eslOK) ESL_XFAIL(status, errbuf, "Failed to send donated block, error status code: %d\n", status);
+  free(tail);
+
+  return eslOK;
+
+ ERROR:
+  if(rest != NULL) free(rest);
+  if(tail != NULL) free(tail);
+  return status;
+}
+
+/* Function:  mpi_worker_recv_block()
+ * Synopsis:  Wait for the master to send a worker its next block.
+ *
+ * Purpose:   Receive the next MPI_BLOCK from the master, which may
+ *            already have arrived while we were searching the
+ *            previous one, and post the receive for the block after
+ *            it. While we wait, reply to any request to donate part
+ *            of the previous block, which the master may have sent
+ *            before learning we'd finished it, so it isn't left
+ *            waiting.
+ *
+ * Returns:   <eslOK> on success, <*ret_block> is the new block.
+ *            If !eslOK, errbuf is filled and caller should exit
+ *            with mpi_failure().
+ */
+int
+mpi_worker_recv_block(ESL_SQFILE *dbfp, MPI_WORKER_COMM *wc, char *errbuf, char **buf, int *nalloc, MPI_BLOCK **ret_block)
+{
+  int         status;
+  int         pos;
+  int         which;
+  MPI_Request reqA[2];
+  MPI_Status  mpistatus;
+
+  while(TRUE) { 
+    reqA[0] = wc->block_req;
+    reqA[1] = wc->split_req;
+    if (MPI_Waitany(2, reqA, &which, &mpistatus) != 0) ESL_FAIL(eslESYS, errbuf, "MPI error waiting for sequence block");
+    wc->block_req = reqA[0];
+    wc->split_req = reqA[1];
+    if (which == 0) break;
+    if((status = mpi_worker_answer_split(dbfp, NULL, 0, 0, wc, errbuf, buf, nalloc)) != eslOK) return status;
+  }
+
+  pos = 0;
+  if((status = mpi_block_unpack(wc->block_buf, wc->block_n, &pos, MPI_COMM_WORLD, ret_block)) != eslOK) 
+    ESL_FAIL(status, errbuf, "Failed to unpack sequence block, error status code: %d\n", status);
+  if (MPI_Irecv(wc->block_buf, wc->block_n, MPI_PACKED, 0, INFERNAL_BLOCK_TAG, MPI_COMM_WORLD, &(wc->block_req)) != 0) 
+    ESL_FAIL(eslESYS, errbuf, "MPI error posting receive for sequence block");
+  if((*ret_block)->first_idx != -1) wc->nrecv++;
+
+  return eslOK;
+}
+
 MPI_BLOCK *
 create_mpi_block()
 { 
@@ -2867,6 +4937,33 @@ create_mpi_block_list()
   return NULL;
 }
 
+/* prepend_mpi_block()
+ * Add <block> to the front of <list>, so it's the next one
+ * handed out. Returns eslOK on success, eslEMEM if we can't
+ * grow <list>.
+ */
+int
+prepend_mpi_block(MPI_BLOCK_LIST *list, MPI_BLOCK *block)
+{ 
+  int status;
+  int i;
+
+  if(list->N == list->nalloc) { 
+    ESL_REALLOC(list->blocks, sizeof(MPI_BLOCK *) * (list->nalloc+100));
+    list->nalloc += 100;
+  }
+  for(i = list->N; i > 0; i--) { 
+    list->blocks[i] = list->blocks[i-1];
+  }
+  list->blocks[0] = block;
+  list->N++;
+
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
 void
 free_mpi_block_list(MPI_BLOCK_LIST *list)
 { 
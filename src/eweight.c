@@ -26,22 +26,171 @@
 
 #include "easel.h"
 #include "esl_rootfinder.h"
+#include "esl_stats.h"
 #include "esl_vectorops.h"
 
 #include "hmmer.h"
 
 #include "infernal.h"
 
+/* The relative entropy targeted by entropy weighting only depends on
+ * the match emissions (MATP_MP, MATL_ML and MATR_MR states), so
+ * instead of rescaling and priorifying the whole CM for each Neff
+ * the rootfinder tries, we collect the counts of those states into
+ * one batch per emission prior once, with the terms of each mixture
+ * component's posterior that don't depend on the counts, and only
+ * recompute the match emissions.
+ */
+struct ew_batch_s {
+  ESL_MIXDCHLET *pri;   /* prior for all states in the batch, NULL if emissions aren't priorified */
+  int            n;     /* number of states in the batch */
+  int            K;     /* size of each emission vector (K or K*K) */
+  int           *vA;    /* [0..n-1] CM state index of each state */
+  double        *c;     /* [0..n*K-1] original counts of each state */
+  double        *ctot;  /* [0..n-1] total original count of each state */
+  double        *sc;    /* [0..n*K-1] counts rescaled to the current Neff */
+  double        *atot;  /* [0..pri->N-1] sum of each component's alpha */
+  double        *lpq;   /* [0..pri->N-1] log pq + lgamma(atot) - \sum_x lgamma(alpha_x), -inf if pq == 0 */
+  double        *mix;   /* [0..n*pri->N-1] posterior P(q | c) of each component for each state */
+};
+
 struct ew_param_s {
-  CM_t      *cm;		/* ptr to the original count-based CM, cm->t and cm->e be changed, but we have a copy of the original data in t_orig and e_orig */
-  const Prior_t *pri;		/* Dirichlet prior used to parameterize from counts */
-  float           **t_orig;     /* copy of initial (when this object was created) CM transitions in counts form */
-  float           **e_orig;     /* copy of initial (when this object was created) CM emissions   in counts form */
-  float           *begin_orig;  /* copy of initial (when this object was created) CM begin transitions in counts form */
-  float           *end_orig;    /* copy of initial (when this object was created) CM end transitions in counts form */
-  double           etarget;	/* information content target, in bits */
+  CM_t              *cm;       /* ptr to the original count-based CM, match emissions in cm->e are changed, originals are in the batches */
+  struct ew_batch_s  bp;       /* MATP_MP states, consensus base pair prior */
+  struct ew_batch_s  bs;       /* MATL_ML and MATR_MR states, consensus singlet prior */
+  double             etarget;  /* information content target, in bits */
 };
 
+/* ew_batch_create()
+ * Collect the counts of states whose stid is <stid1> or <stid2> into
+ * batch <b>, and precompute the count-independent terms of prior <pri>.
+ */
+static int
+ew_batch_create(CM_t *cm, ESL_MIXDCHLET *pri, int K, int stid1, int stid2, struct ew_batch_s *b)
+{
+  int    status;
+  int    v, x, q, s;
+  int    n = 0;
+  double lg;
+
+  b->pri  = (cm->flags & CM_RSEARCHEMIT) ? NULL : pri; /* in rsearch emit mode, emissions are not priorified */
+  b->K    = K;
+  b->vA   = NULL;
+  b->c    = b->ctot = b->sc = NULL;
+  b->atot = b->lpq  = b->mix = NULL;
+
+  for (v = 0; v < cm->M; v++) if (cm->stid[v] == stid1 || cm->stid[v] == stid2) n++;
+  b->n = n;
+  ESL_ALLOC(b->vA,   sizeof(int)    * (n+1)); /* +1 so n==0 is ok */
+  ESL_ALLOC(b->c,    sizeof(double) * (n*K+1));
+  for (s = 0, v = 0; v < cm->M; v++) {
+    if (cm->stid[v] == stid1 || cm->stid[v] == stid2) {
+      b->vA[s] = v;
+      for (x = 0; x < K; x++) b->c[s*K+x] = (double) cm->e[v][x];
+      s++;
+    }
+  }
+
+  ESL_ALLOC(b->ctot, sizeof(double) * (n+1));
+  ESL_ALLOC(b->sc,   sizeof(double) * (n*K+1));
+  for (s = 0; s < n; s++) b->ctot[s] = esl_vec_DSum(b->c + s*K, K);
+
+  if (b->pri != NULL) {
+    ESL_ALLOC(b->atot, sizeof(double) * pri->N);
+    ESL_ALLOC(b->lpq,  sizeof(double) * pri->N);
+    ESL_ALLOC(b->mix,  sizeof(double) * (n*pri->N+1));
+    for (q = 0; q < pri->N; q++) {
+      b->atot[q] = esl_vec_DSum(pri->alpha[q], K);
+      if (pri->pq[q] > 0.) {
+	esl_stats_LogGamma(b->atot[q], &lg);
+	b->lpq[q] = log(pri->pq[q]) + lg;
+	for (x = 0; x < K; x++) { esl_stats_LogGamma(pri->alpha[q][x], &lg); b->lpq[q] -= lg; }
+      }
+      else b->lpq[q] = -eslINFINITY;
+    }
+  }
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* ew_batch_priorify()
+ * Set the emissions of all states in batch <b> to their mean posterior
+ * parameters given their counts rescaled by <scale>, as PriorifyCM()
+ * would. The lgamma(c+1) terms of the likelihood of the counts given
+ * each component are the same for all components and cancel when the
+ * posteriors are normalized, so we skip them.
+ */
+static void
+ew_batch_priorify(CM_t *cm, struct ew_batch_s *b, double scale)
+{
+  ESL_MIXDCHLET *pri = b->pri;
+  int     K = b->K;
+  int     s, q, x;
+  double *sc, *mix;
+  double  stot, lg, lp;
+  float  *e;
+
+  for (x = 0; x < b->n * K; x++) b->sc[x] = b->c[x] * scale;
+
+  if (pri == NULL) { 
+    for (s = 0; s < b->n; s++) 
+      for (e = cm->e[b->vA[s]], sc = b->sc + s*K, x = 0; x < K; x++) e[x] = (float) sc[x];
+    return;
+  }
+
+  /* posterior log probability of each component, for all states */
+  for (q = 0; q < pri->N; q++) {
+    for (s = 0; s < b->n; s++) {
+      if (b->lpq[q] == -eslINFINITY) { b->mix[s*pri->N+q] = -eslINFINITY; continue; }
+      sc = b->sc + s*K;
+      esl_stats_LogGamma(b->ctot[s] * scale + b->atot[q], &lg);
+      lp = b->lpq[q] - lg;
+      for (x = 0; x < K; x++) { esl_stats_LogGamma(sc[x] + pri->alpha[q][x], &lg); lp += lg; }
+      b->mix[s*pri->N+q] = lp;
+    }
+  }
+
+  /* mean posterior parameters */
+  for (s = 0; s < b->n; s++) {
+    sc   = b->sc  + s*K;
+    mix  = b->mix + s*pri->N;
+    stot = b->ctot[s] * scale;
+    e    = cm->e[b->vA[s]];
+    esl_vec_DLogNorm(mix, pri->N);
+    for (x = 0; x < K; x++) { 
+      lp = 0.;
+      for (q = 0; q < pri->N; q++) lp += mix[q] * (sc[x] + pri->alpha[q][x]) / (stot + b->atot[q]);
+      e[x] = (float) lp;
+    }
+    esl_vec_FNorm(e, K);
+  }
+}
+
+/* ew_batch_restore()
+ * Restore the original counts of the states in batch <b> to the CM,
+ * and free the batch.
+ */
+static void
+ew_batch_restore(CM_t *cm, struct ew_batch_s *b)
+{
+  int s, x;
+
+  if (b->vA != NULL && b->c != NULL) 
+    for (s = 0; s < b->n; s++)
+      for (x = 0; x < b->K; x++) cm->e[b->vA[s]][x] = (float) b->c[s*b->K+x];
+
+  if (b->vA   != NULL) free(b->vA);
+  if (b->c    != NULL) free(b->c);
+  if (b->ctot != NULL) free(b->ctot);
+  if (b->sc   != NULL) free(b->sc);
+  if (b->atot != NULL) free(b->atot);
+  if (b->lpq  != NULL) free(b->lpq);
+  if (b->mix  != NULL) free(b->mix);
+  b->vA = NULL;
+  b->c  = NULL;
+}
 
 /* Evaluate fx = cm rel entropy - etarget, which we want to be = 0,
  * for effective sequence number <Neff>.
@@ -50,18 +199,10 @@ static int
 cm_eweight_target_f(double Neff, void *params, double *ret_fx)
 {
   struct ew_param_s *p = (struct ew_param_s *) params;
-  int v, i;
   /*printf("cm_eweight_target_f() Neff:  %f\n", Neff); */
 
-  /* copy parameters from to p->*_orig to CM arrays */
-  for (v = 0; v < p->cm->M; v++) {
-    for (i = 0; i < MAXCONNECT; i++)                    p->cm->t[v][i] = p->t_orig[v][i];
-    for (i = 0; i < p->cm->abc->K * p->cm->abc->K; i++) p->cm->e[v][i] = p->e_orig[v][i];
-    p->cm->begin[v] = p->begin_orig[v];
-    p->cm->end[v]   = p->end_orig[v];
-  }
-  cm_Rescale(p->cm, Neff / (double) p->cm->nseq);
-  PriorifyCM(p->cm, p->pri);
+  ew_batch_priorify(p->cm, &(p->bp), Neff / (double) p->cm->nseq);
+  ew_batch_priorify(p->cm, &(p->bs), Neff / (double) p->cm->nseq);
   *ret_fx = cm_MeanMatchRelativeEntropy(p->cm) - p->etarget; /* only diff with hmm_eweight_target_f */
   return eslOK;
 }
@@ -77,18 +218,10 @@ static int
 hmm_eweight_target_f(double Neff, void *params, double *ret_fx)
 {
   struct ew_param_s *p = (struct ew_param_s *) params;
-  int v, i;
   /*printf("hmm_eweight_target_f() Neff: %f\n", Neff); */
 
-  /* copy parameters from CM to p->*_orig arrays */
-  for (v = 0; v < p->cm->M; v++) {
-    for (i = 0; i < MAXCONNECT; i++)                    p->cm->t[v][i] = p->t_orig[v][i];
-    for (i = 0; i < p->cm->abc->K * p->cm->abc->K; i++) p->cm->e[v][i] = p->e_orig[v][i];
-    p->cm->begin[v] = p->begin_orig[v];
-    p->cm->end[v]   = p->end_orig[v];
-  }
-  cm_Rescale(p->cm, Neff / (double) p->cm->nseq);
-  PriorifyCM(p->cm, p->pri);
+  ew_batch_priorify(p->cm, &(p->bp), Neff / (double) p->cm->nseq);
+  ew_batch_priorify(p->cm, &(p->bs), Neff / (double) p->cm->nseq);
   *ret_fx = cm_MeanMatchRelativeEntropyHMM(p->cm) - p->etarget; /* only diff with cm_eweight_target_f */
   return eslOK;
 }
@@ -115,6 +248,11 @@ hmm_eweight_target_f(double Neff, void *params, double *ret_fx)
  *            emissions are marginalized, treating pair emitting states
  *            effectively as a pair of singlet emitting states. 
  *            
+ *            Only the match emissions are rescaled and priorified
+ *            for each Neff tried, since the relative entropy 
+ *            doesn't depend on the other parameters. The result 
+ *            is the same as rescaling with cm_Rescale() and
+ *            priorifying with PriorifyCM().
  *
  * Returns:   <eslOK> on success. 
  *
@@ -129,33 +267,16 @@ cm_EntropyWeight(CM_t *cm, const Prior_t *pri, double etarget, double min_Neff,
   double Neff;
   double fx;
   double hmm_re;
-  int v, i;
 
-  /* Store parameters in the structure we'll pass to the rootfinder
+  /* Store parameters in the structure we'll pass to the rootfinder,
+   * the batches keep a copy of the match emission counts that will be 
+   * changed.
    */
-  p.cm = cm;
-  /* copy parameters of the CM that will be changed by cm_Rescale() */
-  ESL_ALLOC(p.t_orig,     (cm->M) * sizeof(float *));
-  ESL_ALLOC(p.e_orig,     (cm->M) * sizeof(float *));
-  ESL_ALLOC(p.begin_orig, (cm->M) * sizeof(float));
-  ESL_ALLOC(p.end_orig,   (cm->M) * sizeof(float));
-
-  p.t_orig[0]   = NULL;
-  p.e_orig[0]   = NULL;
-  ESL_ALLOC(p.t_orig[0], MAXCONNECT * cm->M * sizeof(float));
-  ESL_ALLOC(p.e_orig[0], cm->abc->K * cm->abc->K * cm->M * sizeof(float));
-  for (v = 0; v < cm->M; v++) {
-    p.t_orig[v]    = p.t_orig[0]    + v * MAXCONNECT;
-    p.e_orig[v]    = p.e_orig[0]    + v * (cm->abc->K * cm->abc->K);
-  }
-  for (v = 0; v < p.cm->M; v++) {
-    for (i = 0; i < MAXCONNECT; i++)              p.t_orig[v][i] = cm->t[v][i];
-    for (i = 0; i < cm->abc->K * cm->abc->K; i++) p.e_orig[v][i] = cm->e[v][i];
-    p.begin_orig[v] = cm->begin[v];
-    p.end_orig[v]   = cm->end[v];
-  }
-  p.pri = pri;
+  p.cm      = cm;
   p.etarget = etarget;
+  p.bp.vA   = p.bs.vA = NULL;
+  if ((status = ew_batch_create(cm, pri->mbp, cm->abc->K * cm->abc->K, MATP_MP, MATP_MP, &(p.bp))) != eslOK) goto ERROR;
+  if ((status = ew_batch_create(cm, pri->mnt, cm->abc->K,              MATL_ML, MATR_MR, &(p.bs))) != eslOK) goto ERROR;
 
   /* First, check if min_Neff gives a rel entropy >= e.target, if so
    * set Neff to min_Neff.  In this case its impossible to get a Neff
@@ -185,20 +306,9 @@ cm_EntropyWeight(CM_t *cm, const Prior_t *pri, double etarget, double min_Neff,
    */
   hmm_re = cm_MeanMatchRelativeEntropyHMM(p.cm);
 
-  /* reset CM params to their original values */
-  for (v = 0; v < cm->M; v++) {
-    for (i = 0; i < MAXCONNECT; i++)              cm->t[v][i] = p.t_orig[v][i];
-    for (i = 0; i < cm->abc->K * cm->abc->K; i++) cm->e[v][i] = p.e_orig[v][i];
-    cm->begin[v] = p.begin_orig[v];
-    cm->end[v]   = p.end_orig[v];
-  }
-  /* free params p */
-  free(p.t_orig[0]);
-  free(p.t_orig);
-  free(p.e_orig[0]);
-  free(p.e_orig);
-  free(p.begin_orig);
-  free(p.end_orig);
+  /* reset CM params to their original values and free the batches */
+  ew_batch_restore(cm, &(p.bp));
+  ew_batch_restore(cm, &(p.bs));
 
   *ret_hmm_re = hmm_re;
   *ret_Neff = Neff;
@@ -206,6 +316,8 @@ cm_EntropyWeight(CM_t *cm, const Prior_t *pri, double etarget, double min_Neff,
 
  ERROR:
   if (R    != NULL)   esl_rootfinder_Destroy(R);
+  if (p.bp.vA != NULL) ew_batch_restore(cm, &(p.bp));
+  if (p.bs.vA != NULL) ew_batch_restore(cm, &(p.bs));
   *ret_Neff = (double) cm->nseq;
   return status;
 }
@@ -1610,6 +1610,9 @@ typedef struct cm_qdbinfo_s {
 #define SMX_QDB2_LOOSE  2
 #define NSMX_QDB_IDX 3
 
+/* number of d cells per tile in the bifurcation kernels of cm_dpbif.c */
+#define CM_BIF_TILE 256
+
 typedef struct cm_scan_mx_s {
   /* general info about the model/search */
   CM_QDBINFO *qdbinfo;   /* a pointer to the qdbinfo related to the matrix */
@@ -2144,6 +2147,12 @@ typedef struct cm_pipeline_accounting_s {
   uint64_t      pos_past_fwdbias;  /* # positions that pass Fwd bias filter */
   uint64_t      pos_past_gfwdbias; /* # positions that pass gFwd bias filter*/
   uint64_t      pos_past_edefbias; /* # positions that pass dom def bias filter */
+  uint64_t      pos_lfilter;       /* # positions scored by local HMM MSV, Vit and Fwd filters */
+  uint64_t      pos_lfilter_redun; /* # of those already scored by same filter, same sequence */
+  uint64_t      pos_lfilter_reuse; /* # of those whose score was reused from an earlier pass */
+  uint64_t      pos_lcmask;        /* # positions masked as low complexity before SSV */
+  uint64_t      n_fwd_reuse;       /* # HMM only windows whose local Fwd filter parse was reused */
+  uint64_t      n_term_skip;       /* # windows not filtered, can't include pass's required terminal residue(s) */
   uint64_t      n_overflow_fcyk;   /* # hits that couldn't use an HMM banded mx in CYK filter stage */
   uint64_t      n_overflow_final;  /* # hits that couldn't use an HMM banded mx in final stage */
   uint64_t      n_aln_hb;          /* # HMM banded alignments computed */
@@ -2155,6 +2164,76 @@ typedef struct cm_pipeline_accounting_s {
  * 38. CM_PIPELINE: the accelerated seq/profile comparison pipeline 
  ***********************************************************************************/
 
+/* max number of profile variants (gm, Rgm, Lgm, Tgm) cm_p7_GForwardFused() scores at once */
+#define CM_P7_NFUSED 4
+
+/* CM_P7_GFB: workspace for the glocal Forward/Backward in
+ * cm_p7_gfwdback.c, which compute only the special state rows of a
+ * P7_GMX, in probability space with rescaled rows. Holds
+ * probabilities converted from the scores of the profile <gm> it was
+ * last prepared for with cm_p7_gfb_SetProfile().
+ */
+typedef struct cm_p7_gfb_s {
+  const P7_PROFILE *gm;           /* profile we're prepared for, NULL if none        */
+  int      M;                     /* gm->M                                           */
+  int      allocM;                /* max M we can hold without reallocation          */
+  int      Kp;                    /* alphabet size of msc, isc, rset                 */
+  double  *tsc;                   /* transition probs, memory for tp[]               */
+  double  *tp[p7P_NTRANS];        /* tp[p7P_MM][0..M] etc., contiguous per type      */
+  double **msc;                   /* [0..Kp-1][0..M] match emission odds ratios      */
+  double **isc;                   /* [0..Kp-1][0..M] insert emission odds ratios     */
+  int     *rset;                  /* [0..Kp-1] TRUE if msc[x], isc[x] are set for gm */
+  double  *row;                   /* eight DP rows of M+2 doubles                    */
+  double  *frow;                  /* six rows of (M+2)*CM_P7_NFUSED, for fused Fwd   */
+  double  *fbm;                   /* begin probs for fused Fwd, (M+1)*CM_P7_NFUSED   */
+} CM_P7_GFB;
+
+/* CM_P7_WCACHE: the local HMM filter results of pli_p7_filter() for
+ * the sequence cm_Pipeline() is searching, shared by its passes,
+ * which often filter the same windows of the same residues (e.g. the
+ * forced truncated passes search a sequence no longer than
+ * pli->maxW in full). Window coordinates are relative to <dsq>, the
+ * residues passed to cm_Pipeline(), so they're the same in every
+ * pass. Also tracks which residues each filter stage has scored, for
+ * the redundant residue counts in the pipeline accounting.
+ */
+#define CM_P7_WC_MSV  (1<<0)   /* mfsc is set     */
+#define CM_P7_WC_BIAS (1<<1)   /* filtersc is set */
+#define CM_P7_WC_VIT  (1<<2)   /* vfsc is set     */
+#define CM_P7_WC_FWD  (1<<3)   /* fwdsc is set    */
+
+typedef struct cm_p7_wcwin_s {
+  int64_t  ws, we;                /* window start, end                           */
+  int      flags;                 /* CM_P7_WC_* flags, which scores are set      */
+  float    mfsc;                  /* MSV score, nats                             */
+  float    filtersc;              /* bias filter null score, nats                */
+  float    vfsc;                  /* Viterbi filter score, nats                  */
+  float    fwdsc;                 /* Forward filter score, nats                  */
+} CM_P7_WCWIN;
+
+typedef struct cm_p7_wcache_s {
+  const ESL_DSQ *dsq;             /* residues the cache is valid for, NULL if none    */
+  int64_t        L;               /* length of dsq                                    */
+
+  /* SSV: windows found (and split) in the last subsequence filtered */
+  int64_t        ssv_i, ssv_j;    /* subsequence ssv_ws, ssv_we are for, -1 if none   */
+  double         ssv_F1;          /* SSV P-value threshold ssv_ws, ssv_we are for     */
+  int64_t       *ssv_ws;          /* [0..ssv_nwin-1] window start positions           */
+  int64_t       *ssv_we;          /* [0..ssv_nwin-1] window end positions             */
+  int            ssv_nwin;        /* number of SSV windows                            */
+  int            ssv_nalloc;      /* number of windows allocated for ssv_ws, ssv_we   */
+
+  /* MSV, bias, Viterbi, Forward: scores of each window filtered, in pass order */
+  CM_P7_WCWIN   *win;             /* [0..nwin-1] windows                              */
+  int            nwin;            /* number of windows                                */
+  int            nalloc;          /* number of windows allocated                      */
+  int            pstart[NPLI_PASSES]; /* pass p's windows are win[pstart[p]..], sorted  */
+  int            pn[NPLI_PASSES];     /* number of windows for pass p                   */
+
+  uint8_t       *scored;          /* [1..L] CM_P7_WC_* flags of stages that scored x */
+  int64_t        scored_alloc;    /* number of bytes allocated for scored             */
+} CM_P7_WCACHE;
+
 enum cm_pipemodes_e     { CM_SEARCH_SEQS = 0, CM_SCAN_MODELS = 1 };
 enum cm_newmodelmodes_e { CM_NEWMODEL_MSV = 0, CM_NEWMODEL_CM = 1 };
 enum cm_zsetby_e        { CM_ZSETBY_SSIINFO = 0, CM_ZSETBY_SSI_AND_QLENGTH = 1, CM_ZSETBY_FILEREAD = 2, CM_ZSETBY_OPTION = 3, CM_ZSETBY_FILEINFO = 4};
@@ -2169,6 +2248,49 @@ typedef struct cm_pipeline_s {
   P7_GMX       *gxb;		/* generic Backward matrix                  */
   P7_GMX       *gfwd;		/* generic full Fwd matrix for envelopes    */
   P7_GMX       *gbck;		/* generic full Bck matrix for envelopes    */
+  CM_P7_GFB    *gfb;		/* workspace for glocal gxf, gxb Fwd/Bck    */
+
+  /* Glocal Forward (F4) results for the truncated passes' profiles,
+   * computed with gm's in the PLI_PASS_STD_ANY pass by
+   * cm_p7_GForwardFused() when a later pass will search the same
+   * windows of the same sequence (see cm_Pipeline()).
+   */
+  const ESL_DSQ *f4c_dsq;                 /* sequence the cache is valid for, NULL if none */
+  int64_t        f4c_n;                   /* length of f4c_dsq                             */
+  int            f4c_do[NPLI_PASSES];     /* TRUE to cache F4 results for pass p           */
+  int64_t        f4c_ws[NPLI_PASSES];     /* start of window cached for pass p, -1 if none */
+  int64_t        f4c_we[NPLI_PASSES];     /* end of window cached for pass p               */
+  float          f4c_sc[NPLI_PASSES];     /* cached Forward score for pass p, nats         */
+  float         *f4c_xmx[NPLI_PASSES];    /* cached special state rows for pass p          */
+  int64_t        f4c_nalloc[NPLI_PASSES]; /* number of floats allocated for f4c_xmx[p]     */
+
+  /* Views of the sequence being searched: ESL_SQs whose dsq points
+   * into the caller's residues instead of owning a copy, created on
+   * first use and re-pointed with pli_sqview_Set() (see cm_pipeline.c).
+   */
+  ESL_SQ        *term_sqv;                /* 5' or 3' terminal pli->maxW residues  */
+  ESL_SQ        *win_sqv;                 /* a window, HMM envelope definition     */
+  ESL_SQ        *hit_sqv;                 /* a hit, alignment                      */
+  int64_t        nsqalloc;                /* number of ESL_SQs created by pipeline */
+
+  /* local HMM filter results shared by passes, see pli_p7_filter() */
+  CM_P7_WCACHE   wc;
+
+  /* lengths the filter HMM was last configured for, see pli_oprofile_ReconfigLength() */
+  P7_OPROFILE   *ocfg_om;                 /* profile ocfg_msvL, ocfg_restL are for, NULL if none */
+  int            ocfg_msvL;               /* length of om's MSV filter parameters, -1 if unknown */
+  int            ocfg_restL;              /* length of om's Vit, Fwd parameters, -1 if unknown   */
+  int64_t        nocfg;                   /* number of length reconfigurations done              */
+  int64_t        nocfg_skip;              /* number skipped because the length was unchanged     */
+
+  /* Forward parses of windows surviving the HMM only pass filters, see pli_fparse_Next() */
+  P7_OMX       **fpA;                     /* [0..fp_nalloc-1] Forward parser matrices            */
+  int64_t       *fp_ws;                   /* [0..fp_n-1] start of window parsed in fpA[x]        */
+  int64_t       *fp_we;                   /* [0..fp_n-1] end   of window parsed in fpA[x]        */
+  float         *fp_mb;                   /* [0..fp_nalloc-1] size of fpA[x] in Mb, 0 if NULL     */
+  float          fp_mb_tot;               /* total size of matrices in fpA in Mb                 */
+  int            fp_n;                    /* number of parses kept for the current sequence      */
+  int            fp_nalloc;               /* number of matrices allocated in fpA                 */
 
   enum cm_pipemodes_e mode;    	/* CM_SCAN_MODELS | CM_SEARCH_SEQS           */
   ESL_ALPHABET *abc;            /* ptr to alphabet info */
@@ -2210,6 +2332,7 @@ typedef struct cm_pipeline_s {
   int           do_wcx;         /* TRUE to set cm->W as cm->clen * wcx      */
   float         wcx;            /* set W as cm->clen * wcx, ignoring W from CM file */
   int           do_one_cmpass;  /* TRUE to only use CM for best scoring HMM pass if envelope encompasses full sequence */
+  int           do_shortpass;   /* TRUE to search seqs with both termini and <= cmW residues in one truncated pass */
   /* these are all currently hard-coded, in cm_pipeline_Create() */
   float         smult;          /* 2.0;  W multiplier for window splitting */
   float         wmult;          /* 1.0;  maxW will be max of wmult * cm->W and cmult * cm->clen */
@@ -2276,6 +2399,16 @@ typedef struct cm_pipeline_s {
   int     do_gfwdbias;     	/* TRUE to use biased comp HMM filter w/gFwd*/
   int     do_edefbias;     	/* TRUE to use biased comp HMM filter w/edef*/
 
+  /* low complexity masking prior to SSV, see pli_lcmask() */
+  int      do_lcmask;           /* TRUE to mask low complexity regions      */
+  float    lcmask;              /* mask windows w/composition score > this, bits */
+  int      lcw;                 /* length of windows scored for masking     */
+  float   *lcl;                 /* [0..c..lcw] c * log_2 c, precomputed     */
+  int64_t *lc_ss;               /* [0..lc_nseg-1] start of unmasked segment */
+  int64_t *lc_se;               /* [0..lc_nseg-1] end of unmasked segment   */
+  int      lc_nseg;             /* number of unmasked segments              */
+  int      lc_nalloc;           /* number of segments allocated             */
+
   /* truncated sequence detection parameters */
   int     do_trunc_ends;                /* TRUE to use truncated CM algs at sequence ends */
   int     do_trunc_any;                 /* TRUE to use truncated CM algs for entire sequences */
@@ -2322,6 +2455,7 @@ typedef struct cm_pipeline_s {
   /* configure/alignment options for all CMs we'll use in the pipeline */
   int     cm_config_opts;
   int     cm_align_opts;
+  int     do_defer_ali;           /* TRUE to skip alignment in final stage, caller aligns hits later w/cm_pli_AlignHit() */
 
 } CM_PIPELINE;
 
@@ -2475,6 +2609,11 @@ typedef struct cm_tophits_s {
 					   */
 } CM_TOPHITS;
 
+/* Binary hit list format, cm_tophits_Serialize(), cm_tophits_WriteBinary() */
+#define CM_TOPHITS_BIN_VERSION   1
+#define CM_TOPHITS_BIN_DEFAULT   0
+#define CM_TOPHITS_BIN_COMPRESS  (1<<0)  /* compress alignment display strings */
+
 
 /***********************************************************************************
  * 42. CM_P7_OM_BLOCK: block of P7_OPROFILEs and related info, for cmscan.
@@ -2702,6 +2841,17 @@ extern int  cm_TrPostCode           (CM_t *cm, char *errbuf,               int L
 extern int  cm_TrPostCodeHB         (CM_t *cm, char *errbuf,               int L, CM_TR_HB_EMIT_MX *emit_mx, Parsetree_t *tr, char **ret_ppstr, float *ret_avgp);
 extern int  cm_TrFillFromMode       (char mode, int *ret_fill_L, int *ret_fill_R, int *ret_fill_T);
 
+/* from cm_dpbif.c */
+extern void cm_bif_FMaxPlusRow      (float *dst, const float *src, float addsc, int n);
+extern void cm_bif_FMaxPlusRowShadow(float *dst, int *kshadow, const float *src, float addsc, int k, int n);
+extern void cm_bif_FLogsumPlusRow   (float *dst, const float *src, float addsc, int n);
+extern void cm_bif_ILogsumPlusRow   (int *dst, const int *src, int addsc, int n);
+extern void cm_bif_ScanMaxPlus      (float *vrow, float ***alpha_begl, const int *jp_wA, int w, const float *yrow, int dn, int dx, int kn, int kx, int dn_w, int dx_w);
+extern void cm_bif_ScanFLogsumPlus  (float *vrow, float ***alpha_begl, const int *jp_wA, int w, const float *yrow, int dn, int dx, int kn, int kx, int dn_w, int dx_w);
+extern void cm_bif_ScanILogsumPlus  (int   *vrow, int   ***alpha_begl, const int *jp_wA, int w, const int   *yrow, int dn, int dx, int kn, int kx, int dn_w, int dx_w);
+extern void cm_bif_HBMaxPlus        (CP9Bands_t *cp9b, int v, int y, int z, float **vdeck, int **kshadow, float **ydeck, float **zdeck, int do_skip_end_k);
+extern void cm_bif_HBLogsumPlus     (CP9Bands_t *cp9b, int v, int y, int z, float **vdeck, float **ydeck, float **zdeck, int do_skip_end_k);
+
 /* from cm_dpsearch.c */
 extern int  FastCYKScan      (CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *dsq, int64_t i0, int64_t j0, float cutoff, CM_TOPHITS *hitlist, int do_null3, float env_cutoff, int64_t *ret_envi, int64_t *ret_envj, float **ret_vsc, float *ret_sc);
 extern int  RefCYKScan       (CM_t *cm, char *errbuf, CM_SCAN_MX *smx, int qdbidx, ESL_DSQ *dsq, int64_t i0, int64_t j0, float cutoff, CM_TOPHITS *hitlist, int do_null3, float env_cutoff, int64_t *ret_envi, int64_t *ret_envj, float **ret_vsc, float *ret_sc);
@@ -2952,10 +3102,13 @@ extern int   cm_pli_NewSeq            (CM_PIPELINE *pli, const ESL_SQ *sq, int64
 extern int   cm_Pipeline              (CM_PIPELINE *pli, off_t cm_offset, P7_OPROFILE *om, P7_BG *bg, float *p7_evparam, P7_SCOREDATA *msvdata, ESL_SQ *sq, CM_TOPHITS *hitlist, int in_rc, P7_HMM **opt_hmm, P7_PROFILE **opt_gm, P7_PROFILE **opt_Rgm, P7_PROFILE **opt_Lgm, P7_PROFILE **opt_Tgm, CM_t **opt_cm);
 extern int   cm_pli_Statistics    (FILE *ofp, CM_PIPELINE *pli, ESL_STOPWATCH *w);
 extern int   cm_pli_ZeroAccounting(CM_PLI_ACCT *pli_acct);
+extern int   cm_pli_WriteAccounting(FILE *fp, CM_PIPELINE *pli);
+extern int   cm_pli_ReadAccounting(FILE *fp, CM_PIPELINE *pli);
 extern int   cm_pli_PassEnforcesFirstRes(int pass_idx);
 extern int   cm_pli_PassEnforcesFinalRes(int pass_idx);
 extern int   cm_pli_PassAllowsTruncation(int pass_idx);
 extern void  cm_pli_AdjustNresForOverlaps(CM_PIPELINE *pli, int64_t noverlap, int in_rc);
+extern int   cm_pli_AlignHit(CM_PIPELINE *pli, CM_t *cm, const ESL_SQ *sq, CM_HIT *hit);
 
 /* from cm_qdband.c */
 extern void     BandExperiment(CM_t *cm);
@@ -3018,8 +3171,14 @@ extern void        cm_tophits_Destroy(CM_TOPHITS *h);
 extern int         cm_tophits_CloneHitMostly(CM_TOPHITS *src_th, int h, CM_TOPHITS *dest_th);
 extern int         cm_tophits_ComputeEvalues(CM_TOPHITS *th, double eZ, int istart);
 extern int         cm_tophits_RemoveOrMarkOverlaps(CM_TOPHITS *th, int do_clans_only, char *errbuf);
+extern int         cm_tophits_RemoveOrMarkOverlapsParallel(CM_TOPHITS *th, int do_clans_only, int ncpus, char *errbuf);
+extern int         cm_tophits_RemoveResolvedDuplicates(CM_TOPHITS *th, int64_t hit_start, int64_t res_from, int64_t res_to, int64_t *ret_nremoved, char *errbuf);
 extern int         cm_tophits_UpdateHitPositions(CM_TOPHITS *th, int hit_start, int64_t seq_start, int in_revcomp);
 extern int         cm_tophits_SetSourceLengths(CM_TOPHITS *th, int64_t *srcL, uint64_t nseqs);
+extern int         cm_tophits_Serialize(CM_TOPHITS *th, uint32_t flags, char **buf, int *nalloc, int *ret_n);
+extern int         cm_tophits_Deserialize(char *buf, int n, CM_TOPHITS *th, char *errbuf);
+extern int         cm_tophits_WriteBinary(FILE *fp, CM_TOPHITS *th, uint32_t flags);
+extern int         cm_tophits_ReadBinary(FILE *fp, CM_TOPHITS *th, char *errbuf);
 
 extern int cm_tophits_Threshold(CM_TOPHITS *th, CM_PIPELINE *pli);
 extern int cm_tophits_Targets(FILE *ofp, CM_TOPHITS *th, CM_PIPELINE *pli, int textw);
@@ -3071,6 +3230,15 @@ extern int          P7BandsAdjustForSubCM(int *kmin, int *kmax, int L, int spos,
 extern int p7_domaindef_GlocalByPosteriorHeuristics(const ESL_SQ *sq, P7_PROFILE *gm, P7_GMX *gxf, P7_GMX *gxb,
 						    P7_GMX *fwd, P7_GMX *bck, P7_DOMAINDEF *ddef, int do_null2);
 
+/* from cm_p7_gfwdback.c */
+extern CM_P7_GFB *cm_p7_gfb_Create(int allocM);
+extern int        cm_p7_gfb_GrowTo(CM_P7_GFB *gfb, int M);
+extern int        cm_p7_gfb_SetProfile(CM_P7_GFB *gfb, const P7_PROFILE *gm);
+extern void       cm_p7_gfb_Destroy(CM_P7_GFB *gfb);
+extern int        cm_p7_GForward (const ESL_DSQ *dsq, int L, const P7_PROFILE *gm, CM_P7_GFB *gfb, P7_GMX *gx, float *opt_sc);
+extern int        cm_p7_GBackward(const ESL_DSQ *dsq, int L, const P7_PROFILE *gm, CM_P7_GFB *gfb, P7_GMX *gx, float *opt_sc);
+extern int        cm_p7_GForwardFused(const ESL_DSQ *dsq, int L, const P7_PROFILE **gmA, int ngm, CM_P7_GFB *gfb, float **xmxA, float *scA);
+
 /* from cm_p7_modelconfig_trunc.c */
 extern int p7_ProfileConfig5PrimeTrunc(P7_PROFILE *gm, int L);
 extern int p7_ProfileConfig3PrimeTrunc(const P7_HMM *hmm, P7_PROFILE *gm, int L);
@@ -3082,6 +3250,7 @@ extern int p7_ReconfigLength3PrimeTrunc(P7_PROFILE *gm, int L);
 extern int          BuildP7HMM_MatchEmitsOnly(CM_t *cm, CP9_t *cp9, P7_HMM **ret_p7);
 extern int          cm_cp9_to_p7(CM_t *cm, CP9_t *cp9, char *errbuf);
 extern int          cm_p7_Calibrate(P7_HMM *hmm, char *errbuf, int ElmL, int ElvL, int ElfL, int EgfL, int ElmN, int ElvN, int ElfN, int EgfN, double ElfT, double EgfT, double *ret_gfmu, double *ret_gflambda);
+extern int          cm_p7_CalibrateParallel(P7_HMM *hmm, char *errbuf, int ElmL, int ElvL, int ElfL, int EgfL, int ElmN, int ElvN, int ElfN, int EgfN, double ElfT, double EgfT, int ncpus, double *ret_gfmu, double *ret_gflambda);
 extern int          cm_p7_Tau(ESL_RANDOMNESS *r, char *errbuf, P7_OPROFILE *om, P7_PROFILE *gm, P7_BG *bg, int L, int N, double lambda, double tailp, double *ret_tau);
 extern int          cm_SetFilterHMM(CM_t *cm, P7_HMM *hmm, double gfmu, double gflambda);
 extern int          dump_p7(P7_HMM *hmm, FILE *fp);
@@ -3251,6 +3420,8 @@ extern int cm_pipeline_MPISend(CM_PIPELINE *pli, int dest, int tag, MPI_Comm com
 extern int cm_pipeline_MPIRecv(int source, int tag, MPI_Comm comm, char **buf, int *nalloc, ESL_GETOPTS *go, CM_PIPELINE **ret_pli);
 extern int cm_tophits_MPISend(CM_TOPHITS *th, int dest, int tag, MPI_Comm comm, char **buf, int *nalloc);
 extern int cm_tophits_MPIRecv(int source, int tag, MPI_Comm comm, char **buf, int *nalloc, CM_TOPHITS **ret_th);
+extern int cm_tophits_MPIStreamSend(CM_TOPHITS *th, int dest, int tag, MPI_Comm comm, char **buf, int *nalloc, MPI_Request *req);
+extern int cm_tophits_MPIStreamRecv(int source, int tag, MPI_Comm comm, char **buf, int *nalloc, CM_TOPHITS *th);
 extern int cm_alndata_MPISend(CM_ALNDATA *data, int include_sq, char *errbuf, int dest, int tag, MPI_Comm comm, char **buf, int *nalloc);
 extern int cm_alndata_MPIUnpack(char *buf, int n, int *pos, MPI_Comm comm, ESL_ALPHABET *abc, CM_ALNDATA **ret_data);
 #endif
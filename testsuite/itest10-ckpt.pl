@@ -0,0 +1,140 @@
+#! /usr/bin/perl
+
+# Test that cmsearch and cmcalibrate runs that are killed after
+# saving a checkpoint (--ckpt) and then resumed (--resume) give the
+# same results as uninterrupted runs.
+#
+# Usage:   ./itest10-ckpt.pl <builddir> <srcdir> <tmpfile prefix>
+# Example: ./itest10-ckpt.pl ..         ..       tmpfoo
+
+BEGIN {
+    $builddir  = shift;
+    $srcdir    = shift;
+    $tmppfx    = shift;
+}
+use lib "$srcdir/testsuite";  # The BEGIN is necessary to make this work: sets $srcdir at compile-time
+use i1;
+use POSIX ":sys_wait_h";
+use Time::HiRes qw(usleep);
+
+$verbose = 0;
+
+# The test makes use of the following files:
+#
+# 4.c.cm       <cm>       4 calibrated models: tRNA, Vault, snR75, Plant_SRP
+# tRNA.c.cm    <cm>       calibrated tRNA model
+# Vault.c.cm   <cm>       calibrated Vault model
+# 10k-4.fa     <seqfile>  40 10 Kb sequences with embedded hits to the 4 models
+#
+# It creates the following files:
+# $tmppfx.cm               <cm>       copy of 4.c.cm
+# $tmppfx.fa               <seqfile>  copy of 10k-4.fa
+# $tmppfx.{out,tbl}{1,2}   <output>   cmsearch output of uninterrupted (1) and resumed (2) searches
+# $tmppfx.ccm{1,2}         <cm>       tRNA and Vault models, calibrated without (1) and with (2) an interruption
+# $tmppfx.ckpt             <ckpt>     checkpoint file
+
+@i1progs  =  ("cmsearch", "cmcalibrate");
+foreach $i1prog  (@i1progs)  { if (! -x "$builddir/src/$i1prog") { die "FAIL: didn't find $i1prog executable in $builddir/src\n"; } }
+foreach $file ("4.c.cm", "tRNA.c.cm", "Vault.c.cm", "10k-4.fa") { if (! -r "$srcdir/testsuite/$file") { die "FAIL: can't read $file in $srcdir/testsuite\n"; } }
+
+`cat $srcdir/testsuite/4.c.cm   > $tmppfx.cm`;  if ($?) { die "FAIL: cat\n"; }
+`cat $srcdir/testsuite/10k-4.fa > $tmppfx.fa`;  if ($?) { die "FAIL: cat\n"; }
+`cat $srcdir/testsuite/tRNA.c.cm $srcdir/testsuite/Vault.c.cm > $tmppfx.ccm1`;  if ($?) { die "FAIL: cat\n"; }
+`cat $srcdir/testsuite/tRNA.c.cm $srcdir/testsuite/Vault.c.cm > $tmppfx.ccm2`;  if ($?) { die "FAIL: cat\n"; }
+
+######################
+# cmsearch
+######################
+# uninterrupted search
+$output = `$builddir/src/cmsearch -o $tmppfx.out1 --tblout $tmppfx.tbl1 $tmppfx.cm $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: cmsearch failed\n"; }
+
+# search with a checkpoint after about every 2 sequences, killed after the first one
+&run_and_interrupt("$tmppfx.ckpt", 0, "$builddir/src/cmsearch", "--ckpt", "$tmppfx.ckpt", "--ckptmb", "0.02", "-o", "$tmppfx.out2", "--tblout", "$tmppfx.tbl2", "$tmppfx.cm", "$tmppfx.fa");
+$output = `$builddir/src/cmsearch --ckpt $tmppfx.ckpt --ckptmb 0.02 --resume -o $tmppfx.out2 --tblout $tmppfx.tbl2 $tmppfx.cm $tmppfx.fa 2>&1`;
+if ($? != 0)           { die "FAIL: cmsearch --resume failed\n"; }
+if (-e "$tmppfx.ckpt") { die "FAIL: cmsearch --resume didn't remove the checkpoint file\n"; }
+
+# '#' lines hold the command line, options and timings, which differ
+&compare_files("$tmppfx.tbl1", "$tmppfx.tbl2", '^#',       "cmsearch tabular output");
+&compare_files("$tmppfx.out1", "$tmppfx.out2", '^#',       "cmsearch output");
+
+######################
+# cmcalibrate
+######################
+# uninterrupted calibration
+$output = `$builddir/src/cmcalibrate -L 0.1 $tmppfx.ccm1 2>&1`;
+if ($? != 0) { die "FAIL: cmcalibrate failed\n"; }
+
+# calibration killed once at least one model/mode has been saved
+# (the checkpoint header is 16 bytes)
+&run_and_interrupt("$tmppfx.ckpt", 16, "$builddir/src/cmcalibrate", "-L", "0.1", "--ckpt", "$tmppfx.ckpt", "$tmppfx.ccm2");
+$output = `$builddir/src/cmcalibrate -L 0.1 --ckpt $tmppfx.ckpt --resume $tmppfx.ccm2 2>&1`;
+if ($? != 0)           { die "FAIL: cmcalibrate --resume failed\n"; }
+if (-e "$tmppfx.ckpt") { die "FAIL: cmcalibrate --resume didn't remove the checkpoint file\n"; }
+
+# DATE and COM lines record when and with which command the models were calibrated
+&compare_files("$tmppfx.ccm1", "$tmppfx.ccm2", '^(DATE|COM)', "cmcalibrate CM file");
+
+print "ok\n";
+unlink "$tmppfx.cm";
+unlink "$tmppfx.fa";
+unlink "$tmppfx.out1";
+unlink "$tmppfx.out2";
+unlink "$tmppfx.tbl1";
+unlink "$tmppfx.tbl2";
+unlink "$tmppfx.ccm1";
+unlink "$tmppfx.ccm2";
+unlink "$tmppfx.ckpt";
+unlink "$tmppfx.ckpt.tmp";
+exit 0;
+
+# run_and_interrupt(): run a program with its arguments, and kill
+# it as soon as checkpoint file <ckptfile> is larger than <minsize>
+# bytes. Fail if the program finishes before we can kill it.
+sub run_and_interrupt {
+    my ($ckptfile, $minsize, $prog, @args) = @_;
+    my ($pid, $size);
+
+    unlink $ckptfile;
+    $pid = fork();
+    if (! defined $pid) { die "FAIL: fork failed\n"; }
+    if ($pid == 0) {
+	open(STDOUT, ">/dev/null");
+	open(STDERR, ">/dev/null");
+	exec { $prog } $prog, @args;
+	exit 1;
+    }
+    while (1) {
+	$size = (-e $ckptfile) ? (-s $ckptfile) : -1;
+	if ($size > $minsize) {
+	    kill 'KILL', $pid;
+	    waitpid($pid, 0);
+	    last;
+	}
+	if (waitpid($pid, WNOHANG) == $pid) { die "FAIL: $prog finished before it was interrupted\n"; }
+	usleep(10000);
+    }
+    if ($verbose) { printf("killed $prog after checkpoint of %d bytes\n", $size); }
+    1;
+}
+
+# compare_files(): compare two files, ignoring lines that match
+# <skip>, and fail if they differ.
+sub compare_files {
+    my ($file1, $file2, $skip, $desc) = @_;
+    my (@lines1, @lines2, $i);
+
+    open(FILE1, $file1) || die "FAIL: couldn't open $file1\n";
+    @lines1 = grep { ! /$skip/ } <FILE1>;
+    close(FILE1);
+    open(FILE2, $file2) || die "FAIL: couldn't open $file2\n";
+    @lines2 = grep { ! /$skip/ } <FILE2>;
+    close(FILE2);
+
+    if (scalar(@lines1) != scalar(@lines2)) { die "FAIL: $desc of resumed run has a different number of lines\n"; }
+    for ($i = 0; $i < scalar(@lines1); $i++) {
+	if ($lines1[$i] ne $lines2[$i]) { die "FAIL: $desc of resumed run differs at line:\n$lines1[$i]$lines2[$i]"; }
+    }
+    1;
+}
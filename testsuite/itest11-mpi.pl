@@ -0,0 +1,104 @@
+#! /usr/bin/perl
+
+# Test that MPI cmsearch finds the same hits as a serial search, on a
+# target database with sequences of very different lengths, so that
+# the master splits blocks and workers donate sequences in the tail
+# of each query's search.
+#
+# The test is skipped (and passes) if cmsearch wasn't built with MPI
+# or mpirun isn't in the PATH.
+#
+# Usage:   ./itest11-mpi.pl <builddir> <srcdir> <tmpfile prefix>
+# Example: ./itest11-mpi.pl ..         ..       tmpfoo
+
+BEGIN {
+    $builddir  = shift;
+    $srcdir    = shift;
+    $tmppfx    = shift;
+}
+use lib "$srcdir/testsuite";  # The BEGIN is necessary to make this work: sets $srcdir at compile-time
+use i1;
+
+$verbose = 0;
+$nproc   = 4;   # 1 master and 3 workers
+
+# The test makes use of the following files:
+#
+# tRNA.c.cm        <cm>       calibrated tRNA model
+# Vault.c.cm       <cm>       calibrated Vault model
+# 100k-4.fa        <seqfile>  40 100 Kb sequences with embedded hits
+# 10k-4.fa         <seqfile>  40  10 Kb sequences with embedded hits
+# 1k-4.fa          <seqfile>  40   1 Kb sequences with embedded hits
+# emitted-tRNA.fa  <seqfile>   3 tRNA sequences
+# mito-ascaris.fa  <seqfile>   1 14 Kb mitochondrial genome
+#
+# It creates the following files:
+# $tmppfx.cm         <cm>       tRNA and Vault models
+# $tmppfx.fa         <seqfile>  first 4 seqs of 100k-4.fa, and all seqs in the other seqfiles
+# $tmppfx.fa.ssi     <ssi>      SSI index of $tmppfx.fa, MPI cmsearch requires it
+# $tmppfx.tbl{1,2}   <output>   tabular output of serial (1) and MPI (2) searches
+
+if (! -x "$builddir/src/cmsearch")              { die "FAIL: didn't find cmsearch executable in $builddir/src\n"; }
+if (! -x "$builddir/easel/miniapps/esl-sfetch") { die "FAIL: didn't find esl-sfetch executable in $builddir/easel/miniapps\n"; }
+foreach $file ("tRNA.c.cm", "Vault.c.cm", "100k-4.fa", "10k-4.fa", "1k-4.fa", "emitted-tRNA.fa", "mito-ascaris.fa") {
+    if (! -r "$srcdir/testsuite/$file") { die "FAIL: can't read $file in $srcdir/testsuite\n"; }
+}
+
+$output = `$builddir/src/cmsearch -h 2>&1`;
+if ($output !~ /--mpi/) { print "ok (skipped, cmsearch wasn't built with MPI)\n"; exit 0; }
+$mpirun = `which mpirun 2>/dev/null`;
+chomp $mpirun;
+if ($mpirun eq "")      { print "ok (skipped, mpirun not found)\n"; exit 0; }
+# Open MPI won't start more processes than there are cores unless asked to
+$output = `$mpirun --version 2>&1`;
+$mpiopts = ($output =~ /Open MPI/) ? "--oversubscribe -np $nproc" : "-np $nproc";
+
+# Create the CM file and the target database
+`cat $srcdir/testsuite/tRNA.c.cm $srcdir/testsuite/Vault.c.cm > $tmppfx.cm`;  if ($?) { die "FAIL: cat\n"; }
+open(IN,  "$srcdir/testsuite/100k-4.fa") || die "FAIL: couldn't open 100k-4.fa\n";
+open(OUT, ">$tmppfx.fa")                  || die "FAIL: couldn't open $tmppfx.fa\n";
+$nseq = 0;
+while ($line = <IN>) {
+    if ($line =~ /^>/) { $nseq++; }
+    if ($nseq > 4)     { last; }
+    print OUT $line;
+}
+close(IN);
+close(OUT);
+`cat $srcdir/testsuite/10k-4.fa $srcdir/testsuite/emitted-tRNA.fa $srcdir/testsuite/1k-4.fa $srcdir/testsuite/mito-ascaris.fa >> $tmppfx.fa`;  if ($?) { die "FAIL: cat\n"; }
+if (-e "$tmppfx.fa.ssi") { unlink "$tmppfx.fa.ssi"; }
+`$builddir/easel/miniapps/esl-sfetch --index $tmppfx.fa`;  if ($?) { die "FAIL: esl-sfetch --index\n"; }
+
+# serial search
+$output = `$builddir/src/cmsearch --cpu 0 --tblout $tmppfx.tbl1 $tmppfx.cm $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: cmsearch failed\n"; }
+
+# MPI search
+$output = `$mpirun $mpiopts $builddir/src/cmsearch --mpi --tblout $tmppfx.tbl2 $tmppfx.cm $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: mpirun cmsearch --mpi failed\n"; }
+
+# Same hits, in the same order, with the same scores and E-values
+&i1::ParseTblFormat1("$tmppfx.tbl1");
+$ntbl1 = $i1::ntbl;
+if ($ntbl1 == 0) { die "FAIL: serial cmsearch found no hits\n"; }
+@hits1 = ();
+for ($i = 0; $i < $ntbl1; $i++) {
+    push(@hits1, join(" ", $i1::tname[$i], $i1::qname[$i], $i1::mfrom[$i], $i1::mto[$i], $i1::sfrom[$i], $i1::sto[$i], $i1::strand[$i],
+		      $i1::trunc[$i], $i1::pass[$i], $i1::hitsc[$i], $i1::hitE[$i], $i1::inc[$i]));
+}
+&i1::ParseTblFormat1("$tmppfx.tbl2");
+if ($i1::ntbl != $ntbl1) { die "FAIL: MPI cmsearch found $i1::ntbl hits, serial cmsearch found $ntbl1\n"; }
+for ($i = 0; $i < $ntbl1; $i++) {
+    $hit2 = join(" ", $i1::tname[$i], $i1::qname[$i], $i1::mfrom[$i], $i1::mto[$i], $i1::sfrom[$i], $i1::sto[$i], $i1::strand[$i],
+		 $i1::trunc[$i], $i1::pass[$i], $i1::hitsc[$i], $i1::hitE[$i], $i1::inc[$i]);
+    if ($hit2 ne $hits1[$i]) { die "FAIL: hit " . ($i+1) . " differs between serial and MPI cmsearch:\n$hits1[$i]\n$hit2\n"; }
+}
+if ($verbose) { print "$ntbl1 hits identical\n"; }
+
+print "ok\n";
+unlink "$tmppfx.cm";
+unlink "$tmppfx.fa";
+unlink "$tmppfx.fa.ssi";
+unlink "$tmppfx.tbl1";
+unlink "$tmppfx.tbl2";
+exit 0;
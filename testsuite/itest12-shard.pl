@@ -0,0 +1,85 @@
+#! /usr/bin/perl
+
+# Test that searching a target database in shards (--shard, with
+# --hitsout) and merging the shards' hit lists (--merge) gives the
+# same hits, scores and E-values as searching the whole database
+# at once.
+#
+# Usage:   ./itest12-shard.pl <builddir> <srcdir> <tmpfile prefix>
+# Example: ./itest12-shard.pl ..         ..       tmpfoo
+
+BEGIN {
+    $builddir  = shift;
+    $srcdir    = shift;
+    $tmppfx    = shift;
+}
+use lib "$srcdir/testsuite";  # The BEGIN is necessary to make this work: sets $srcdir at compile-time
+use i1;
+
+$verbose = 0;
+$nshards = 3;
+
+# The test makes use of the following files:
+#
+# 4.c.cm       <cm>       4 calibrated models: tRNA, Vault, snR75, Plant_SRP
+# 10k-4.fa     <seqfile>  40 10 Kb sequences with embedded hits to the 4 models
+#
+# It creates the following files:
+# $tmppfx.cm               <cm>       copy of 4.c.cm
+# $tmppfx.fa               <seqfile>  copy of 10k-4.fa
+# $tmppfx.fa.ssi           <ssi>      SSI index of $tmppfx.fa, --shard requires it
+# $tmppfx.hits{1..3}       <hits>     --hitsout files of each shard's search
+# $tmppfx.tbl{1,2}         <output>   tabular output of the single (1) and merged (2) searches
+
+if (! -x "$builddir/src/cmsearch")              { die "FAIL: didn't find cmsearch executable in $builddir/src\n"; }
+if (! -x "$builddir/easel/miniapps/esl-sfetch") { die "FAIL: didn't find esl-sfetch executable in $builddir/easel/miniapps\n"; }
+foreach $file ("4.c.cm", "10k-4.fa") { if (! -r "$srcdir/testsuite/$file") { die "FAIL: can't read $file in $srcdir/testsuite\n"; } }
+
+`cat $srcdir/testsuite/4.c.cm   > $tmppfx.cm`;  if ($?) { die "FAIL: cat\n"; }
+`cat $srcdir/testsuite/10k-4.fa > $tmppfx.fa`;  if ($?) { die "FAIL: cat\n"; }
+if (-e "$tmppfx.fa.ssi") { unlink "$tmppfx.fa.ssi"; }
+`$builddir/easel/miniapps/esl-sfetch --index $tmppfx.fa`;  if ($?) { die "FAIL: esl-sfetch --index\n"; }
+
+# search of the whole database
+$output = `$builddir/src/cmsearch --tblout $tmppfx.tbl1 $tmppfx.cm $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: cmsearch failed\n"; }
+
+# search of each shard, then merge; the shards are merged out of
+# order, which mustn't matter
+$hitsfiles = "";
+for ($i = 1; $i <= $nshards; $i++) {
+    $output = `$builddir/src/cmsearch --shard $i/$nshards --hitsout $tmppfx.hits$i $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? != 0) { die "FAIL: cmsearch --shard $i/$nshards failed\n"; }
+    $hitsfiles = "$tmppfx.hits$i " . $hitsfiles;
+}
+$output = `$builddir/src/cmsearch --merge --tblout $tmppfx.tbl2 $tmppfx.cm $hitsfiles 2>&1`;
+if ($? != 0) { die "FAIL: cmsearch --merge failed\n"; }
+
+# Same hits, in the same order, with the same scores and E-values
+# (E-values depend on the database size Z, which the merge must
+# take from the whole database, not from one shard)
+&i1::ParseTblFormat1("$tmppfx.tbl1");
+$ntbl1 = $i1::ntbl;
+if ($ntbl1 == 0) { die "FAIL: cmsearch found no hits\n"; }
+@hits1 = ();
+for ($i = 0; $i < $ntbl1; $i++) {
+    push(@hits1, join(" ", $i1::tname[$i], $i1::qname[$i], $i1::mfrom[$i], $i1::mto[$i], $i1::sfrom[$i], $i1::sto[$i], $i1::strand[$i],
+		      $i1::trunc[$i], $i1::pass[$i], $i1::hitsc[$i], $i1::hitE[$i], $i1::inc[$i]));
+}
+&i1::ParseTblFormat1("$tmppfx.tbl2");
+if ($i1::ntbl != $ntbl1) { die "FAIL: merged sharded searches found $i1::ntbl hits, single search found $ntbl1\n"; }
+for ($i = 0; $i < $ntbl1; $i++) {
+    $hit2 = join(" ", $i1::tname[$i], $i1::qname[$i], $i1::mfrom[$i], $i1::mto[$i], $i1::sfrom[$i], $i1::sto[$i], $i1::strand[$i],
+		 $i1::trunc[$i], $i1::pass[$i], $i1::hitsc[$i], $i1::hitE[$i], $i1::inc[$i]);
+    if ($hit2 ne $hits1[$i]) { die "FAIL: hit " . ($i+1) . " differs between single and merged sharded searches:\n$hits1[$i]\n$hit2\n"; }
+}
+if ($verbose) { print "$ntbl1 hits identical\n"; }
+
+print "ok\n";
+unlink "$tmppfx.cm";
+unlink "$tmppfx.fa";
+unlink "$tmppfx.fa.ssi";
+for ($i = 1; $i <= $nshards; $i++) { unlink "$tmppfx.hits$i"; }
+unlink "$tmppfx.tbl1";
+unlink "$tmppfx.tbl2";
+exit 0;
@@ -0,0 +1,72 @@
+#! /usr/bin/perl
+
+# Test that HMM-only searches (--hmmonly) reuse the Forward parses
+# of the HMM filter in envelope definition and still find hits, for
+# both cmsearch and cmscan. Built with eslDEBUGLEVEL >= 1, the
+# pipeline also recomputes every reused parse and fails if the two
+# differ, so this test then checks the parses themselves.
+#
+# Usage:   ./itest13-hmmonly-reuse.pl <builddir> <srcdir> <tmpfile prefix>
+# Example: ./itest13-hmmonly-reuse.pl ..         ..       tmpfoo
+
+BEGIN {
+    $builddir  = shift;
+    $srcdir    = shift;
+    $tmppfx    = shift;
+}
+use lib "$srcdir/testsuite";  # The BEGIN is necessary to make this work: sets $srcdir at compile-time
+use i1;
+
+$verbose = 0;
+
+# The test makes use of the following files:
+#
+# 4.c.cm       <cm>       4 calibrated models: tRNA, Vault, snR75, Plant_SRP
+# 10k-4.fa     <seqfile>  40 10 Kb sequences with embedded hits to the 4 models
+#
+# It creates the following files:
+# $tmppfx.cm               <cm>       copy of 4.c.cm, cmpress'd for cmscan
+# $tmppfx.fa               <seqfile>  copy of 10k-4.fa
+# $tmppfx.cm{search,scan}  <output>   tabular output
+
+@i1progs = ("cmpress", "cmsearch", "cmscan");
+foreach $i1prog (@i1progs) { if (! -x "$builddir/src/$i1prog") { die "FAIL: didn't find $i1prog executable in $builddir/src\n"; } }
+foreach $file ("4.c.cm", "10k-4.fa") { if (! -r "$srcdir/testsuite/$file") { die "FAIL: can't read $file in $srcdir/testsuite\n"; } }
+
+`cat $srcdir/testsuite/4.c.cm   > $tmppfx.cm`;  if ($?) { die "FAIL: cat\n"; }
+`cat $srcdir/testsuite/10k-4.fa > $tmppfx.fa`;  if ($?) { die "FAIL: cat\n"; }
+foreach $sfx ("i1m", "i1i", "i1f", "i1p") { if (-e "$tmppfx.cm.$sfx") { unlink "$tmppfx.cm.$sfx"; } }
+`$builddir/src/cmpress $tmppfx.cm`;  if ($?) { die "FAIL: cmpress\n"; }
+
+foreach $prog ("cmsearch", "cmscan") {
+    $output = `$builddir/src/$prog --hmmonly --verbose --tblout $tmppfx.$prog $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? != 0) { die "FAIL: $prog --hmmonly failed\n$output"; }
+    $nreuse = &count_reuse($output);
+    if ($nreuse <  0) { die "FAIL: $prog --hmmonly --verbose didn't report Forward parse reuse\n"; }
+    if ($nreuse == 0) { die "FAIL: $prog --hmmonly reused no Forward parses\n"; }
+
+    &i1::ParseTblFormat1("$tmppfx.$prog");
+    if ($i1::ntbl == 0) { die "FAIL: $prog --hmmonly found no hits\n"; }
+    if ($verbose) { print "$prog: $i1::ntbl hits, $nreuse Forward parses reused\n"; }
+}
+
+print "ok\n";
+unlink "$tmppfx.cm";
+foreach $sfx ("i1m", "i1i", "i1f", "i1p") { unlink "$tmppfx.cm.$sfx"; }
+unlink "$tmppfx.fa";
+foreach $prog ("cmsearch", "cmscan") { unlink "$tmppfx.$prog"; }
+exit 0;
+
+# count_reuse(): total number of windows with a reused Forward
+# parse in --verbose output <$output>, summed over all the
+# statistics summaries in it (cmscan prints one per query); -1 if
+# there are none.
+sub count_reuse {
+    my ($output) = @_;
+    my $nreuse = -1;
+    while ($output =~ /Windows with Forward parse reused:\s+(\d+)/g) {
+	if ($nreuse < 0) { $nreuse = 0; }
+	$nreuse += $1;
+    }
+    return $nreuse;
+}
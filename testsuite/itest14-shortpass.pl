@@ -0,0 +1,150 @@
+#! /usr/bin/perl
+
+# Tests of the --shortpass option of cmsearch and cmscan on short
+# reads: hits found without it must still be found with it, both
+# full-length hits and hits truncated at a read end, and the option
+# must be rejected with -g and with --hmmonly.
+#
+# Usage:   ./itest14-shortpass.pl <builddir> <srcdir> <tmpfile prefix>
+# Example: ./itest14-shortpass.pl ..         ..       tmpfoo
+
+BEGIN {
+    $builddir  = shift;
+    $srcdir    = shift;
+    $tmppfx    = shift;
+}
+use lib "$srcdir/testsuite";  # The BEGIN is necessary to make this work: sets $srcdir at compile-time
+use i1;
+
+$verbose = 0;
+
+# The test makes use of the following files:
+#
+# tRNA.c.cm               <cm>       calibrated tRNA model, built from tRNA.sto (W = 218)
+# emitted-tRNA.fa         <seqfile>  3 sequences emitted from tRNA.c.cm
+#
+# It creates the following files:
+# $tmppfx.cm            <cm>       copy of tRNA.c.cm, cmpress'd for cmscan
+# $tmppfx.fa            <seqfile>  9 150 nt reads, 3 per emitted tRNA:
+#                                  full.<n>: whole tRNA embedded in random flanks
+#                                  t5.<n>:   tRNA missing its first 25 nt, at the read's start
+#                                  t3.<n>:   first 45 nt of the tRNA, at the read's end
+# $tmppfx.tbl{1,2}      <output>   tabular output without (1) and with (2) --shortpass
+
+$model   = "tRNA";
+$readlen = 150;
+
+@i1progs  =  ("cmpress", "cmsearch", "cmscan");
+foreach $i1prog  (@i1progs)  { if (! -x "$builddir/src/$i1prog")            { die "FAIL: didn't find $i1prog executable in $builddir/src\n"; } }
+if (! -r "$srcdir/testsuite/$model.c.cm")      { die "FAIL: can't read profile $model.c.cm in $srcdir/testsuite\n"; }
+if (! -r "$srcdir/testsuite/emitted-$model.fa") { die "FAIL: can't read emitted-$model.fa in $srcdir/testsuite\n"; }
+
+# Create the test CM file
+`cat $srcdir/testsuite/$model.c.cm > $tmppfx.cm`;  if ($?) { die "FAIL: cat\n"; }
+foreach $sfx ("i1m", "i1i", "i1f", "i1p", "ssi") { if (-e "$tmppfx.cm.$sfx") { unlink "$tmppfx.cm.$sfx"; } }
+`$builddir/src/cmpress $tmppfx.cm`;  if ($?) { die "FAIL: cmpress\n"; }
+
+# Cut the reads. Flanks come from a fixed linear congruential
+# generator so the reads are the same on every platform.
+@trna = &read_fasta("$srcdir/testsuite/emitted-$model.fa");
+if (scalar(@trna) != 3) { die "FAIL: expected 3 sequences in emitted-$model.fa\n"; }
+$lcg = 7;
+open(FA, ">$tmppfx.fa") || die "FAIL: can't open $tmppfx.fa for writing\n";
+for ($n = 1; $n <= scalar(@trna); $n++) {
+    $t = $trna[$n-1];
+    $s = &flank(40) . $t;
+    printf FA (">full.$n\n%s\n", $s . &flank($readlen - length($s)));
+    $s = substr($t, 25);
+    printf FA (">t5.$n\n%s\n",   $s . &flank($readlen - length($s)));
+    $s = substr($t, 0, 45);
+    printf FA (">t3.$n\n%s\n",   &flank($readlen - length($s)) . $s);
+}
+close(FA);
+
+foreach $prog ("cmsearch", "cmscan") {
+    # default
+    $output = `$builddir/src/$prog --tblout $tmppfx.tbl1 $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? != 0) { die "FAIL: $prog failed\n"; }
+    &i1::ParseTblFormat1("$tmppfx.tbl1");
+    $ntbl1 = $i1::ntbl;
+    %hit1 = ();
+    $ntrunc1 = 0;
+    for ($i = 0; $i < $ntbl1; $i++) {
+	$sqname = ($prog eq "cmsearch") ? $i1::tname[$i] : $i1::qname[$i];
+	if (! exists $hit1{$sqname}) { $hit1{$sqname} = "$i1::sfrom[$i] $i1::sto[$i] $i1::strand[$i]"; }
+	if ($sqname =~ /^t[53]\./ && $i1::trunc[$i] ne "no") { $ntrunc1++; }
+    }
+    for ($n = 1; $n <= scalar(@trna); $n++) {
+	if (! exists $hit1{"full.$n"}) { die "FAIL: $prog, no hit to read full.$n\n"; }
+    }
+    if ($ntrunc1 == 0) { die "FAIL: $prog, no truncated hit to any end-truncated read\n"; }
+
+    # --shortpass; every read is shorter than W, so all of them are
+    # searched in the short-sequence pass
+    $output = `$builddir/src/$prog --shortpass --verbose --tblout $tmppfx.tbl2 $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? != 0) { die "FAIL: $prog --shortpass failed\n"; }
+    if ($output !~ /sequences? searched in short-sequence pass:\s+(\d+)/) { die "FAIL: $prog --shortpass --verbose didn't report the short-sequence pass\n"; }
+    if ($1 == 0)                                                           { die "FAIL: $prog --shortpass searched no sequences in the short-sequence pass\n"; }
+
+    # every read with a hit without --shortpass must have an
+    # overlapping hit on the same strand with it
+    &i1::ParseTblFormat1("$tmppfx.tbl2");
+    foreach $sqname (sort keys %hit1) {
+	($from1, $to1, $strand1) = split(" ", $hit1{$sqname});
+	$found = 0;
+	for ($i = 0; $i < $i1::ntbl; $i++) {
+	    if ((($prog eq "cmsearch") ? $i1::tname[$i] : $i1::qname[$i]) ne $sqname) { next; }
+	    if ($i1::strand[$i] ne $strand1) { next; }
+	    if (&overlap($from1, $to1, $i1::sfrom[$i], $i1::sto[$i])) { $found = 1; last; }
+	}
+	if (! $found) { die "FAIL: $prog --shortpass, hit to $sqname ($from1..$to1 $strand1) not found\n"; }
+    }
+    if ($verbose) { printf("$prog: %d hits without --shortpass, %d with it, all found\n", $ntbl1, $i1::ntbl); }
+
+    # --shortpass is incompatible with -g and --hmmonly
+    $output = `$builddir/src/$prog --shortpass -g $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? == 0) { die "FAIL: $prog --shortpass -g didn't fail\n"; }
+    $output = `$builddir/src/$prog --shortpass --hmmonly $tmppfx.cm $tmppfx.fa 2>&1`;
+    if ($? == 0) { die "FAIL: $prog --shortpass --hmmonly didn't fail\n"; }
+}
+
+print "ok\n";
+unlink <$tmppfx.cm*>;
+unlink "$tmppfx.fa";
+unlink "$tmppfx.tbl1";
+unlink "$tmppfx.tbl2";
+exit 0;
+
+# read_fasta(): return the sequences in FASTA file <$file>.
+sub read_fasta {
+    my ($file) = @_;
+    my @seqs = ();
+    open(IN, $file) || die "FAIL: can't open $file\n";
+    while (<IN>) {
+	chomp;
+	if    (/^>/)        { push(@seqs, ""); }
+	elsif (scalar(@seqs)) { $seqs[-1] .= $_; }
+    }
+    close(IN);
+    return @seqs;
+}
+
+# flank(): return <$len> random RNA residues.
+sub flank {
+    my ($len) = @_;
+    my $s = "";
+    for (my $i = 0; $i < $len; $i++) {
+	$lcg = ($lcg * 1103515245 + 12345) % 2147483648;
+	$s  .= substr("ACGU", ($lcg >> 16) % 4, 1);
+    }
+    return $s;
+}
+
+# overlap(): TRUE if <$from1>..<$to1> and <$from2>..<$to2> overlap,
+# either coordinate order (minus strand hits have from > to).
+sub overlap {
+    my ($from1, $to1, $from2, $to2) = @_;
+    if ($from1 > $to1) { ($from1, $to1) = ($to1, $from1); }
+    if ($from2 > $to2) { ($from2, $to2) = ($to2, $from2); }
+    return ($from1 <= $to2 && $from2 <= $to1) ? 1 : 0;
+}